@@ -52,6 +52,17 @@ int main(int argc, char **argv)
             pid = args.at(0).section(QLatin1Char(':'), 1).toInt();
             args.removeFirst();
         }
+        // number of parallel processes for a segmented render, and ffmpeg path to join the segments
+        int segments = 1;
+        QString ffmpeg;
+        while (args.count() > 0 && (args.at(0).startsWith(QLatin1String("-segments:")) || args.at(0).startsWith(QLatin1String("-ffmpeg:")))) {
+            if (args.at(0).startsWith(QLatin1String("-segments:"))) {
+                segments = args.at(0).section(QLatin1Char(':'), 1).toInt();
+            } else {
+                ffmpeg = args.at(0).mid(8);
+            }
+            args.removeFirst();
+        }
         // Do we want a split render
         if (args.count() > 0 && args.at(0) == QLatin1String("-split")) {
             args.removeFirst();
@@ -140,6 +151,9 @@ int main(int argc, char **argv)
         }
 
         auto *rJob = new RenderJob(render, playlist, target, pid, in, out, qApp);
+        if (segments > 1) {
+            rJob->setSegments(segments, ffmpeg);
+        }
         rJob->start();
         QObject::connect(rJob, &RenderJob::renderingFinished, [&, rJob]() {
             rJob->deleteLater();
@@ -149,11 +163,13 @@ int main(int argc, char **argv)
     } else {
         fprintf(stderr,
                 "Kdenlive video renderer for MLT.\nUsage: "
-                "kdenlive_render [-erase] [-kuiserver] [-locale:LOCALE] [in=pos] [out=pos] [render] [profile] [rendermodule] [player] [src] [dest] [[arg1] "
+                "kdenlive_render [-erase] [-kuiserver] [-locale:LOCALE] [-segments:N] [-ffmpeg:PATH] [in=pos] [out=pos] [render] [profile] [rendermodule] [player] [src] [dest] [[arg1] "
                 "[arg2] ...]\n"
                 "  -erase: if that parameter is present, src file will be erased at the end\n"
                 "  -kuiserver: if that parameter is present, use KDE job tracker\n"
                 "  -locale:LOCALE : set a locale for rendering. For example, -locale:fr_FR.UTF-8 will use a french locale (comma as numeric separator)\n"
+                "  -segments:N : render the video in N parallel processes, joined without re-encoding\n"
+                "  -ffmpeg:PATH : path to ffmpeg, used to join the segments\n"
                 "  in=pos: start rendering at frame pos\n"
                 "  out=pos: end rendering at frame pos\n"
                 "  render: path to MLT melt renderer\n"
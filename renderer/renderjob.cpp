@@ -18,13 +18,24 @@
  ***************************************************************************/
 
 #include "renderjob.h"
+#include "segmentplanner.hpp"
 
+#include <QDomDocument>
 #include <QFile>
+#include <QRegularExpression>
 #include <QStringList>
 #include <QThread>
 #include <QtDBus>
 #include <QElapsedTimer>
 #include <utility>
+
+namespace {
+// Shortest segment worth a process of its own, shorter zones are not split
+const int minimumSegmentFrames = 250;
+// Audio is rendered in its own process, it only costs a fraction of the video encoding
+const int audioCostDivider = 8;
+} // namespace
+
 // Can't believe I need to do this to sleep.
 class SleepThread : QThread
 {
@@ -49,6 +60,10 @@ RenderJob::RenderJob(const QString &render, const QString &scenelist, const QStr
     , m_frame(0)
     , m_pid(pid)
     , m_dualpass(false)
+    , m_segmentCount(1)
+    , m_runningSegments(0)
+    , m_expectedFrames(0)
+    , m_ffmpegProcess(nullptr)
 {
     m_renderProcess = new QProcess;
     m_renderProcess->setReadChannel(QProcess::StandardError);
@@ -85,6 +100,12 @@ void RenderJob::setLocale(const QString &locale)
     qputenv("LC_NUMERIC", locale.toUtf8().constData());
 }
 
+void RenderJob::setSegments(int segments, const QString &ffmpeg)
+{
+    m_segmentCount = qMax(1, segments);
+    m_ffmpeg = ffmpeg.isEmpty() ? QStringLiteral("ffmpeg") : ffmpeg;
+}
+
 void RenderJob::slotAbort(const QString &url)
 {
     if (m_dest == url) {
@@ -96,6 +117,13 @@ void RenderJob::slotAbort()
 {
     qWarning() << "Job aborted by user...";
     m_renderProcess->kill();
+    for (const Segment &segment : m_segments) {
+        segment.process->kill();
+    }
+    if (m_ffmpegProcess) {
+        m_ffmpegProcess->kill();
+    }
+    m_segmentDir.reset();
 
     if (m_kdenliveinterface) {
         m_dbusargs[1] = -3;
@@ -132,29 +160,31 @@ void RenderJob::receivedStderr()
         } else if (m_args.contains(QStringLiteral("pass=2"))) {
             m_progress = 50 + m_progress / 2.0;
         }
-        int frame = result.section(QLatin1Char(','), 1).section(QLatin1Char(' '), -1).toInt();
-        if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
-            m_dbusargs[1] = m_progress;
-            m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), m_dbusargs);
+        m_frame = result.section(QLatin1Char(','), 1).section(QLatin1Char(' '), -1).toInt();
+        sendProgress();
+    }
+}
+
+void RenderJob::sendProgress()
+{
+    if ((m_kdenliveinterface != nullptr) && m_kdenliveinterface->isValid()) {
+        m_dbusargs[1] = m_progress;
+        m_kdenliveinterface->callWithArgumentList(QDBus::NoBlock, QStringLiteral("setRenderingProgress"), m_dbusargs);
+    }
+    if (m_jobUiserver && m_progress > 0) {
+        m_jobUiserver->call(QStringLiteral("setPercent"), (uint)m_progress);
+        int seconds = m_startTime.secsTo(QTime::currentTime());
+        if (seconds < 0) {
+            // 1 day offset, add seconds in a day
+            seconds += 86400;
         }
-        if (m_jobUiserver) {
-            m_jobUiserver->call(QStringLiteral("setPercent"), (uint)m_progress);
-            int seconds = m_startTime.secsTo(QTime::currentTime());
-            if (seconds < 0) {
-                // 1 day offset, add seconds in a day
-                seconds += 86400;
-            }
-            seconds = (int)(seconds * (100 - m_progress) / m_progress);
-            if (seconds == m_seconds) {
-                return;
-            }
-            m_jobUiserver->call(QStringLiteral("setDescriptionField"), (uint)0, QString(),
-                                tr("Remaining time: ") + QTime(0, 0, 0).addSecs(seconds).toString(QStringLiteral("hh:mm:ss")));
-            // m_jobUiserver->call(QStringLiteral("setSpeed"), (frame - m_frame) / (seconds - m_seconds));
-            // m_jobUiserver->call("setSpeed", (frame - m_frame) / (seconds - m_seconds));
-            m_frame = frame;
-            m_seconds = seconds;
+        seconds = (int)(seconds * (100 - m_progress) / m_progress);
+        if (seconds == m_seconds) {
+            return;
         }
+        m_jobUiserver->call(QStringLiteral("setDescriptionField"), (uint)0, QString(),
+                            tr("Remaining time: ") + QTime(0, 0, 0).addSecs(seconds).toString(QStringLiteral("hh:mm:ss")));
+        m_seconds = seconds;
     }
 }
 
@@ -207,6 +237,11 @@ void RenderJob::start()
         slotIsOver(QProcess::NormalExit, false);
     }*/
 
+    if (m_segmentCount > 1 && prepareSegments()) {
+        startSegments();
+        return;
+    }
+
     // Because of the logging, we connect to stderr in all cases.
     connect(m_renderProcess, &QProcess::readyReadStandardError, this, &RenderJob::receivedStderr);
     m_renderProcess->start(m_prog, m_args);
@@ -314,3 +349,252 @@ void RenderJob::slotIsOver(QProcess::ExitStatus status, bool isWritable)
     }
     emit renderingFinished();
 }
+
+bool RenderJob::prepareSegments()
+{
+    // Playlists using the multi consumer are passed as xml:path?multi=1
+    const QString playlistFile = m_scenelist.startsWith(QLatin1String("xml:")) ? m_scenelist.mid(4).section(QLatin1Char('?'), 0, -2) : m_scenelist;
+    QFile file(playlistFile);
+    QDomDocument doc;
+    if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file, false)) {
+        return false;
+    }
+    file.close();
+    QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    if (consumer.isNull() || consumer.attribute(QStringLiteral("mlt_service")) != QLatin1String("avformat") || !consumer.hasAttribute(QStringLiteral("in")) ||
+        !consumer.hasAttribute(QStringLiteral("out")) || consumer.hasAttribute(QStringLiteral("pass")) ||
+        consumer.attribute(QStringLiteral("x265-params")).contains(QLatin1String("pass=")) || consumer.hasAttribute(QStringLiteral("glsl.")) ||
+        consumer.attribute(QStringLiteral("vn")) == QLatin1String("1") || consumer.attribute(QStringLiteral("target")).contains(QLatin1Char('%'))) {
+        // Two pass, movit, audio only and image sequence renders need a single process
+        m_logstream << "Playlist cannot be rendered in segments, using a single process" << "\n";
+        return false;
+    }
+    const int in = consumer.attribute(QStringLiteral("in")).toInt();
+    const int out = consumer.attribute(QStringLiteral("out")).toInt();
+    const QVector<QPair<int, int>> ranges = SegmentPlanner::plan(in, out, m_segmentCount, consumer.attribute(QStringLiteral("g")).toInt(), minimumSegmentFrames);
+    if (ranges.size() < 2) {
+        m_logstream << "Zone is too short to be rendered in segments, using a single process" << "\n";
+        return false;
+    }
+    // Keep the segments on the destination drive, they are as large as the result
+    m_segmentDir.reset(new QTemporaryDir(QFileInfo(m_dest).absolutePath() + QStringLiteral("/.kdenlive-segments-XXXXXX")));
+    if (!m_segmentDir->isValid()) {
+        m_segmentDir.reset();
+        return false;
+    }
+    const QString extension = QFileInfo(m_dest).suffix();
+    m_outputFormat = consumer.attribute(QStringLiteral("f"));
+    m_expectedFrames = out - in + 1;
+    // Parallelism comes from the processes, each of them uses a single worker thread
+    consumer.setAttribute(QStringLiteral("real_time"), -1);
+
+    auto addJob = [&](const QString &name, int cost) {
+        const QString path = m_segmentDir->filePath(name + QStringLiteral(".mlt"));
+        QFile playlist(path);
+        if (!playlist.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            return false;
+        }
+        playlist.write(doc.toString().toUtf8());
+        playlist.close();
+        auto *process = new QProcess(this);
+        process->setReadChannel(QProcess::StandardError);
+        Segment segment{process, {QStringLiteral("-progress"), QString(m_scenelist).replace(playlistFile, path)}, cost, 0};
+        m_segments.append(segment);
+        return true;
+    };
+
+    if (consumer.attribute(QStringLiteral("an")) != QLatin1String("1")) {
+        // Audio encoders add priming samples at the start of each stream, so audio is rendered in one piece
+        m_audioFile = m_segmentDir->filePath(QStringLiteral("audio.mka"));
+        consumer.setAttribute(QStringLiteral("target"), m_audioFile);
+        consumer.setAttribute(QStringLiteral("f"), QStringLiteral("matroska"));
+        consumer.setAttribute(QStringLiteral("vn"), 1);
+        if (!addJob(QStringLiteral("audio"), qMax(1, m_expectedFrames / audioCostDivider))) {
+            m_segmentDir.reset();
+            return false;
+        }
+        consumer.removeAttribute(QStringLiteral("vn"));
+        if (!m_outputFormat.isEmpty()) {
+            consumer.setAttribute(QStringLiteral("f"), m_outputFormat);
+        } else {
+            consumer.removeAttribute(QStringLiteral("f"));
+        }
+    }
+    consumer.setAttribute(QStringLiteral("an"), 1);
+    for (int i = 0; i < ranges.size(); ++i) {
+        const QString name = QStringLiteral("segment%1").arg(i, 4, 10, QLatin1Char('0'));
+        const QString target = m_segmentDir->filePath(extension.isEmpty() ? name : name + QLatin1Char('.') + extension);
+        consumer.setAttribute(QStringLiteral("target"), target);
+        consumer.setAttribute(QStringLiteral("in"), ranges.at(i).first);
+        consumer.setAttribute(QStringLiteral("out"), ranges.at(i).second);
+        if (!addJob(name, ranges.at(i).second - ranges.at(i).first + 1)) {
+            m_segmentDir.reset();
+            return false;
+        }
+        m_segmentFiles << target;
+    }
+    m_logstream << "Rendering " << m_expectedFrames << " frames in " << ranges.size() << " segments" << "\n";
+    return true;
+}
+
+void RenderJob::startSegments()
+{
+    m_runningSegments = m_segments.size();
+    for (int i = 0; i < m_segments.size(); ++i) {
+        QProcess *process = m_segments.at(i).process;
+        connect(process, &QProcess::readyReadStandardError, this, [this, i]() { receivedSegmentStderr(i); });
+        connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+                [this, i](int exitCode, QProcess::ExitStatus status) { slotSegmentOver(i, exitCode, status); });
+        connect(process, &QProcess::errorOccurred, this, [this, i](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                slotSegmentOver(i, -1, QProcess::CrashExit);
+            }
+        });
+        process->start(m_prog, m_segments.at(i).args);
+        m_logstream << "Started segment render process: " << m_prog << ' ' << m_segments.at(i).args.join(QLatin1Char(' ')) << "\n";
+    }
+    m_logstream.flush();
+}
+
+void RenderJob::receivedSegmentStderr(int index)
+{
+    Segment &segment = m_segments[index];
+    QString result = QString::fromLocal8Bit(segment.process->readAllStandardError()).simplified();
+    if (!result.startsWith(QLatin1String("Current Frame"))) {
+        m_errorMessage.append(result + QStringLiteral("<br>"));
+        return;
+    }
+    int pro = result.section(QLatin1Char(' '), -1).toInt();
+    if (pro <= segment.progress || pro > 100) {
+        return;
+    }
+    segment.progress = pro;
+    qint64 done = 0;
+    qint64 total = 0;
+    for (const Segment &s : m_segments) {
+        done += qint64(s.cost) * s.progress;
+        total += s.cost;
+    }
+    // Keep the last percent for the concatenation
+    const int progress = int(done * 99 / (total * 100));
+    if (progress <= m_progress) {
+        return;
+    }
+    m_progress = progress;
+    sendProgress();
+}
+
+void RenderJob::slotSegmentOver(int index, int exitCode, QProcess::ExitStatus status)
+{
+    if (m_runningSegments == 0) {
+        // Another segment already failed
+        return;
+    }
+    if (status == QProcess::CrashExit || exitCode != 0) {
+        m_runningSegments = 0;
+        m_logstream << "Segment render process " << m_segments.at(index).args.join(QLatin1Char(' ')) << " failed" << "\n";
+        for (const Segment &segment : m_segments) {
+            segment.process->kill();
+        }
+        finishSegmentedRender(false);
+        return;
+    }
+    m_segments[index].progress = 100;
+    if (--m_runningSegments == 0) {
+        concatSegments();
+    }
+}
+
+void RenderJob::runFfmpeg(const QStringList &args, const std::function<void(bool, const QString &)> &done)
+{
+    if (m_ffmpegProcess) {
+        m_ffmpegProcess->deleteLater();
+    }
+    m_ffmpegProcess = new QProcess(this);
+    QProcess *process = m_ffmpegProcess;
+    connect(process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), this,
+            [process, done](int exitCode, QProcess::ExitStatus status) {
+                done(status == QProcess::NormalExit && exitCode == 0, QString::fromLocal8Bit(process->readAllStandardError()));
+            });
+    connect(process, &QProcess::errorOccurred, this, [this, done](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            done(false, tr("Cannot start %1").arg(m_ffmpeg));
+        }
+    });
+    m_logstream << "Started process: " << m_ffmpeg << ' ' << args.join(QLatin1Char(' ')) << "\n";
+    m_logstream.flush();
+    process->start(m_ffmpeg, args);
+}
+
+void RenderJob::concatSegments()
+{
+    const QString listFile = m_segmentDir->filePath(QStringLiteral("segments.txt"));
+    QFile list(listFile);
+    if (!list.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        m_errorMessage.append(tr("Cannot write to %1").arg(listFile) + QStringLiteral("<br>"));
+        finishSegmentedRender(false);
+        return;
+    }
+    QTextStream stream(&list);
+    for (const QString &segment : qAsConst(m_segmentFiles)) {
+        // Paths are single quoted in the concat demuxer list
+        stream << "file '" << QString(segment).replace(QLatin1Char('\''), QLatin1String("'\\''")) << "'\n";
+    }
+    stream.flush();
+    list.close();
+
+    QStringList args = {QStringLiteral("-y"), QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-f"), QStringLiteral("concat"),
+                        QStringLiteral("-safe"), QStringLiteral("0"), QStringLiteral("-i"), listFile};
+    if (!m_audioFile.isEmpty()) {
+        args << QStringLiteral("-i") << m_audioFile;
+    }
+    args << QStringLiteral("-map") << QStringLiteral("0:v");
+    if (!m_audioFile.isEmpty()) {
+        args << QStringLiteral("-map") << QStringLiteral("1:a");
+    }
+    args << QStringLiteral("-c") << QStringLiteral("copy");
+    if (!m_outputFormat.isEmpty()) {
+        args << QStringLiteral("-f") << m_outputFormat;
+    }
+    args << m_dest;
+    runFfmpeg(args, [this](bool success, const QString &output) {
+        if (!success) {
+            m_errorMessage.append(output.toHtmlEscaped() + QStringLiteral("<br>"));
+            finishSegmentedRender(false);
+            return;
+        }
+        verifySegmentedRender();
+    });
+}
+
+void RenderJob::verifySegmentedRender()
+{
+    // Copying the video stream to the null muxer counts its frames without decoding them
+    const QStringList args = {QStringLiteral("-v"),   QStringLiteral("error"), QStringLiteral("-stats"), QStringLiteral("-i"), m_dest,
+                              QStringLiteral("-map"), QStringLiteral("0:v:0"), QStringLiteral("-c"),     QStringLiteral("copy"),
+                              QStringLiteral("-f"),   QStringLiteral("null"),  QStringLiteral("-")};
+    runFfmpeg(args, [this](bool success, const QString &output) {
+        int frames = -1;
+        QRegularExpressionMatchIterator it = QRegularExpression(QStringLiteral("frame=\\s*(\\d+)")).globalMatch(output);
+        while (it.hasNext()) {
+            frames = it.next().captured(1).toInt();
+        }
+        if (!success || frames != m_expectedFrames) {
+            m_errorMessage.append(tr("Segmented render produced %1 frames instead of %2.").arg(frames).arg(m_expectedFrames) + QStringLiteral("<br>"));
+            finishSegmentedRender(false);
+            return;
+        }
+        m_logstream << "Segmented render checked, " << frames << " frames" << "\n";
+        finishSegmentedRender(true);
+    });
+}
+
+void RenderJob::finishSegmentedRender(bool success)
+{
+    m_segmentDir.reset();
+    if (success) {
+        m_progress = 100;
+        sendProgress();
+    }
+    slotIsOver(success ? QProcess::NormalExit : QProcess::CrashExit);
+}
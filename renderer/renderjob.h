@@ -22,11 +22,16 @@
 
 #include <QDBusInterface>
 #include <QObject>
+#include <QPair>
 #include <QProcess>
+#include <QTemporaryDir>
 #include <QTime>
 #include <QFile>
+#include <QVector>
 // Testing
 #include <QTextStream>
+#include <functional>
+#include <memory>
 
 class RenderJob : public QObject
 {
@@ -36,6 +41,9 @@ public:
     RenderJob(const QString &render, const QString &scenelist, const QString &target, int pid = -1, int in = -1, int out = -1, QObject *parent = nullptr);
     ~RenderJob();
     void setLocale(const QString &locale);
+    /** @brief Render the video in @param segments parallel melt processes, joined with @param ffmpeg without re-encoding.
+        Falls back to a single process if the playlist cannot be split (two pass, image sequence, short zone...) */
+    void setSegments(int segments, const QString &ffmpeg);
 
 public slots:
     void start();
@@ -46,6 +54,7 @@ private slots:
     void slotAbort();
     void slotAbort(const QString &url);
     void slotCheckProcess(QProcess::ProcessState state);
+    void slotSegmentOver(int index, int exitCode, QProcess::ExitStatus status);
 
 private:
     QString m_scenelist;
@@ -71,7 +80,41 @@ private:
     QStringList m_args;
     /** @brief Used to write to the log file. */
     QTextStream m_logstream;
+    struct Segment
+    {
+        QProcess *process;
+        QStringList args;
+        /** @brief Estimated cost of the job, in frames */
+        int cost;
+        int progress;
+    };
+    /** @brief Requested number of processes, 1 for a normal render */
+    int m_segmentCount;
+    QString m_ffmpeg;
+    /** @brief The video segments, followed by the audio job if any */
+    QVector<Segment> m_segments;
+    QStringList m_segmentFiles;
+    QString m_audioFile;
+    QString m_outputFormat;
+    int m_runningSegments;
+    int m_expectedFrames;
+    /** @brief Temporary folder holding the segment playlists and files, next to the destination */
+    std::unique_ptr<QTemporaryDir> m_segmentDir;
+    QProcess *m_ffmpegProcess;
     void initKdenliveDbusInterface();
+    /** @brief Send m_progress to Kdenlive and the job tracker */
+    void sendProgress();
+    /** @brief Writes one playlist per segment, returns false if this render cannot be split */
+    bool prepareSegments();
+    void startSegments();
+    void receivedSegmentStderr(int index);
+    /** @brief Joins the rendered segments and the audio into the destination file */
+    void concatSegments();
+    /** @brief Starts ffmpeg with @param args, @param done receives the success and stderr output */
+    void runFfmpeg(const QStringList &args, const std::function<void(bool, const QString &)> &done);
+    /** @brief Checks that the destination file has the expected number of video frames */
+    void verifySegmentedRender();
+    void finishSegmentedRender(bool success);
 
 signals:
     void renderingFinished();
@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "segmentplanner.hpp"
+
+QVector<QPair<int, int>> SegmentPlanner::plan(int in, int out, int count, int gop, int minimumLength)
+{
+    QVector<QPair<int, int>> segments;
+    const int length = out - in + 1;
+    count = qMin(count, length / qMax(1, minimumLength));
+    if (count < 2) {
+        segments << qMakePair(in, out);
+        return segments;
+    }
+    int start = in;
+    for (int i = 1; i < count; ++i) {
+        int boundary = int(qint64(length) * i / count);
+        if (gop > 0) {
+            // Start each segment on a keyframe of the single process encoding
+            boundary = (boundary + gop / 2) / gop * gop;
+        }
+        boundary += in;
+        if (boundary <= start || boundary > out) {
+            continue;
+        }
+        segments << qMakePair(start, boundary - 1);
+        start = boundary;
+    }
+    segments << qMakePair(start, out);
+    return segments;
+}
@@ -0,0 +1,34 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QPair>
+#include <QVector>
+
+/** @brief Splitting of a render zone in ranges rendered by parallel processes */
+namespace SegmentPlanner {
+
+/** @brief Splits [in, out] in at most @param count ranges of at least @param minimumLength frames,
+    with boundaries on multiples of @param gop frames after @param in when gop > 0 */
+QVector<QPair<int, int>> plan(int in, int out, int count, int gop, int minimumLength);
+
+} // namespace SegmentPlanner
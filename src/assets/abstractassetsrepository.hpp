@@ -29,6 +29,8 @@
 #include <mutex>
 #include <unordered_map>
 
+class AssetsCache;
+
 /** @brief This class is the base class for assets (transitions or effets) repositories
  */
 
@@ -73,9 +75,15 @@ protected:
     // Reads the asset list from file and populates appropriate structure
     void parseAssetList(const QString &filePath, QSet<QString> &destination);
 
+    /* @brief Fills the repository from the assets cache, or by parsing MLT services and asset files if the cache is outdated */
     void init();
     virtual Mlt::Properties *retrieveListFromMlt() const = 0;
 
+    /* @brief Restores the assets stored in @param cache, returns false if it was not written for @param key */
+    bool loadCache(AssetsCache &cache, const QByteArray &key);
+    /* @brief Stores the parsed assets in @param cache */
+    void saveCache(AssetsCache &cache, const QByteArray &key) const;
+
     /* @brief Parse some info from a mlt structure
        @param res Datastructure to fill
        @return true on success
@@ -97,7 +105,12 @@ protected:
     /* @brief Retrieves additional info about asset from a custom XML file
        The resulting assets are stored in customAssets
      */
-    virtual void parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const = 0;
+    void loadCustomAssetFile(const QString &filePath, std::unordered_map<QString, Info> &customAssets) const;
+
+    /* @brief Retrieves additional info about asset from the content of a custom XML file
+       The resulting assets are stored in customAssets
+     */
+    virtual void parseCustomAssetFile(const QString &file_name, QDomDocument &doc, std::unordered_map<QString, Info> &customAssets) const = 0;
 
     /* @brief Returns the path to custom XML description of the assets*/
     virtual QStringList assetDirs() const = 0;
@@ -108,6 +121,9 @@ protected:
     /* @brief Returns the path to the assets' preferred list*/
     virtual QString assetPreferredListPath() const = 0;
 
+    /* @brief Returns the name of the assets' cache file*/
+    virtual QString assetCacheName() const = 0;
+
     std::unordered_map<QString, Info> m_assets;
 
     QSet<QString> m_blacklist;
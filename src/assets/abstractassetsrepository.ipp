@@ -19,17 +19,22 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
  ***************************************************************************/
 
-#include "xml/xml.hpp"
+#include "assets/assetscache.hpp"
 #include "kdenlivesettings.h"
+#include "project/loadtimings.h"
+#include "xml/xml.hpp"
 
+#include <QDataStream>
 #include <QDir>
 #include <QFile>
 #include <QStandardPaths>
 #include <QString>
 #include <QTextStream>
+#include <QtConcurrent>
 #include <KLocalizedString>
 
 #include <locale>
+#include <numeric>
 #ifdef Q_OS_MAC
 #include <xlocale.h>
 #endif
@@ -44,6 +49,7 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
 #else
     setlocale(LC_NUMERIC_MASK, nullptr);
 #endif
+    LoadTimings timings;
 
     // Parse blacklist
     parseAssetList(assetBlackListPath(), m_blacklist);
@@ -55,37 +61,25 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
     QScopedPointer<Mlt::Properties> assets(retrieveListFromMlt());
     int max = assets->count();
     QString sox = QStringLiteral("sox.");
+    QStringList services;
     for (int i = 0; i < max; ++i) {
-        Info info;
         QString name = assets->get_name(i);
-        info.id = name;
         if (name.startsWith(sox)) {
             // sox effects are not usage directly (parameters not available)
             continue;
         }
-        // qDebug() << "trying to parse " <<name <<" blacklist="<<m_blacklist.contains(name);
-        if (!m_blacklist.contains(name) && parseInfoFromMlt(name, info)) {
-            m_assets[name] = info;
-        } else {
-            if (m_blacklist.contains(name)) {
-                qDebug() << name << "is blacklisted";
-            } else {
-                qDebug() << "WARNING : Fails to parse " << name;
-            }
+        if (m_blacklist.contains(name)) {
+            qDebug() << name << "is blacklisted";
+            continue;
         }
+        services << name;
     }
 
     // We now parse custom effect xml
 
     // Set the directories to look into for effects.
     QStringList asset_dirs = assetDirs();
-
-    /* Parsing of custom xml works as follows: we parse all custom files.
-       Each of them contains a tag, which is the corresponding mlt asset, and an id that is the name of the asset. Note that several custom files can correspond
-       to the same tag, and in that case they must have different ids. We do the parsing in a map from ids to parse info, and then we add them to the asset
-       list, while discarding the bare version of each tag (the one with no file associated)
-    */
-    std::unordered_map<QString, Info> customAssets;
+    QStringList assetFiles;
     // reverse order to prioritize local install
     QListIterator<QString> dirs_it(asset_dirs);
     for (dirs_it.toBack(); dirs_it.hasPrevious();) { auto dir=dirs_it.previous();
@@ -93,10 +87,48 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
         QStringList filter {QStringLiteral("*.xml")};
         QStringList fileList = current_dir.entryList(filter, QDir::Files);
         for (const auto &file : fileList) {
-            QString path = current_dir.absoluteFilePath(file);
-            parseCustomAssetFile(path, customAssets);
+            assetFiles << current_dir.absoluteFilePath(file);
         }
     }
+    AssetsCache cache(assetCacheName());
+    const QByteArray cacheKey = AssetsCache::key(services, assetFiles);
+    timings.mark(QStringLiteral("listing"));
+    if (loadCache(cache, cacheKey)) {
+        timings.mark(QStringLiteral("cache"));
+        qDebug() << "Loaded" << m_assets.size() << assetCacheName() << "from cache," << timings.toString();
+        return;
+    }
+
+    // MLT metadata loaders (yaml parsing, module callbacks) are not thread safe, so services are parsed serially.
+    // The cache above makes this a one time cost per MLT and Kdenlive installation
+    for (const QString &name : services) {
+        Info info;
+        info.id = name;
+        if (parseInfoFromMlt(name, info)) {
+            m_assets[name] = info;
+        } else {
+            qDebug() << "WARNING : Fails to parse " << name;
+        }
+    }
+    timings.mark(QStringLiteral("mlt services"));
+
+    /* Parsing of custom xml works as follows: we parse all custom files.
+       Each of them contains a tag, which is the corresponding mlt asset, and an id that is the name of the asset. Note that several custom files can correspond
+       to the same tag, and in that case they must have different ids. We do the parsing in a map from ids to parse info, and then we add them to the asset
+       list, while discarding the bare version of each tag (the one with no file associated)
+    */
+    std::unordered_map<QString, Info> customAssets;
+    // Files are read in parallel, then interpreted in order since later files override earlier ones
+    QVector<QDomDocument> documents(assetFiles.size());
+    QVector<int> indexes(assetFiles.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    QtConcurrent::blockingMap(indexes, [&assetFiles, &documents](int ix) {
+        QFile file(assetFiles.at(ix));
+        documents[ix].setContent(&file, false);
+    });
+    for (int i = 0; i < assetFiles.size(); ++i) {
+        parseCustomAssetFile(assetFiles.at(i), documents[i], customAssets);
+    }
 
     // We add the custom assets
     for (const auto &custom : customAssets) {
@@ -111,6 +143,88 @@ template <typename AssetType> void AbstractAssetsRepository<AssetType>::init()
             qDebug() << "Error: conflicting asset name " << custom.first;
         }*/
     }
+    timings.mark(QStringLiteral("custom assets"));
+    saveCache(cache, cacheKey);
+    timings.mark(QStringLiteral("cache write"));
+    qDebug() << "Parsed" << m_assets.size() << assetCacheName() << "," << timings.toString();
+}
+
+template <typename AssetType> bool AbstractAssetsRepository<AssetType>::loadCache(AssetsCache &cache, const QByteArray &key)
+{
+    QDataStream *stream = cache.open(key);
+    if (stream == nullptr) {
+        return false;
+    }
+    struct CachedInfo : Info
+    {
+        QString key;
+    };
+    quint32 count = 0;
+    *stream >> count;
+    std::vector<CachedInfo> cached(count);
+    for (CachedInfo &info : cached) {
+        int type;
+        *stream >> info.key >> info.id >> info.mltId >> info.name >> info.description >> info.author >> info.version_str >> info.version >> type;
+        info.type = AssetType(type);
+    }
+    // All xml descriptions are stored in a single document, in the same order
+    QString xml;
+    *stream >> xml;
+    QDomDocument doc;
+    if (stream->status() != QDataStream::Ok || !doc.setContent(xml, false)) {
+        qDebug() << "// Invalid assets cache" << cache.path();
+        return false;
+    }
+    QDomElement element = doc.documentElement().firstChildElement();
+    for (CachedInfo &info : cached) {
+        if (element.isNull()) {
+            qDebug() << "// Invalid assets cache" << cache.path();
+            return false;
+        }
+        if (element.tagName() != QLatin1String("noxml")) {
+            info.xml = element;
+        }
+        element = element.nextSiblingElement();
+    }
+    m_assets.clear();
+    for (CachedInfo &info : cached) {
+        m_assets[info.key] = std::move(info);
+    }
+    return true;
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::saveCache(AssetsCache &cache, const QByteArray &key) const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << quint32(m_assets.size());
+    QString xml;
+    QTextStream xmlStream(&xml);
+    xmlStream << QStringLiteral("<assets>");
+    for (const auto &asset : m_assets) {
+        const Info &info = asset.second;
+        stream << asset.first << info.id << info.mltId << info.name << info.description << info.author << info.version_str << info.version << int(info.type);
+        if (info.xml.isNull()) {
+            xmlStream << QStringLiteral("<noxml/>");
+        } else {
+            info.xml.save(xmlStream, -1);
+        }
+    }
+    xmlStream << QStringLiteral("</assets>");
+    xmlStream.flush();
+    stream << xml;
+    if (!cache.save(key, data)) {
+        qDebug() << "// Cannot write assets cache" << cache.path();
+    }
+}
+
+template <typename AssetType> void AbstractAssetsRepository<AssetType>::loadCustomAssetFile(const QString &filePath, std::unordered_map<QString, Info> &customAssets) const
+{
+    QFile file(filePath);
+    QDomDocument doc;
+    doc.setContent(&file, false);
+    file.close();
+    parseCustomAssetFile(filePath, doc, customAssets);
 }
 
 template <typename AssetType> void AbstractAssetsRepository<AssetType>::parseAssetList(const QString &filePath, QSet<QString> &destination)
@@ -0,0 +1,126 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "assetscache.hpp"
+
+#include <KLocalizedString>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <config-kdenlive.h>
+#include <mlt++/Mlt.h>
+
+namespace {
+const quint32 cacheMagic = 0x4b415354; // KAST
+// Increase when the cached data changes
+const quint32 cacheVersion = 1;
+
+void addFile(QCryptographicHash &hash, const QFileInfo &info)
+{
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+}
+} // namespace
+
+AssetsCache::AssetsCache(const QString &name)
+{
+    QDir dir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    m_file.setFileName(dir.absoluteFilePath(QStringLiteral("assets/%1.cache").arg(name)));
+}
+
+AssetsCache::~AssetsCache()
+{
+    delete m_stream;
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+// static
+QByteArray AssetsCache::key(const QStringList &services, const QStringList &files)
+{
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(cacheVersion));
+    hash.addData(KDENLIVE_VERSION);
+    hash.addData(mlt_version_get_string());
+    // Names, descriptions and numbers are translated when parsing
+    hash.addData(QLocale().name().toUtf8());
+    hash.addData(KLocalizedString::languages().join(QLatin1Char(',')).toUtf8());
+    hash.addData(services.join(QLatin1Char(',')).toUtf8());
+    // Updated MLT modules may describe their services differently
+    QDir modules(QString::fromUtf8(mlt_environment("MLT_REPOSITORY")));
+    const QFileInfoList moduleFiles = modules.entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo &info : moduleFiles) {
+        addFile(hash, info);
+    }
+    for (const QString &file : files) {
+        addFile(hash, QFileInfo(file));
+    }
+    return hash.result();
+}
+
+QDataStream *AssetsCache::open(const QByteArray &key)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+    m_map = m_file.map(0, m_file.size());
+    if (m_map == nullptr) {
+        m_file.close();
+        return nullptr;
+    }
+    m_data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_map), int(m_file.size()));
+    m_stream = new QDataStream(m_data);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray cachedKey;
+    *m_stream >> magic >> version >> cachedKey;
+    if (m_stream->status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion || cachedKey != key) {
+        return nullptr;
+    }
+    return m_stream;
+}
+
+bool AssetsCache::save(const QByteArray &key, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    QSaveFile file(m_file.fileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "// Cannot write assets cache" << file.fileName() << file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << cacheMagic << cacheVersion << key;
+    file.write(data);
+    return file.commit();
+}
+
+QString AssetsCache::path() const
+{
+    return m_file.fileName();
+}
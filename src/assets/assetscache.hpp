@@ -0,0 +1,58 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+class QDataStream;
+
+/** @brief On disk cache of a parsed assets repository, so that MLT metadata and asset xml files are not parsed on each startup.
+    The cache is only valid for the key it was written with, computed from Kdenlive and MLT versions, language, the list of MLT services and
+    the modification time of MLT modules and asset files.
+ */
+class AssetsCache
+{
+public:
+    /** @param name identifies the repository (effects, transitions) */
+    explicit AssetsCache(const QString &name);
+    ~AssetsCache();
+
+    /** @brief Computes the cache key for the MLT @param services and the asset xml @param files */
+    static QByteArray key(const QStringList &services, const QStringList &files);
+
+    /** @brief Maps the cache file, returns a stream positioned on the cached data if it was written with @param key, nullptr otherwise.
+        The stream is valid until the cache is destroyed */
+    QDataStream *open(const QByteArray &key);
+    /** @brief Writes @param data for @param key, replacing the previous cache */
+    bool save(const QByteArray &key, const QByteArray &data);
+    /** @brief Path of the cache file */
+    QString path() const;
+
+private:
+    QFile m_file;
+    uchar *m_map{nullptr};
+    QByteArray m_data;
+    QDataStream *m_stream{nullptr};
+};
@@ -154,16 +154,21 @@ void AudioLevelWidget::drawBackground(int channels)
 
 // cppcheck-suppress unusedFunction
 void AudioLevelWidget::setAudioValues(const QVector<double> &values)
+{
+    setAudioLevels(values, values);
+}
+
+void AudioLevelWidget::setAudioLevels(const QVector<double> &values, const QVector<double> &peaks)
 {
     m_values = values;
-    if (m_peaks.size() != m_values.size()) {
-        m_peaks = values;
-        drawBackground(values.size());
+    if (m_peaks.size() != peaks.size()) {
+        m_peaks = peaks;
+        drawBackground(peaks.size());
     } else {
-        for (int i = 0; i < m_values.size(); i++) {
+        for (int i = 0; i < peaks.size(); i++) {
             m_peaks[i] -= .003;
-            if (m_values.at(i) > m_peaks.at(i)) {
-                m_peaks[i] = m_values.at(i);
+            if (peaks.at(i) > m_peaks.at(i)) {
+                m_peaks[i] = peaks.at(i);
             }
         }
     }
@@ -59,6 +59,8 @@ private:
 
 public slots:
     void setAudioValues(const QVector<double> &values);
+    /** @brief Displays @param values, while the peak indicators hold the highest of @param peaks */
+    void setAudioLevels(const QVector<double> &values, const QVector<double> &peaks);
 };
 
 #endif
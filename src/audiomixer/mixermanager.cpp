@@ -71,6 +71,10 @@ MixerManager::MixerManager(QWidget *parent)
     m_channelsLayout->addStretch(10);
     m_box->addLayout(m_masterBox);
     setLayout(m_box);
+    qreal refreshRate = QApplication::primaryScreen() ? QApplication::primaryScreen()->refreshRate() : 60.;
+    m_meterTimer.setTimerType(Qt::PreciseTimer);
+    m_meterTimer.setInterval(qMax(1, qRound(1000. / qMax(refreshRate, 1.))));
+    connect(&m_meterTimer, &QTimer::timeout, this, &MixerManager::refreshMeters);
 }
 
 void MixerManager::registerTrack(int tid, std::shared_ptr<Mlt::Tractor> service, const QString &trackTag)
@@ -192,6 +196,11 @@ void MixerManager::recordStateChanged(int tid, bool recording)
 void MixerManager::connectMixer(bool doConnect)
 {
     m_visibleMixerManager = doConnect;
+    if (m_visibleMixerManager) {
+        m_meterTimer.start();
+    } else {
+        m_meterTimer.stop();
+    }
     for (auto item : m_mixers) {
         item.second->connectMixer(m_visibleMixerManager && !KdenliveSettings::mixerCollapse());
     }
@@ -223,6 +232,18 @@ void MixerManager::resetSizePolicy()
     setMinimumWidth(0);
 }
 
+void MixerManager::refreshMeters()
+{
+    if (!KdenliveSettings::mixerCollapse()) {
+        for (const auto &item : m_mixers) {
+            item.second->refreshMeter();
+        }
+    }
+    if (m_masterMixer != nullptr) {
+        m_masterMixer->refreshMeter();
+    }
+}
+
 QSize MixerManager::sizeHint() const
 {
     return QSize(m_recommandedWidth, 0);
@@ -26,6 +26,7 @@
 #include <memory>
 #include <unordered_map>
 
+#include <QTimer>
 #include <QWidget>
 
 namespace Mlt {
@@ -59,6 +60,8 @@ public slots:
 
 private slots:
     void resetSizePolicy();
+    /** @brief Refresh the audio meters of all mixers */
+    void refreshMeters();
 
 signals:
     void updateLevels(int);
@@ -79,7 +82,8 @@ private:
     QHBoxLayout *m_masterBox;
     QHBoxLayout *m_channelsLayout;
     QScrollArea *m_channelsBox;
-    int m_lastFrame;
+    /** @brief Refreshes the audio meters at the screen refresh rate while the mixer is visible */
+    QTimer m_meterTimer;
     bool m_visibleMixerManager;
     int m_expandedWidth;
     QVector <int> m_soloMuted;
@@ -82,15 +82,11 @@ static inline int fromDB(double level)
 
 void MixerWidget::property_changed( mlt_service , MixerWidget *widget, char *name )
 {
+    // Called in the consumer thread for each frame, must not lock nor allocate
     if (widget && !strcmp(name, "_position")) {
         mlt_properties filter_props = MLT_FILTER_PROPERTIES( widget->m_monitorFilter->get_filter());
-        int pos = mlt_properties_get_int(filter_props, "_position");
-        if (!widget->m_levels.contains(pos)) {
-            widget->m_levels[pos] = {IEC_Scale(mlt_properties_get_double(filter_props, "_audio_level.0")), IEC_Scale(mlt_properties_get_double(filter_props, "_audio_level.1"))};
-            if (widget->m_levels.size() > widget->m_maxLevels) {
-                widget->m_levels.erase(widget->m_levels.begin());
-            }
-        }
+        widget->m_levels.store(mlt_properties_get_int(filter_props, "_position"), mlt_properties_get_double(filter_props, "_audio_level.0"),
+                               mlt_properties_get_double(filter_props, "_audio_level.1"));
     }
 }
 
@@ -101,10 +97,12 @@ MixerWidget::MixerWidget(int tid, std::shared_ptr<Mlt::Tractor> service, const Q
     , m_levelFilter(nullptr)
     , m_monitorFilter(nullptr)
     , m_balanceFilter(nullptr)
-    , m_maxLevels(qMax(30, (int)(service->get_fps() * 1.5)))
+    , m_levels(qMax(30, (int)(service->get_fps() * 1.5)))
     , m_solo(nullptr)
     , m_record(nullptr)
     , m_collapse(nullptr)
+    , m_displayPosition(-1)
+    , m_meterPosition(-1)
     , m_lastVolume(0)
     , m_listener(nullptr)
     , m_recording(false)
@@ -119,10 +117,12 @@ MixerWidget::MixerWidget(int tid, Mlt::Tractor *service, const QString &trackTag
     , m_levelFilter(nullptr)
     , m_monitorFilter(nullptr)
     , m_balanceFilter(nullptr)
-    , m_maxLevels(qMax(30, (int)(service->get_fps() * 1.5)))
+    , m_levels(qMax(30, (int)(service->get_fps() * 1.5)))
     , m_solo(nullptr)
     , m_record(nullptr)
     , m_collapse(nullptr)
+    , m_displayPosition(-1)
+    , m_meterPosition(-1)
     , m_lastVolume(0)
     , m_listener(nullptr)
     , m_recording(false)
@@ -307,7 +307,7 @@ void MixerWidget::buildUI(Mlt::Tractor *service, const QString &trackTag)
             m_volumeSpin->setValue(dbValue);
             m_levelFilter->set("level", dbValue);
             m_levelFilter->set("disable", value == 60 ? 1 : 0);
-            m_levels.clear();
+            clear();
             m_manager->purgeCache();
             pCore->setDocumentModified();
         }
@@ -318,7 +318,7 @@ void MixerWidget::buildUI(Mlt::Tractor *service, const QString &trackTag)
         if (m_balanceFilter != nullptr) {
             m_balanceFilter->set("start", (value + 50) / 100.);
             m_balanceFilter->set("disable", value == 0 ? 1 : 0);
-            m_levels.clear();
+            clear();
             m_manager->purgeCache();
             pCore->setDocumentModified();
         }
@@ -402,27 +402,35 @@ void MixerWidget::updateLabel()
 
 void MixerWidget::updateAudioLevel(int pos)
 {
-    QMutexLocker lk(&m_storeMutex);
-    if (m_levels.contains(pos)) {
-        m_audioMeterWidget->setAudioValues({m_levels.value(pos).first, m_levels.value(pos).second});
-        //m_levels.remove(pos);
+    m_displayPosition = pos;
+}
+
+void MixerWidget::refreshMeter()
+{
+    if (m_displayPosition == m_meterPosition) {
+        // Nothing new displayed, only empty the queue
+        m_levels.fetch();
+        return;
+    }
+    m_meterPosition = m_displayPosition;
+    TrackLevels::Meter meter;
+    if (m_levels.collect(m_meterPosition, meter)) {
+        m_audioMeterWidget->setAudioLevels({IEC_Scale(meter.rms[0]), IEC_Scale(meter.rms[1])}, {IEC_Scale(meter.peak[0]), IEC_Scale(meter.peak[1])});
     } else {
         m_audioMeterWidget->setAudioValues({-100, -100});
     }
 }
 
-
 void MixerWidget::reset()
 {
-    QMutexLocker lk(&m_storeMutex);
-    m_levels.clear();
+    clear();
     m_audioMeterWidget->setAudioValues({-100, -100});
 }
 
 void MixerWidget::clear()
 {
-    QMutexLocker lk(&m_storeMutex);
     m_levels.clear();
+    m_displayPosition = m_meterPosition = -1;
 }
 
 
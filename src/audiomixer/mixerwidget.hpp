@@ -23,12 +23,12 @@
 #define MIXERWIDGET_H
 
 #include "definitions.h"
+#include "tracklevels.hpp"
 #include "mlt++/MltService.h"
 
 #include <memory>
 #include <unordered_map>
 #include <QWidget>
-#include <QMutex>
 
 class KDualAction;
 class AudioLevelWidget;
@@ -70,11 +70,14 @@ public:
     void connectMixer(bool doConnect);
     /** @brief Disable/enable monitoring by disabling/enabling filter */
     void pauseMonitoring(bool pause);
+    /** @brief Display the audio levels collected for the last displayed frame */
+    void refreshMeter();
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
 
 public slots:
+    /** @brief The frame at @param pos is displayed in monitor, its levels will be shown on next meter refresh */
     void updateAudioLevel(int pos);
     void setRecordState(bool recording);
 
@@ -87,12 +90,11 @@ protected:
     std::shared_ptr<Mlt::Filter> m_levelFilter;
     std::shared_ptr<Mlt::Filter> m_monitorFilter;
     std::shared_ptr<Mlt::Filter> m_balanceFilter;
-    QMap<int, QPair<double, double>> m_levels;
+    TrackLevels m_levels;
     KDualAction *m_muteAction;
     QSpinBox *m_balanceSpin;
     QDial *m_balanceDial;
     QDoubleSpinBox *m_volumeSpin;
-    int m_maxLevels;
 
 private:
     std::shared_ptr<AudioLevelWidget> m_audioMeterWidget;
@@ -101,7 +103,8 @@ private:
     QToolButton *m_record;
     QToolButton *m_collapse;
     QLabel *m_trackLabel;
-    QMutex m_storeMutex;
+    int m_displayPosition;
+    int m_meterPosition;
     int m_lastVolume;
     Mlt::Event *m_listener;
     bool m_recording;
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "tracklevels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+TrackLevels::TrackLevels(int history)
+    : m_queue(size_t(std::max(history, 2)))
+    , m_history(m_queue.capacity())
+    , m_lastPosition(-1)
+{
+}
+
+void TrackLevels::store(int position, double left, double right)
+{
+    Level level;
+    level.position = position;
+    level.left = float(left);
+    level.right = float(right);
+    m_queue.push(level);
+}
+
+void TrackLevels::fetch()
+{
+    const size_t size = m_history.size();
+    m_queue.drain([this, size](const Level &level) {
+        if (level.position >= 0) {
+            m_history[size_t(level.position) % size] = level;
+        }
+    });
+}
+
+bool TrackLevels::collect(int position, Meter &meter)
+{
+    fetch();
+    const int size = int(m_history.size());
+    // Sum up the frames rendered since the last collect, or only the displayed frame after a seek
+    int start = position;
+    if (m_lastPosition >= 0 && position > m_lastPosition && position - m_lastPosition <= size) {
+        start = m_lastPosition + 1;
+    }
+    m_lastPosition = position;
+    double sum[2] = {0., 0.};
+    meter.peak[0] = meter.peak[1] = 0.;
+    meter.frames = 0;
+    for (int pos = std::max(start, 0); pos <= position; ++pos) {
+        const Level &level = m_history[size_t(pos % size)];
+        if (level.position != pos) {
+            continue;
+        }
+        sum[0] += double(level.left) * level.left;
+        sum[1] += double(level.right) * level.right;
+        meter.peak[0] = std::max(meter.peak[0], double(level.left));
+        meter.peak[1] = std::max(meter.peak[1], double(level.right));
+        meter.frames++;
+    }
+    if (meter.frames == 0) {
+        meter.rms[0] = meter.rms[1] = 0.;
+        return false;
+    }
+    meter.rms[0] = std::sqrt(sum[0] / meter.frames);
+    meter.rms[1] = std::sqrt(sum[1] / meter.frames);
+    return true;
+}
+
+void TrackLevels::clear()
+{
+    m_queue.discard();
+    std::fill(m_history.begin(), m_history.end(), Level());
+    m_lastPosition = -1;
+}
+
+size_t TrackLevels::dropped() const
+{
+    return m_queue.dropped();
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "utils/spscringbuffer.hpp"
+
+#include <vector>
+
+/** @brief Audio levels of a mixer track, from the MLT consumer thread to the GUI.
+    The consumer thread stores the levels of each rendered frame in a lock-free queue. The GUI periodically collects them
+    for the displayed frame, summing up the frames rendered since the previous collect in a peak and RMS value per channel.
+ */
+class TrackLevels
+{
+public:
+    /** @param history the number of frames kept, the consumer can render that many frames ahead of the display */
+    explicit TrackLevels(int history);
+
+    /** @brief Consumer thread: stores the linear audio levels of the frame at @param position. Never blocks nor allocates */
+    void store(int position, double left, double right);
+
+    struct Meter
+    {
+        double rms[2];
+        double peak[2];
+        int frames;
+    };
+    /** @brief GUI thread: computes in @param meter the levels of the frames after the previous collected position, up to @param position.
+        Returns false if no level was stored for these frames */
+    bool collect(int position, Meter &meter);
+    /** @brief GUI thread: reads the stored levels without collecting them, so that the queue does not fill up */
+    void fetch();
+    /** @brief GUI thread: discards all stored levels */
+    void clear();
+    /** @brief Number of frames whose levels were lost because the GUI did not fetch them in time */
+    size_t dropped() const;
+
+private:
+    struct Level
+    {
+        int position = -1;
+        float left = 0.f;
+        float right = 0.f;
+    };
+    SpscRingBuffer<Level> m_queue;
+    // Indexed by position modulo its size
+    std::vector<Level> m_history;
+    int m_lastPosition;
+};
@@ -746,6 +746,16 @@ void SmallJobLabel::slotSetJobCount(int jobCount)
     }
 }
 
+void SmallJobLabel::slotSetJobQueueStats(int queued, int running, int averageWait, int longestWait)
+{
+    QMutexLocker lk(&m_locker);
+    if (queued + running == 0) {
+        setToolTip(QString());
+        return;
+    }
+    setToolTip(i18n("%1 running, %2 queued\nAverage wait: %3 ms, longest wait: %4 ms", running, queued, averageWait, longestWait));
+}
+
 LineEventEater::LineEventEater(QObject *parent)
     : QObject(parent)
 {
@@ -1106,6 +1116,7 @@ Bin::Bin(std::shared_ptr<ProjectItemModel> model, QWidget *parent)
     m_infoLabel = new SmallJobLabel(this);
     m_infoLabel->setStyleSheet(SmallJobLabel::getStyleSheet(palette()));
     connect(pCore->jobManager().get(), &JobManager::jobCount, m_infoLabel, &SmallJobLabel::slotSetJobCount);
+    connect(pCore->jobManager().get(), &JobManager::jobQueueStats, m_infoLabel, &SmallJobLabel::slotSetJobQueueStats);
     QAction *infoAction = m_toolbar->addWidget(m_infoLabel);
     m_jobsMenu = new QMenu(this);
     // connect(m_jobsMenu, &QMenu::aboutToShow, this, &Bin::slotPrepareJobsMenu);
@@ -3862,6 +3873,8 @@ void Bin::setCurrent(const std::shared_ptr<AbstractProjectItem> &item)
 {
     switch (item->itemType()) {
     case AbstractProjectItem::ClipItem: {
+        // Jobs of the clip displayed in monitor should not wait behind the rest of the bin
+        pCore->jobManager()->setClipPriority(item->clipId(), JobPriority::Interactive);
         openProducer(std::static_pointer_cast<ProjectClip>(item));
         std::shared_ptr<ProjectClip> clp = std::static_pointer_cast<ProjectClip>(item);
         emit requestShowEffectStack(clp->clipName(), clp->m_effectStack, clp->getFrameSize(), false);
@@ -136,6 +136,7 @@ private:
 
 public slots:
     void slotSetJobCount(int jobCount);
+    void slotSetJobQueueStats(int queued, int running, int averageWait, int longestWait);
 
 private slots:
     void slotTimeLineChanged(qreal value);
@@ -0,0 +1,187 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "clipprober.hpp"
+#include "kdenlivesettings.h"
+#include "utils/mediacache.hpp"
+#include "xml/xml.hpp"
+
+#include <QDebug>
+#include <QDomDocument>
+#include <QFile>
+#include <QThread>
+#include <QtConcurrent>
+#include <cstring>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+namespace {
+// Most containers keep their headers in the first block, mp4 and mov files often keep their index in the last one
+const qint64 headBlock = 512 * 1024;
+const qint64 tailBlock = 128 * 1024;
+
+QFuture<bool> finishedFuture(bool result)
+{
+    QFutureInterface<bool> futureInterface;
+    futureInterface.reportStarted();
+    futureInterface.reportResult(result);
+    futureInterface.reportFinished();
+    return futureInterface.future();
+}
+
+// Copy what the xml parser would have found when opening the file, without overriding the document values
+void copyProbedProperties(Mlt::Properties &media, Mlt::Producer &producer)
+{
+    for (int i = 0; i < media.count(); ++i) {
+        const char *name = media.get_name(i);
+        if (name == nullptr || name[0] == '_') {
+            continue;
+        }
+        if (strncmp(name, "meta.", 5) == 0 || producer.get(name) == nullptr) {
+            producer.set(name, media.get(i));
+        }
+    }
+    producer.set("_kdenlive_probe", 0);
+}
+} // namespace
+
+ClipProber::ClipProber(Mlt::Profile &profile)
+    : m_profile(profile)
+{
+    m_ioPool.setMaxThreadCount(qMax(1, KdenliveSettings::probeiothreads()));
+    m_cpuPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+ClipProber::~ClipProber()
+{
+    cancel();
+}
+
+// static
+int ClipProber::deferProbing(QDomDocument &doc)
+{
+    int changed = 0;
+    QDomNodeList producers = doc.elementsByTagName(QStringLiteral("producer"));
+    for (int i = 0; i < producers.count(); ++i) {
+        QDomElement prod = producers.at(i).toElement();
+        if (Xml::getXmlProperty(prod, QStringLiteral("mlt_service")) != QLatin1String("avformat") ||
+            Xml::getXmlProperty(prod, QStringLiteral("meta.media.nb_streams")).isEmpty()) {
+            continue;
+        }
+        Xml::setXmlProperty(prod, QStringLiteral("mlt_service"), QStringLiteral("avformat-novalidate"));
+        // Properties starting with an underscore are not saved, so the flag does not leak into the project file
+        Xml::setXmlProperty(prod, QStringLiteral("_kdenlive_probe"), QStringLiteral("1"));
+        changed++;
+    }
+    return changed;
+}
+
+// static
+bool ClipProber::needsProbe(Mlt::Producer &producer)
+{
+    const char *service = producer.get("mlt_service");
+    if (service == nullptr || strcmp(service, "avformat-novalidate") != 0) {
+        // Other producers are opened by the xml parser
+        return false;
+    }
+    return producer.get_int("_kdenlive_probe") == 1 || producer.get("meta.media.nb_streams") == nullptr;
+}
+
+void ClipProber::enqueue(int id, const std::shared_ptr<Mlt::Producer> &producer)
+{
+    const QString resource = QString::fromUtf8(producer->get("resource"));
+    const bool mustProbe = needsProbe(*producer);
+    QFuture<QFuture<bool>> future = QtConcurrent::run(&m_ioPool, [this, resource, mustProbe, producer]() {
+        if (m_canceled) {
+            return finishedFuture(!mustProbe);
+        }
+        if (mustProbe) {
+            Mlt::Properties cached;
+            if (MediaCache::get()->restoreProperties(resource, cached)) {
+                copyProbedProperties(cached, *producer.get());
+                return finishedFuture(true);
+            }
+        }
+        readHeaders(resource);
+        if (!mustProbe) {
+            return finishedFuture(true);
+        }
+        return QtConcurrent::run(&m_cpuPool, [this, producer]() { return !m_canceled && probe(producer); });
+    });
+    if (mustProbe) {
+        m_probes[id] = future;
+    }
+}
+
+bool ClipProber::waitFor(int id)
+{
+    auto it = m_probes.find(id);
+    if (it == m_probes.end()) {
+        return true;
+    }
+    bool result = it->second.result().result();
+    m_probes.erase(it);
+    return result;
+}
+
+void ClipProber::cancel()
+{
+    m_canceled = true;
+    m_ioPool.waitForDone();
+    m_cpuPool.waitForDone();
+    m_probes.clear();
+}
+
+int ClipProber::probedCount() const
+{
+    return m_probed;
+}
+
+int ClipProber::failedCount() const
+{
+    return m_failed;
+}
+
+void ClipProber::readHeaders(const QString &path) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    file.read(headBlock);
+    if (file.size() > headBlock + tailBlock && file.seek(file.size() - tailBlock)) {
+        file.read(tailBlock);
+    }
+}
+
+bool ClipProber::probe(const std::shared_ptr<Mlt::Producer> &producer)
+{
+    m_probed++;
+    Mlt::Producer media(m_profile, "avformat", producer->get("resource"));
+    if (!media.is_valid()) {
+        qDebug() << "// Cannot probe clip" << producer->get("resource");
+        m_failed++;
+        return false;
+    }
+    MediaCache::get()->storeProperties(QString::fromUtf8(producer->get("resource")), media);
+    copyProbedProperties(media, *producer.get());
+    return true;
+}
@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef CLIPPROBER_H
+#define CLIPPROBER_H
+
+#include <QFuture>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+class QDomDocument;
+namespace Mlt {
+class Producer;
+class Profile;
+} // namespace Mlt
+
+/** @brief Probes the media of the bin clips in parallel while a project is loaded.
+    Parsing a project used to open every avformat clip one after the other. Clips whose stream information is saved in the document
+    are now parsed as lazy producers (see deferProbing). Each bin clip then goes through an I/O stage reading the start and end of its
+    file on a pool sized for disk latency, and the clips that still need probing are opened on a pool sized to the cpu cores.
+    The bin only waits for the clips that need probing, the others keep warming the disk cache in the background.
+ */
+class ClipProber
+{
+public:
+    explicit ClipProber(Mlt::Profile &profile);
+    ~ClipProber();
+    ClipProber(const ClipProber &) = delete;
+    ClipProber &operator=(const ClipProber &) = delete;
+
+    /** @brief Turns the avformat producers of @param doc that carry their stream information into lazy avformat-novalidate producers
+        flagged for probing, so that the project parsing does not open them. Returns the number of producers changed */
+    static int deferProbing(QDomDocument &doc);
+    /** @brief Returns true if the properties of @param producer cannot be used before it is probed */
+    static bool needsProbe(Mlt::Producer &producer);
+
+    /** @brief Starts reading the media of clip @param id */
+    void enqueue(int id, const std::shared_ptr<Mlt::Producer> &producer);
+    /** @brief Blocks until clip @param id can be used, returns false if it needed probing and the probe failed */
+    bool waitFor(int id);
+    /** @brief Skips the pending tasks and waits for the running ones */
+    void cancel();
+
+    /** @brief Number of clips opened on the cpu pool */
+    int probedCount() const;
+    /** @brief Number of clips whose probe failed */
+    int failedCount() const;
+
+private:
+    /** @brief Reads the first and last blocks of @param path, where containers store their headers and index */
+    void readHeaders(const QString &path) const;
+    /** @brief Opens the media of @param producer and copies the stream information to it */
+    bool probe(const std::shared_ptr<Mlt::Producer> &producer);
+
+    Mlt::Profile &m_profile;
+    QThreadPool m_ioPool;
+    QThreadPool m_cpuPool;
+    // the I/O task of each clip that needs probing returns the future of its cpu task
+    std::unordered_map<int, QFuture<QFuture<bool>>> m_probes;
+    std::atomic<bool> m_canceled{false};
+    std::atomic<int> m_probed{0};
+    std::atomic<int> m_failed{0};
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "filewatcher.hpp"
 
+#include <QDir>
 #include <QFileInfo>
 
 FileWatcher::FileWatcher(QObject *parent)
@@ -29,10 +30,27 @@ FileWatcher::FileWatcher(QObject *parent)
 {
     // Init clip modification tracker
     m_modifiedTimer.setInterval(1500);
-    connect(m_fileWatcher.get(), &KDirWatch::dirty, this, &FileWatcher::slotUrlModified);
-    connect(m_fileWatcher.get(), &KDirWatch::deleted, this, &FileWatcher::slotUrlMissing);
-    connect(m_fileWatcher.get(), &KDirWatch::created, this, &FileWatcher::slotUrlAdded);
+    // Change notifications often come in bursts (copy, render, sync), process them together
+    m_eventsTimer.setSingleShot(true);
+    m_eventsTimer.setInterval(250);
+    connect(m_fileWatcher.get(), &KDirWatch::dirty, this, &FileWatcher::slotUrlChanged);
+    connect(m_fileWatcher.get(), &KDirWatch::deleted, this, &FileWatcher::slotUrlChanged);
+    connect(m_fileWatcher.get(), &KDirWatch::created, this, &FileWatcher::slotUrlChanged);
+    connect(&m_eventsTimer, &QTimer::timeout, this, &FileWatcher::slotProcessEvents);
     connect(&m_modifiedTimer, &QTimer::timeout, this, &FileWatcher::slotProcessModifiedUrls);
+    m_statsTimer.start();
+}
+
+FileWatcher::FileState FileWatcher::fileState(const QString &path)
+{
+    FileState state;
+    QFileInfo info(path);
+    if (info.exists()) {
+        state.exists = true;
+        state.size = info.size();
+        state.modified = info.lastModified();
+    }
+    return state;
 }
 
 void FileWatcher::addFile(const QString &binId, const QString &url)
@@ -45,11 +63,21 @@ void FileWatcher::addFile(const QString &binId, const QString &url)
     if (!check_file.exists() || !check_file.isFile()) {
         return;
     }
-    if (m_occurences.count(url) == 0) {
-        m_fileWatcher->addFile(url);
+    const QString path = check_file.absoluteFilePath();
+    if (m_binClipPaths.count(binId) > 0) {
+        if (m_binClipPaths.at(binId) == path) {
+            return;
+        }
+        removeFile(binId);
+    }
+    if (m_occurences.insert(path, binId)) {
+        m_states[path] = fileState(path);
+        const QString folder = check_file.absolutePath();
+        if (m_folders[folder]++ == 0) {
+            m_fileWatcher->addDir(folder, KDirWatch::WatchFiles);
+        }
     }
-    m_occurences[url].insert(binId);
-    m_binClipPaths[binId] = url;
+    m_binClipPaths[binId] = path;
 }
 
 void FileWatcher::removeFile(const QString &binId)
@@ -58,38 +86,91 @@ void FileWatcher::removeFile(const QString &binId)
         return;
     }
     QString url = m_binClipPaths[binId];
-    m_occurences[url].erase(binId);
     m_binClipPaths.erase(binId);
-    if (m_occurences[url].empty()) {
-        m_fileWatcher->removeFile(url);
-        m_occurences.erase(url);
+    if (m_occurences.remove(url, binId)) {
+        m_states.erase(url);
+        m_modifiedUrls.erase(url);
+        const QString folder = QFileInfo(url).absolutePath();
+        auto it = m_folders.find(folder);
+        if (it != m_folders.end() && --it->second == 0) {
+            m_fileWatcher->removeDir(folder);
+            m_folders.erase(it);
+        }
     }
 }
 
-void FileWatcher::slotUrlModified(const QString &path)
+void FileWatcher::slotUrlChanged(const QString &path)
 {
-    if (m_modifiedUrls.count(path) == 0) {
-        m_modifiedUrls.insert(path);
-        for (const QString &id : m_occurences[path]) {
-            emit binClipWaiting(id);
-        }
-    }
-    if (!m_modifiedTimer.isActive()) {
-        m_modifiedTimer.start();
+    m_stats.events++;
+    m_pendingUrls.insert(path);
+    if (!m_eventsTimer.isActive()) {
+        m_eventsTimer.start();
     }
 }
 
-void FileWatcher::slotUrlAdded(const QString &path)
+void FileWatcher::slotProcessEvents()
 {
-    for (const QString &id : m_occurences[path]) {
-        emit binClipModified(id);
+    if (m_pendingUrls.empty()) {
+        return;
+    }
+    m_stats.batches++;
+    m_stats.largestBatch = qMax(m_stats.largestBatch, int(m_pendingUrls.size()));
+    std::unordered_set<QString> files;
+    for (const QString &url : m_pendingUrls) {
+        const QString path = QDir::cleanPath(url);
+        if (m_occurences.contains(path)) {
+            files.insert(path);
+        } else if (m_folders.count(path) > 0) {
+            // Some backends only report the folder
+            for (const QString &file : m_occurences.files(path)) {
+                files.insert(file);
+            }
+        } else {
+            // A parent folder was moved or deleted
+            for (const QString &file : m_occurences.filesBelow(path)) {
+                files.insert(file);
+            }
+        }
+    }
+    m_pendingUrls.clear();
+    for (const QString &path : files) {
+        checkFile(path);
     }
 }
 
-void FileWatcher::slotUrlMissing(const QString &path)
+void FileWatcher::checkFile(const QString &path)
 {
-    for (const QString &id : m_occurences[path]) {
-        emit binClipMissing(id);
+    m_stats.checkedFiles++;
+    auto it = m_states.find(path);
+    if (it == m_states.end()) {
+        return;
+    }
+    const FileState state = fileState(path);
+    if (state == it->second) {
+        return;
+    }
+    const bool existed = it->second.exists;
+    it->second = state;
+    m_stats.changedFiles++;
+    if (!state.exists) {
+        m_modifiedUrls.erase(path);
+        for (const QString &id : m_occurences.ids(path)) {
+            emit binClipMissing(id);
+        }
+    } else if (!existed) {
+        for (const QString &id : m_occurences.ids(path)) {
+            emit binClipModified(id);
+        }
+    } else {
+        if (m_modifiedUrls.count(path) == 0) {
+            m_modifiedUrls.insert(path);
+            for (const QString &id : m_occurences.ids(path)) {
+                emit binClipWaiting(id);
+            }
+        }
+        if (!m_modifiedTimer.isActive()) {
+            m_modifiedTimer.start();
+        }
     }
 }
 
@@ -97,8 +178,8 @@ void FileWatcher::slotProcessModifiedUrls()
 {
     auto checkList = m_modifiedUrls;
     for (const QString &path : checkList) {
-        if (m_fileWatcher->ctime(path).msecsTo(QDateTime::currentDateTime()) > 1000) {
-            for (const QString &id : m_occurences[path]) {
+        if (QFileInfo(path).lastModified().msecsTo(QDateTime::currentDateTime()) > 1000) {
+            for (const QString &id : m_occurences.ids(path)) {
                 emit binClipModified(id);
             }
             m_modifiedUrls.erase(path);
@@ -109,14 +190,46 @@ void FileWatcher::slotProcessModifiedUrls()
     }
 }
 
+FileWatcher::Stats FileWatcher::stats() const
+{
+    Stats stats = m_stats;
+    stats.folders = int(m_folders.size());
+    stats.files = m_occurences.size();
+    stats.clips = int(m_binClipPaths.size());
+    const qint64 elapsed = m_statsTimer.elapsed();
+    stats.eventRate = elapsed > 0 ? double(m_stats.events) * 1000. / double(elapsed) : 0.;
+    switch (m_fileWatcher->internalMethod()) {
+    case KDirWatch::INotify:
+        stats.method = QStringLiteral("INotify");
+        break;
+    case KDirWatch::FAM:
+        stats.method = QStringLiteral("FAM");
+        break;
+    case KDirWatch::QFSWatch:
+        stats.method = QStringLiteral("QFileSystemWatcher");
+        break;
+    default:
+        stats.method = QStringLiteral("Stat");
+        break;
+    }
+    return stats;
+}
+
 void FileWatcher::clear()
 {
     m_fileWatcher->stopScan();
-    for (const auto &f : m_occurences) {
-        m_fileWatcher->removeFile(f.first);
+    for (const auto &f : m_folders) {
+        m_fileWatcher->removeDir(f.first);
     }
     m_occurences.clear();
+    m_states.clear();
+    m_folders.clear();
+    m_pendingUrls.clear();
+    m_eventsTimer.stop();
     m_modifiedUrls.clear();
+    m_modifiedTimer.stop();
     m_binClipPaths.clear();
+    m_stats = Stats();
+    m_statsTimer.restart();
     m_fileWatcher->startScan();
 }
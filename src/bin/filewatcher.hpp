@@ -23,13 +23,19 @@
 #define FILEWATCHER_H
 
 #include "definitions.h"
+#include "pathtrie.hpp"
 #include <KDirWatch>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QTimer>
 #include <unordered_map>
 #include <unordered_set>
 
 /** @brief This class is responsible for watching all files used in the project
     and triggers a reload notification when a file changes.
+    Folders are watched instead of files, so that thousands of clips in a few folders only use a few watches. Change
+    notifications are collected and processed in batches, the files concerned are found through a path trie and
+    only the ones whose size or modification time changed are reported.
  */
 
 class FileWatcher : public QObject
@@ -46,32 +52,71 @@ public:
     // Reset all watched files
     void clear();
 
+    struct Stats
+    {
+        // Number of watched folders
+        int folders = 0;
+        // Number of watched files and of clips using them
+        int files = 0;
+        int clips = 0;
+        // Change notifications received, and batches they were processed in
+        qint64 events = 0;
+        qint64 batches = 0;
+        int largestBatch = 0;
+        // Files whose state was checked, and the ones that really changed
+        qint64 checkedFiles = 0;
+        qint64 changedFiles = 0;
+        // Notifications per second since the watcher was started or cleared
+        double eventRate = 0.;
+        // KDirWatch backend, INotify on Linux unless the system prevents it
+        QString method;
+    };
+    Stats stats() const;
+
 signals:
     /** @brief This signal is triggered whenever the file corresponding to a bin clip has been modified and should be reloaded. Note that this signal is sent no
      * more than every 1500 ms. We also make sure that at least 1000ms has passed since the last modification of the file. */
     void binClipModified(const QString &binId);
-    /** @brief Same signal than binClipModified, but triggers immediately. Can be useful to refresh UI without actually reloading the file (yet)*/
+    /** @brief Same signal than binClipModified, but triggers once the change notifications are processed. Can be useful to refresh UI without actually reloading the file (yet)*/
     void binClipWaiting(const QString &binId);
     void binClipMissing(const QString &binId);
 
 private slots:
-    void slotUrlModified(const QString &path);
-    void slotUrlMissing(const QString &path);
-    void slotUrlAdded(const QString &path);
+    void slotUrlChanged(const QString &path);
+    void slotProcessEvents();
     void slotProcessModifiedUrls();
 
 private:
-    // This is a handle to the watcher singleton, not owned by this class.
+    struct FileState
+    {
+        bool exists = false;
+        qint64 size = -1;
+        QDateTime modified;
+        bool operator==(const FileState &other) const { return exists == other.exists && size == other.size && modified == other.modified; }
+    };
+    static FileState fileState(const QString &path);
+    /** @brief Compares the state of @param path with the stored one and sends the corresponding signals */
+    void checkFile(const QString &path);
+
     std::unique_ptr<KDirWatch> m_fileWatcher;
-    // A list with urls as keys, and the corresponding clip ids as value
-    std::unordered_map<QString, std::unordered_set<QString>> m_occurences;
+    // Watched files, with the corresponding clip ids
+    PathTrie m_occurences;
     // keys are binId, keys are stored paths
     std::unordered_map<QString, QString> m_binClipPaths;
+    // Last known state of the watched files
+    std::unordered_map<QString, FileState> m_states;
+    // Watched folders, with the number of watched files they contain
+    std::unordered_map<QString, int> m_folders;
 
+    // Paths notified since the last batch
+    std::unordered_set<QString> m_pendingUrls;
+    QTimer m_eventsTimer;
     // List of files for which we received an update since the last send
     std::unordered_set<QString> m_modifiedUrls;
 
     QTimer m_modifiedTimer;
+    Stats m_stats;
+    QElapsedTimer m_statsTimer;
 };
 
 #endif
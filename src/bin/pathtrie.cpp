@@ -0,0 +1,156 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "pathtrie.hpp"
+
+#include <QVector>
+#include <vector>
+
+PathTrie::PathTrie()
+    : m_root(new Node)
+    , m_size(0)
+{
+}
+
+PathTrie::~PathTrie() = default;
+
+bool PathTrie::insert(const QString &path, const QString &id)
+{
+    Node *node = m_root.get();
+    const QVector<QStringRef> parts = path.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
+    for (const QStringRef &part : parts) {
+        std::unique_ptr<Node> &child = node->children[part.toString()];
+        if (!child) {
+            child.reset(new Node);
+        }
+        node = child.get();
+    }
+    const bool added = node->ids.empty();
+    node->ids.insert(id);
+    if (added) {
+        m_size++;
+    }
+    return added;
+}
+
+bool PathTrie::remove(const QString &path, const QString &id)
+{
+    const QVector<QStringRef> parts = path.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
+    // Keep the nodes of the path to prune the ones left empty
+    std::vector<Node *> nodes{m_root.get()};
+    for (const QStringRef &part : parts) {
+        auto it = nodes.back()->children.find(part.toString());
+        if (it == nodes.back()->children.end()) {
+            return false;
+        }
+        nodes.push_back(it->second.get());
+    }
+    Node *node = nodes.back();
+    if (node->ids.erase(id) == 0 || !node->ids.empty()) {
+        return false;
+    }
+    m_size--;
+    for (int i = parts.size(); i > 0; --i) {
+        Node *current = nodes[size_t(i)];
+        if (!current->ids.empty() || !current->children.empty()) {
+            break;
+        }
+        nodes[size_t(i - 1)]->children.erase(parts.at(i - 1).toString());
+    }
+    return true;
+}
+
+const PathTrie::Node *PathTrie::find(const QString &path) const
+{
+    const Node *node = m_root.get();
+    const QVector<QStringRef> parts = path.splitRef(QLatin1Char('/'), QString::SkipEmptyParts);
+    for (const QStringRef &part : parts) {
+        auto it = node->children.find(part.toString());
+        if (it == node->children.end()) {
+            return nullptr;
+        }
+        node = it->second.get();
+    }
+    return node;
+}
+
+std::unordered_set<QString> PathTrie::ids(const QString &path) const
+{
+    const Node *node = find(path);
+    return node ? node->ids : std::unordered_set<QString>();
+}
+
+bool PathTrie::contains(const QString &path) const
+{
+    const Node *node = find(path);
+    return node != nullptr && !node->ids.empty();
+}
+
+QStringList PathTrie::files(const QString &dir) const
+{
+    QStringList result;
+    const Node *node = find(dir);
+    if (node == nullptr) {
+        return result;
+    }
+    const QString prefix = dir.endsWith(QLatin1Char('/')) ? dir : dir + QLatin1Char('/');
+    for (const auto &child : node->children) {
+        if (!child.second->ids.empty()) {
+            result << prefix + child.first;
+        }
+    }
+    return result;
+}
+
+QStringList PathTrie::filesBelow(const QString &dir) const
+{
+    QStringList result;
+    const Node *node = find(dir);
+    if (node != nullptr) {
+        QString path = dir;
+        while (path.endsWith(QLatin1Char('/'))) {
+            path.chop(1);
+        }
+        collect(node, path, result);
+    }
+    return result;
+}
+
+void PathTrie::collect(const Node *node, const QString &path, QStringList &result)
+{
+    if (!node->ids.empty()) {
+        result << path;
+    }
+    for (const auto &child : node->children) {
+        collect(child.second.get(), path + QLatin1Char('/') + child.first, result);
+    }
+}
+
+int PathTrie::size() const
+{
+    return m_size;
+}
+
+void PathTrie::clear()
+{
+    m_root.reset(new Node);
+    m_size = 0;
+}
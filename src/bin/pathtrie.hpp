@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "definitions.h"
+#include <QString>
+#include <QStringList>
+#include <map>
+#include <memory>
+#include <unordered_set>
+
+/** @brief Maps file paths to the ids of the bin clips using them.
+    Paths are stored component by component, so that the files of a folder, or of a whole folder tree, are found without scanning all paths.
+ */
+class PathTrie
+{
+public:
+    PathTrie();
+    ~PathTrie();
+
+    /** @brief Adds @param id to the clips using @param path. Returns true if the path was not used yet */
+    bool insert(const QString &path, const QString &id);
+    /** @brief Removes @param id from the clips using @param path. Returns true if the path is not used anymore */
+    bool remove(const QString &path, const QString &id);
+    /** @brief Returns the ids of the clips using @param path */
+    std::unordered_set<QString> ids(const QString &path) const;
+    /** @brief Returns true if a clip uses @param path */
+    bool contains(const QString &path) const;
+    /** @brief Returns the used files directly in folder @param dir */
+    QStringList files(const QString &dir) const;
+    /** @brief Returns the used files in folder @param dir and its subfolders, or @param dir itself if it is a used file */
+    QStringList filesBelow(const QString &dir) const;
+    /** @brief Number of used files */
+    int size() const;
+    void clear();
+
+private:
+    struct Node
+    {
+        std::map<QString, std::unique_ptr<Node>> children;
+        std::unordered_set<QString> ids;
+    };
+    std::unique_ptr<Node> m_root;
+    int m_size;
+    const Node *find(const QString &path) const;
+    static void collect(const Node *node, const QString &path, QStringList &result);
+};
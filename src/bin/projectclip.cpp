@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "jobs/thumbjob.hpp"
 #include "jobs/cachejob.hpp"
 #include "kdenlivesettings.h"
+#include "lib/audio/audioLevels.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "mltcontroller/clipcontroller.h"
 #include "mltcontroller/clippropertiescontroller.h"
@@ -46,7 +47,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "timecode.h"
 #include "timeline2/model/snapmodel.hpp"
 
+#include "utils/mediacache.hpp"
 #include "utils/thumbnailcache.hpp"
+#include "utils/thumbnailscheduler.hpp"
 #include "xml/xml.hpp"
 #include <QPainter>
 #include <jobs/proxyclipjob.h>
@@ -54,6 +57,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "kdenlive_debug.h"
 #include "logger.hpp"
+#include <KIO/Global>
 #include <KLocalizedString>
 #include <KMessageBox>
 #include <QApplication>
@@ -61,7 +65,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDir>
 #include <QDomElement>
 #include <QFile>
+#include <cstring>
 #include <memory>
+#include <unordered_set>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -164,7 +170,8 @@ ProjectClip::~ProjectClip()
     m_requestedThumbs.clear();
     m_thumbMutex.unlock();
     m_thumbThread.waitForFinished();
-    audioFrameCache.clear();
+    ThumbnailScheduler::get()->invalidate(m_binId);
+    audioLevels.reset();
 }
 
 void ProjectClip::connectEffectStack()
@@ -179,10 +186,16 @@ void ProjectClip::connectEffectStack()
 
 QString ProjectClip::getToolTip() const
 {
+    QString tip = m_path;
     if (m_clipType == ClipType::Color && m_path.contains(QLatin1Char('/'))) {
-        return m_path.section(QLatin1Char('/'), -1);
+        tip = m_path.section(QLatin1Char('/'), -1);
     }
-    return m_path;
+    const DecoderStats stats = decoderStats();
+    if (stats.audio + stats.video > 0) {
+        tip.append(QLatin1Char('\n') + i18n("%1 audio and %2 video decoders for %3 timeline uses, about %4", stats.audio, stats.video, stats.users,
+                                            KIO::convertSize(KIO::filesize_t(stats.memory))));
+    }
+    return tip;
 }
 
 QString ProjectClip::getXmlProperty(const QDomElement &producer, const QString &propertyName, const QString &defaultValue)
@@ -198,12 +211,12 @@ QString ProjectClip::getXmlProperty(const QDomElement &producer, const QString &
     return value;
 }
 
-void ProjectClip::updateAudioThumbnail(const QVector<uint8_t> audioLevels)
+void ProjectClip::updateAudioThumbnail(std::shared_ptr<const AudioLevels> levels)
 {
     if (!KdenliveSettings::audiothumbnails()) {
         return;
     }
-    audioFrameCache = audioLevels;
+    audioLevels = std::move(levels);
     m_audioThumbCreated = true;
     updateTimelineClips({TimelineModel::ReloadThumbRole});
 }
@@ -316,6 +329,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool audioStreamChanged, bool
         ThumbnailCache::get()->invalidateThumbsForClip(clipId(), false);
         pCore->jobManager()->discardJobs(clipId(), AbstractClipJob::THUMBJOB);
         m_thumbsProducer.reset();
+        ThumbnailScheduler::get()->invalidate(clipId());
         pCore->jobManager()->startJob<ThumbJob>({clipId()}, loadjobId, QString(), -1, true, true);
     } else {
         // If another load job is running?
@@ -330,6 +344,7 @@ void ProjectClip::reloadProducer(bool refreshOnly, bool audioStreamChanged, bool
         if (!xml.isNull()) {
             pCore->jobManager()->discardJobs(clipId(), AbstractClipJob::THUMBJOB);
             m_thumbsProducer.reset();
+            ThumbnailScheduler::get()->invalidate(clipId());
             ClipType::ProducerType type = clipType();
             if (type != ClipType::Color && type != ClipType::Image && type != ClipType::SlideShow) {
                 xml.removeAttribute("out");
@@ -415,6 +430,7 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool repl
     QMutexLocker locker(&m_producerMutex);
     updateProducer(producer);
     m_thumbsProducer.reset();
+    ThumbnailScheduler::get()->invalidate(clipId());
     connectEffectStack();
 
     // Update info
@@ -503,6 +519,7 @@ bool ProjectClip::setProducer(std::shared_ptr<Mlt::Producer> producer, bool repl
     m_audioProducers.clear();
     m_videoProducers.clear();
     m_timewarpProducers.clear();
+    m_producerUse.clear();
     emit refreshPropertiesPanel();
     if (m_clipType == ClipType::AV || m_clipType == ClipType::Video || m_clipType == ClipType::Playlist) {
         QTimer::singleShot(1000, this, [this]() {
@@ -526,36 +543,46 @@ std::shared_ptr<Mlt::Producer> ProjectClip::thumbProducer()
         return nullptr;
     }
     QMutexLocker lock(&m_thumbMutex);
+    m_thumbsProducer = createThumbProducer();
+    return m_thumbsProducer;
+}
+
+std::shared_ptr<Mlt::Producer> ProjectClip::createThumbProducer()
+{
+    if (clipType() == ClipType::Unknown) {
+        return nullptr;
+    }
     std::shared_ptr<Mlt::Producer> prod = originalProducer();
     if (!prod->is_valid()) {
         return nullptr;
     }
+    std::shared_ptr<Mlt::Producer> thumbsProducer;
     if (KdenliveSettings::gpu_accel()) {
         // TODO: when the original producer changes, we must reload this thumb producer
-        m_thumbsProducer = softClone(ClipController::getPassPropertiesList());
+        thumbsProducer = softClone(ClipController::getPassPropertiesList());
     } else {
         QString mltService = m_masterProducer->get("mlt_service");
         const QString mltResource = m_masterProducer->get("resource");
         if (mltService == QLatin1String("avformat")) {
             mltService = QStringLiteral("avformat-novalidate");
         }
-        m_thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
-        if (m_thumbsProducer->is_valid()) {
+        thumbsProducer.reset(new Mlt::Producer(*pCore->thumbProfile(), mltService.toUtf8().constData(), mltResource.toUtf8().constData()));
+        if (thumbsProducer->is_valid()) {
             Mlt::Properties original(m_masterProducer->get_properties());
-            Mlt::Properties cloneProps(m_thumbsProducer->get_properties());
+            Mlt::Properties cloneProps(thumbsProducer->get_properties());
             cloneProps.pass_list(original, ClipController::getPassPropertiesList());
             Mlt::Filter scaler(*pCore->thumbProfile(), "swscale");
             Mlt::Filter padder(*pCore->thumbProfile(), "resize");
             Mlt::Filter converter(*pCore->thumbProfile(), "avcolor_space");
-            m_thumbsProducer->set("audio_index", -1);
+            thumbsProducer->set("audio_index", -1);
             // Required to make get_playtime() return > 1
-            m_thumbsProducer->set("out", m_thumbsProducer->get_length() -1);
-            m_thumbsProducer->attach(scaler);
-            m_thumbsProducer->attach(padder);
-            m_thumbsProducer->attach(converter);
+            thumbsProducer->set("out", thumbsProducer->get_length() -1);
+            thumbsProducer->attach(scaler);
+            thumbsProducer->attach(padder);
+            thumbsProducer->attach(converter);
         }
     }
-    return m_thumbsProducer;
+    return thumbsProducer;
 }
 
 void ProjectClip::createDisabledMasterProducer()
@@ -587,34 +614,16 @@ std::shared_ptr<Mlt::Producer> ProjectClip::getTimelineProducer(int trackId, int
         }
         if (state == PlaylistState::AudioOnly) {
             // We need to get an audio producer, if none exists
-            if (m_audioProducers.count(trackId) == 0) {
-                m_audioProducers[trackId] = cloneProducer(true);
-                m_audioProducers[trackId]->set("set.test_audio", 0);
-                m_audioProducers[trackId]->set("set.test_image", 1);
-                m_effectStack->addService(m_audioProducers[trackId]);
-            }
-            return std::shared_ptr<Mlt::Producer>(m_audioProducers[trackId]->cut());
-        }
-        if (m_audioProducers.count(trackId) > 0) {
-            m_effectStack->removeService(m_audioProducers[trackId]);
-            m_audioProducers.erase(trackId);
+            return std::shared_ptr<Mlt::Producer>(pooledProducer(m_audioProducers, trackId, true)->cut());
         }
+        releasePooledProducer(m_audioProducers, trackId);
         if (state == PlaylistState::VideoOnly) {
             // we return the video producer
-            // We need to get an audio producer, if none exists
-            if (m_videoProducers.count(trackId) == 0) {
-                m_videoProducers[trackId] = cloneProducer(true);
-                m_videoProducers[trackId]->set("set.test_audio", 1);
-                m_videoProducers[trackId]->set("set.test_image", 0);
-                m_effectStack->addService(m_videoProducers[trackId]);
-            }
+            // We need to get a video producer, if none exists
             int duration = m_masterProducer->time_to_frames(m_masterProducer->get("kdenlive:duration"));
-            return std::shared_ptr<Mlt::Producer>(m_videoProducers[trackId]->cut(-1, duration > 0 ? duration - 1: -1));
-        }
-        if (m_videoProducers.count(trackId) > 0) {
-            m_effectStack->removeService(m_videoProducers[trackId]);
-            m_videoProducers.erase(trackId);
+            return std::shared_ptr<Mlt::Producer>(pooledProducer(m_videoProducers, trackId, false)->cut(-1, duration > 0 ? duration - 1: -1));
         }
+        releasePooledProducer(m_videoProducers, trackId);
         Q_ASSERT(state == PlaylistState::Disabled);
         createDisabledMasterProducer();
         int duration = m_masterProducer->time_to_frames(m_masterProducer->get("kdenlive:duration"));
@@ -739,8 +748,145 @@ std::pair<std::shared_ptr<Mlt::Producer>, bool> ProjectClip::giveMasterAndGetTim
     return {std::shared_ptr<Mlt::Producer>(ClipController::mediaUnavailable->cut()), false};
 }
 
+std::shared_ptr<Mlt::Producer> ProjectClip::pooledProducer(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, int trackId, bool audio)
+{
+    auto it = producers.find(trackId);
+    if (it == producers.end()) {
+        // Tracks never share a producer: cuts of the same producer played at different positions would seek on every frame.
+        // A producer whose cuts were all deleted is only referenced by the pool though, so it can be handed over to this track
+        std::shared_ptr<Mlt::Producer> producer;
+        for (const auto &p : producers) {
+            if (p.second->ref_count() <= 1 && (!producer || m_producerUse[p.second.get()] > m_producerUse[producer.get()])) {
+                producer = p.second;
+            }
+        }
+        if (producer) {
+            for (auto p = producers.begin(); p != producers.end();) {
+                if (p->second == producer) {
+                    p = producers.erase(p);
+                } else {
+                    ++p;
+                }
+            }
+        } else {
+            producer = cloneProducer(true);
+            producer->set("set.test_audio", audio ? 0 : 1);
+            producer->set("set.test_image", audio ? 1 : 0);
+            m_effectStack->addService(producer);
+        }
+        it = producers.emplace(trackId, producer).first;
+        closeIdleProducers(producers, producer);
+    }
+    m_producerUse[it->second.get()] = ++m_producerUseCounter;
+    return it->second;
+}
+
+void ProjectClip::closeIdleProducers(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, const std::shared_ptr<Mlt::Producer> &keep)
+{
+    std::unordered_set<const Mlt::Producer *> distinct;
+    for (const auto &p : producers) {
+        distinct.insert(p.second.get());
+    }
+    const size_t limit = size_t(qMax(1, KdenliveSettings::maxdecodersperclip()));
+    while (distinct.size() > limit) {
+        std::shared_ptr<Mlt::Producer> leastRecent;
+        for (const auto &p : producers) {
+            if (p.second != keep && p.second->ref_count() <= 1 && (!leastRecent || m_producerUse[p.second.get()] < m_producerUse[leastRecent.get()])) {
+                leastRecent = p.second;
+            }
+        }
+        if (!leastRecent) {
+            // All the decoders are used by timeline clips
+            return;
+        }
+        for (auto p = producers.begin(); p != producers.end();) {
+            if (p->second == leastRecent) {
+                p = producers.erase(p);
+            } else {
+                ++p;
+            }
+        }
+        distinct.erase(leastRecent.get());
+        m_effectStack->removeService(leastRecent);
+        m_producerUse.erase(leastRecent.get());
+    }
+}
+
+void ProjectClip::releasePooledProducer(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, int key)
+{
+    auto it = producers.find(key);
+    if (it == producers.end()) {
+        return;
+    }
+    std::shared_ptr<Mlt::Producer> producer = it->second;
+    producers.erase(it);
+    m_effectStack->removeService(producer);
+    m_producerUse.erase(producer.get());
+}
+
+ProjectClip::DecoderStats ProjectClip::decoderStats() const
+{
+    DecoderStats stats;
+    std::unordered_set<const Mlt::Producer *> audio;
+    std::unordered_set<const Mlt::Producer *> video;
+    for (const auto &p : m_audioProducers) {
+        audio.insert(p.second.get());
+    }
+    for (const auto &p : m_videoProducers) {
+        video.insert(p.second.get());
+    }
+    for (const auto &p : m_timewarpProducers) {
+        video.insert(p.second.get());
+    }
+    stats.audio = int(audio.size());
+    stats.video = int(video.size());
+    stats.users = int(m_audioProducers.size() + m_videoProducers.size() + m_timewarpProducers.size());
+    // A video decoder keeps its reference and threading frames in 4:2:0, an audio decoder a few packets
+    const qint64 frameBytes = qint64(getProducerIntProperty(QStringLiteral("meta.media.width"))) * getProducerIntProperty(QStringLiteral("meta.media.height")) * 3 / 2;
+    stats.memory = stats.video * frameBytes * 16 + stats.audio * 1024 * 1024;
+    return stats;
+}
+
+std::shared_ptr<Mlt::Producer> ProjectClip::cloneProducerDirect(bool removeEffects) const
+{
+    if (!QString::fromLatin1(m_masterProducer->get("mlt_service")).startsWith(QLatin1String("avformat"))) {
+        return nullptr;
+    }
+    // Filters that are not kdenlive effects can only be copied through xml
+    int ct = 0;
+    Mlt::Filter *filter = m_masterProducer->filter(ct);
+    while (filter) {
+        const bool effect = filter->get("kdenlive_id") != nullptr && strlen(filter->get("kdenlive_id")) > 0;
+        delete filter;
+        if (!removeEffects || !effect) {
+            return nullptr;
+        }
+        filter = m_masterProducer->filter(++ct);
+    }
+    std::shared_ptr<Mlt::Producer> prod(new Mlt::Producer(pCore->getCurrentProfile()->profile(), "avformat-novalidate", m_masterProducer->get("resource")));
+    if (!prod->is_valid()) {
+        return nullptr;
+    }
+    // Copy the public properties like the xml consumer does, metadata included
+    for (int i = 0; i < m_masterProducer->count(); ++i) {
+        const char *name = m_masterProducer->get_name(i);
+        const char *value = m_masterProducer->get(i);
+        if (name == nullptr || value == nullptr || name[0] == '_' || strcmp(name, "mlt_service") == 0 || strcmp(name, "mlt_type") == 0 ||
+            strcmp(name, "resource") == 0 || strcmp(name, "id") == 0) {
+            continue;
+        }
+        prod->set(name, value);
+    }
+    prod->set("mute_on_pause", 0);
+    return prod;
+}
+
 std::shared_ptr<Mlt::Producer> ProjectClip::cloneProducer(bool removeEffects)
 {
+    std::shared_ptr<Mlt::Producer> direct = cloneProducerDirect(removeEffects);
+    if (direct) {
+        return direct;
+    }
     Mlt::Consumer c(pCore->getCurrentProfile()->profile(), "xml", "string");
     Mlt::Service s(m_masterProducer->get_service());
     int ignore = s.get_int("ignore_points");
@@ -900,27 +1046,17 @@ const QString ProjectClip::getFileHash()
         fileData = getProducerProperty(QStringLiteral("resource")).toUtf8();
         fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
         break;
-    default:
-        QFile file(clipUrl());
-        if (file.open(QIODevice::ReadOnly)) { // write size and hash only if resource points to a file
-            /*
-             * 1 MB = 1 second per 450 files (or faster)
-             * 10 MB = 9 seconds per 450 files (or faster)
-             */
-            if (file.size() > 2000000) {
-                fileData = file.read(1000000);
-                if (file.seek(file.size() - 1000000)) {
-                    fileData.append(file.readAll());
-                }
-            } else {
-                fileData = file.readAll();
-            }
-            file.close();
-            ClipController::setProducerProperty(QStringLiteral("kdenlive:file_size"), QString::number(file.size()));
-            fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
+    default: {
+        // write size and hash only if resource points to a file, the media cache avoids reading files that did not change
+        qint64 size = 0;
+        const QString hash = MediaCache::get()->fileHash(clipUrl(), &size);
+        if (!hash.isEmpty()) {
+            ClipController::setProducerProperty(QStringLiteral("kdenlive:file_size"), QString::number(size));
+            fileHash = QByteArray::fromHex(hash.toLatin1());
         }
         break;
     }
+    }
     if (fileHash.isEmpty()) {
         qDebug() << "// WARNING EMPTY CLIP HASH: ";
         return QString();
@@ -1216,11 +1352,14 @@ int ProjectClip::audioChannels() const
 
 void ProjectClip::discardAudioThumb()
 {
+    // Release our mapping of the cache file before removing it
+    audioLevels.reset();
     QString audioThumbPath = getAudioThumbPath();
     if (!audioThumbPath.isEmpty()) {
         QFile::remove(audioThumbPath);
+        // Also remove the levels cached by older versions, otherwise the next audio thumb job would import them again
+        QFile::remove(getLegacyAudioThumbPath());
     }
-    audioFrameCache.clear();
     qCDebug(KDENLIVE_LOG) << "////////////////////  DISCARD AUIIO THUMBNS";
     m_audioThumbCreated = false;
     refreshAudioInfo();
@@ -1251,10 +1390,20 @@ const QString ProjectClip::getAudioThumbPath(bool miniThumb)
         audioPath.append(QLatin1Char('_') + QString::number(audioInfo()->audio_index()));
     }
     int roundedFps = (int)pCore->getCurrentFps();
-    audioPath.append(QStringLiteral("_%1_audio.png").arg(roundedFps));
+    audioPath.append(QStringLiteral("_%1_audio").arg(roundedFps) + AudioLevels::extension());
     return audioPath;
 }
 
+const QString ProjectClip::getLegacyAudioThumbPath()
+{
+    QString audioPath = getAudioThumbPath();
+    if (audioPath.isEmpty()) {
+        return QString();
+    }
+    audioPath.chop(AudioLevels::extension().size());
+    return audioPath + QStringLiteral(".png");
+}
+
 QStringList ProjectClip::updatedAnalysisData(const QString &name, const QString &data, int offset)
 {
     if (data.isEmpty()) {
@@ -1360,14 +1509,8 @@ void ProjectClip::deregisterTimelineClip(int clipId)
     qDebug() << " ** * DEREGISTERING TIMELINE CLIP: " << clipId;
     Q_ASSERT(m_registeredClips.count(clipId) > 0);
     m_registeredClips.erase(clipId);
-    if (m_videoProducers.count(clipId) > 0) {
-        m_effectStack->removeService(m_videoProducers[clipId]);
-        m_videoProducers.erase(clipId);
-    }
-    if (m_audioProducers.count(clipId) > 0) {
-        m_effectStack->removeService(m_audioProducers[clipId]);
-        m_audioProducers.erase(clipId);
-    }
+    releasePooledProducer(m_videoProducers, clipId);
+    releasePooledProducer(m_audioProducers, clipId);
     setRefCount((uint)m_registeredClips.size());
 }
 
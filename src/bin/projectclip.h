@@ -32,6 +32,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMutex>
 #include <memory>
 
+class AudioLevels;
 class ClipPropertiesController;
 class ProjectFolder;
 class ProjectSubClip;
@@ -151,6 +152,8 @@ public:
 
     /** @brief Returns this clip's producer. */
     std::shared_ptr<Mlt::Producer> thumbProducer() override;
+    /** @brief Returns a new producer suitable for thumbnail extraction, that is not shared with other users. */
+    std::shared_ptr<Mlt::Producer> createThumbProducer();
 
     /** @brief Recursively disable/enable bin effects. */
     void setBinEffectsEnabled(bool enabled) override;
@@ -169,9 +172,8 @@ public:
     /** @brief Returns true if we are using a proxy for this clip. */
     bool hasProxy() const;
 
-    /** Cache for every audio Frame with 10 Bytes */
-    /** format is frame -> channel ->bytes */
-    QVector<uint8_t> audioFrameCache;
+    /** Audio levels of every frame, shared with the timeline clips. Format is frame -> channel -> byte */
+    std::shared_ptr<const AudioLevels> audioLevels;
     bool audioThumbCreated() const;
 
     void setWaitingStatus(const QString &id);
@@ -189,6 +191,8 @@ public:
     void discardAudioThumb();
     /** @brief Get path for this clip's audio thumbnail */
     const QString getAudioThumbPath(bool miniThumb = false);
+    /** @brief Get path where older versions cached this clip's audio levels as an image */
+    const QString getLegacyAudioThumbPath();
     /** @brief Returns true if this producer has audio and can be splitted on timeline*/
     bool isSplittable() const;
 
@@ -198,6 +202,19 @@ public:
     bool isIncludedInTimeline() override;
     /** @brief Returns a list of all timeline clip ids for this bin clip */
     QList<int> timelineInstances() const;
+
+    struct DecoderStats
+    {
+        /** @brief Producers decoding audio, and video (including timewarp producers) */
+        int audio = 0;
+        int video = 0;
+        /** @brief Timeline tracks using these producers */
+        int users = 0;
+        /** @brief Estimated memory held by the decoders, in bytes */
+        qint64 memory = 0;
+    };
+    /** @brief Returns the decoders opened for this clip in the timeline */
+    DecoderStats decoderStats() const;
     /** @brief This function returns a cut to the master producer associated to the timeline clip with given ID.
         Each clip must have a different master producer (see comment of the class)
     */
@@ -248,9 +265,8 @@ protected:
     void connectEffectStack() override;
 
 public slots:
-    /* @brief Store the audio thumbnails once computed. Note that the parameter is a value and not a reference, fill free to use it as a sink (use std::move to
-     * avoid copy). */
-    void updateAudioThumbnail(const QVector<uint8_t> audioLevels);
+    /* @brief Store the audio thumbnails once computed. The levels are immutable and shared, so no copy is made. */
+    void updateAudioThumbnail(std::shared_ptr<const AudioLevels> levels);
     /** @brief Delete the proxy file */
     void deleteProxy();
 
@@ -268,6 +284,16 @@ private:
 
     // This is a helper function that creates the disabled producer. This is a clone of the original one, with audio and video disabled
     void createDisabledMasterProducer();
+    /** @brief Clones an avformat master producer by copying its properties, without the xml round trip. Returns nullptr for other producers */
+    std::shared_ptr<Mlt::Producer> cloneProducerDirect(bool removeEffects) const;
+    /** @brief Returns the producer of @param trackId in @param producers. Each track gets its own producer, reusing one that no timeline clip
+        references anymore, or opening a new one */
+    std::shared_ptr<Mlt::Producer> pooledProducer(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, int trackId, bool audio);
+    /** @brief Closes the least recently used producers that no timeline clip references until @param producers holds maxdecodersperclip ones,
+        @param keep excepted */
+    void closeIdleProducers(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, const std::shared_ptr<Mlt::Producer> &keep);
+    /** @brief Removes and releases the producer of @param key */
+    void releasePooledProducer(std::unordered_map<int, std::shared_ptr<Mlt::Producer>> &producers, int key);
 
     std::map<int, std::weak_ptr<TimelineModel>> m_registeredClips;
 
@@ -277,6 +303,9 @@ private:
     std::unordered_map<int, std::shared_ptr<Mlt::Producer>> m_videoProducers;
     std::unordered_map<int, std::shared_ptr<Mlt::Producer>> m_timewarpProducers;
     std::shared_ptr<Mlt::Producer> m_disabledProducer;
+    // last use of each pooled producer, used to pick the unused ones to reuse or close
+    std::unordered_map<const Mlt::Producer *, quint64> m_producerUse;
+    quint64 m_producerUseCounter = 0;
 
 signals:
     void producerChanged(const QString &, const std::shared_ptr<Mlt::Producer> &);
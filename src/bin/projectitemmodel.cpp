@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "projectitemmodel.h"
 #include "abstractprojectitem.h"
 #include "binplaylist.hpp"
+#include "clipprober.hpp"
 #include "core.h"
 #include "doc/kdenlivedoc.h"
 #include "filewatcher.hpp"
@@ -390,7 +391,7 @@ std::shared_ptr<ProjectClip> ProjectItemModel::getClipByBinID(const QString &bin
     return nullptr;
 }
 
-const QVector<uint8_t> ProjectItemModel::getAudioLevelsByBinID(const QString &binId)
+std::shared_ptr<const AudioLevels> ProjectItemModel::getAudioLevelsByBinID(const QString &binId)
 {
     READ_LOCK();
     if (binId.contains(QLatin1Char('_'))) {
@@ -399,10 +400,10 @@ const QVector<uint8_t> ProjectItemModel::getAudioLevelsByBinID(const QString &bi
     for (const auto &clip : m_allItems) {
         auto c = std::static_pointer_cast<AbstractProjectItem>(clip.second.lock());
         if (c->itemType() == AbstractProjectItem::ClipItem && c->clipId() == binId) {
-            return std::static_pointer_cast<ProjectClip>(c)->audioFrameCache;
+            return std::static_pointer_cast<ProjectClip>(c)->audioLevels;
         }
     }
-    return QVector<uint8_t>();
+    return nullptr;
 }
 
 bool ProjectItemModel::hasClip(const QString &binId)
@@ -490,6 +491,7 @@ void ProjectItemModel::clean()
     Q_ASSERT(rootItem->childCount() == 0);
     m_nextId = 1;
     m_fileWatcher->clear();
+    m_prober.reset();
 }
 
 std::shared_ptr<ProjectFolder> ProjectItemModel::getRootFolder() const
@@ -994,6 +996,8 @@ void ProjectItemModel::loadBinPlaylist(Mlt::Tractor *documentTractor, Mlt::Tract
                 progressDialog->setMaximum(progressDialog->maximum() + max);
             }
             QMap <int, std::shared_ptr<Mlt::Producer> > binProducers;
+            // Clips are read in parallel while we walk the playlist, insertion only waits for the ones that need probing
+            m_prober.reset(new ClipProber(pCore->getCurrentProfile()->profile()));
             for (int i = 0; i < max; i++) {
                 if (progressDialog) {
                     progressDialog->setValue(i);
@@ -1007,11 +1011,15 @@ void ProjectItemModel::loadBinPlaylist(Mlt::Tractor *documentTractor, Mlt::Tract
                 int id = producer->get_int("kdenlive:id");
                 if (!id) id = getFreeClipId();
                 binProducers.insert(id, producer);
+                m_prober->enqueue(id, producer);
             }
             // Do the real insertion
             QMapIterator<int, std::shared_ptr<Mlt::Producer> > i(binProducers);
             while (i.hasNext()) {
                 i.next();
+                if (!m_prober->waitFor(i.key())) {
+                    qDebug() << "Cannot probe clip" << i.key() << i.value()->get("resource");
+                }
                 QString newId = QString::number(getFreeClipId());
                 QString parentId = qstrdup(i.value()->get("kdenlive:folderid"));
                 if (parentId.isEmpty()) {
@@ -1022,6 +1030,7 @@ void ProjectItemModel::loadBinPlaylist(Mlt::Tractor *documentTractor, Mlt::Tract
                 binIdCorresp[QString::number(i.key())] = newId;
                 qDebug() << "Loaded clip " << i.key() << "under id" << newId;
             }
+            qDebug() << "Probed" << m_prober->probedCount() << "clips," << m_prober->failedCount() << "failed";
         }
     }
     m_binPlaylist->setRetainIn(modelTractor);
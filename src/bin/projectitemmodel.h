@@ -34,7 +34,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSize>
 
 class AbstractProjectItem;
+class AudioLevels;
 class BinPlaylist;
+class ClipProber;
 class FileWatcher;
 class MarkerListModel;
 class ProjectClip;
@@ -67,8 +69,8 @@ public:
 
     /** @brief Returns a clip from the hierarchy, given its id */
     std::shared_ptr<ProjectClip> getClipByBinID(const QString &binId);
-    /** @brief Returns audio levels for a clip from its id */
-    const QVector <uint8_t>getAudioLevelsByBinID(const QString &binId);
+    /** @brief Returns the shared audio levels for a clip from its id, nullptr if they are not computed yet */
+    std::shared_ptr<const AudioLevels> getAudioLevelsByBinID(const QString &binId);
 
     /** @brief Returns a list of clips using the given url */
     QStringList getClipByUrl(const QFileInfo &url) const;
@@ -247,6 +249,9 @@ private:
 
     std::unique_ptr<FileWatcher> m_fileWatcher;
 
+    /** @brief Reads the clips of the project being loaded */
+    std::unique_ptr<ClipProber> m_prober;
+
     int m_nextId;
     QIcon m_blankThumb;
     PlaylistState::ClipState m_dragType;
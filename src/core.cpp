@@ -14,6 +14,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "capture/mediacapture.h"
 #include "doc/docundostack.hpp"
 #include "doc/kdenlivedoc.h"
+#include "effects/effectsrepository.hpp"
 #include "jobs/jobmanager.h"
 #include "kdenlive_debug.h"
 #include "kdenlivesettings.h"
@@ -25,10 +26,12 @@ the Free Software Foundation, either version 3 of the License, or
 #include "monitor/monitormanager.h"
 #include "profiles/profilemodel.hpp"
 #include "profiles/profilerepository.hpp"
+#include "project/loadtimings.h"
 #include "project/projectmanager.h"
 #include "timeline2/model/timelineitemmodel.hpp"
 #include "timeline2/view/timelinecontroller.h"
 #include "timeline2/view/timelinewidget.h"
+#include "transitions/transitionsrepository.hpp"
 
 #include <mlt++/MltRepository.h>
 
@@ -75,8 +78,10 @@ void Core::build(bool isAppImage, const QString &MltPath)
     if (m_self) {
         return;
     }
+    LoadTimings timings;
     m_self.reset(new Core());
     m_self->initLocale();
+    timings.mark(QStringLiteral("locale"));
 
     qRegisterMetaType<audioShortVector>("audioShortVector");
     qRegisterMetaType<QVector<double>>("QVector<double>");
@@ -100,6 +105,7 @@ void Core::build(bool isAppImage, const QString &MltPath)
         // Open connection with Mlt
         MltConnection::construct(MltPath);
     }
+    timings.mark(QStringLiteral("mlt"));
 
     // load the profile from disk
     ProfileRepository::get()->refresh();
@@ -109,6 +115,13 @@ void Core::build(bool isAppImage, const QString &MltPath)
         m_self->m_profile = ProjectManager::getDefaultProjectFormat();
         KdenliveSettings::setDefault_profile(m_self->m_profile);
     }
+    timings.mark(QStringLiteral("profiles"));
+
+    // Load the assets now, they are cached between runs
+    EffectsRepository::get();
+    timings.mark(QStringLiteral("effects"));
+    TransitionsRepository::get();
+    timings.mark(QStringLiteral("transitions"));
 
     // Init producer shown for unavailable media
     // TODO make it a more proper image, it currently causes a crash on exit
@@ -118,6 +131,8 @@ void Core::build(bool isAppImage, const QString &MltPath)
     m_self->m_projectItemModel = ProjectItemModel::construct();
     // Job manager must be created before bin to correctly connect
     m_self->m_jobManager.reset(new JobManager(m_self.get()));
+    timings.mark(QStringLiteral("models"));
+    qCDebug(KDENLIVE_LOG) << "Core built," << timings.toString();
 }
 
 void Core::initGUI(const QUrl &Url, const QString &clipsToLoad)
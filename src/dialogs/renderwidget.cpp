@@ -35,6 +35,7 @@
 #include "klocalizedstring.h"
 #include <KColorScheme>
 #include <KIO/DesktopExecParser>
+#include <KIO/Global>
 #include <KMessageBox>
 #include <KNotification>
 #include <KRun>
@@ -50,10 +51,13 @@
 #include <QHeaderView>
 #include <QInputDialog>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QKeyEvent>
+#include <QLockFile>
 #include <QMimeDatabase>
 #include <QProcess>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QTemporaryFile>
 #include <QThread>
@@ -71,6 +75,14 @@
 #ifdef Q_OS_MAC
 #include <xlocale.h>
 #endif
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
 
 // Render profiles roles
 enum {
@@ -95,6 +107,11 @@ const int ParametersRole = Qt::UserRole + 1;
 const int TimeRole = Qt::UserRole + 2;
 const int ProgressRole = Qt::UserRole + 3;
 const int ExtraInfoRole = Qt::UserRole + 5;
+// Resources declared by a job for the queue admission: threads, memory in MB and rendered frames
+const int ThreadsRole = Qt::UserRole + 6;
+const int MemoryRole = Qt::UserRole + 7;
+const int FramesRole = Qt::UserRole + 8;
+const int FpsRole = Qt::UserRole + 9;
 
 // Running job status
 enum JOBSTATUS { WAITINGJOB = 0, STARTINGJOB, RUNNINGJOB, FINISHEDJOB, FAILEDJOB, ABORTEDJOB };
@@ -103,6 +120,72 @@ static QStringList acodecsList;
 static QStringList vcodecsList;
 static QStringList supportedFormats;
 
+namespace {
+// Memory used by a render process besides its frame buffers, in MB
+const int processBaseMemory = 200;
+// Frames buffered by the MLT consumer
+const int consumerBufferFrames = 25;
+
+// Folder of the render queue files, one per running instance
+QString renderQueueFolder()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/renderqueue");
+}
+
+QString renderQueueFile(qint64 pid)
+{
+    return renderQueueFolder() + QStringLiteral("/%1.json").arg(pid);
+}
+
+/** @brief Installed memory in MB, 0 if unknown */
+qint64 physicalMemory()
+{
+#ifdef Q_OS_WIN
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status) != 0) {
+        return qint64(status.ullTotalPhys / (1024 * 1024));
+    }
+#elif defined(Q_OS_UNIX) && defined(_SC_PHYS_PAGES)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && pageSize > 0) {
+        return qint64(pages) * pageSize / (1024 * 1024);
+    }
+#endif
+    return 0;
+}
+
+/** @brief Estimates the threads and memory used to render the playlist @param doc in @param processes parallel segments */
+void declareJobResources(QTreeWidgetItem *item, const QDomDocument &doc, int processes)
+{
+    const QDomElement consumer = doc.documentElement().firstChildElement(QStringLiteral("consumer"));
+    const QDomElement profile = doc.elementsByTagName(QStringLiteral("profile")).at(0).toElement();
+    int threads = 1;
+    int memory = processBaseMemory;
+    if (consumer.attribute(QStringLiteral("vn")) != QLatin1String("1")) {
+        // Segmented renders use a single MLT worker per process
+        const int workers = processes > 1 ? 1 : qMax(1, qAbs(consumer.attribute(QStringLiteral("real_time"), QStringLiteral("1")).toInt()));
+        int encoders = consumer.attribute(QStringLiteral("threads")).toInt();
+        if (encoders <= 0) {
+            // FFmpeg picks its own thread count
+            encoders = qMax(1, QThread::idealThreadCount() / 2);
+        }
+        threads = workers + encoders;
+        QSize size(profile.attribute(QStringLiteral("width")).toInt(), profile.attribute(QStringLiteral("height")).toInt());
+        const QString subsize = consumer.attribute(QStringLiteral("s"));
+        if (subsize.contains(QLatin1Char('x'))) {
+            size = QSize(subsize.section(QLatin1Char('x'), 0, 0).toInt(), subsize.section(QLatin1Char('x'), 1, 1).toInt());
+        }
+        const qint64 frameBytes = qint64(size.width()) * size.height() * 4;
+        memory += int(frameBytes * (consumerBufferFrames + 2 * workers) / (1024 * 1024));
+    }
+    item->setData(1, ThreadsRole, threads * processes);
+    item->setData(1, MemoryRole, memory * processes);
+    item->setData(1, FramesRole, qMax(0, consumer.attribute(QStringLiteral("out")).toInt() - consumer.attribute(QStringLiteral("in")).toInt() + 1));
+}
+} // namespace
+
 RenderJobItem::RenderJobItem(QTreeWidget *parent, const QStringList &strings, int type)
     : QTreeWidgetItem(parent, strings, type)
     , m_status(-1)
@@ -359,12 +442,18 @@ RenderWidget::RenderWidget(bool enableProxy, QWidget *parent)
     if (KdenliveSettings::gpu_accel()) {
         // Disable parallel rendering for movit
         m_view.parallel_process->setEnabled(false);
+        m_view.render_segments->setEnabled(false);
     }
+    m_view.render_segments->setMaximum(qMax(1, QThread::idealThreadCount()));
+    m_view.render_segments->setValue(KdenliveSettings::rendersegments());
+    connect(m_view.render_segments, QOverload<int>::of(&QSpinBox::valueChanged), [](int value) { KdenliveSettings::setRendersegments(value); });
     m_view.field_order->setEnabled(false);
     connect(m_view.scanning_list, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index) { m_view.field_order->setEnabled(index == 2); });
     refreshView();
     focusFirstVisibleItem();
     adjustSize();
+    // Resume the jobs of a session that crashed
+    restoreRenderQueue();
 }
 
 void RenderWidget::slotShareActionFinished(const QJsonObject &output, int error, const QString &message)
@@ -399,6 +488,8 @@ QSize RenderWidget::sizeHint() const
 
 RenderWidget::~RenderWidget()
 {
+    // Waiting jobs were either handed to a script or discarded when closing, only a crash keeps the queue
+    QFile::remove(renderQueueFile(QCoreApplication::applicationPid()));
     m_view.running_jobs->blockSignals(true);
     m_view.scripts_list->blockSignals(true);
     m_view.running_jobs->clear();
@@ -1594,6 +1685,13 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
         file.close();
     }
 
+    // Segmented render, kdenlive_render falls back to a single process when the playlist cannot be split
+    QStringList segmentArgs;
+    if (m_view.render_segments->isEnabled() && m_view.render_segments->value() > 1) {
+        segmentArgs << QStringLiteral("-segments:%1").arg(m_view.render_segments->value())
+                    << QStringLiteral("-ffmpeg:%1").arg(KdenliveSettings::ffmpegpath());
+    }
+
     // Create job
     RenderJobItem *renderItem = nullptr;
     QList<QTreeWidgetItem *> existing = m_view.running_jobs->findItems(renderedFile, Qt::MatchExactly, 1);
@@ -1615,7 +1713,9 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
             renderItem->setData(1, Qt::UserRole, i18n("Waiting..."));
             QStringList argsJob = {KdenliveSettings::rendererpath(), playlistPath, renderedFile,
                                    QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid())};
+            argsJob << segmentArgs;
             renderItem->setData(1, ParametersRole, argsJob);
+            declareJobResources(renderItem, doc, segmentArgs.isEmpty() ? 1 : m_view.render_segments->value());
             renderItem->setData(1, TimeRole, QDateTime::currentDateTime());
             if (!exportAudio) {
                 renderItem->setData(1, ExtraInfoRole, i18n("Video without audio track"));
@@ -1637,7 +1737,9 @@ void RenderWidget::generateRenderFiles(QDomDocument doc, const QString &playlist
         renderItem = new RenderJobItem(m_view.running_jobs, QStringList() << QString() << renderedFile);
         renderItem->setData(1, TimeRole, QDateTime::currentDateTime());
         QStringList argsJob = {KdenliveSettings::rendererpath(), pl, renderedFile, QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid())};
+        argsJob << segmentArgs;
         renderItem->setData(1, ParametersRole, argsJob);
+        declareJobResources(renderItem, doc, segmentArgs.isEmpty() ? 1 : m_view.render_segments->value());
         qDebug() << "* CREATED JOB WITH ARGS: " << argsJob;
         if (!exportAudio) {
             renderItem->setData(1, ExtraInfoRole, i18n("Video without audio track"));
@@ -1690,51 +1792,211 @@ void RenderWidget::checkRenderStatus()
     if (m_blockProcessing) {
         return;
     }
+    const int threadBudget = KdenliveSettings::renderthreadbudget() > 0 ? KdenliveSettings::renderthreadbudget() : QThread::idealThreadCount();
+    // Keep half of the memory for the system and Kdenlive itself, no limit if it cannot be found
+    const qint64 memoryBudget = KdenliveSettings::rendermemorybudget() > 0 ? KdenliveSettings::rendermemorybudget() : physicalMemory() / 2;
 
+    // Resources used by the running jobs
+    int usedThreads = 0;
+    qint64 usedMemory = 0;
+    QStringList activeFiles;
     auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
-
-    // Make sure no other rendering is running
     while (item != nullptr) {
-        if (item->status() == RUNNINGJOB) {
-            return;
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB) {
+            usedThreads += item->data(1, ThreadsRole).toInt();
+            usedMemory += item->data(1, MemoryRole).toInt();
+            activeFiles << item->text(1);
         }
         item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
     }
     item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
     bool waitingJob = false;
 
-    // Find first waiting job
+    // Start the waiting jobs that fit in the budget, in queue order
     while (item != nullptr) {
-        if (item->status() == WAITINGJOB) {
-            item->setData(1, TimeRole, QDateTime::currentDateTime());
-            waitingJob = true;
-            startRendering(item);
-            // Check for 2 pass encoding
-            QStringList jobData = item->data(1, ParametersRole).toStringList();
-            if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
-                // Find and remove 1st pass job
-                QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
-                QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
-                while (above) {
-                    QStringList aboveData = above->data(1, ParametersRole).toStringList();
-                    qDebug() << "// GOT  JOB: " << aboveData.at(1);
-                    if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
-                        delete above;
-                        break;
-                    }
-                    above = m_view.running_jobs->itemAbove(above);
+        if (item->status() != WAITINGJOB) {
+            item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+            continue;
+        }
+        waitingJob = true;
+        const int threads = item->data(1, ThreadsRole).toInt();
+        const int memory = item->data(1, MemoryRole).toInt();
+        // The second pass of a job writes the same file as the first one and waits for it
+        if (activeFiles.contains(item->text(1))) {
+            item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+            continue;
+        }
+        // A job larger than the budget still runs when the queue is idle. Once the first waiting job does not fit,
+        // no later job is started, otherwise smaller jobs could keep a large one waiting forever
+        if (!activeFiles.isEmpty() && (usedThreads + threads > threadBudget || (memoryBudget > 0 && usedMemory + memory > memoryBudget))) {
+            break;
+        }
+        item->setData(1, TimeRole, QDateTime::currentDateTime());
+        item->setStatus(STARTINGJOB);
+        startRendering(item);
+        // Check for 2 pass encoding
+        QStringList jobData = item->data(1, ParametersRole).toStringList();
+        if (jobData.size() > 2 && jobData.at(1).endsWith(QStringLiteral("-pass2.mlt"))) {
+            // Find and remove 1st pass job
+            QTreeWidgetItem *above = m_view.running_jobs->itemAbove(item);
+            QString firstPassName = jobData.at(1).section(QLatin1Char('-'), 0, -2) + QStringLiteral(".mlt");
+            while (above) {
+                QStringList aboveData = above->data(1, ParametersRole).toStringList();
+                qDebug() << "// GOT  JOB: " << aboveData.at(1);
+                if (aboveData.size() > 2 && aboveData.at(1) == firstPassName) {
+                    delete above;
+                    break;
                 }
+                above = m_view.running_jobs->itemAbove(above);
             }
-            item->setStatus(STARTINGJOB);
-            break;
+        }
+        if (item->status() == STARTINGJOB) {
+            usedThreads += threads;
+            usedMemory += memory;
+            activeFiles << item->text(1);
         }
         item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
     }
-    if (!waitingJob && m_view.shutdown->isChecked()) {
+    saveRenderQueue();
+    updateQueueInfo();
+    if (!waitingJob && activeFiles.isEmpty() && m_view.shutdown->isChecked()) {
         emit shutdown();
     }
 }
 
+void RenderWidget::updateQueueInfo()
+{
+    int running = 0;
+    int waiting = 0;
+    int threads = 0;
+    qint64 memory = 0;
+    double fps = 0;
+    auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    while (item != nullptr) {
+        if (item->status() == RUNNINGJOB || item->status() == STARTINGJOB) {
+            running++;
+            threads += item->data(1, ThreadsRole).toInt();
+            memory += item->data(1, MemoryRole).toInt();
+            if (item->status() == RUNNINGJOB) {
+                fps += item->data(1, FpsRole).toDouble();
+            }
+        } else if (item->status() == WAITINGJOB) {
+            waiting++;
+        }
+        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+    }
+    if (running == 0 && waiting == 0) {
+        m_view.queue_info->clear();
+        return;
+    }
+    m_view.queue_info->setText(i18n("%1 running, %2 waiting, %3 frames/s, %4 threads, %5 of memory", running, waiting, QString::number(fps, 'f', 1), threads,
+                                    KIO::convertSize(KIO::filesize_t(memory) * 1024 * 1024)));
+}
+
+void RenderWidget::saveRenderQueue()
+{
+    QJsonArray jobs;
+    auto *item = static_cast<RenderJobItem *>(m_view.running_jobs->topLevelItem(0));
+    while (item != nullptr) {
+        // Started jobs are not saved: kdenlive_render is detached and keeps rendering if we crash, restarting it would render twice to the same file
+        if (item->status() == WAITINGJOB) {
+            QJsonObject job;
+            job.insert(QStringLiteral("file"), item->text(1));
+            job.insert(QStringLiteral("arguments"), QJsonArray::fromStringList(item->data(1, ParametersRole).toStringList()));
+            job.insert(QStringLiteral("group"), item->data(0, Qt::UserRole).toString());
+            job.insert(QStringLiteral("metadata"), item->metadata());
+            job.insert(QStringLiteral("info"), item->data(1, ExtraInfoRole).toString());
+            job.insert(QStringLiteral("threads"), item->data(1, ThreadsRole).toInt());
+            job.insert(QStringLiteral("memory"), item->data(1, MemoryRole).toInt());
+            job.insert(QStringLiteral("frames"), item->data(1, FramesRole).toInt());
+            jobs.append(job);
+        }
+        item = static_cast<RenderJobItem *>(m_view.running_jobs->itemBelow(item));
+    }
+    const QString path = renderQueueFile(QCoreApplication::applicationPid());
+    if (jobs.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(KDENLIVE_LOG) << "// Cannot save render queue to" << path;
+        return;
+    }
+    file.write(QJsonDocument(jobs).toJson());
+    file.commit();
+}
+
+void RenderWidget::restoreRenderQueue()
+{
+    QDir folder(renderQueueFolder());
+    folder.mkpath(QStringLiteral("."));
+    const QString ownQueue = renderQueueFile(QCoreApplication::applicationPid());
+    // A lock left by a process that is not running anymore is stale whatever its age
+    m_queueLock.reset(new QLockFile(ownQueue + QStringLiteral(".lock")));
+    m_queueLock->setStaleLockTime(0);
+    if (!m_queueLock->tryLock(0)) {
+        qCWarning(KDENLIVE_LOG) << "// Cannot lock render queue" << ownQueue;
+    }
+    // The queue of a previous process with the same pid
+    loadRenderQueue(ownQueue);
+    // The queues whose lock can be taken belong to instances that crashed
+    const QStringList queues = folder.entryList({QStringLiteral("*.json")}, QDir::Files);
+    for (const QString &queue : queues) {
+        const QString path = folder.absoluteFilePath(queue);
+        if (path == ownQueue) {
+            continue;
+        }
+        QLockFile lock(path + QStringLiteral(".lock"));
+        lock.setStaleLockTime(0);
+        if (lock.tryLock(0)) {
+            loadRenderQueue(path);
+        }
+    }
+    if (m_view.running_jobs->topLevelItemCount() > 0) {
+        m_view.tabWidget->setCurrentIndex(1);
+    }
+    checkRenderStatus();
+}
+
+void RenderWidget::loadRenderQueue(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonArray jobs = QJsonDocument::fromJson(file.readAll()).array();
+    file.close();
+    file.remove();
+    for (const auto &value : jobs) {
+        const QJsonObject job = value.toObject();
+        const QString dest = job.value(QStringLiteral("file")).toString();
+        QStringList args;
+        for (const auto &arg : job.value(QStringLiteral("arguments")).toArray()) {
+            args << arg.toString();
+        }
+        // The playlist is removed once a job is finished
+        if (args.size() < 3 || !QFile::exists(args.at(1)) || !m_view.running_jobs->findItems(dest, Qt::MatchExactly, 1).isEmpty()) {
+            continue;
+        }
+        for (QString &arg : args) {
+            if (arg.startsWith(QLatin1String("-pid:"))) {
+                arg = QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid());
+            }
+        }
+        auto *renderItem = new RenderJobItem(m_view.running_jobs, QStringList() << QString() << dest);
+        renderItem->setData(0, Qt::UserRole, job.value(QStringLiteral("group")).toString());
+        renderItem->setMetadata(job.value(QStringLiteral("metadata")).toString());
+        renderItem->setData(1, ParametersRole, args);
+        renderItem->setData(1, ProgressRole, 0);
+        renderItem->setData(1, TimeRole, QDateTime::currentDateTime());
+        renderItem->setData(1, ExtraInfoRole, job.value(QStringLiteral("info")).toString());
+        renderItem->setData(1, ThreadsRole, job.value(QStringLiteral("threads")).toInt());
+        renderItem->setData(1, MemoryRole, job.value(QStringLiteral("memory")).toInt());
+        renderItem->setData(1, FramesRole, job.value(QStringLiteral("frames")).toInt());
+    }
+}
+
 void RenderWidget::startRendering(RenderJobItem *item)
 {
     auto rendererArgs = item->data(1, ParametersRole).toStringList();
@@ -2490,8 +2752,15 @@ void RenderWidget::setRenderJob(const QString &dest, int progress)
         QString est = (days > 0) ? i18np("%1 day ", "%1 days ", days) : QString();
         est.append(when.toString(QStringLiteral("hh:mm:ss")));
         QString t = i18n("Remaining time %1", est);
+        const int frames = item->data(1, FramesRole).toInt();
+        if (frames > 0 && elapsedTime > 0) {
+            const double fps = double(frames) * progress / 100. / elapsedTime;
+            item->setData(1, FpsRole, fps);
+            t = i18n("Remaining time %1, %2 frames/s", est, QString::number(fps, 'f', 1));
+        }
         item->setData(1, Qt::UserRole, t);
     }
+    updateQueueInfo();
 }
 
 void RenderWidget::setRenderStatus(const QString &dest, int status, const QString &error)
@@ -2575,7 +2844,11 @@ void RenderWidget::slotStartCurrentJob()
 {
     auto *current = static_cast<RenderJobItem *>(m_view.running_jobs->currentItem());
     if ((current != nullptr) && current->status() == WAITINGJOB) {
+        current->setData(1, TimeRole, QDateTime::currentDateTime());
+        current->setStatus(STARTINGJOB);
         startRendering(current);
+        saveRenderQueue();
+        updateQueueInfo();
     }
     m_view.start_job->setEnabled(false);
 }
@@ -2723,6 +2996,12 @@ void RenderWidget::slotStartScript()
         renderItem->setData(1, TimeRole, QDateTime::currentDateTime());
         QStringList argsJob = {KdenliveSettings::rendererpath(), path, destination, QStringLiteral("-pid:%1").arg(QCoreApplication::applicationPid())};
         renderItem->setData(1, ParametersRole, argsJob);
+        QFile playlist(path);
+        QDomDocument doc;
+        if (playlist.open(QIODevice::ReadOnly) && doc.setContent(&playlist, false)) {
+            declareJobResources(renderItem, doc, 1);
+        }
+        playlist.close();
         checkRenderStatus();
         m_view.tabWidget->setCurrentIndex(1);
     }
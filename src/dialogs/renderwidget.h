@@ -38,6 +38,7 @@ class Menu;
 
 class QDomElement;
 class QKeyEvent;
+class QLockFile;
 
 // RenderViewDelegate is used to draw the progress bars.
 class RenderViewDelegate : public QStyledItemDelegate
@@ -215,6 +216,8 @@ private:
     KMessageWidget *m_jobInfoMessage;
     QMap<int, QString> m_errorMessages;
     std::weak_ptr<MarkerListModel> m_guidesModel;
+    /** @brief Lock on this instance's render queue file, held while Kdenlive runs */
+    std::unique_ptr<QLockFile> m_queueLock;
 
 #ifdef KF5_USE_PURPOSE
     Purpose::Menu *m_shareMenu;
@@ -224,8 +227,17 @@ private:
     void parseFile(const QString &exportFile, bool editable);
     void updateButtons();
     QUrl filenameWithExtension(QUrl url, const QString &extension);
-    /** @brief Check if a job needs to be started. */
+    /** @brief Start the waiting jobs that fit in the thread and memory budget. */
     void checkRenderStatus();
+    /** @brief Display the running jobs, their throughput and resources. */
+    void updateQueueInfo();
+    /** @brief Save the waiting jobs, so that they can be started after a crash.
+        Each running Kdenlive instance has its own queue file, locked while it runs. */
+    void saveRenderQueue();
+    /** @brief Lock this instance's queue file, and take over the waiting jobs of the instances that crashed. */
+    void restoreRenderQueue();
+    /** @brief Add the jobs saved in the queue file @param path to the queue, and remove the file. */
+    void loadRenderQueue(const QString &path);
     void startRendering(RenderJobItem *item);
     bool saveProfile(QDomElement newprofile);
     /** @brief Create a rendering profile from MLT preset. */
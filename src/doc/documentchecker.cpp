@@ -19,6 +19,7 @@
 
 #include "documentchecker.h"
 #include "bin/binplaylist.hpp"
+#include "doc/fileindex.hpp"
 #include "effects/effectsrepository.hpp"
 #include "kdenlivesettings.h"
 #include "kthumb.h"
@@ -30,10 +31,11 @@
 #include <klocalizedstring.h>
 
 #include "kdenlive_debug.h"
-#include <QCryptographicHash>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
 #include <QFontDatabase>
+#include <QProgressDialog>
 #include <QStandardPaths>
 #include <QTreeWidgetItem>
 #include <utility>
@@ -718,18 +720,82 @@ void DocumentChecker::slotSearchClips()
     if (newpath.isEmpty()) {
         return;
     }
-    int ix = 0;
     bool fixed = false;
     m_ui.recursiveSearch->setChecked(true);
-    // TODO: make non modal
+    m_ui.recursiveSearch->setEnabled(false);
+    // Collect the clips that can be found by size and hash
+    QList<QTreeWidgetItem *> hashedItems;
+    for (int ix = 0; ix < m_ui.treeWidget->topLevelItemCount(); ++ix) {
+        QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
+        if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
+            for (int j = 0; j < child->childCount(); ++j) {
+                hashedItems << child->child(j);
+            }
+        } else if (child->data(0, statusRole).toInt() == CLIPMISSING && (ClipType::ProducerType)child->data(0, clipTypeRole).toInt() != ClipType::SlideShow) {
+            // Slideshows cannot be found with hash / size
+            hashedItems << child;
+        }
+    }
+    QList<QPair<qint64, QString>> queries;
+    for (QTreeWidgetItem *item : hashedItems) {
+        queries << qMakePair(item->data(0, sizeRole).toLongLong(), item->data(0, hashRole).toString());
+    }
+
+    // List the folder once for all missing files
+    FileIndex index(KdenliveSettings::probeiothreads());
+    QProgressDialog progressDialog(i18n("Scanning folders"), i18n("Cancel"), 0, 0, m_dialog);
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setMinimumDuration(500);
+    connect(&progressDialog, &QProgressDialog::canceled, this, [&index]() { index.cancel(); });
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QElapsedTimer refresh;
+    refresh.start();
+    index.build(newpath, [&](int folders, int) {
+        if (refresh.elapsed() > 100) {
+            refresh.restart();
+            progressDialog.setLabelText(i18n("Scanning folders: %1 (%2 folders/s)", folders, folders * 1000 / qMax(qint64(1), elapsed.elapsed())));
+            qApp->processEvents();
+        }
+    });
+    progressDialog.setLabelText(i18n("Checking files"));
+    elapsed.restart();
+    const QHash<QString, QString> hashMatches = index.findByHash(queries, [&](int done, int total) {
+        if (refresh.elapsed() > 100 || done == total) {
+            refresh.restart();
+            progressDialog.setMaximum(total);
+            progressDialog.setLabelText(
+                i18n("Checking files (%1 MB/s)", index.stats().hashedBytes * 1000 / 1000000 / qMax(qint64(1), elapsed.elapsed())));
+            progressDialog.setValue(done);
+        }
+    });
+    progressDialog.reset();
+    const FileIndex::Stats stats = index.stats();
+    qCDebug(KDENLIVE_LOG) << "Missing clips search:" << stats.folders << "folders," << stats.files << "files listed in" << stats.scanTime << "ms,"
+                          << stats.hashedFiles << "files," << stats.hashedBytes / 1000000 << "MB checked in" << stats.hashTime << "ms";
+    if (index.isCanceled()) {
+        m_ui.recursiveSearch->setChecked(false);
+        m_ui.recursiveSearch->setEnabled(true);
+        return;
+    }
+    auto hashMatch = [&hashMatches](QTreeWidgetItem *item) {
+        const QString hash = item->data(0, hashRole).toString();
+        if (hash.isEmpty() || item->data(0, sizeRole).toString().isEmpty()) {
+            return QString();
+        }
+        return hashMatches.value(hash);
+    };
+
+    int ix = 0;
     QTreeWidgetItem *child = m_ui.treeWidget->topLevelItem(ix);
-    QDir searchDir(newpath);
     while (child != nullptr) {
         if (child->data(0, statusRole).toInt() == SOURCEMISSING) {
             for (int j = 0; j < child->childCount(); ++j) {
                 QTreeWidgetItem *subchild = child->child(j);
-                QString clipPath =
-                    searchFileRecursively(searchDir, subchild->data(0, sizeRole).toString(), subchild->data(0, hashRole).toString(), subchild->text(1));
+                QString clipPath = hashMatch(subchild);
+                if (clipPath.isEmpty() && subchild->data(0, sizeRole).toString().isEmpty() && subchild->data(0, hashRole).toString().isEmpty()) {
+                    clipPath = index.findByName(QUrl::fromLocalFile(subchild->text(1)).fileName());
+                }
                 if (!clipPath.isEmpty()) {
                     fixed = true;
                     subchild->setText(1, clipPath);
@@ -742,11 +808,20 @@ void DocumentChecker::slotSearchClips()
             ClipType::ProducerType type = (ClipType::ProducerType)child->data(0, clipTypeRole).toInt();
             QString clipPath;
             if (type != ClipType::SlideShow) {
-                // Slideshows cannot be found with hash / size
-                clipPath = searchFileRecursively(searchDir, child->data(0, sizeRole).toString(), child->data(0, hashRole).toString(), child->text(1));
+                clipPath = hashMatch(child);
             }
             if (clipPath.isEmpty()) {
-                clipPath = searchPathRecursively(searchDir, QUrl::fromLocalFile(child->text(1)).fileName(), type);
+                const QString fileName = QUrl::fromLocalFile(child->text(1)).fileName();
+                if (type == ClipType::SlideShow) {
+                    if (fileName.contains(QLatin1Char('%'))) {
+                        const QString found = index.findByPrefix(fileName.section(QLatin1Char('%'), 0, -2));
+                        if (!found.isEmpty()) {
+                            clipPath = QFileInfo(found).absoluteDir().absoluteFilePath(fileName);
+                        }
+                    }
+                } else {
+                    clipPath = index.findByName(fileName);
+                }
                 perfectMatch = false;
             }
             if (!clipPath.isEmpty()) {
@@ -756,7 +831,7 @@ void DocumentChecker::slotSearchClips()
                 child->setData(0, statusRole, CLIPOK);
             }
         } else if (child->data(0, statusRole).toInt() == LUMAMISSING) {
-            QString fileName = searchLuma(searchDir, child->data(0, idRole).toString());
+            QString fileName = searchLuma(index, child->data(0, idRole).toString());
             if (!fileName.isEmpty()) {
                 fixed = true;
                 child->setText(1, fileName);
@@ -766,7 +841,7 @@ void DocumentChecker::slotSearchClips()
         } else if (child->data(0, typeRole).toInt() == TITLE_IMAGE_ELEMENT && child->data(0, statusRole).toInt() == CLIPPLACEHOLDER) {
             // Search missing title images
             QString missingFileName = QUrl::fromLocalFile(child->text(1)).fileName();
-            QString newPath = searchPathRecursively(searchDir, missingFileName);
+            QString newPath = index.findByName(missingFileName);
             if (!newPath.isEmpty()) {
                 // File found
                 fixed = true;
@@ -787,7 +862,7 @@ void DocumentChecker::slotSearchClips()
     checkStatus();
 }
 
-QString DocumentChecker::searchLuma(const QDir &dir, const QString &file) const
+QString DocumentChecker::searchLuma(const FileIndex &index, const QString &file) const
 {
     QDir searchPath(KdenliveSettings::mltpath());
     QString fname = QUrl::fromLocalFile(file).fileName();
@@ -817,85 +892,7 @@ QString DocumentChecker::searchLuma(const QDir &dir, const QString &file) const
         return res;
     }
     // Try in user's chosen folder
-    return searchPathRecursively(dir, fname);
-}
-
-QString DocumentChecker::searchPathRecursively(const QDir &dir, const QString &fileName, ClipType::ProducerType type) const
-{
-    QString foundFileName;
-    QStringList filters;
-    if (type == ClipType::SlideShow) {
-        if (fileName.contains(QLatin1Char('%'))) {
-            filters << fileName.section(QLatin1Char('%'), 0, -2) + QLatin1Char('*');
-        } else {
-            return QString();
-        }
-    } else {
-        filters << fileName;
-    }
-    QDir searchDir(dir);
-    searchDir.setNameFilters(filters);
-    QStringList filesAndDirs = searchDir.entryList(QDir::Files | QDir::Readable);
-    if (!filesAndDirs.isEmpty()) {
-        // File Found
-        if (type == ClipType::SlideShow) {
-            return searchDir.absoluteFilePath(fileName);
-        }
-        return searchDir.absoluteFilePath(filesAndDirs.at(0));
-    }
-    searchDir.setNameFilters(QStringList());
-    filesAndDirs = searchDir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchPathRecursively(searchDir.absoluteFilePath(filesAndDirs.at(i)), fileName, type);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
-}
-
-QString DocumentChecker::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const
-{
-    if (matchSize.isEmpty() && matchHash.isEmpty()) {
-        return searchPathRecursively(dir, QUrl::fromLocalFile(fileName).fileName());
-    }
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (QString::number(file.size()) == matchSize) {
-            if (file.open(QIODevice::ReadOnly)) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash, fileName);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
+    return index.findByName(fname);
 }
 
 void DocumentChecker::slotEditItem(QTreeWidgetItem *item, int)
@@ -27,6 +27,8 @@
 #include <QDomElement>
 #include <QUrl>
 
+class FileIndex;
+
 class DocumentChecker : public QObject
 {
     Q_OBJECT
@@ -52,7 +54,6 @@ private slots:
     QString getProperty(const QDomElement &effect, const QString &name);
     void updateProperty(const QDomElement &effect, const QString &name, const QString &value);
     void setProperty(QDomElement &effect, const QString &name, const QString &value);
-    QString searchLuma(const QDir &dir, const QString &file) const;
     /** @brief Check if images and fonts in this clip exists, returns a list of images that do exist so we don't check twice. */
     void checkMissingImagesAndFonts(const QStringList &images, const QStringList &fonts, const QString &id, const QString &baseClip);
     void slotCheckButtons();
@@ -63,8 +64,7 @@ private:
     Ui::MissingClips_UI m_ui;
     QDialog *m_dialog;
     QPair<QString, QString> m_rootReplacement;
-    QString searchPathRecursively(const QDir &dir, const QString &fileName, ClipType::ProducerType type = ClipType::Unknown) const;
-    QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash, const QString &fileName) const;
+    QString searchLuma(const FileIndex &index, const QString &file) const;
     void checkStatus();
     QMap<QString, QString> m_missingTitleImages;
     QMap<QString, QString> m_missingTitleFonts;
@@ -0,0 +1,201 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "fileindex.hpp"
+#include "utils/mediacache.hpp"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+struct FolderListing
+{
+    QVector<QPair<QString, qint64>> files;
+    // absolute and canonical path of the subfolders
+    QVector<QPair<QString, QString>> folders;
+};
+
+FolderListing listFolder(const QString &path)
+{
+    FolderListing listing;
+    QDir dir(path);
+    const QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::Readable, QDir::Name);
+    listing.files.reserve(files.size());
+    for (const QFileInfo &info : files) {
+        listing.files.append({info.absoluteFilePath(), info.size()});
+    }
+    const QFileInfoList folders = dir.entryInfoList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot, QDir::Name);
+    for (const QFileInfo &info : folders) {
+        listing.folders.append({info.absoluteFilePath(), info.canonicalFilePath()});
+    }
+    return listing;
+}
+} // namespace
+
+FileIndex::FileIndex(int ioThreads)
+{
+    m_pool.setMaxThreadCount(qMax(1, ioThreads));
+}
+
+FileIndex::~FileIndex()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+void FileIndex::build(const QString &root, const Progress &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_paths.clear();
+    m_bySize.clear();
+    m_byName.clear();
+    m_stats = Stats();
+    // Symbolic links may point to a parent folder
+    QSet<QString> visited{QFileInfo(root).canonicalFilePath()};
+    QStringList level{root};
+    // Folders of a level are listed in parallel, the results are merged in order to keep the search deterministic
+    while (!level.isEmpty() && !m_canceled) {
+        std::vector<QFuture<FolderListing>> listings;
+        listings.reserve(size_t(level.size()));
+        for (const QString &folder : level) {
+            listings.push_back(QtConcurrent::run(&m_pool, [this, folder]() { return m_canceled ? FolderListing() : listFolder(folder); }));
+        }
+        QStringList nextLevel;
+        for (auto &future : listings) {
+            const FolderListing listing = future.result();
+            m_stats.folders++;
+            for (const auto &file : listing.files) {
+                const int ix = int(m_paths.size());
+                m_paths.push_back(file.first);
+                m_bySize.emplace(file.second, ix);
+                m_byName.emplace(QFileInfo(file.first).fileName(), ix);
+            }
+            for (const auto &folder : listing.folders) {
+                if (!visited.contains(folder.second)) {
+                    visited.insert(folder.second);
+                    nextLevel << folder.first;
+                }
+            }
+            if (progress) {
+                progress(m_stats.folders, 0);
+            }
+        }
+        level = nextLevel;
+    }
+    m_stats.files = int(m_paths.size());
+    m_stats.scanTime = timer.elapsed();
+}
+
+QHash<QString, QString> FileIndex::findByHash(const QList<QPair<qint64, QString>> &queries, const Progress &progress)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QHash<QString, QString> found;
+    // Only hash the files that have the size of a missing clip
+    std::unordered_set<qint64> sizes;
+    QSet<QString> hashes;
+    for (const auto &query : queries) {
+        if (query.first > 0 && !query.second.isEmpty()) {
+            sizes.insert(query.first);
+            hashes.insert(query.second);
+        }
+    }
+    std::vector<int> candidates;
+    for (qint64 size : sizes) {
+        auto range = m_bySize.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it) {
+            candidates.push_back(it->second);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    std::vector<QFuture<QPair<QString, qint64>>> results;
+    results.reserve(candidates.size());
+    for (int ix : candidates) {
+        const QString path = m_paths.at(size_t(ix));
+        results.push_back(QtConcurrent::run(&m_pool, [this, path]() {
+            QPair<QString, qint64> hash{QString(), 0};
+            if (!m_canceled) {
+                hash.first = MediaCache::get()->fileHash(path, nullptr, &hash.second);
+            }
+            return hash;
+        }));
+    }
+    // Candidates are sorted in discovery order, so the first match is the closest to the root
+    int done = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const QPair<QString, qint64> hash = results[i].result();
+        if (!hash.first.isEmpty()) {
+            m_stats.hashedFiles++;
+            m_stats.hashedBytes += hash.second;
+            if (hashes.contains(hash.first) && !found.contains(hash.first)) {
+                found.insert(hash.first, m_paths.at(size_t(candidates.at(i))));
+            }
+        }
+        if (progress) {
+            progress(++done, int(results.size()));
+        }
+    }
+    m_stats.hashTime += timer.elapsed();
+    return found;
+}
+
+QString FileIndex::findByName(const QString &fileName) const
+{
+    auto range = m_byName.equal_range(fileName);
+    int best = -1;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (best < 0 || it->second < best) {
+            best = it->second;
+        }
+    }
+    return best < 0 ? QString() : m_paths.at(size_t(best));
+}
+
+QString FileIndex::findByPrefix(const QString &prefix) const
+{
+    for (const QString &path : m_paths) {
+        if (QFileInfo(path).fileName().startsWith(prefix)) {
+            return path;
+        }
+    }
+    return QString();
+}
+
+void FileIndex::cancel()
+{
+    m_canceled = true;
+}
+
+bool FileIndex::isCanceled() const
+{
+    return m_canceled;
+}
+
+FileIndex::Stats FileIndex::stats() const
+{
+    return m_stats;
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "definitions.h"
+#include <QHash>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/** @brief Index of the files found below a folder, used to relink missing clips.
+    The folder tree is listed once, several folders being read at the same time, and files are indexed by size and name.
+    Files are only hashed when their size matches a searched clip.
+    When several files match, the one closest to the root folder is returned.
+ */
+class FileIndex
+{
+public:
+    /** @param ioThreads is the number of folders listed or files hashed at the same time */
+    explicit FileIndex(int ioThreads);
+    ~FileIndex();
+
+    /** @brief Called from the calling thread with the number of items done and to do (0 if unknown) */
+    using Progress = std::function<void(int done, int total)>;
+
+    /** @brief Lists all readable files below @param root */
+    void build(const QString &root, const Progress &progress = nullptr);
+    /** @brief Returns the path of the files matching each (size, hash) pair of @param queries, keyed by hash */
+    QHash<QString, QString> findByHash(const QList<QPair<qint64, QString>> &queries, const Progress &progress = nullptr);
+    /** @brief Returns the path of a file named @param fileName, or an empty string */
+    QString findByName(const QString &fileName) const;
+    /** @brief Returns the path of a file whose name starts with @param prefix, or an empty string */
+    QString findByPrefix(const QString &prefix) const;
+    /** @brief Stops the current build or search, can be called from any thread */
+    void cancel();
+    bool isCanceled() const;
+
+    struct Stats
+    {
+        int folders = 0;
+        int files = 0;
+        int hashedFiles = 0;
+        // Bytes read from disk, hashes cached by MediaCache are not counted
+        qint64 hashedBytes = 0;
+        qint64 scanTime = 0; // ms
+        qint64 hashTime = 0; // ms
+    };
+    Stats stats() const;
+
+private:
+    QThreadPool m_pool;
+    std::atomic<bool> m_canceled{false};
+    // Files in discovery order: folders closer to the root come first
+    std::vector<QString> m_paths;
+    std::unordered_multimap<qint64, int> m_bySize;
+    std::unordered_multimap<QString, int> m_byName;
+    Stats m_stats;
+};
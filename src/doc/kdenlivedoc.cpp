@@ -22,6 +22,7 @@
 #include "bin/bincommands.h"
 #include "bin/binplaylist.hpp"
 #include "bin/clipcreator.hpp"
+#include "bin/clipprober.hpp"
 #include "bin/model/markerlistmodel.hpp"
 #include "bin/projectclip.h"
 #include "bin/projectitemmodel.h"
@@ -52,10 +53,10 @@
 #include <klocalizedstring.h>
 
 #include "kdenlive_debug.h"
-#include <QCryptographicHash>
 #include <QDomImplementation>
 #include <QFile>
 #include <QFileDialog>
+#include <QSaveFile>
 #include <QUndoGroup>
 #include <QUndoStack>
 
@@ -78,6 +79,7 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, QString projectFolder, QUndoGroup *und
     , m_clipsCount(0)
     , m_commandStack(std::make_shared<DocUndoStack>(undoGroup))
     , m_modified(false)
+    , m_modificationRevision(0)
     , m_documentOpenStatus(CleanProject)
     , m_projectFolder(std::move(projectFolder))
 {
@@ -158,6 +160,7 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, QString projectFolder, QUndoGroup *und
             QDomImplementation::setInvalidDataPolicy(QDomImplementation::DropInvalidChars);
             success = m_document.setContent(&file, false, &errorMsg, &line, &col);
             file.close();
+            m_loadTimings.mark(QStringLiteral("xml parse"));
 
             if (!success) {
                 // It is corrupted
@@ -229,6 +232,10 @@ KdenliveDoc::KdenliveDoc(const QUrl &url, QString projectFolder, QUndoGroup *und
                         DocumentChecker d(m_url, m_document);
                         success = !d.hasErrorInClips();
                         if (success) {
+                            // Clips are probed in parallel once the project is parsed
+                            int deferred = ClipProber::deferProbing(m_document);
+                            qCDebug(KDENLIVE_LOG) << " // / deferred probing of" << deferred << "clips";
+                            m_loadTimings.mark(QStringLiteral("validation"));
                             loadDocumentProperties();
                             if (m_document.documentElement().hasAttribute(QStringLiteral("upgraded"))) {
                                 m_documentOpenStatus = UpgradedProject;
@@ -440,26 +447,35 @@ bool KdenliveDoc::autoGenerateImageProxy(int width) const
            width > m_documentProperties.value(QStringLiteral("proxyimageminsize")).toInt();
 }
 
-void KdenliveDoc::slotAutoSave(const QString &scene)
+QString KdenliveDoc::autoSavePath()
 {
-    if (m_autosave != nullptr) {
-        if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
-            // show error: could not open the autosave file
-            qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT CREATE AUTOSAVE FILE";
-            pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
-            return;
-        }
-        if (scene.isEmpty()) {
-            // Make sure we don't save if scenelist is corrupted
-            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", m_autosave->fileName()));
-            return;
-        }
-        m_autosave->resize(0);
-        if (m_autosave->write(scene.toUtf8()) < 0) {
-            pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
-        };
-        m_autosave->flush();
+    if (m_autosave == nullptr) {
+        return QString();
+    }
+    // Keep the autosave file open, it holds the lock telling other instances that it is not stale
+    if (!m_autosave->isOpen() && !m_autosave->open(QIODevice::ReadWrite)) {
+        // show error: could not open the autosave file
+        qCDebug(KDENLIVE_LOG) << "ERROR; CANNOT CREATE AUTOSAVE FILE";
+        pCore->displayMessage(i18n("Cannot create autosave file %1", m_autosave->fileName()), ErrorMessage);
+        return QString();
     }
+    return m_autosave->fileName();
+}
+
+// static
+bool KdenliveDoc::writeAutoSave(const QString &path, const QByteArray &scene)
+{
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly) && file.write(scene) == scene.size() && file.commit()) {
+        return true;
+    }
+    // Renaming over the autosave file fails where open files are locked, write it in place
+    qCDebug(KDENLIVE_LOG) << "Cannot replace autosave file, writing in place" << file.errorString();
+    QFile direct(path);
+    if (!direct.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return direct.write(scene) == scene.size() && direct.flush();
 }
 
 void KdenliveDoc::setZoom(int horizontal, int vertical)
@@ -767,6 +783,9 @@ void KdenliveDoc::slotModified()
 
 void KdenliveDoc::setModified(bool mod)
 {
+    if (mod) {
+        m_modificationRevision++;
+    }
     // fix mantis#3160: The document may have an empty URL if not saved yet, but should have a m_autosave in any case
     if ((m_autosave != nullptr) && mod && KdenliveSettings::crashrecovery()) {
         emit startAutoSave();
@@ -778,6 +797,11 @@ void KdenliveDoc::setModified(bool mod)
     emit docModified(m_modified);
 }
 
+int KdenliveDoc::modificationRevision() const
+{
+    return m_modificationRevision;
+}
+
 bool KdenliveDoc::isModified() const
 {
     return m_modified;
@@ -791,49 +815,6 @@ const QString KdenliveDoc::description() const
     return m_url.fileName() + QStringLiteral(" [*]/ ") + pCore->getCurrentProfile()->description();
 }
 
-QString KdenliveDoc::searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const
-{
-    QString foundFileName;
-    QByteArray fileData;
-    QByteArray fileHash;
-    QStringList filesAndDirs = dir.entryList(QDir::Files | QDir::Readable);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        QFile file(dir.absoluteFilePath(filesAndDirs.at(i)));
-        if (file.open(QIODevice::ReadOnly)) {
-            if (QString::number(file.size()) == matchSize) {
-                /*
-                 * 1 MB = 1 second per 450 files (or faster)
-                 * 10 MB = 9 seconds per 450 files (or faster)
-                 */
-                if (file.size() > 1000000 * 2) {
-                    fileData = file.read(1000000);
-                    if (file.seek(file.size() - 1000000)) {
-                        fileData.append(file.readAll());
-                    }
-                } else {
-                    fileData = file.readAll();
-                }
-                file.close();
-                fileHash = QCryptographicHash::hash(fileData, QCryptographicHash::Md5);
-                if (QString::fromLatin1(fileHash.toHex()) == matchHash) {
-                    return file.fileName();
-                }
-                qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << "size match but not hash";
-            }
-        }
-        ////qCDebug(KDENLIVE_LOG) << filesAndDirs.at(i) << file.size() << fileHash.toHex();
-    }
-    filesAndDirs = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
-    for (int i = 0; i < filesAndDirs.size() && foundFileName.isEmpty(); ++i) {
-        foundFileName = searchFileRecursively(dir.absoluteFilePath(filesAndDirs.at(i)), matchSize, matchHash);
-        if (!foundFileName.isEmpty()) {
-            break;
-        }
-    }
-    return foundFileName;
-}
-
-
 QStringList KdenliveDoc::getBinFolderClipIds(const QString &folderId) const
 {
     return pCore->bin()->getBinFolderClipIds(folderId);
@@ -1762,3 +1743,8 @@ QMap <QString, QString> KdenliveDoc::getProjectTags()
     }
     return tags;
 }
+
+const LoadTimings &KdenliveDoc::loadTimings() const
+{
+    return m_loadTimings;
+}
@@ -36,6 +36,7 @@
 
 #include "definitions.h"
 #include "gentime.h"
+#include "project/loadtimings.h"
 #include "timecode.h"
 
 class MainWindow;
@@ -80,6 +81,8 @@ public:
 
     /** @brief Defines whether the document needs to be saved. */
     bool isModified() const;
+    /** @brief Counts the modifications of the document, undoable or not, to know if it changed since a given point. */
+    int modificationRevision() const;
 
     /** @brief Returns the project folder, used to store project temporary files. */
     QString projectTempFolder() const;
@@ -157,10 +160,13 @@ public:
     int clipsCount() const;
     /** @brief Returns a list of project tags (color / description) */
     QMap <QString, QString> getProjectTags();
+    /** @brief Time spent parsing and validating the project file */
+    const LoadTimings &loadTimings() const;
 
 private:
     QUrl m_url;
     QDomDocument m_document;
+    LoadTimings m_loadTimings;
     int m_clipsCount;
     /** @brief MLT's root (base path) that is stripped from urls in saved xml */
     QString m_documentRoot;
@@ -170,6 +176,8 @@ private:
 
     /** @brief Tells whether the current document has been changed after being saved. */
     bool m_modified;
+    /** @brief Incremented on each modification */
+    int m_modificationRevision;
 
     /** @brief The default recommended proxy extension */
     QString m_proxyExtension;
@@ -188,8 +196,6 @@ private:
     QMap<QString, QString> m_documentMetadata;
     std::shared_ptr<MarkerListModel> m_guideModel;
 
-    QString searchFileRecursively(const QDir &dir, const QString &matchSize, const QString &matchHash) const;
-
     /** @brief Creates a new project. */
     QDomDocument createEmptyDocument(int videotracks, int audiotracks);
     QDomDocument createEmptyDocument(const QList<TrackInfo> &tracks);
@@ -209,15 +215,18 @@ public slots:
     void slotCreateTextTemplateClip(const QString &group, const QString &groupId, QUrl path);
 
     /** @brief Sets the document as modified or up to date.
-     * @description  If crash recovery is turned on, a timer calls KdenliveDoc::slotAutoSave() \n
+     * @description  If crash recovery is turned on, a timer calls ProjectManager::slotAutoSave() \n
      * Emits docModified connected to MainWindow::slotUpdateDocumentState \n
      * @param mod (optional) true if the document has to be saved */
     void setModified(bool mod = true);
     void slotProxyCurrentItem(bool doProxy, QList<std::shared_ptr<ProjectClip>> clipList = QList<std::shared_ptr<ProjectClip>>(), bool force = false,
                               QUndoCommand *masterCommand = nullptr);
-    /** @brief Saves the current project at the autosave location.
+    /** @brief Opens the autosave file and returns its path, or an empty string if it cannot be created.
      * @description The autosave files are in ~/.kde/data/stalefiles/kdenlive/ */
-    void slotAutoSave(const QString &scene);
+    QString autoSavePath();
+    /** @brief Replaces the content of the autosave file at @param path with @param scene, so that a crash while writing never leaves a truncated file.
+     * Does not touch the document, can be called from any thread. */
+    static bool writeAutoSave(const QString &path, const QByteArray &scene);
     /** @brief Groups were changed, save to MLT. */
     void groupsChanged(const QString &groups);
 
@@ -23,11 +23,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "core.h"
 #include "kdenlivesettings.h"
 #include "profiles/profilemodel.hpp"
+#include "thumbscaler.hpp"
 
 #include <mlt++/Mlt.h>
 
 #include <QImage>
 #include <QPixmap>
+
+namespace {
+// Video decoded by avformat is YUV: converting it ourselves saves MLT a full size RGBA conversion. Formats with an alpha channel use RGBA
+bool isOpaqueVideo(Mlt::Frame *frame)
+{
+    mlt_producer producer = mlt_frame_get_original_producer(frame->get_frame());
+    if (producer == nullptr) {
+        return false;
+    }
+    mlt_properties properties = MLT_PRODUCER_PROPERTIES(producer);
+    const QString service = QString::fromUtf8(mlt_properties_get(properties, "mlt_service"));
+    if (!service.startsWith(QLatin1String("avformat"))) {
+        return false;
+    }
+    const QByteArray pixFmtKey = QStringLiteral("meta.media.%1.codec.pix_fmt").arg(mlt_properties_get_int(properties, "video_index")).toUtf8();
+    const QString pixFmt = QString::fromUtf8(mlt_properties_get(properties, pixFmtKey.constData()));
+    return pixFmt.startsWith(QLatin1String("yuv")) && !pixFmt.startsWith(QLatin1String("yuva"));
+}
+} // namespace
+
 // static
 QPixmap KThumb::getImage(const QUrl &url, int width, int height)
 {
@@ -101,7 +122,7 @@ QImage KThumb::getFrame(Mlt::Producer &producer, int framepos, int displayWidth,
 }
 
 // static
-QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height, int scaledWidth)
+QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height, int scaledWidth, bool thumbnail)
 {
     if (frame == nullptr || !frame->is_valid()) {
         qDebug() << "* * * *INVALID FRAME";
@@ -109,17 +130,31 @@ QImage KThumb::getFrame(Mlt::Frame *frame, int width, int height, int scaledWidt
     }
     int ow = width;
     int oh = height;
-    mlt_image_format format = mlt_image_rgb24a;
+    // Exported frames may have an alpha channel added by effects, and need MLT's exact conversion
+    mlt_image_format format = thumbnail && width % 2 == 0 && isOpaqueVideo(frame) ? mlt_image_yuv422 : mlt_image_rgb24a;
     const uchar *imagedata = frame->get_image(format, ow, oh);
-    if (imagedata) {
-        QImage temp(ow, oh, QImage::Format_ARGB32);
-        memcpy(temp.scanLine(0), imagedata, (unsigned)(ow * oh * 4));
-        if (scaledWidth == 0 || scaledWidth == width) {
-            return temp.rgbSwapped();
-        }
-        return temp.rgbSwapped().scaled(scaledWidth, height == 0 ? oh : height);
-    }
-    return QImage();
+    if (imagedata && format != mlt_image_rgb24a && (format != mlt_image_yuv422 || ow % 2 != 0)) {
+        format = mlt_image_rgb24a;
+        imagedata = frame->get_image(format, ow, oh);
+    }
+    if (imagedata == nullptr || ow <= 0 || oh <= 0) {
+        return QImage();
+    }
+    int destWidth = ow;
+    int destHeight = oh;
+    if (scaledWidth != 0 && scaledWidth != width) {
+        destWidth = scaledWidth;
+        destHeight = height == 0 ? oh : height;
+    }
+    // Converted and scaled in one pass from the MLT buffer
+    QImage result(destWidth, destHeight, QImage::Format_ARGB32);
+    if (format == mlt_image_yuv422) {
+        ThumbScaler::fromYuv422(imagedata, ow, oh, frame->get_int("colorspace") == 709, frame->get_int("full_luma") == 1, result.bits(), destWidth, destHeight,
+                                result.bytesPerLine());
+    } else {
+        ThumbScaler::fromRgba(imagedata, ow, oh, result.bits(), destWidth, destHeight, result.bytesPerLine());
+    }
+    return result;
 }
 
 // static
@@ -35,7 +35,10 @@ QPixmap getImage(const QUrl &url, int width, int height = -1);
 QPixmap getImage(const QUrl &url, int frame, int width, int height = -1);
 QImage getFrame(Mlt::Producer *producer, int framepos, int displayWidth, int height);
 QImage getFrame(Mlt::Producer &producer, int framepos, int displayWidth, int height);
-QImage getFrame(Mlt::Frame *frame, int width = 0, int height = 0, int scaledWidth = 0);
+/** @brief Converts a frame to an image of @param width x @param height, scaled to @param scaledWidth if not 0.
+ *  If @param thumbnail is true, opaque video frames are converted from YUV by a fast approximate kernel. Otherwise MLT converts them to RGBA.
+ * */
+QImage getFrame(Mlt::Frame *frame, int width = 0, int height = 0, int scaledWidth = 0, bool thumbnail = false);
 /** @brief Calculates image variance, useful to know if a thumbnail is interesting.
  *  @return an integer between 0 and 100. 0 means no variance, eg. black image while bigger values mean contrasted image
  * */
@@ -0,0 +1,216 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#include "thumbscaler.hpp"
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define THUMBS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+// YUV to RGB coefficients in 1/64 units, so that the SSE2 version computes with 16 bit values
+struct YuvCoefficients
+{
+    int y;
+    int yOffset;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+const YuvCoefficients yuvCoefficients[4] = {
+    {75, 16, 102, 25, 52, 129}, // Rec. 601, video range
+    {75, 16, 115, 14, 34, 135}, // Rec. 709, video range
+    {64, 0, 90, 22, 46, 113},   // Rec. 601, full range
+    {64, 0, 101, 12, 30, 119},  // Rec. 709, full range
+};
+
+const YuvCoefficients &coefficients(bool rec709, bool fullRange)
+{
+    return yuvCoefficients[(fullRange ? 2 : 0) + (rec709 ? 1 : 0)];
+}
+
+inline int clampColor(int value)
+{
+    return qBound(0, value, 255);
+}
+
+inline QRgb yuvPixel(int y, int u, int v, const YuvCoefficients &c)
+{
+    const int luma = (y - c.yOffset) * c.y + 32;
+    u -= 128;
+    v -= 128;
+    return qRgb(clampColor((luma + v * c.rv) >> 6), clampColor((luma - u * c.gu - v * c.gv) >> 6), clampColor((luma + u * c.bu) >> 6));
+}
+
+void rgbaRow(const uchar *src, const int *columns, int count, QRgb *dest)
+{
+    for (int x = 0; x < count; ++x) {
+        const uchar *px = src + 4 * columns[x];
+        dest[x] = qRgba(px[0], px[1], px[2], px[3]);
+    }
+}
+
+void yuvRow(const uchar *src, const int *columns, int count, const YuvCoefficients &c, QRgb *dest)
+{
+    for (int x = 0; x < count; ++x) {
+        const int column = columns[x];
+        // Y0 U Y1 V, the chroma is shared by two pixels
+        const uchar *pair = src + 4 * (column / 2);
+        dest[x] = yuvPixel(src[2 * column], pair[1], pair[3], c);
+    }
+}
+
+#ifdef THUMBS_SSE2
+// Converts a row without scaling, returns the number of pixels done
+int rgbaRowSse2(const uchar *src, int count, QRgb *dest)
+{
+    // Read as little endian 32 bit values, pixels are 0xAABBGGRR: swap red and blue
+    const __m128i agMask = _mm_set1_epi32(int(0xff00ff00));
+    const __m128i rbMask = _mm_set1_epi32(0x00ff00ff);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * i));
+        const __m128i rb = _mm_and_si128(px, rbMask);
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_or_si128(_mm_and_si128(px, agMask), swapped));
+    }
+    return i;
+}
+
+int yuvRowSse2(const uchar *src, int count, const YuvCoefficients &c, QRgb *dest)
+{
+    const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+    const __m128i lowWords = _mm_set1_epi32(0xffff);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i yOffset = _mm_set1_epi16(short(c.yOffset));
+    const __m128i yFactor = _mm_set1_epi16(short(c.y));
+    const __m128i rounding = _mm_set1_epi16(32);
+    const __m128i rv = _mm_set1_epi16(short(c.rv));
+    const __m128i gu = _mm_set1_epi16(short(c.gu));
+    const __m128i gv = _mm_set1_epi16(short(c.gv));
+    const __m128i bu = _mm_set1_epi16(short(c.bu));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8(char(0xff));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+        __m128i luma = _mm_and_si128(px, lowBytes);
+        // U0 V0 U1 V1..., then each chroma value duplicated for the two pixels of its pair
+        const __m128i chroma = _mm_srli_epi16(px, 8);
+        __m128i u = _mm_and_si128(chroma, lowWords);
+        __m128i v = _mm_srli_epi32(chroma, 16);
+        u = _mm_sub_epi16(_mm_or_si128(u, _mm_slli_epi32(u, 16)), chromaOffset);
+        v = _mm_sub_epi16(_mm_or_si128(v, _mm_slli_epi32(v, 16)), chromaOffset);
+        luma = _mm_adds_epi16(_mm_mullo_epi16(_mm_sub_epi16(luma, yOffset), yFactor), rounding);
+        // Sums only saturate for values above 255
+        const __m128i r = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(v, rv)), 6);
+        const __m128i g = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(luma, _mm_mullo_epi16(u, gu)), _mm_mullo_epi16(v, gv)), 6);
+        const __m128i b = _mm_srai_epi16(_mm_adds_epi16(luma, _mm_mullo_epi16(u, bu)), 6);
+        // QRgb values are stored B, G, R, A
+        const __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, zero), _mm_packus_epi16(g, zero));
+        const __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, zero), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+    return i;
+}
+#endif
+
+// Scales and converts with nearest neighbour sampling. Rows that keep their width start with @param fastRow
+template <typename Row, typename FastRow>
+void convert(const uchar *src, int width, int height, int bytesPerPixel, uchar *dest, int destWidth, int destHeight, int destStride, Row row, FastRow fastRow)
+{
+    if (width <= 0 || height <= 0 || destWidth <= 0 || destHeight <= 0) {
+        return;
+    }
+    const std::vector<int> columns = ThumbScaler::samplePositions(width, destWidth);
+    const std::vector<int> rows = ThumbScaler::samplePositions(height, destHeight);
+    for (int y = 0; y < destHeight; ++y) {
+        const uchar *line = src + size_t(rows[size_t(y)]) * size_t(width) * size_t(bytesPerPixel);
+        auto *out = reinterpret_cast<QRgb *>(dest + size_t(y) * size_t(destStride));
+        const int done = width == destWidth ? fastRow(line, destWidth, out) : 0;
+        row(line, columns.data() + done, destWidth - done, out + done);
+    }
+}
+
+int noFastRow(const uchar *, int, QRgb *)
+{
+    return 0;
+}
+} // namespace
+
+std::vector<int> ThumbScaler::samplePositions(int source, int destination)
+{
+    std::vector<int> positions(size_t(qMax(0, destination)));
+    for (size_t i = 0; i < positions.size(); ++i) {
+        // Center of the destination pixel
+        positions[i] = qMin(source - 1, int((2 * qint64(i) + 1) * source / (2 * qint64(destination))));
+    }
+    return positions;
+}
+
+void ThumbScaler::fromRgbaScalar(const uchar *src, int width, int height, uchar *dest, int destWidth, int destHeight, int destStride)
+{
+    convert(src, width, height, 4, dest, destWidth, destHeight, destStride, rgbaRow, noFastRow);
+}
+
+void ThumbScaler::fromRgba(const uchar *src, int width, int height, uchar *dest, int destWidth, int destHeight, int destStride)
+{
+#ifdef THUMBS_SSE2
+    convert(src, width, height, 4, dest, destWidth, destHeight, destStride, rgbaRow, rgbaRowSse2);
+#else
+    fromRgbaScalar(src, width, height, dest, destWidth, destHeight, destStride);
+#endif
+}
+
+void ThumbScaler::fromYuv422Scalar(const uchar *src, int width, int height, bool rec709, bool fullRange, uchar *dest, int destWidth, int destHeight,
+                                   int destStride)
+{
+    const YuvCoefficients &c = coefficients(rec709, fullRange);
+    convert(src, width, height, 2, dest, destWidth, destHeight, destStride,
+            [&c](const uchar *line, const int *columns, int count, QRgb *out) { yuvRow(line, columns, count, c, out); }, noFastRow);
+}
+
+void ThumbScaler::fromYuv422(const uchar *src, int width, int height, bool rec709, bool fullRange, uchar *dest, int destWidth, int destHeight, int destStride)
+{
+#ifdef THUMBS_SSE2
+    const YuvCoefficients &c = coefficients(rec709, fullRange);
+    convert(src, width, height, 2, dest, destWidth, destHeight, destStride,
+            [&c](const uchar *line, const int *columns, int count, QRgb *out) { yuvRow(line, columns, count, c, out); },
+            [&c](const uchar *line, int count, QRgb *out) { return yuvRowSse2(line, count, c, out); });
+#else
+    fromYuv422Scalar(src, width, height, rec709, fullRange, dest, destWidth, destHeight, destStride);
+#endif
+}
+
+const char *ThumbScaler::instructionSet()
+{
+#ifdef THUMBS_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QRgb>
+#include <vector>
+
+/** @brief Kernels converting a decoded frame to a thumbnail in a single pass.
+    The frame buffer returned by MLT is read directly: pixels are converted to QImage's ARGB32 layout and written to
+    the thumbnail, only the source rows and columns sampled by the nearest neighbour scaling being read.
+ */
+namespace ThumbScaler {
+
+/* @brief Write the RGBA frame @param src of @param width x @param height pixels to the ARGB32 buffer @param dest of
+   @param destWidth x @param destHeight pixels, whose lines are @param destStride bytes apart. Uses SSE2 when available */
+void fromRgba(const uchar *src, int width, int height, uchar *dest, int destWidth, int destHeight, int destStride);
+/* @brief Same for a packed YUYV 4:2:2 frame of even width, converted with the Rec. 709 or Rec. 601 matrix from full or video range */
+void fromYuv422(const uchar *src, int width, int height, bool rec709, bool fullRange, uchar *dest, int destWidth, int destHeight, int destStride);
+
+/* @brief Plain C++ implementations, used on other architectures and as a reference */
+void fromRgbaScalar(const uchar *src, int width, int height, uchar *dest, int destWidth, int destHeight, int destStride);
+void fromYuv422Scalar(const uchar *src, int width, int height, bool rec709, bool fullRange, uchar *dest, int destWidth, int destHeight, int destStride);
+
+/* @brief Return the source index sampled for each of the @param destination rows or columns */
+std::vector<int> samplePositions(int source, int destination);
+
+/* @brief Name of the instruction set used on this cpu */
+const char *instructionSet();
+} // namespace ThumbScaler
@@ -47,7 +47,9 @@ EffectsRepository::EffectsRepository()
         }
     }
     if (!invalidEffect.isEmpty()) {
-        pCore->displayMessage(i18n("Some of your favorite effects are invalid and were removed: %1", invalidEffect.join(QLatin1Char(','))), ErrorMessage);
+        // The repository is built on startup, before the main window can display messages
+        const QString message = i18n("Some of your favorite effects are invalid and were removed: %1", invalidEffect.join(QLatin1Char(',')));
+        QMetaObject::invokeMethod(pCore.get(), [message]() { pCore->displayMessage(message, ErrorMessage); }, Qt::QueuedConnection);
         QStringList newFavorites = KdenliveSettings::favorite_effects();
         for (const QString &effect : invalidEffect) {
             newFavorites.removeAll(effect);
@@ -66,12 +68,8 @@ Mlt::Properties *EffectsRepository::getMetadata(const QString &effectId) const
     return pCore->getMltRepository()->metadata(filter_type, effectId.toLatin1().data());
 }
 
-void EffectsRepository::parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
+void EffectsRepository::parseCustomAssetFile(const QString &file_name, QDomDocument &doc, std::unordered_map<QString, Info> &customAssets) const
 {
-    QFile file(file_name);
-    QDomDocument doc;
-    doc.setContent(&file, false);
-    file.close();
     QDomElement base = doc.documentElement();
     if (base.tagName() == QLatin1String("effectgroup")) {
         QDomNodeList effects = base.elementsByTagName(QStringLiteral("effect"));
@@ -167,7 +165,7 @@ void EffectsRepository::parseCustomAssetFile(const QString &file_name, std::unor
                 if (effectFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
                     effectFile.write(doc.toString().toUtf8());
                 }
-                file.close();
+                effectFile.close();
             }
         }
         customAssets[result.id] = result;
@@ -204,6 +202,11 @@ QString EffectsRepository::assetPreferredListPath() const
     return QStringLiteral(":data/preferred_effects.txt");
 }
 
+QString EffectsRepository::assetCacheName() const
+{
+    return QStringLiteral("effects");
+}
+
 bool EffectsRepository::isPreferred(const QString &effectId) const
 {
     return m_preferred_list.contains(effectId);
@@ -234,7 +237,7 @@ bool EffectsRepository::hasInternalEffect(const QString &effectId) const
 QPair<QString, QString> EffectsRepository::reloadCustom(const QString &path)
 {
     std::unordered_map<QString, Info> customAssets;
-    parseCustomAssetFile(path, customAssets);
+    loadCustomAssetFile(path, customAssets);
     QPair<QString, QString> result;
     // TODO: handle files with several effects
     for (const auto &custom : customAssets) {
@@ -27,9 +27,11 @@
 #include "doc/kthumb.h"
 #include "kdenlivesettings.h"
 #include "klocalizedstring.h"
+#include "lib/audio/audioLevels.h"
 #include "lib/audio/audioStreamInfo.h"
 #include "macros.hpp"
 #include "utils/thumbnailcache.hpp"
+#include <QFile>
 #include <QScopedPointer>
 #include <QTemporaryFile>
 #include <QProcess>
@@ -106,6 +108,9 @@ bool AudioThumbJob::computeWithMlt()
     for (double &v : mltLevels) {
         m_audioLevels << 255 * v / maxLevel;
     }
+    // The audiolevel filter measures all the samples of the frame, in IEC scale
+    m_iecLevels = true;
+    m_levelsSampleRate = m_frequency;
 
     m_done = true;
     return true;
@@ -261,6 +266,9 @@ bool AudioThumbJob::computeWithFFMPEG()
             for (long &v : ffmpegLevels) {
                 m_audioLevels << (uint8_t) (255 * v / maxLevel);
             }
+            // Mean amplitude of one sample every intraOffset, the audio was resampled to 100Hz when not using FFmpeg
+            m_iecLevels = false;
+            m_levelsSampleRate = (isFFmpeg ? m_frequency : 100) / intraOffset;
             m_done = true;
             return true;
         }
@@ -332,21 +340,29 @@ bool AudioThumbJob::startJob()
     m_cachePath = m_binClip->getAudioThumbPath();
 
     // checking for cached thumbs
-    QImage image(m_cachePath);
-    if (!image.isNull()) {
-        // convert cached image
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p = image.pixel(i / m_channels, i % m_channels);
-            m_audioLevels << (uint8_t)qRed(p);
-            m_audioLevels << (uint8_t)qGreen(p);
-            m_audioLevels << (uint8_t)qBlue(p);
-            m_audioLevels << (uint8_t)qAlpha(p);
+    m_levels = AudioLevels::load(m_cachePath);
+    if (m_levels == nullptr) {
+        // Convert audio levels cached by older versions as an image
+        const QString legacyPath = m_binClip->getLegacyAudioThumbPath();
+        QImage image(legacyPath);
+        if (!image.isNull()) {
+            int n = image.width() * image.height();
+            for (int i = 0; i < n; i++) {
+                QRgb p = image.pixel(i / m_channels, i % m_channels);
+                m_audioLevels << (uint8_t)qRed(p);
+                m_audioLevels << (uint8_t)qGreen(p);
+                m_audioLevels << (uint8_t)qBlue(p);
+                m_audioLevels << (uint8_t)qAlpha(p);
+            }
+        }
+        if (!m_audioLevels.isEmpty()) {
+            m_levels = AudioLevels::fromLevels(std::move(m_audioLevels), m_channels);
+            if (m_levels->save(m_cachePath)) {
+                QFile::remove(legacyPath);
+            }
         }
     }
-    if (!m_audioLevels.isEmpty()) {
-        m_dataInCache = true;
-    }
+    m_dataInCache = m_levels != nullptr;
 
     // Check audio thumbnail image
     if (ThumbnailCache::get()->hasThumbnail(m_clipId, -1, false)) {
@@ -363,26 +379,9 @@ bool AudioThumbJob::startJob()
     Q_ASSERT(ok == m_done);
 
     if (ok && m_done && !m_dataInCache && !m_audioLevels.isEmpty()) {
-        // Put into an image for caching.
-        int count = m_audioLevels.size();
-        image = QImage((int)lrint((count + 3) / 4.0 / m_channels), m_channels, QImage::Format_ARGB32);
-        int n = image.width() * image.height();
-        for (int i = 0; i < n; i++) {
-            QRgb p;
-            if ((4 * i + 3) < count) {
-                p = qRgba(m_audioLevels.at(4 * i), m_audioLevels.at(4 * i + 1), m_audioLevels.at(4 * i + 2),
-                          m_audioLevels.at(4 * i + 3));
-            } else {
-                int last = m_audioLevels.last();
-                int r = (4 * i + 0) < count ? m_audioLevels.at(4 * i + 0) : last;
-                int g = (4 * i + 1) < count ? m_audioLevels.at(4 * i + 1) : last;
-                int b = (4 * i + 2) < count ? m_audioLevels.at(4 * i + 2) : last;
-                int a = last;
-                p = qRgba(r, g, b, a);
-            }
-            image.setPixel(i / m_channels, i % m_channels, p);
-        }
-        image.save(m_cachePath);
+        m_levels = AudioLevels::fromLevels(std::move(m_audioLevels), m_channels, m_iecLevels ? AudioLevels::Scale::IEC : AudioLevels::Scale::Linear,
+                                           m_levelsSampleRate);
+        m_levels->save(m_cachePath);
         m_successful = true;
         return true;
     } else if (ok && m_thumbInCache && (m_done || !KdenliveSettings::audiothumbnails())) {
@@ -406,7 +405,7 @@ bool AudioThumbJob::commitResult(Fun &undo, Fun &redo)
     if (!m_successful) {
         return false;
     }
-    QVector <uint8_t>old = m_binClip->audioFrameCache;
+    std::shared_ptr<const AudioLevels> old = m_binClip->audioLevels;
     QImage oldImage;
     QImage result;
     if (m_binClip->clipType() == ClipType::Audio) {
@@ -415,17 +414,17 @@ bool AudioThumbJob::commitResult(Fun &undo, Fun &redo)
     }
 
     // note that the image is moved into lambda, it won't be available from this class anymore
-    auto operation = [clip = m_binClip, audio = std::move(m_audioLevels), image = std::move(result)]() {
-        if (!audio.isEmpty()) {
-            clip->updateAudioThumbnail(audio);
+    auto operation = [clip = m_binClip, levels = std::move(m_levels), image = std::move(result)]() {
+        if (levels != nullptr) {
+            clip->updateAudioThumbnail(levels);
         }
         if (!image.isNull() && clip->clipType() == ClipType::Audio) {
             clip->setThumbnail(image);
         }
         return true;
     };
-    auto reverse = [clip = m_binClip, audio = std::move(old), image = std::move(oldImage)]() {
-        clip->updateAudioThumbnail(audio);
+    auto reverse = [clip = m_binClip, levels = std::move(old), image = std::move(oldImage)]() {
+        clip->updateAudioThumbnail(levels);
         if (!image.isNull() && clip->clipType() == ClipType::Audio) {
             clip->setThumbnail(image);
         }
@@ -29,6 +29,7 @@
 /* @brief This class represents the job that corresponds to computing the audio thumb of a clip (waveform)
  */
 
+class AudioLevels;
 class ProjectClip;
 namespace Mlt {
 class Producer;
@@ -73,5 +74,9 @@ private:
     bool m_done{false}, m_successful{false};
     int m_channels, m_frequency, m_lengthInFrames, m_audioStream;
     QVector <uint8_t>m_audioLevels;
+    // How m_audioLevels were measured: IEC scaled levels or mean amplitudes, over m_levelsSampleRate samples per second
+    bool m_iecLevels{false};
+    int m_levelsSampleRate{0};
+    std::shared_ptr<const AudioLevels> m_levels;
     std::unique_ptr<QProcess> m_ffmpegProcess;
 };
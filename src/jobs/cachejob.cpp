@@ -114,7 +114,7 @@ bool CacheJob::startJob()
         frame->set("top_field_first", -1);
         frame->set("rescale.interp", "nearest");
         if (frame != nullptr && frame->is_valid()) {
-            QImage result = KThumb::getFrame(frame.data(), 0, 0, m_fullWidth);
+            QImage result = KThumb::getFrame(frame.data(), 0, 0, m_fullWidth, true);
             ThumbnailCache::get()->storeThumbnail(m_clipId, i, result, true);
         }
         m_semaphore.release(1);
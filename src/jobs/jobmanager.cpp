@@ -37,7 +37,9 @@ int JobManager::m_currentId = 0;
 JobManager::JobManager(QObject *parent)
     : QAbstractListModel(parent)
     , m_lock(QReadWriteLock::Recursive)
+    , m_scheduler(new JobScheduler(this))
 {
+    connect(m_scheduler, &JobScheduler::queueChanged, this, &JobManager::updateJobCount, Qt::QueuedConnection);
 }
 
 JobManager::~JobManager()
@@ -145,6 +147,12 @@ void JobManager::updateJobCount()
     }
     // Set jobs count
     emit jobCount(count);
+    emit jobQueueStats(m_scheduler->queuedCount(), m_scheduler->runningCount(), m_scheduler->averageWaitTime(), m_scheduler->longestWaitTime());
+}
+
+void JobManager::setClipPriority(const QString &binId, JobPriority priority)
+{
+    m_scheduler->setClipPriority(binId, priority);
 }
 
 /*
@@ -239,8 +247,17 @@ void JobManager::createJob(const std::shared_ptr<Job_t> &job)
     connect(&job->m_future, &QFutureWatcher<bool>::started, this, &JobManager::updateJobCount);
     connect(&job->m_future, &QFutureWatcher<bool>::finished, [this, id = job->m_id]() { if (m_jobs.count(id)> 0) slotManageFinishedJob(id); });
     connect(&job->m_future, &QFutureWatcher<bool>::canceled, [this, id = job->m_id]() { slotManageCanceledJob(id); });
-    job->m_actualFuture = QtConcurrent::mapped(job->m_job, AbstractClipJob::execute);
+    job->m_pendingTasks = int(job->m_job.size());
+    job->m_futureInterface.setProgressRange(0, int(job->m_job.size()));
+    // The future is started by the scheduler when the first task runs, so that pending jobs can be told apart
+    job->m_actualFuture = job->m_futureInterface.future();
     job->m_future.setFuture(job->m_actualFuture);
+    if (job->m_job.empty()) {
+        job->m_futureInterface.reportStarted();
+        job->m_futureInterface.reportFinished();
+        return;
+    }
+    m_scheduler->enqueue(job, JobScheduler::defaultPriority(job->m_type));
 }
 
 void JobManager::slotManageCanceledJob(int id)
@@ -345,7 +362,7 @@ void JobManager::slotManageFinishedJob(int id)
         std::vector<int> children = m_jobsByParents[id];
         for (int cid : children) {
             if (!m_jobs[cid]->m_processed) {
-                QtConcurrent::run(this, &JobManager::createJob, m_jobs[cid]);
+                createJob(m_jobs[cid]);
             }
         }
         m_jobsByParents.erase(id);
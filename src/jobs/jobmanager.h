@@ -25,8 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "abstractclipjob.h"
 #include "definitions.h"
+#include "jobscheduler.hpp"
 
 #include <QAbstractListModel>
+#include <QAtomicInt>
+#include <QFutureInterface>
 #include <QFutureWatcher>
 #include <QObject>
 #include <QReadWriteLock>
@@ -52,6 +55,8 @@ struct Job_t
     std::unordered_map<QString, size_t> m_indices;       // keys are binIds, value are ids in the vectors m_job and m_progress;
     QFutureWatcher<bool> m_future;                       // future of the job
     QFuture<bool> m_actualFuture;
+    QFutureInterface<bool> m_futureInterface;            // reports the results of the clip jobs as the scheduler executes them
+    QAtomicInt m_pendingTasks;                           // number of clip jobs not yet processed by the scheduler
     QMutex m_completionMutex; // mutex that is locked during execution of the process
     AbstractClipJob::JOBTYPE m_type;
     QString m_undoString;
@@ -127,13 +132,16 @@ public:
     /** @brief return the message of a given job on a given clip (message, detailed log)*/
     QPair<QString, QString> getJobMessageForClip(int jobId, const QString &binId) const;
 
+    /** @brief Move the pending jobs of a clip to another priority class (for example when the clip is displayed in the monitor) */
+    void setClipPriority(const QString &binId, JobPriority priority);
+
     // Mandatory overloads
     QVariant data(const QModelIndex &index, int role) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
 protected:
     // Helper function to launch a given job.
-    // This has to be launched asynchrnously since it blocks until all parents are finished
+    // This only queues the job in the scheduler, so it can be called from the GUI thread once all parents are finished
     void createJob(const std::shared_ptr<Job_t> &job);
 
     void updateJobCount();
@@ -159,9 +167,13 @@ private:
     /** @brief List of all the jobs by clip. */
     std::unordered_map<QString, std::vector<int>> m_jobsByClip;
     std::unordered_map<int, std::vector<int>> m_jobsByParents;
+    /** @brief Dispatches the clip jobs on a dedicated thread pool */
+    JobScheduler *m_scheduler;
 
 signals:
     void jobCount(int);
+    /** @brief Scheduler counters: number of queued and running clip jobs, average and longest wait time in the queue (ms) */
+    void jobQueueStats(int queued, int running, int averageWait, int longestWait);
 };
 
 #include "jobmanager.ipp"
@@ -51,7 +51,7 @@ int JobManager::startJob(const std::vector<QString> &binIds, int parentId, QStri
         if (parentId != -1 && m_jobs.count(parentId) > 0) {
             m_jobs[parentId]->m_completionMutex.unlock();
         }
-        QtConcurrent::run(this, &JobManager::createJob, job);
+        createJob(job);
     } else {
         m_jobsByParents[parentId].push_back(jobId);
     }
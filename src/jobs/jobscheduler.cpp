@@ -0,0 +1,268 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "jobscheduler.hpp"
+#include "jobmanager.h"
+
+#include <QDebug>
+#include <QRunnable>
+#include <QThread>
+
+class JobTask : public QRunnable
+{
+public:
+    JobTask(JobScheduler *scheduler, JobScheduler::Task task)
+        : m_scheduler(scheduler)
+        , m_task(std::move(task))
+    {
+    }
+
+    void run() override
+    {
+        bool executed = false;
+        bool result = false;
+        if (!m_task.job->m_futureInterface.isCanceled()) {
+            // Only the first task of the job changes the state
+            m_task.job->m_futureInterface.reportStarted();
+            executed = true;
+            result = AbstractClipJob::execute(m_task.job->m_job[m_task.index]);
+        }
+        m_scheduler->taskDone(m_task, result, executed);
+    }
+
+private:
+    JobScheduler *m_scheduler;
+    JobScheduler::Task m_task;
+};
+
+JobScheduler::JobScheduler(QObject *parent)
+    : QObject(parent)
+{
+    // Proxy and transcode jobs may block a worker while an external process runs, so keep enough threads to serve thumbnails meanwhile
+    int cores = qMax(1, QThread::idealThreadCount());
+    m_pool.setMaxThreadCount(qMax(4, cores));
+    // Jobs spawning an encoder process already use several threads each, allow roughly one per physical core
+    int encoders = qMax(1, cores / 2);
+    m_typeLimits[AbstractClipJob::PROXYJOB] = encoders;
+    m_typeLimits[AbstractClipJob::TRANSCODEJOB] = encoders;
+    m_typeLimits[AbstractClipJob::CUTJOB] = encoders;
+    m_typeLimits[AbstractClipJob::STABILIZEJOB] = encoders;
+    m_typeLimits[AbstractClipJob::FILTERCLIPJOB] = encoders;
+    m_typeLimits[AbstractClipJob::SPEEDJOB] = encoders;
+    // Audio thumbnails are decoded sequentially through the whole file, don't let them starve the image thumbnails
+    m_typeLimits[AbstractClipJob::AUDIOTHUMBJOB] = qMax(1, cores / 2);
+}
+
+JobScheduler::~JobScheduler()
+{
+    QMutexLocker lk(&m_mutex);
+    m_closing = true;
+    for (auto &queue : m_queues) {
+        for (const Task &task : queue) {
+            task.job->m_futureInterface.cancel();
+        }
+        queue.clear();
+    }
+    lk.unlock();
+    m_pool.waitForDone();
+}
+
+// static
+JobPriority JobScheduler::defaultPriority(AbstractClipJob::JOBTYPE type)
+{
+    switch (type) {
+    case AbstractClipJob::LOADJOB:
+    case AbstractClipJob::THUMBJOB:
+        return JobPriority::Visible;
+    case AbstractClipJob::CUTJOB:
+    case AbstractClipJob::FILTERCLIPJOB:
+    case AbstractClipJob::ANALYSECLIPJOB:
+        // Explicitly requested by the user
+        return JobPriority::Interactive;
+    default:
+        return JobPriority::Background;
+    }
+}
+
+void JobScheduler::enqueue(const std::shared_ptr<Job_t> &job, JobPriority priority)
+{
+    QMutexLocker lk(&m_mutex);
+    if (m_closing) {
+        return;
+    }
+    auto &queue = m_queues[size_t(priority)];
+    for (size_t i = 0; i < job->m_job.size(); ++i) {
+        Task task{job, i, QElapsedTimer()};
+        task.queued.start();
+        queue.push_back(std::move(task));
+    }
+    lk.unlock();
+    dispatch();
+    emit queueChanged();
+}
+
+void JobScheduler::setClipPriority(const QString &binId, JobPriority priority)
+{
+    QMutexLocker lk(&m_mutex);
+    auto &target = m_queues[size_t(priority)];
+    std::deque<Task> moved;
+    for (size_t p = 0; p < m_queues.size(); ++p) {
+        if (p == size_t(priority)) {
+            continue;
+        }
+        auto &queue = m_queues[p];
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->job->m_job[it->index]->clipId() == binId) {
+                moved.push_back(std::move(*it));
+                it = queue.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    if (moved.empty()) {
+        return;
+    }
+    // Promoted tasks go in front of their new class
+    target.insert(priority == JobPriority::Interactive ? target.begin() : target.end(), moved.begin(), moved.end());
+    lk.unlock();
+    dispatch();
+}
+
+void JobScheduler::setTypeLimit(AbstractClipJob::JOBTYPE type, int maxConcurrent)
+{
+    QMutexLocker lk(&m_mutex);
+    if (maxConcurrent <= 0) {
+        m_typeLimits.erase(type);
+    } else {
+        m_typeLimits[type] = maxConcurrent;
+    }
+    lk.unlock();
+    dispatch();
+}
+
+bool JobScheduler::canStart(AbstractClipJob::JOBTYPE type) const
+{
+    auto limit = m_typeLimits.find(type);
+    if (limit == m_typeLimits.end()) {
+        return true;
+    }
+    auto running = m_runningByType.find(type);
+    return running == m_runningByType.end() || running->second < limit->second;
+}
+
+void JobScheduler::dispatch()
+{
+    QMutexLocker lk(&m_mutex);
+    bool changed = false;
+    while (!m_closing && m_running < m_pool.maxThreadCount()) {
+        bool found = false;
+        for (auto &queue : m_queues) {
+            for (auto it = queue.begin(); it != queue.end(); ++it) {
+                if (it->job->m_futureInterface.isCanceled()) {
+                    // Don't occupy a worker for a canceled job, just account for the task
+                    Task task = std::move(*it);
+                    queue.erase(it);
+                    lk.unlock();
+                    taskDone(task, false, false);
+                    lk.relock();
+                    found = true;
+                    break;
+                }
+                AbstractClipJob::JOBTYPE type = it->job->m_type;
+                if (!canStart(type)) {
+                    continue;
+                }
+                Task task = std::move(*it);
+                queue.erase(it);
+                m_totalWait += task.queued.elapsed();
+                m_dispatched++;
+                m_runningByType[type]++;
+                m_running++;
+                m_pool.start(new JobTask(this, std::move(task)));
+                found = changed = true;
+                break;
+            }
+            if (found) {
+                break;
+            }
+        }
+        if (!found) {
+            break;
+        }
+    }
+    lk.unlock();
+    if (changed) {
+        emit queueChanged();
+    }
+}
+
+void JobScheduler::taskDone(const Task &task, bool result, bool executed)
+{
+    if (executed) {
+        task.job->m_futureInterface.reportResult(result, int(task.index));
+        QMutexLocker lk(&m_mutex);
+        m_runningByType[task.job->m_type]--;
+        m_running--;
+    }
+    if (task.job->m_pendingTasks.fetchAndAddOrdered(-1) == 1) {
+        // Last task of this job
+        task.job->m_futureInterface.reportFinished();
+    }
+    if (executed) {
+        dispatch();
+        emit queueChanged();
+    }
+}
+
+int JobScheduler::queuedCount() const
+{
+    QMutexLocker lk(&m_mutex);
+    size_t count = 0;
+    for (const auto &queue : m_queues) {
+        count += queue.size();
+    }
+    return int(count);
+}
+
+int JobScheduler::runningCount() const
+{
+    QMutexLocker lk(&m_mutex);
+    return m_running;
+}
+
+int JobScheduler::averageWaitTime() const
+{
+    QMutexLocker lk(&m_mutex);
+    return m_dispatched == 0 ? 0 : int(m_totalWait / m_dispatched);
+}
+
+int JobScheduler::longestWaitTime() const
+{
+    QMutexLocker lk(&m_mutex);
+    qint64 wait = 0;
+    for (const auto &queue : m_queues) {
+        for (const Task &task : queue) {
+            wait = qMax(wait, task.queued.elapsed());
+        }
+    }
+    return int(wait);
+}
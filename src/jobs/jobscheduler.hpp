@@ -0,0 +1,104 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "abstractclipjob.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+#include <array>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+struct Job_t;
+
+/** @brief Scheduling class of a job. Lower values are dispatched first */
+enum class JobPriority { Interactive = 0, Visible = 1, Background = 2 };
+
+/**
+ * @class JobScheduler
+ * @brief Dispatches clip jobs on a dedicated thread pool.
+ * Each clip of a job is queued as a separate task in the queue matching its priority. Tasks are dispatched by priority, then by
+ * submission order, as long as the concurrency limit of their job type is not reached. Dependencies are resolved by the JobManager
+ * before a job is enqueued, so a worker never waits on another job.
+ */
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobScheduler(QObject *parent = nullptr);
+    ~JobScheduler() override;
+
+    /** @brief Returns the default priority class of a job type */
+    static JobPriority defaultPriority(AbstractClipJob::JOBTYPE type);
+
+    /** @brief Queue all the clip jobs of @param job. Results are reported through the job's future interface */
+    void enqueue(const std::shared_ptr<Job_t> &job, JobPriority priority);
+
+    /** @brief Move the pending tasks working on @param binId to the @param priority class */
+    void setClipPriority(const QString &binId, JobPriority priority);
+
+    /** @brief Set the maximum number of tasks of a given type that can run at the same time, 0 means no limit */
+    void setTypeLimit(AbstractClipJob::JOBTYPE type, int maxConcurrent);
+
+    /** @brief Number of tasks waiting for a worker */
+    int queuedCount() const;
+    /** @brief Number of tasks currently executing */
+    int runningCount() const;
+    /** @brief Average time (in ms) spent in the queue by the dispatched tasks */
+    int averageWaitTime() const;
+    /** @brief Time (in ms) the oldest pending task has been waiting */
+    int longestWaitTime() const;
+
+private:
+    struct Task
+    {
+        std::shared_ptr<Job_t> job;
+        size_t index;
+        QElapsedTimer queued;
+    };
+    friend class JobTask;
+
+    /** @brief Start as many pending tasks as the pool and the type limits allow */
+    void dispatch();
+    /** @brief Called from the worker thread once a task has been processed */
+    void taskDone(const Task &task, bool result, bool executed);
+    bool canStart(AbstractClipJob::JOBTYPE type) const;
+
+    QThreadPool m_pool;
+    mutable QMutex m_mutex;
+    std::array<std::deque<Task>, 3> m_queues;
+    std::unordered_map<int, int> m_typeLimits;
+    std::unordered_map<int, int> m_runningByType;
+    int m_running{0};
+    qint64 m_totalWait{0};
+    qint64 m_dispatched{0};
+    bool m_closing{false};
+
+signals:
+    /** @brief Emitted (possibly from a worker thread) whenever a task is queued, started or done */
+    void queueChanged();
+};
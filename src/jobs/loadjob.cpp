@@ -31,6 +31,7 @@
 #include "macros.hpp"
 #include "profiles/profilemodel.hpp"
 #include "project/dialogs/slideshowclip.h"
+#include "utils/mediacache.hpp"
 #include "effects/effectsrepository.hpp"
 #include "effects/effectstack/model/effectstackmodel.hpp"
 #include "monitor/monitor.h"
@@ -384,12 +385,27 @@ bool LoadJob::startJob()
         m_producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, m_resource.toUtf8().constData());
         break;
     default:
+        if (type != ClipType::Image && (service.isEmpty() || service.startsWith(QLatin1String("avformat")))) {
+            // Media already probed in this or another project: reuse its stream information instead of opening the file
+            auto cached = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), "avformat-novalidate", m_resource.toUtf8().constData());
+            if (cached->is_valid() && MediaCache::get()->restoreProperties(m_resource, *cached.get())) {
+                if (cached->get_int("video_index") > -1) {
+                    // Same as the avformat producers converted by ClipController
+                    cached->set("mute_on_pause", 0);
+                }
+                m_producer = cached;
+                break;
+            }
+        }
         if (!service.isEmpty()) {
             service.append(QChar(':'));
             m_producer = loadResource(m_resource, service);
         } else {
             m_producer = std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), nullptr, m_resource.toUtf8().constData());
         }
+        if (m_producer && m_producer->is_valid()) {
+            MediaCache::get()->storeProperties(m_resource, *m_producer.get());
+        }
         break;
     }
     if (!m_producer || m_producer->is_blank() || !m_producer->is_valid()) {
@@ -484,7 +500,7 @@ bool LoadJob::startJob()
             m_producer->set("length", fixedLength);
             m_producer->set("out", fixedLength - 1);
         }
-    } else if (mltService == QLatin1String("avformat")) {
+    } else if (mltService == QLatin1String("avformat") || mltService == QLatin1String("avformat-novalidate")) {
         // check if there are multiple streams
         vindex = m_producer->get_int("video_index");
         // List streams
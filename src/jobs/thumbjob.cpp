@@ -122,7 +122,7 @@ bool ThumbJob::startJob()
     frame->set("top_field_first", -1);
     frame->set("rescale.interp", "nearest");
     if ((frame != nullptr) && frame->is_valid()) {
-        m_result = KThumb::getFrame(frame.data(), m_imageWidth, m_imageHeight, m_fullWidth);
+        m_result = KThumb::getFrame(frame.data(), m_imageWidth, m_imageHeight, m_fullWidth, true);
         m_done = true;
     }
     m_mutex.unlock();
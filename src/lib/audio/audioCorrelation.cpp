@@ -14,6 +14,7 @@ the Free Software Foundation, either version 3 of the License, or
 #include "kdenlive_debug.h"
 #include "klocalizedstring.h"
 #include <QElapsedTimer>
+#include <QtConcurrent>
 #include <cmath>
 #include <iostream>
 
@@ -27,6 +28,10 @@ AudioCorrelation::AudioCorrelation(std::unique_ptr<AudioEnvelope> mainTrackEnvel
 
 AudioCorrelation::~AudioCorrelation()
 {
+    for (QFutureWatcher<void> *watcher : m_pending) {
+        watcher->disconnect(this);
+        watcher->waitForFinished();
+    }
     for (AudioEnvelope *envelope : m_children) {
         delete envelope;
     }
@@ -48,6 +53,13 @@ void AudioCorrelation::addChild(AudioEnvelope *envelope)
     // there is no race condition where the signal 'envelopeReady' is
     // lost.
     Q_ASSERT(!envelope->hasComputationStarted());
+    // Levels and decoded envelopes have different scales, both sides must use the same source
+    if (!m_mainTrackEnvelope->usesLevels()) {
+        envelope->disableLevels();
+    } else if (!envelope->usesLevels() && !m_decodedMainEnvelope) {
+        m_decodedMainEnvelope = m_mainTrackEnvelope->decodedCopy();
+        m_decodedMainEnvelope->startComputeEnvelope();
+    }
     connect(envelope, &AudioEnvelope::envelopeReady, this, &AudioCorrelation::slotProcessChild);
     envelope->startComputeEnvelope();
 }
@@ -57,27 +69,46 @@ void AudioCorrelation::slotProcessChild(AudioEnvelope *envelope)
     // Note that at this point the computation of the envelope of the
     // main track might not be finished. envelope() will block until
     // the computation is done.
-    const size_t sizeMain = m_mainTrackEnvelope->envelope().size();
+    const bool decoded = m_mainTrackEnvelope->usesLevels() && !envelope->usesLevels();
+    AudioEnvelope *mainEnvelope = decoded ? m_decodedMainEnvelope.get() : m_mainTrackEnvelope.get();
+    std::shared_ptr<const FFTCorrelation::Reference> &mainReference = decoded ? m_decodedReference : m_reference;
+    const size_t sizeMain = mainEnvelope->envelope().size();
     const size_t sizeSub = envelope->envelope().size();
 
     auto *info = new AudioCorrelationInfo(sizeMain, sizeSub);
-    qint64 *correlation = info->correlationVector();
+    m_children.append(envelope);
+    m_correlations.append(info);
+    Q_ASSERT(m_correlations.size() == m_children.size());
 
-    const std::vector<qint64> &envMain = m_mainTrackEnvelope->envelope();
+    const std::vector<qint64> &envMain = mainEnvelope->envelope();
     const std::vector<qint64> &envSub = envelope->envelope();
-    qint64 max = 0;
 
     if (sizeSub > 200) {
-        FFTCorrelation::correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation);
+        // Children are correlated in the thread pool, against the same reference spectrum
+        if (!mainReference) {
+            mainReference = std::make_shared<const FFTCorrelation::Reference>(&envMain[0], sizeMain);
+        }
+        auto *watcher = new QFutureWatcher<void>(this);
+        m_pending << watcher;
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, envelope]() {
+            m_pending.removeAll(watcher);
+            watcher->deleteLater();
+            announceShift(envelope);
+        });
+        std::shared_ptr<const FFTCorrelation::Reference> reference = mainReference;
+        const qint64 *sub = &envSub[0];
+        qint64 *correlation = info->correlationVector();
+        watcher->setFuture(QtConcurrent::run([reference, sub, sizeSub, correlation]() { reference->correlate(sub, sizeSub, correlation); }));
     } else {
-        correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, correlation, &max);
+        qint64 max = 0;
+        correlate(&envMain[0], sizeMain, &envSub[0], sizeSub, info->correlationVector(), &max);
         info->setMax(max);
+        announceShift(envelope);
     }
+}
 
-    m_children.append(envelope);
-    m_correlations.append(info);
-
-    Q_ASSERT(m_correlations.size() == m_children.size());
+void AudioCorrelation::announceShift(AudioEnvelope *envelope)
+{
     int index = m_children.indexOf(envelope);
     int shift = getShift(index);
     emit gotAudioAlignData(envelope->clipId(), shift);
@@ -14,6 +14,8 @@
 #include "audioCorrelationInfo.h"
 #include "audioEnvelope.h"
 #include "definitions.h"
+#include "fftCorrelation.h"
+#include <QFutureWatcher>
 #include <QList>
 
 /**
@@ -49,6 +51,10 @@ public:
       envelope, the computation of the envelope must not be started
       when it is passed to this object.
 
+      The child and the reference are correlated on envelopes computed
+      from the same source: the audio thumbnail levels if both can use
+      them, the decoded audio otherwise.
+
       This object will take ownership of the passed envelope.
       */
     void addChild(AudioEnvelope *envelope);
@@ -64,9 +70,19 @@ public:
 
 private:
     std::unique_ptr<AudioEnvelope> m_mainTrackEnvelope;
+    /** @brief Spectrum of the main track envelope, shared by all FFT correlations */
+    std::shared_ptr<const FFTCorrelation::Reference> m_reference;
+    /** @brief Decoded envelope of the reference and its spectrum, for the children that cannot use audio thumbnail levels when the main track does */
+    std::unique_ptr<AudioEnvelope> m_decodedMainEnvelope;
+    std::shared_ptr<const FFTCorrelation::Reference> m_decodedReference;
 
     QList<AudioEnvelope *> m_children;
     QList<AudioCorrelationInfo *> m_correlations;
+    /** @brief Correlations running in the thread pool */
+    QList<QFutureWatcher<void> *> m_pending;
+
+    /** @brief Emits the alignment of a child once its correlation is computed */
+    void announceShift(AudioEnvelope *envelope);
 
 private slots:
     /**
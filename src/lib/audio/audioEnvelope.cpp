@@ -9,39 +9,104 @@
  ***************************************************************************/
 
 #include "audioEnvelope.h"
+#include "audioLevels.h"
 #include "audioStreamInfo.h"
 #include "bin/bin.h"
 #include "bin/projectclip.h"
 #include "core.h"
 #include "kdenlive_debug.h"
+#include <QCache>
 #include <QImage>
 #include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
 #include <QtConcurrent>
 #include <KLocalizedString>
 #include <algorithm>
 #include <cmath>
 #include <memory>
+#include <numeric>
+
+namespace {
+// Shortest segment worth opening another producer for, in frames
+const size_t minSegmentFrames = 1500;
+// Audio thumbnail levels measured on fewer samples per frame are too noisy to align clips
+const double minLevelSamplesPerFrame = 50;
+
+// Raw (not normalized) envelopes of the last analysed clips, cost in kB
+QMutex s_cacheMutex;
+QCache<QString, std::shared_ptr<const std::vector<qint64>>> s_envelopeCache(64 * 1024);
+
+std::shared_ptr<const std::vector<qint64>> cachedEnvelope(const QString &key)
+{
+    QMutexLocker lock(&s_cacheMutex);
+    std::shared_ptr<const std::vector<qint64>> *envelope = s_envelopeCache.object(key);
+    return envelope ? *envelope : nullptr;
+}
+
+void cacheEnvelope(const QString &key, const std::vector<qint64> &amplitudes)
+{
+    QMutexLocker lock(&s_cacheMutex);
+    s_envelopeCache.insert(key, new std::shared_ptr<const std::vector<qint64>>(std::make_shared<const std::vector<qint64>>(amplitudes)),
+                           int(amplitudes.size() * sizeof(qint64) / 1024) + 1);
+}
+
+QByteArray serializeProducer(Mlt::Producer &producer)
+{
+    Mlt::Consumer c(*producer.profile(), "xml", "string");
+    Mlt::Service s(producer.get_service());
+    c.connect(s);
+    c.set("time_format", "frames");
+    c.set("no_meta", 1);
+    c.set("no_root", 1);
+    c.set("no_profile", 1);
+    c.set("root", "/");
+    c.set("store", "kdenlive");
+    c.run();
+    return QByteArray(c.get("string"));
+}
+} // namespace
 
 AudioEnvelope::AudioEnvelope(const QString &binId, int clipId, size_t offset, size_t length, size_t startPos)
-    : m_offset(offset)
+    : m_binId(binId)
+    , m_requestedOffset(offset)
+    , m_requestedLength(length)
+    , m_offset(offset)
     , m_clipId(clipId)
     , m_startpos(startPos)
+    , m_zoneStart(0)
 {
     std::shared_ptr<ProjectClip> clip = pCore->bin()->getBinClip(binId);
     m_producer = clip->cloneProducer();
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] { envelopeReady(this); });
+    if (!m_producer || !m_producer->is_valid()) {
+        qCDebug(KDENLIVE_LOG) << "// Cannot create envelope for producer: " << binId;
+        m_envelopeSize = 0;
+        return;
+    }
+    // Segments are decoded on their own producers, serialized before the zone is set so that they use clip frames
+    m_producerXml = serializeProducer(*m_producer);
     if (length > 2000) {
         // Analyse on timeline clip zone only
         m_offset = 0;
+        m_zoneStart = offset;
         m_producer->set_in_and_out((int) offset, (int) (offset + length));
     }
     m_envelopeSize = (size_t)m_producer->get_playtime();
 
     m_producer->set("set.test_image", 1);
-    connect(&m_watcher, &QFutureWatcherBase::finished, this, [this] { envelopeReady(this); });
-    if (!m_producer || !m_producer->is_valid()) {
-        qCDebug(KDENLIVE_LOG) << "// Cannot create envelope for producer: " << binId;
-    } else {
-        m_info = std::make_unique<AudioInfo>(m_producer);
+    m_info = std::make_unique<AudioInfo>(m_producer);
+
+    const QString clipHash = clip->hash();
+    if (!clipHash.isEmpty()) {
+        int audioStream = clip->audioInfo() ? clip->audioInfo()->ffmpeg_audio_index() : -1;
+        m_cacheKey = QStringLiteral("%1:%2:%3:%4:%5").arg(clipHash).arg(audioStream).arg(m_zoneStart).arg(m_envelopeSize).arg(m_producer->get_fps());
+    }
+    // Audio thumbnail levels are computed per frame, they can replace decoding if their scale is known and they were measured on enough samples
+    std::shared_ptr<const AudioLevels> levels = clip->audioLevels;
+    if (levels && levels->scale() != AudioLevels::Scale::Unknown && levels->sampleRate() >= minLevelSamplesPerFrame * m_producer->get_fps() &&
+        size_t(levels->frames()) >= m_zoneStart + m_envelopeSize) {
+        m_levels = levels;
     }
 }
 
@@ -66,6 +131,43 @@ void AudioEnvelope::startComputeEnvelope()
     m_watcher.setFuture(m_audioSummary);
 }
 
+bool AudioEnvelope::usesLevels() const
+{
+    return m_levels != nullptr;
+}
+
+void AudioEnvelope::disableLevels()
+{
+    Q_ASSERT(!hasComputationStarted());
+    m_levels.reset();
+}
+
+std::unique_ptr<AudioEnvelope> AudioEnvelope::decodedCopy() const
+{
+    std::unique_ptr<AudioEnvelope> copy(new AudioEnvelope(m_binId, m_clipId, m_requestedOffset, m_requestedLength, m_startpos));
+    copy->disableLevels();
+    return copy;
+}
+
+// static
+std::vector<qint64> AudioEnvelope::levelsEnvelope(const AudioLevels &levels, size_t first, size_t count)
+{
+    qint64 amplitudes[256];
+    for (int i = 0; i < 256; ++i) {
+        amplitudes[i] = qint64(AudioLevels::amplitude(uint8_t(i), levels.scale()) * 32767);
+    }
+    std::vector<qint64> envelope(count);
+    const int channels = levels.channels();
+    for (size_t i = 0; i < count; ++i) {
+        qint64 sum = 0;
+        for (int c = 0; c < channels; ++c) {
+            sum += amplitudes[levels.level(int(first + i), c)];
+        }
+        envelope[i] = sum;
+    }
+    return envelope;
+}
+
 bool AudioEnvelope::hasComputationStarted() const
 {
     // An empty qFuture is canceled. QtConcurrent::run() returns a
@@ -95,34 +197,77 @@ const std::vector<qint64> &AudioEnvelope::envelope()
     return audioSummary().audioAmplitudes;
 }
 
+void AudioEnvelope::decodeSegment(size_t first, size_t last, qint64 *amplitudes, std::atomic<size_t> &progress) const
+{
+    Mlt::Producer producer(*m_producer->profile(), "xml-string", m_producerXml.constData());
+    if (!producer.is_valid()) {
+        qCDebug(KDENLIVE_LOG) << "// Cannot open producer for envelope segment" << first << last;
+        return;
+    }
+    producer.set("set.test_image", 1);
+    const int samplingRate = m_info->info(0)->samplingRate();
+    const double fps = producer.get_fps();
+    mlt_audio_format format_s16 = mlt_audio_s16;
+
+    producer.seek(int(m_zoneStart + first));
+    for (size_t i = first; i < last; ++i) {
+        std::unique_ptr<Mlt::Frame> frame(producer.get_frame());
+        int frequency = samplingRate;
+        int channels = 1;
+        int samples = mlt_sample_calculator(float(fps), frequency, mlt_frame_get_position(frame->get_frame()));
+        auto *data = static_cast<qint16 *>(frame->get_audio(format_s16, frequency, channels, samples));
+        qint64 sum = 0;
+        if (data != nullptr) {
+            for (int k = 0; k < samples; ++k) {
+                sum += abs(data[k]);
+            }
+        }
+        amplitudes[i] = sum;
+        const size_t done = ++progress;
+        if (done * 100 / m_envelopeSize != (done - 1) * 100 / m_envelopeSize) {
+            pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, (int)(100 * done / m_envelopeSize));
+        }
+    }
+}
+
 AudioEnvelope::AudioSummary AudioEnvelope::loadAndNormalizeEnvelope() const
 {
     qCDebug(KDENLIVE_LOG) << "Loading envelope ...";
     AudioSummary summary(m_envelopeSize);
-    if (!m_info || m_info->size() < 1) {
+    if (!m_info || m_info->size() < 1 || m_envelopeSize == 0) {
         return summary;
     }
-    int samplingRate = m_info->info(0)->samplingRate();
-    mlt_audio_format format_s16 = mlt_audio_s16;
-    int channels = 1;
 
     QElapsedTimer t;
     t.start();
-    m_producer->seek(0);
     size_t max = summary.audioAmplitudes.size();
-    for (size_t i = 0; i < max; ++i) {
-        std::unique_ptr<Mlt::Frame> frame(m_producer->get_frame((int)i));
-        qint64 position = mlt_frame_get_position(frame->get_frame());
-        int samples = mlt_sample_calculator(m_producer->get_fps(), samplingRate, position);
-        auto *data = static_cast<qint16 *>(frame->get_audio(format_s16, samplingRate, channels, samples));
-
-        summary.audioAmplitudes[i] = 0;
-        for (int k = 0; k < samples; ++k) {
-            summary.audioAmplitudes[i] += abs(data[k]);
+    // Levels and decoded envelopes have different scales
+    const QString cacheKey = m_cacheKey.isEmpty() ? QString() : m_cacheKey + (m_levels ? QStringLiteral(":levels") : QStringLiteral(":decoded"));
+    std::shared_ptr<const std::vector<qint64>> cached = cacheKey.isEmpty() ? nullptr : cachedEnvelope(cacheKey);
+    if (cached && cached->size() == max) {
+        summary.audioAmplitudes = *cached;
+        qCDebug(KDENLIVE_LOG) << "Envelope (" << m_envelopeSize << " frames) found in cache.";
+    } else {
+        if (m_levels) {
+            summary.audioAmplitudes = levelsEnvelope(*m_levels, m_zoneStart, max);
+            qCDebug(KDENLIVE_LOG) << "Calculating the envelope (" << m_envelopeSize << " frames) from audio thumbnail took " << t.elapsed() << " ms.";
+        } else {
+            const int segments = int(qBound(size_t(1), max / minSegmentFrames, size_t(qMax(1, QThread::idealThreadCount()))));
+            QVector<int> indexes(segments);
+            std::iota(indexes.begin(), indexes.end(), 0);
+            std::atomic<size_t> progress(0);
+            qint64 *amplitudes = summary.audioAmplitudes.data();
+            // Envelopes are already computed in a pool thread: blockingMap also works in the calling thread, so it cannot starve the pool
+            QtConcurrent::blockingMap(indexes, [&](int segment) {
+                decodeSegment(max * size_t(segment) / size_t(segments), max * size_t(segment + 1) / size_t(segments), amplitudes, progress);
+            });
+            qCDebug(KDENLIVE_LOG) << "Calculating the envelope (" << m_envelopeSize << " frames) in " << segments << " segments took " << t.elapsed()
+                                  << " ms.";
+        }
+        if (!cacheKey.isEmpty()) {
+            cacheEnvelope(cacheKey, summary.audioAmplitudes);
         }
-        pCore->displayMessage(i18n("Processing data analysis"), ProcessingJobMessage, (int) (100 * i / max));
     }
-    qCDebug(KDENLIVE_LOG) << "Calculating the envelope (" << m_envelopeSize << " frames) took " << t.elapsed() << " ms.";
     qCDebug(KDENLIVE_LOG) << "Normalizing envelope ...";
     const qint64 meanBeforeNormalization =
         std::accumulate(summary.audioAmplitudes.begin(), summary.audioAmplitudes.end(), 0LL) / (qint64)summary.audioAmplitudes.size();
@@ -14,10 +14,12 @@
 #include "audioInfo.h"
 #include <QFutureWatcher>
 #include <QObject>
+#include <atomic>
 #include <memory>
 #include <mlt++/Mlt.h>
 #include <vector>
 
+class AudioLevels;
 class QImage;
 
 /**
@@ -25,6 +27,12 @@ class QImage;
   with frame resolution. One entry is calculated by the sum
   of the absolute values of all samples in the current frame.
 
+  The clip is decoded in segments, in parallel, each on its own producer. When the audio
+  thumbnail levels of the clip are available and were measured on enough samples per frame,
+  they are converted back to linear amplitudes and used instead of decoding. Both sides of a
+  correlation must use the same source, see disableLevels(). Envelopes are cached by clip
+  hash and source, so aligning several clips to the same reference only computes it once.
+
   See also: http://web.archive.org/web/20180626235917/http://bemasc.net/wordpress/2011/07/26/an-auto-aligner-for-pitivi/
   */
 class AudioEnvelope : public QObject
@@ -41,6 +49,18 @@ public:
     */
     void startComputeEnvelope();
 
+    /** @brief True if the envelope is computed from the audio thumbnail levels instead of decoding the audio */
+    bool usesLevels() const;
+    /** @brief Decode the audio even if the audio thumbnail levels could be used.
+        REQUIRES: startComputeEnvelope() has not been called. */
+    void disableLevels();
+    /** @brief Returns a new envelope of the same audio zone, that decodes the audio */
+    std::unique_ptr<AudioEnvelope> decodedCopy() const;
+
+    /** @brief Envelope of the frames [@param first, @param first + @param count[ computed from audio thumbnail levels of known scale,
+        proportional to the amplitude summed over the channels */
+    static std::vector<qint64> levelsEnvelope(const AudioLevels &levels, size_t first, size_t count);
+
     /**
        Returns whether startComputeEnvelope() has been called.
     */
@@ -88,15 +108,29 @@ private:
      Actually computes the envelope data, synchronously.
     */
     AudioSummary loadAndNormalizeEnvelope() const;
+    /** @brief Sums the absolute samples of frames [first, last[ of the envelope into @param amplitudes, decoding with a new producer */
+    void decodeSegment(size_t first, size_t last, qint64 *amplitudes, std::atomic<size_t> &progress) const;
 
     std::shared_ptr<Mlt::Producer> m_producer;
     std::unique_ptr<AudioInfo> m_info;
     QFutureWatcher<AudioSummary> m_watcher;
     QFuture<AudioSummary> m_audioSummary;
-
+    /** @brief Serialized producer, used to open one producer per decoded segment */
+    QByteArray m_producerXml;
+    /** @brief Levels of the audio thumbnail, if they can be used instead of decoding */
+    std::shared_ptr<const AudioLevels> m_levels;
+    /** @brief Identifies the analysed audio in the envelope cache, empty if it cannot be cached */
+    QString m_cacheKey;
+
+    const QString m_binId;
+    /** @brief Arguments of the constructor, to create a decoded copy */
+    const size_t m_requestedOffset;
+    const size_t m_requestedLength;
     size_t m_offset;
     const int m_clipId;
     const size_t m_startpos;
+    /** @brief First analysed frame, in clip frames */
+    size_t m_zoneStart;
     size_t m_envelopeSize;
 
 signals:
@@ -0,0 +1,151 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "audioLevelPyramid.h"
+
+#include <algorithm>
+#include <cmath>
+
+AudioLevelPyramid::AudioLevelPyramid(const QVector<uint8_t> &levels, int channels)
+    : m_channels(qMax(1, channels))
+    , m_frames(levels.size() / qMax(1, channels))
+    , m_ownedBase(levels)
+    , m_base(m_ownedBase.constData())
+{
+    build();
+}
+
+AudioLevelPyramid::AudioLevelPyramid(const uint8_t *levels, int frames, int channels)
+    : m_channels(qMax(1, channels))
+    , m_frames(levels == nullptr ? 0 : qMax(0, frames))
+    , m_base(levels)
+{
+    build();
+}
+
+void AudioLevelPyramid::build()
+{
+    int previousBuckets = m_frames;
+    int bucketSize = 2;
+    while (previousBuckets > 1) {
+        const int buckets = (previousBuckets + 1) / 2;
+        Level level;
+        level.bucketSize = bucketSize;
+        level.min.resize(size_t(buckets * m_channels));
+        level.max.resize(size_t(buckets * m_channels));
+        level.rms.resize(size_t(buckets * m_channels));
+        for (int b = 0; b < buckets; ++b) {
+            const int first = 2 * b;
+            const int last = qMin(first + 1, previousBuckets - 1);
+            for (int c = 0; c < m_channels; ++c) {
+                const size_t out = size_t(b * m_channels + c);
+                if (m_levels.empty()) {
+                    // Build from the per-frame levels
+                    uint8_t a = m_base[first * m_channels + c];
+                    uint8_t z = m_base[last * m_channels + c];
+                    level.min[out] = std::min(a, z);
+                    level.max[out] = std::max(a, z);
+                    level.rms[out] = uint8_t(lrint(std::sqrt((double(a) * a + double(z) * z) / 2.)));
+                } else {
+                    const Level &prev = m_levels.back();
+                    const size_t a = size_t(first * m_channels + c);
+                    const size_t z = size_t(last * m_channels + c);
+                    level.min[out] = std::min(prev.min[a], prev.min[z]);
+                    level.max[out] = std::max(prev.max[a], prev.max[z]);
+                    level.rms[out] = uint8_t(lrint(std::sqrt((double(prev.rms[a]) * prev.rms[a] + double(prev.rms[z]) * prev.rms[z]) / 2.)));
+                }
+            }
+        }
+        m_levels.push_back(std::move(level));
+        previousBuckets = buckets;
+        bucketSize *= 2;
+    }
+}
+
+int AudioLevelPyramid::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevelPyramid::frames() const
+{
+    return m_frames;
+}
+
+int AudioLevelPyramid::levels() const
+{
+    return int(m_levels.size()) + 1;
+}
+
+AudioLevelPyramid::Sample AudioLevelPyramid::sample(int start, int end, int channel) const
+{
+    if (m_frames <= 0) {
+        return {0, 0, 0};
+    }
+    start = qBound(0, start, m_frames - 1);
+    end = qBound(start + 1, end, m_frames);
+    const int firstChannel = channel < 0 ? 0 : qMin(channel, m_channels - 1);
+    const int lastChannel = channel < 0 ? m_channels - 1 : firstChannel;
+    uint8_t min = 255;
+    uint8_t max = 0;
+    double squares = 0;
+    int count = 0;
+    // Pick the coarsest level whose buckets still fit in the range
+    int levelIndex = -1;
+    while (levelIndex + 1 < int(m_levels.size()) && m_levels[size_t(levelIndex + 1)].bucketSize <= end - start) {
+        levelIndex++;
+    }
+    if (levelIndex < 0) {
+        for (int f = start; f < end; ++f) {
+            for (int c = firstChannel; c <= lastChannel; ++c) {
+                uint8_t v = m_base[f * m_channels + c];
+                min = std::min(min, v);
+                max = std::max(max, v);
+                squares += double(v) * v;
+                count++;
+            }
+        }
+    } else {
+        // The buckets overlapping the range, at most 3 of them since a bucket is not larger than the range
+        const Level &level = m_levels[size_t(levelIndex)];
+        const int firstBucket = start / level.bucketSize;
+        const int lastBucket = (end - 1) / level.bucketSize;
+        for (int b = firstBucket; b <= lastBucket; ++b) {
+            for (int c = firstChannel; c <= lastChannel; ++c) {
+                const size_t ix = size_t(b * m_channels + c);
+                min = std::min(min, level.min[ix]);
+                max = std::max(max, level.max[ix]);
+                squares += double(level.rms[ix]) * level.rms[ix];
+                count++;
+            }
+        }
+    }
+    return {min, max, uint8_t(lrint(std::sqrt(squares / qMax(1, count))))};
+}
+
+size_t AudioLevelPyramid::memoryUse() const
+{
+    size_t bytes = size_t(m_ownedBase.size());
+    for (const Level &level : m_levels) {
+        bytes += level.min.size() + level.max.size() + level.rms.size();
+    }
+    return bytes;
+}
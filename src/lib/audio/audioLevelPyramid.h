@@ -0,0 +1,85 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELPYRAMID_H
+#define AUDIOLEVELPYRAMID_H
+
+#include <QVector>
+#include <cstdint>
+#include <vector>
+
+/**
+  Multi-resolution view of the audio levels of a clip.
+  The base level is the per-frame level computed by the audio thumb job (one byte per frame and channel, channels interleaved).
+  Each following level halves the resolution and keeps, for every bucket and channel, the minimum, maximum and RMS of
+  the levels it covers. A range of frames can then be summarized by reading at most a few buckets of the coarsest
+  level that still fits in the range, so the cost of drawing a waveform depends on its width in pixels, not on the
+  number of frames it displays.
+  */
+class AudioLevelPyramid
+{
+public:
+    struct Sample
+    {
+        uint8_t min;
+        uint8_t max;
+        uint8_t rms;
+    };
+
+    /** @param levels the per-frame levels, frame -> channel
+        @param channels the number of channels interleaved in @param levels */
+    AudioLevelPyramid(const QVector<uint8_t> &levels, int channels);
+    /** @brief Same, but the base level is not copied: @param levels must outlive the pyramid */
+    AudioLevelPyramid(const uint8_t *levels, int frames, int channels);
+    AudioLevelPyramid(const AudioLevelPyramid &) = delete;
+    AudioLevelPyramid &operator=(const AudioLevelPyramid &) = delete;
+
+    int channels() const;
+    /** @brief Number of frames in the base level */
+    int frames() const;
+    /** @brief Number of levels, including the base level */
+    int levels() const;
+
+    /** @brief Summarize frames [start, end[ for a channel, or for all channels merged if @param channel is -1 */
+    Sample sample(int start, int end, int channel = -1) const;
+
+    /** @brief Memory used by the pyramid, in bytes. The base level is only counted if the pyramid owns it */
+    size_t memoryUse() const;
+
+private:
+    struct Level
+    {
+        int bucketSize;
+        std::vector<uint8_t> min;
+        std::vector<uint8_t> max;
+        std::vector<uint8_t> rms;
+    };
+    void build();
+    int m_channels;
+    int m_frames;
+    /** @brief keeps the base level alive when the pyramid was built from a QVector */
+    QVector<uint8_t> m_ownedBase;
+    const uint8_t *m_base;
+    /** @brief levels above the base one, level i has buckets of 2^(i+1) frames */
+    std::vector<Level> m_levels;
+};
+
+#endif
@@ -0,0 +1,235 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "audioLevels.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const quint32 levelsMagic = 0x4b4c564c; // LVLK
+const quint32 levelsVersion = 2;
+
+struct LevelsHeader
+{
+    quint32 magic;
+    quint32 version;
+    qint32 channels;
+    qint32 frames;
+};
+
+// Since version 2, the header tells how the levels were measured
+struct LevelsFormat
+{
+    quint32 scale;
+    qint32 sampleRate;
+};
+
+std::atomic<qint64> s_memoryUse(0);
+std::atomic<qint64> s_mappedSize(0);
+} // namespace
+
+AudioLevels::AudioLevels(QVector<uint8_t> levels, std::unique_ptr<QFile> file, const uint8_t *data, int frames, int channels, Scale scale, int sampleRate)
+    : m_levels(std::move(levels))
+    , m_file(std::move(file))
+    , m_mappedSize(m_file ? m_file->size() : 0)
+    , m_data(m_file ? data : m_levels.constData())
+    , m_frames(frames)
+    , m_channels(channels)
+    , m_scale(scale)
+    , m_sampleRate(sampleRate)
+    , m_pyramid(m_data, frames, channels)
+{
+    s_memoryUse += qint64(memoryUse());
+    s_mappedSize += m_mappedSize;
+}
+
+AudioLevels::~AudioLevels()
+{
+    s_memoryUse -= qint64(memoryUse());
+    s_mappedSize -= m_mappedSize;
+}
+
+// static
+std::shared_ptr<const AudioLevels> AudioLevels::fromLevels(QVector<uint8_t> levels, int channels, Scale scale, int sampleRate)
+{
+    channels = qMax(1, channels);
+    const int frames = levels.size() / channels;
+    // Drop an incomplete last frame so that the layout stays consistent
+    levels.resize(frames * channels);
+    return std::shared_ptr<const AudioLevels>(new AudioLevels(std::move(levels), nullptr, nullptr, frames, channels, scale, sampleRate));
+}
+
+// static
+std::shared_ptr<const AudioLevels> AudioLevels::load(const QString &path)
+{
+    std::unique_ptr<QFile> file(new QFile(path));
+    if (!file->open(QIODevice::ReadOnly) || file->size() < qint64(sizeof(LevelsHeader))) {
+        return nullptr;
+    }
+    const uchar *map = file->map(0, file->size());
+    if (map == nullptr) {
+        qDebug() << "// Cannot map audio levels" << path << file->errorString();
+        return nullptr;
+    }
+    LevelsHeader header;
+    memcpy(&header, map, sizeof(LevelsHeader));
+    // Version 1 files do not record the scale, they can still be drawn
+    LevelsFormat format{quint32(Scale::Unknown), 0};
+    qint64 headerSize = sizeof(LevelsHeader);
+    if (header.version == levelsVersion && file->size() >= qint64(sizeof(LevelsHeader) + sizeof(LevelsFormat))) {
+        memcpy(&format, map + sizeof(LevelsHeader), sizeof(LevelsFormat));
+        headerSize += sizeof(LevelsFormat);
+    }
+    if (header.magic != levelsMagic || (header.version != 1 && header.version != levelsVersion) || header.channels <= 0 || header.frames < 0 ||
+        file->size() != headerSize + qint64(header.channels) * header.frames) {
+        qDebug() << "// Invalid audio levels file" << path;
+        return nullptr;
+    }
+    if (format.scale > quint32(Scale::IEC)) {
+        format.scale = quint32(Scale::Unknown);
+    }
+    // The mapping stays valid after closing the file, until the QFile is destroyed
+    file->close();
+    return std::shared_ptr<const AudioLevels>(new AudioLevels(QVector<uint8_t>(), std::move(file), map + headerSize, header.frames, header.channels,
+                                                              Scale(format.scale), format.sampleRate));
+}
+
+bool AudioLevels::save(const QString &path) const
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "// Cannot write audio levels" << path << file.errorString();
+        return false;
+    }
+    LevelsHeader header{levelsMagic, levelsVersion, m_channels, m_frames};
+    LevelsFormat format{quint32(m_scale), m_sampleRate};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(LevelsHeader));
+    file.write(reinterpret_cast<const char *>(&format), sizeof(LevelsFormat));
+    file.write(reinterpret_cast<const char *>(m_data), size());
+    return file.commit();
+}
+
+// static
+const QString AudioLevels::extension()
+{
+    return QStringLiteral(".klevels");
+}
+
+int AudioLevels::channels() const
+{
+    return m_channels;
+}
+
+int AudioLevels::frames() const
+{
+    return m_frames;
+}
+
+int AudioLevels::size() const
+{
+    return m_frames * m_channels;
+}
+
+const uint8_t *AudioLevels::data() const
+{
+    return m_data;
+}
+
+uint8_t AudioLevels::level(int frame, int channel) const
+{
+    Q_ASSERT(frame >= 0 && frame < m_frames && channel >= 0 && channel < m_channels);
+    return m_data[frame * m_channels + channel];
+}
+
+AudioLevels::Scale AudioLevels::scale() const
+{
+    return m_scale;
+}
+
+int AudioLevels::sampleRate() const
+{
+    return m_sampleRate;
+}
+
+// static
+double AudioLevels::amplitude(uint8_t level, Scale scale)
+{
+    const double value = level / 255.;
+    switch (scale) {
+    case Scale::Linear:
+        return value;
+    case Scale::IEC: {
+        // Inverse of the IEC 268-18 scale used by MLT's audiolevel filter
+        if (level == 0) {
+            return 0.;
+        }
+        double dB;
+        if (value < 0.025) {
+            dB = value / 0.0025 - 70.;
+        } else if (value < 0.075) {
+            dB = (value - 0.025) / 0.005 - 60.;
+        } else if (value < 0.15) {
+            dB = (value - 0.075) / 0.0075 - 50.;
+        } else if (value < 0.3) {
+            dB = (value - 0.15) / 0.015 - 40.;
+        } else if (value < 0.5) {
+            dB = (value - 0.3) / 0.02 - 30.;
+        } else {
+            dB = (value - 0.5) / 0.025 - 20.;
+        }
+        return pow(10., dB / 20.);
+    }
+    default:
+        return 0.;
+    }
+}
+
+const AudioLevelPyramid &AudioLevels::pyramid() const
+{
+    return m_pyramid;
+}
+
+bool AudioLevels::isMapped() const
+{
+    return m_file != nullptr;
+}
+
+size_t AudioLevels::memoryUse() const
+{
+    return size_t(m_levels.size()) + m_pyramid.memoryUse();
+}
+
+// static
+qint64 AudioLevels::totalMemoryUse()
+{
+    return s_memoryUse;
+}
+
+// static
+qint64 AudioLevels::totalMappedSize()
+{
+    return s_mappedSize;
+}
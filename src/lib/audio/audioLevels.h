@@ -0,0 +1,105 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef AUDIOLEVELS_H
+#define AUDIOLEVELS_H
+
+#include "audioLevelPyramid.h"
+
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <memory>
+
+class QFile;
+
+/**
+  Immutable per-frame audio levels of a clip, shared by the bin clip and all its timeline instances through
+  std::shared_ptr<const AudioLevels>, so that a clip used many times in the timeline is only held once in memory.
+
+  Layout is frame major, channels interleaved: level(frame, channel) is data()[frame * channels() + channel],
+  one byte per value (0 - 255, normalized to the loudest frame of the clip). Depending on how they were computed,
+  the values are proportional to the amplitude or IEC scaled, see scale().
+
+  On disk, the levels are stored as a small header followed by the raw buffer, so that a cached file can be
+  memory mapped on reopen instead of being decoded.
+  */
+class AudioLevels
+{
+public:
+    /** @brief How the values relate to the audio amplitude */
+    enum class Scale : quint32 { Unknown = 0, Linear = 1, IEC = 2 };
+
+    ~AudioLevels();
+    AudioLevels(const AudioLevels &) = delete;
+    AudioLevels &operator=(const AudioLevels &) = delete;
+
+    /** @brief Wraps computed levels, taking ownership of the buffer
+        @param levels the per-frame levels, frame -> channel
+        @param scale how the levels were scaled
+        @param sampleRate number of audio samples per second the levels were measured on, 0 if unknown */
+    static std::shared_ptr<const AudioLevels> fromLevels(QVector<uint8_t> levels, int channels, Scale scale = Scale::Unknown, int sampleRate = 0);
+    /** @brief Maps a file written by save(), returns nullptr if it is missing or invalid */
+    static std::shared_ptr<const AudioLevels> load(const QString &path);
+    /** @brief Writes the levels to @param path, atomically */
+    bool save(const QString &path) const;
+    /** @brief File extension of the levels cache */
+    static const QString extension();
+
+    int channels() const;
+    int frames() const;
+    /** @brief Number of values, frames() * channels() */
+    int size() const;
+    const uint8_t *data() const;
+    uint8_t level(int frame, int channel) const;
+    Scale scale() const;
+    /** @brief Number of audio samples per second the levels were measured on, 0 if unknown */
+    int sampleRate() const;
+    /** @brief Linear amplitude (0 - 1) corresponding to @param level, 0 if @param scale is unknown */
+    static double amplitude(uint8_t level, Scale scale);
+    /** @brief Multi-resolution summary of the levels, to draw waveforms at any zoom level */
+    const AudioLevelPyramid &pyramid() const;
+
+    /** @brief True if the levels are read from a mapped file */
+    bool isMapped() const;
+    /** @brief Heap memory used by this buffer and its pyramid, in bytes */
+    size_t memoryUse() const;
+
+    /** @brief Heap memory used by all the audio levels currently loaded, in bytes */
+    static qint64 totalMemoryUse();
+    /** @brief Size of all the audio levels files currently mapped, in bytes */
+    static qint64 totalMappedSize();
+
+private:
+    AudioLevels(QVector<uint8_t> levels, std::unique_ptr<QFile> file, const uint8_t *data, int frames, int channels, Scale scale, int sampleRate);
+
+    QVector<uint8_t> m_levels;
+    std::unique_ptr<QFile> m_file;
+    qint64 m_mappedSize;
+    const uint8_t *m_data;
+    int m_frames;
+    int m_channels;
+    Scale m_scale;
+    int m_sampleRate;
+    AudioLevelPyramid m_pyramid;
+};
+
+#endif
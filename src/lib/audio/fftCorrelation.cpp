@@ -10,75 +10,59 @@ the Free Software Foundation, either version 3 of the License, or
 
 #include "fftCorrelation.h"
 #include <QElapsedTimer>
-extern "C" {
-#include "../external/kiss_fft/tools/kiss_fftr.h"
-}
 
 #include "kdenlive_debug.h"
 #include <algorithm>
-#include <vector>
 
-void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, qint64 *out_correlated)
+namespace {
+/** FFT configurations and work buffers for one transform size */
+struct Plan
 {
-    auto *correlatedFloat = new float[leftSize + rightSize + 1];
-    correlate(left, leftSize, right, rightSize, correlatedFloat);
-
-    // The correlation vector will have entries up to N (number of entries
-    // of the vector), so converting to integers will not lose that much
-    // of precision.
-    for (size_t i = 0; i < leftSize + rightSize + 1; ++i) {
-        out_correlated[i] = correlatedFloat[i];
+    explicit Plan(size_t size)
+        : forward(kiss_fftr_alloc((int)size, 0, nullptr, nullptr))
+        , inverse(kiss_fftr_alloc((int)size, 1, nullptr, nullptr))
+        , signal(size)
+        , spectrum(size / 2 + 1)
+        , otherSpectrum(size / 2 + 1)
+    {
     }
-    delete[] correlatedFloat;
-}
+    ~Plan()
+    {
+        kiss_fftr_free(forward);
+        kiss_fftr_free(inverse);
+    }
+    Plan(const Plan &) = delete;
+    Plan &operator=(const Plan &) = delete;
 
-void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated)
-{
-    QElapsedTimer t;
-    t.start();
+    kiss_fftr_cfg forward;
+    kiss_fftr_cfg inverse;
+    std::vector<float> signal;
+    std::vector<kiss_fft_cpx> spectrum;
+    std::vector<kiss_fft_cpx> otherSpectrum;
+};
 
-    auto *leftF = new float[leftSize];
-    auto *rightF = new float[rightSize];
+/** Number of plans kept by each thread. Pool threads live as long as the application, so only the last used sizes are kept */
+const size_t maxPlans = 2;
 
-    // First the qint64 values need to be normalized to floats
-    // Dividing by the max value is maybe not the best solution, but the
-    // maximum value after correlation should not be larger than the longest
-    // vector since each value should be at most 1
-    qint64 maxLeft = 1;
-    qint64 maxRight = 1;
-    for (size_t i = 0; i < leftSize; ++i) {
-        if (qAbs(left[i]) > maxLeft) {
-            maxLeft = qAbs(left[i]);
-        }
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        if (qAbs(right[i]) > maxRight) {
-            maxRight = qAbs(right[i]);
+Plan &plan(size_t size)
+{
+    // kiss_fftr configurations contain a work buffer, so plans cannot be shared between threads.
+    // Most recently used first
+    thread_local std::vector<std::unique_ptr<Plan>> plans;
+    auto it = std::find_if(plans.begin(), plans.end(), [size](const std::unique_ptr<Plan> &p) { return p->signal.size() == size; });
+    if (it == plans.end()) {
+        if (plans.size() >= maxPlans) {
+            plans.pop_back();
         }
+        plans.emplace(plans.begin(), new Plan(size));
+    } else {
+        std::rotate(plans.begin(), it, it + 1);
     }
-
-    // One side needs to be reversed, since multiplication in frequency domain (fourier space)
-    // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
-    for (size_t i = 0; i < leftSize; ++i) {
-        leftF[i] = double(left[i]) / (double)maxLeft;
-    }
-    for (size_t i = 0; i < rightSize; ++i) {
-        rightF[rightSize - 1 - i] = double(right[i]) / (double)maxRight;
-    }
-
-    // Now we can convolve to get the correlation
-    convolve(leftF, leftSize, rightF, rightSize, out_correlated);
-
-    qCDebug(KDENLIVE_LOG) << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
-    delete[] leftF;
-    delete[] rightF;
+    return *plans.front();
 }
 
-void FFTCorrelation::convolve(const float *left, const size_t leftSize, const float *right, const size_t rightSize, float *out_convolved)
+size_t fftSize(size_t leftSize, size_t rightSize)
 {
-    QElapsedTimer time;
-    time.start();
-
     // To avoid issues with repetition (we are dealing with cosine waves
     // in the fourier domain) we need to pad the vectors to at least twice their size,
     // otherwise convolution would convolve with the repeated pattern as well
@@ -90,44 +74,129 @@ void FFTCorrelation::convolve(const float *left, const size_t leftSize, const fl
     while (size / 2 < largestSize) {
         size = size << 1;
     }
+    return size;
+}
+
+qint64 maxAbs(const qint64 *data, size_t size)
+{
+    qint64 max = 1;
+    for (size_t i = 0; i < size; ++i) {
+        max = std::max(max, qAbs(data[i]));
+    }
+    return max;
+}
+
+/** Transforms p.signal into p.spectrum, multiplies it with @param other, and transforms back into p.signal */
+void convolveSignal(Plan &p, const kiss_fft_cpx *other)
+{
+    kiss_fftr(p.forward, p.signal.data(), p.spectrum.data());
+    // Convolution in spacial domain is a multiplication in fourier domain. O(n).
+    for (size_t i = 0; i < p.spectrum.size(); ++i) {
+        const kiss_fft_cpx a = other[i];
+        const kiss_fft_cpx b = p.spectrum[i];
+        p.spectrum[i].r = a.r * b.r - a.i * b.i;
+        p.spectrum[i].i = a.r * b.i + a.i * b.r;
+    }
+    kiss_fftri(p.inverse, p.spectrum.data(), p.signal.data());
+}
+
+/** Copies the convolution in p.signal to @param out, with one element inserted at the
+    beginning to obtain the same result that we also get with the nested for loop correlation. */
+template <typename T> void copyResult(const Plan &p, size_t outSize, T *out)
+{
+    out[0] = 0;
+    for (size_t i = 0; i + 1 < outSize; ++i) {
+        out[i + 1] = T(p.signal[i]);
+    }
+}
+} // namespace
 
-    const size_t fft_size = size / 2 + 1;
-    kiss_fftr_cfg fftConfig = kiss_fftr_alloc((int)size, 0, nullptr, nullptr);
-    kiss_fftr_cfg ifftConfig = kiss_fftr_alloc((int)size, 1, nullptr, nullptr);
-    std::vector<kiss_fft_cpx> leftFFT(fft_size);
-    std::vector<kiss_fft_cpx> rightFFT(fft_size);
-    std::vector<kiss_fft_cpx> correlatedFFT(fft_size);
+FFTCorrelation::Reference::Reference(const qint64 *data, size_t size)
+    : m_data(size)
+{
+    // First the qint64 values need to be normalized to floats
+    // Dividing by the max value is maybe not the best solution, but the
+    // maximum value after correlation should not be larger than the longest
+    // vector since each value should be at most 1
+    const qint64 max = maxAbs(data, size);
+    for (size_t i = 0; i < size; ++i) {
+        m_data[i] = float(double(data[i]) / (double)max);
+    }
+}
 
-    // Fill in the data into our new vectors with padding
-    std::vector<float> leftData(size, 0);
-    std::vector<float> rightData(size, 0);
-    std::vector<float> convolved(size);
+size_t FFTCorrelation::Reference::size() const
+{
+    return m_data.size();
+}
 
-    std::copy(left, left + leftSize, leftData.begin());
-    std::copy(right, right + rightSize, rightData.begin());
+std::shared_ptr<const std::vector<kiss_fft_cpx>> FFTCorrelation::Reference::spectrum(size_t fftSize) const
+{
+    QMutexLocker lock(&m_mutex);
+    std::shared_ptr<const std::vector<kiss_fft_cpx>> &spectrum = m_spectra[fftSize];
+    if (!spectrum) {
+        Plan &p = plan(fftSize);
+        std::fill(std::copy(m_data.begin(), m_data.end(), p.signal.begin()), p.signal.end(), 0.f);
+        auto result = std::make_shared<std::vector<kiss_fft_cpx>>(fftSize / 2 + 1);
+        kiss_fftr(p.forward, p.signal.data(), result->data());
+        spectrum = result;
+    }
+    return spectrum;
+}
 
-    // Fourier transformation of the vectors
-    kiss_fftr(fftConfig, &leftData[0], &leftFFT[0]);
-    kiss_fftr(fftConfig, &rightData[0], &rightFFT[0]);
+void FFTCorrelation::Reference::correlate(const qint64 *right, size_t rightSize, float *out_correlated) const
+{
+    QElapsedTimer t;
+    t.start();
+    const size_t size = fftSize(m_data.size(), rightSize);
+    std::shared_ptr<const std::vector<kiss_fft_cpx>> leftFFT = spectrum(size);
+    Plan &p = plan(size);
 
-    // Convolution in spacial domain is a multiplication in fourier domain. O(n).
-    for (size_t i = 0; i < correlatedFFT.size(); ++i) {
-        correlatedFFT[i].r = leftFFT[i].r * rightFFT[i].r - leftFFT[i].i * rightFFT[i].i;
-        correlatedFFT[i].i = leftFFT[i].r * rightFFT[i].i + leftFFT[i].i * rightFFT[i].r;
+    // One side needs to be reversed, since multiplication in frequency domain (fourier space)
+    // calculates the convolution: \sum l[x]r[N-x] and not the correlation: \sum l[x]r[x]
+    const qint64 maxRight = maxAbs(right, rightSize);
+    for (size_t i = 0; i < rightSize; ++i) {
+        p.signal[rightSize - 1 - i] = float(double(right[i]) / (double)maxRight);
     }
+    std::fill(p.signal.begin() + (int)rightSize, p.signal.end(), 0.f);
+    convolveSignal(p, leftFFT->data());
+    copyResult(p, m_data.size() + rightSize + 1, out_correlated);
+    qCDebug(KDENLIVE_LOG) << "Correlation (FFT based) computed in " << t.elapsed() << " ms.";
+}
 
-    // Inverse fourier transformation to get the convolved data.
-    // Insert one element at the beginning to obtain the same result
-    // that we also get with the nested for loop correlation.
-    *out_convolved = 0;
-    size_t out_size = leftSize + rightSize + 1;
+void FFTCorrelation::Reference::correlate(const qint64 *right, size_t rightSize, qint64 *out_correlated) const
+{
+    // The correlation vector will have entries up to N (number of entries
+    // of the vector), so converting to integers will not lose that much
+    // of precision.
+    std::vector<float> correlatedFloat(m_data.size() + rightSize + 1);
+    correlate(right, rightSize, correlatedFloat.data());
+    std::copy(correlatedFloat.begin(), correlatedFloat.end(), out_correlated);
+}
+
+void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, qint64 *out_correlated)
+{
+    Reference(left, leftSize).correlate(right, rightSize, out_correlated);
+}
+
+void FFTCorrelation::correlate(const qint64 *left, const size_t leftSize, const qint64 *right, const size_t rightSize, float *out_correlated)
+{
+    Reference(left, leftSize).correlate(right, rightSize, out_correlated);
+}
+
+void FFTCorrelation::convolve(const float *left, const size_t leftSize, const float *right, const size_t rightSize, float *out_convolved)
+{
+    QElapsedTimer time;
+    time.start();
 
-    kiss_fftri(ifftConfig, &correlatedFFT[0], &convolved[0]);
-    std::copy(convolved.begin(), convolved.begin() + (int)out_size - 1, out_convolved + 1);
+    const size_t size = fftSize(leftSize, rightSize);
+    Plan &p = plan(size);
 
-    // Finally some cleanup.
-    kiss_fftr_free(fftConfig);
-    kiss_fftr_free(ifftConfig);
+    // Fill in the data with padding, and transform the left side first
+    std::fill(std::copy(left, left + leftSize, p.signal.begin()), p.signal.end(), 0.f);
+    kiss_fftr(p.forward, p.signal.data(), p.otherSpectrum.data());
+    std::fill(std::copy(right, right + rightSize, p.signal.begin()), p.signal.end(), 0.f);
+    convolveSignal(p, p.otherSpectrum.data());
+    copyResult(p, leftSize + rightSize + 1, out_convolved);
 
     qCDebug(KDENLIVE_LOG) << "FFT convolution computed. Time taken: " << time.elapsed() << " ms";
 }
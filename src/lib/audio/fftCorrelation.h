@@ -11,16 +11,51 @@ the Free Software Foundation, either version 3 of the License, or
 #ifndef FFTCORRELATION_H
 #define FFTCORRELATION_H
 
+#include "../external/kiss_fft/tools/kiss_fftr.h"
+#include <QMutex>
 #include <QtGlobal>
+#include <map>
+#include <memory>
+#include <vector>
+
 /**
   This class provides methods to calculate convolution
   and correlation of two vectors by means of FFT, which
   is O(n log n) (convolution in spacial domain would be
   O(n²)).
+
+  FFT plans and work buffers are allocated per size and thread, and the last two sizes used by a thread are kept for the next calls.
   */
 class FFTCorrelation
 {
 public:
+    /**
+      A vector that several others are correlated against. Its spectrum is only computed
+      once for each FFT size, so correlating many vectors of similar length against it
+      costs one forward and one inverse transform each.
+      Correlations can run from several threads at once.
+      */
+    class Reference
+    {
+    public:
+        Reference(const qint64 *data, size_t size);
+        size_t size() const;
+        /**
+          Computes the correlation between the reference and \c right, as
+          FFTCorrelation::correlate(reference, size(), right, rightSize, out_correlated) would.
+          */
+        void correlate(const qint64 *right, size_t rightSize, float *out_correlated) const;
+        void correlate(const qint64 *right, size_t rightSize, qint64 *out_correlated) const;
+
+    private:
+        /** @brief Returns the spectrum of the zero padded reference for an FFT of @param fftSize */
+        std::shared_ptr<const std::vector<kiss_fft_cpx>> spectrum(size_t fftSize) const;
+        /** @brief The reference, normalized to [-1, 1] */
+        std::vector<float> m_data;
+        mutable QMutex m_mutex;
+        mutable std::map<size_t, std::shared_ptr<const std::vector<kiss_fft_cpx>>> m_spectra;
+    };
+
     /**
       Computes the convolution between \c left and \c right.
       \c out_correlated must be a pre-allocated vector of size
@@ -10,11 +10,10 @@
 
 #include "fftTools.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
-#include <QString>
-
 // Uncomment for debugging, like writing a GNU Octave .m file to /tmp
 //#define DEBUG_FFTTOOLS
 
@@ -24,28 +23,15 @@
 #include <fstream>
 #endif
 
-FFTTools::FFTTools()
-    : m_fftCfgs()
-    , m_windowFunctions()
-{
-}
+FFTTools::FFTTools() = default;
+
 FFTTools::~FFTTools()
 {
-    QHash<QString, kiss_fftr_cfg>::iterator i;
-    for (i = m_fftCfgs.begin(); i != m_fftCfgs.end(); ++i) {
-        free(*i);
+    for (auto &plan : m_plans) {
+        free(plan.second.cfg);
     }
 }
 
-const QString FFTTools::windowSignature(const WindowType windowType, const int size, const float param)
-{
-    return QStringLiteral("s%1_t%2_p%3").arg(size).arg(windowType).arg(param, 0, 'f', 3);
-}
-const QString FFTTools::cfgSignature(const int size)
-{
-    return QStringLiteral("s%1").arg(size);
-}
-
 // https://cplusplus.syntaxerrors.info/index.php?title=Cannot_declare_member_function_%E2%80%98static_int_Foo::bar%28%29%E2%80%99_to_have_static_linkage
 const QVector<float> FFTTools::window(const WindowType windowType, const int size, const float param)
 {
@@ -111,6 +97,26 @@ const QVector<float> FFTTools::window(const WindowType windowType, const int siz
     return QVector<float>();
 }
 
+const std::vector<float> &FFTTools::normalizedWindow(const WindowType windowType, const uint size, const float param)
+{
+    const WindowKey key(int(windowType), size, param);
+    auto it = m_windows.find(key);
+    if (it != m_windows.end()) {
+        return it->second;
+    }
+#ifdef DEBUG_FFTTOOLS
+    qCDebug(KDENLIVE_LOG) << "Building new window function of type" << windowType << "and size" << size;
+#endif
+    const QVector<float> factors = window(windowType, (int)size, param);
+    std::vector<float> normalized(size + 1);
+    // Normalize signals to [0,1] to get correct dB values later on
+    for (uint i = 0; i < size; ++i) {
+        normalized[i] = factors[(int)i] / 32767.0f;
+    }
+    normalized[size] = factors[(int)size];
+    return m_windows.emplace(key, std::move(normalized)).first->second;
+}
+
 void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint channel, const uint numChannels, float *freqSpectrum, const WindowType windowType,
                              const uint windowSize, const float param)
 {
@@ -124,79 +130,45 @@ void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint chan
         return;
     }
 
-    const QString cfgSig = cfgSignature((int)windowSize);
-    const QString winSig = windowSignature(windowType, (int)windowSize, param);
-
-    // Get the kiss_fft configuration from the config cache
+    // Get the kiss_fft configuration and buffers from the cache
     // or build a new configuration if the requested one is not available.
-    kiss_fftr_cfg myCfg;
-    if (m_fftCfgs.contains(cfgSig)) {
-#ifdef DEBUG_FFTTOOLS
-        qCDebug(KDENLIVE_LOG) << "Re-using FFT configuration with size " << windowSize;
-#endif
-        myCfg = m_fftCfgs.value(cfgSig);
-    } else {
+    auto planIt = m_plans.find(windowSize);
+    if (planIt == m_plans.end()) {
 #ifdef DEBUG_FFTTOOLS
         qCDebug(KDENLIVE_LOG) << "Creating FFT configuration with size " << windowSize;
 #endif
-        myCfg = kiss_fftr_alloc((int)windowSize, 0, nullptr, nullptr);
-        m_fftCfgs.insert(cfgSig, myCfg);
+        Plan plan;
+        plan.cfg = kiss_fftr_alloc((int)windowSize, 0, nullptr, nullptr);
+        plan.input.resize(windowSize);
+        plan.output.resize(windowSize / 2 + 1);
+        planIt = m_plans.emplace(windowSize, std::move(plan)).first;
     }
+    Plan &plan = planIt->second;
+    float *data = plan.input.data();
+    kiss_fft_cpx *freqData = plan.output.data();
 
-    // Get the window function from the cache
-    // (except for a rectangular window; nothing to do there).
-    QVector<float> window;
-    float windowScaleFactor = 1;
-    if (windowType != FFTTools::Window_Rect) {
+    // The rectangular window only normalizes the samples
+    const std::vector<float> &window = normalizedWindow(windowType, windowSize, param);
+    const float windowScaleFactor = 1.0f / window[windowSize];
 
-        if (m_windowFunctions.contains(winSig)) {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Re-using window function with signature " << winSig;
-#endif
-            window = m_windowFunctions.value(winSig);
-        } else {
-#ifdef DEBUG_FFTTOOLS
-            qCDebug(KDENLIVE_LOG) << "Building new window function with signature " << winSig;
-#endif
-            window = FFTTools::window(windowType, (int)windowSize, 0);
-            m_windowFunctions.insert(winSig, window);
-        }
-        windowScaleFactor = 1.0 / window[(int)windowSize];
-    }
-
-    // Prepare frequency space vector. The resulting FFT vector is only half as long.
-    auto *freqData = new kiss_fft_cpx[int(windowSize) / 2];
-    auto *data = new float[(int)windowSize];
-
-    // Copy the first channel's audio into a vector for the FFT display;
+    // Copy the channel's audio into a vector for the FFT display;
     // Fill the data vector indices that cannot be covered with sample data with 0
-    if (numSamples < windowSize) {
-        std::fill(&data[numSamples], &data[windowSize - 1], 0);
-    }
-    // Normalize signals to [0,1] to get correct dB values later on
-    for (uint i = 0; i < numSamples && i < windowSize; ++i) {
-        // Performance note: Benchmarking has shown that using the if/else inside the loop
-        // does not do noticeable worse than keeping it outside (perhaps the branch predictor
-        // is good enough), so it remains in there for better readability.
-        if (windowType != FFTTools::Window_Rect) {
-            data[i] = (float)audioFrame.data()[i * numChannels + channel] / 32767.0f * window[(int)i];
-        } else {
-            data[i] = (float)audioFrame.data()[i * numChannels + channel] / 32767.0f;
-        }
+    const uint copied = qMin(numSamples, windowSize);
+    const qint16 *samples = audioFrame.constData() + channel;
+    for (uint i = 0; i < copied; ++i) {
+        data[i] = (float)samples[i * numChannels] * window[i];
     }
+    std::fill(data + copied, data + windowSize, 0.f);
 
     // Calculate the Fast Fourier Transform for the input data
-    kiss_fftr(myCfg, data, freqData);
+    kiss_fftr(plan.cfg, data, freqData);
 
     // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-    // with N = FFT size (after FFT, 1/2 window size)
+    // with N = FFT size (after FFT, 1/2 window size).
+    // Computed as 10 * log(power * scale²), which saves the square root.
+    const float powerScale = windowScaleFactor * windowScaleFactor / ((float)windowSize * (float)windowSize / 4.0f);
     for (uint i = 0; i < windowSize / 2; ++i) {
-        // Logarithmic scale: 20 * log ( 2 * magnitude / N ) with magnitude = sqrt(r² + i²)
-        // with N = FFT size (after FFT, 1/2 window size)
-        freqSpectrum[i] =
-            20 * log(pow(pow(fabs(freqData[i].r * windowScaleFactor), 2) + pow(fabs(freqData[i].i * windowScaleFactor), 2), .5) / ((float)windowSize / 2.0f)) /
-            log(10);
-        ;
+        freqSpectrum[i] = 10.0f * log10f((freqData[i].r * freqData[i].r + freqData[i].i * freqData[i].i) * powerScale);
     }
 
 #ifdef DEBUG_FFTTOOLS
@@ -226,25 +198,28 @@ void FFTTools::fftNormalized(const audioShortVector &audioFrame, const uint chan
 #ifdef DEBUG_FFTTOOLS
     qCDebug(KDENLIVE_LOG) << "Calculated FFT in " << start.elapsed() << " ms.";
 #endif
-    delete[] freqData;
-    delete[] data;
 }
 
 const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left, uint right, float fill)
+{
+    QVector<float> out((int)targetSize);
+    interpolatePeakPreserving(in.constData(), (uint)in.size(), out.data(), targetSize, left, right, fill);
+    return out;
+}
+
+void FFTTools::interpolatePeakPreserving(const float *in, const uint inSize, float *out, const uint targetSize, uint left, uint right, float fill)
 {
 #ifdef DEBUG_FFTTOOLS
     QTime start = QTime::currentTime();
 #endif
 
     if (right == 0) {
-        Q_ASSERT(in.size() > 0);
-        right = (uint)in.size() - 1;
+        Q_ASSERT(inSize > 0);
+        right = inSize - 1;
     }
     Q_ASSERT(targetSize > 0);
     Q_ASSERT(left < right);
 
-    QVector<float> out((int)targetSize);
-
     float x;
     int xi;
     int i;
@@ -260,14 +235,14 @@ const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &i
             x = ((float)i) / float(targetSize - 1) * float(right - left) + (float)left;
             xi = (int)floor(x);
 
-            if (x > float(in.size() - 1)) {
+            if (x > float(inSize - 1)) {
                 // This may happen if right > in.size()-1; Fill the rest of the vector
                 // with the default value now.
                 break;
             }
 
             // Use linear interpolation in order to get smoother display
-            if (xi == 0 || xi == (int)in.size() - 1) {
+            if (xi == 0 || xi == (int)inSize - 1) {
                 // ... except if we are at the left or right border of the input sigal.
                 // Special case here since we consider previous and future values as well for
                 // the actual interpolation (not possible here).
@@ -301,7 +276,7 @@ const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &i
 
             out[i] = fill;
 
-            for (; src < xi && src < (int)in.size(); ++src) {
+            for (; src < xi && src < (int)inSize; ++src) {
                 if (out[i] < in[src]) {
                     out[i] = in[src];
                 }
@@ -317,10 +292,8 @@ const QVector<float> FFTTools::interpolatePeakPreserving(const QVector<float> &i
     }
 
 #ifdef DEBUG_FFTTOOLS
-    qCDebug(KDENLIVE_LOG) << "Interpolated " << targetSize << " nodes from " << in.size() << " input points in " << start.elapsed() << " ms";
+    qCDebug(KDENLIVE_LOG) << "Interpolated " << targetSize << " nodes from " << inSize << " input points in " << start.elapsed() << " ms";
 #endif
-
-    return out;
 }
 
 #ifdef DEBUG_FFTTOOLS
@@ -13,14 +13,23 @@
 
 #include "../../definitions.h"
 #include "../external/kiss_fft/tools/kiss_fftr.h"
-#include <QHash>
 #include <QVector>
+#include <map>
+#include <tuple>
+#include <vector>
 
+/**
+  FFT configurations, work buffers and window functions are created once per window size
+  and reused, so that computing a spectrum does not allocate.
+  An instance must only be used from one thread at a time.
+  */
 class FFTTools
 {
 public:
     FFTTools();
     ~FFTTools();
+    FFTTools(const FFTTools &) = delete;
+    FFTTools &operator=(const FFTTools &) = delete;
 
     enum WindowType { Window_Rect, Window_Triangle, Window_Hamming };
 
@@ -39,12 +48,6 @@ public:
     */
     static const QVector<float> window(const WindowType windowType, const int size, const float param = 0);
 
-    static const QString windowSignature(const WindowType windowType, const int size, const float param = 0);
-
-    /** Returns a signature for a kiss_fft configuration
-        used as a hash in the cache */
-    static const QString cfgSignature(const int size);
-
     /** Calculates the Fourier Transformation of the input audio frame.
         The resulting values will be given in relative decibel: The maximum power is 0 dB, lower powers have
         negative dB values.
@@ -72,10 +75,23 @@ public:
                             will be used for filling the missing information.
         */
     static const QVector<float> interpolatePeakPreserving(const QVector<float> &in, const uint targetSize, uint left = 0, uint right = 0, float fill = 0.0);
+    /** Same as above, reading @param inSize values from @param in and writing @param targetSize values to @param out. */
+    static void interpolatePeakPreserving(const float *in, const uint inSize, float *out, const uint targetSize, uint left = 0, uint right = 0,
+                                          float fill = 0.0);
 
 private:
-    QHash<QString, kiss_fftr_cfg> m_fftCfgs;          // FFT cfg cache
-    QHash<QString, QVector<float>> m_windowFunctions; // Window function cache
+    struct Plan
+    {
+        kiss_fftr_cfg cfg;
+        std::vector<float> input;
+        std::vector<kiss_fft_cpx> output;
+    };
+    /** Window factors, including the normalization of 16 bit samples to [-1, 1], followed by the area of the window */
+    using WindowKey = std::tuple<int, uint, float>;
+    const std::vector<float> &normalizedWindow(const WindowType windowType, const uint size, const float param);
+
+    std::map<uint, Plan> m_plans;                        // FFT plans by window size
+    std::map<WindowKey, std::vector<float>> m_windows;   // Window functions by type, size and parameter
 };
 
 #endif // FFTTOOLS_H
@@ -37,6 +37,7 @@
 #include "monitorproxy.h"
 #include "profiles/profilemodel.hpp"
 #include "timeline2/view/qml/timelineitems.h"
+#include "utils/tractorsnapshot.hpp"
 #include <mlt++/Mlt.h>
 
 #ifndef GL_UNPACK_ROW_LENGTH
@@ -1363,24 +1364,8 @@ void GLWidget::resetConsumer(bool fullReset)
 
 const QString GLWidget::sceneList(const QString &root, const QString &fullPath)
 {
-    QString playlist;
     qCDebug(KDENLIVE_LOG) << " * * *Setting document xml root: " << root;
-    Mlt::Consumer xmlConsumer(pCore->getCurrentProfile()->profile(), "xml", fullPath.isEmpty() ? "kdenlive_playlist" : fullPath.toUtf8().constData());
-    if (!root.isEmpty()) {
-        xmlConsumer.set("root", root.toUtf8().constData());
-    }
-    if (!xmlConsumer.is_valid()) {
-        return QString();
-    }
-    xmlConsumer.set("store", "kdenlive");
-    xmlConsumer.set("time_format", "clock");
-    // Disabling meta creates cleaner files, but then we don't have access to metadata on the fly (meta channels, etc)
-    // And we must use "avformat" instead of "avformat-novalidate" on project loading which causes a big delay on project opening
-    // xmlConsumer.set("no_meta", 1);
-    xmlConsumer.connect(*m_producer.get());
-    xmlConsumer.run();
-    playlist = fullPath.isEmpty() ? QString::fromUtf8(xmlConsumer.get("kdenlive_playlist")) : fullPath;
-    return playlist;
+    return TractorSnapshot::sceneList(pCore->getCurrentProfile()->profile(), *m_producer.get(), root, fullPath);
 }
 
 void GLWidget::updateTexture(GLuint yName, GLuint uName, GLuint vName)
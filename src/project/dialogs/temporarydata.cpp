@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "temporarydata.h"
 #include "doc/kdenlivedoc.h"
+#include "lib/audio/audioLevels.h"
+#include "utils/thumbnailcache.hpp"
 
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -292,6 +294,8 @@ void TemporaryData::gotAudioSize(KJob *job)
     m_totalCurrent += total;
     m_currentSizes[2] = total;
     m_audioSize->setText(KIO::convertSize(total));
+    m_audioSize->setToolTip(i18n("%1 of audio levels in memory, %2 mapped from the cache", KIO::convertSize(KIO::filesize_t(AudioLevels::totalMemoryUse())),
+                                 KIO::convertSize(KIO::filesize_t(AudioLevels::totalMappedSize()))));
     updateTotal();
 }
 
@@ -396,6 +400,8 @@ void TemporaryData::deleteThumbs()
         return;
     }
     if (dir.dirName() == QLatin1String("videothumbs")) {
+        // The open packs would keep writing to the deleted files
+        ThumbnailCache::get()->closePacks();
         dir.removeRecursively();
         dir.mkpath(QStringLiteral("."));
         updateDataInfo();
@@ -415,6 +421,7 @@ void TemporaryData::deleteCurrentCacheData()
     if (dir.dirName() == m_doc->getDocumentProperty(QStringLiteral("documentid"))) {
         emit disablePreview();
         emit disableProxies();
+        ThumbnailCache::get()->closePacks();
         dir.removeRecursively();
         m_doc->initCacheDirs();
         updateDataInfo();
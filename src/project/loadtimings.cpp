@@ -0,0 +1,63 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "loadtimings.h"
+
+#include <QStringList>
+
+LoadTimings::LoadTimings()
+{
+    m_timer.start();
+}
+
+void LoadTimings::resume()
+{
+    m_timer.restart();
+}
+
+void LoadTimings::mark(const QString &phase)
+{
+    m_phases.append({phase, m_timer.restart()});
+}
+
+const QVector<QPair<QString, qint64>> &LoadTimings::phases() const
+{
+    return m_phases;
+}
+
+qint64 LoadTimings::total() const
+{
+    qint64 total = 0;
+    for (const auto &phase : m_phases) {
+        total += phase.second;
+    }
+    return total;
+}
+
+QString LoadTimings::toString() const
+{
+    QStringList parts;
+    for (const auto &phase : m_phases) {
+        parts << QStringLiteral("%1: %2ms").arg(phase.first).arg(phase.second);
+    }
+    parts << QStringLiteral("total: %1ms").arg(total());
+    return parts.join(QStringLiteral(", "));
+}
@@ -0,0 +1,49 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef LOADTIMINGS_H
+#define LOADTIMINGS_H
+
+#include <QElapsedTimer>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+/** @brief Time spent in the successive phases of a project load (xml parse, validation, clip probing, timeline build...) */
+class LoadTimings
+{
+public:
+    LoadTimings();
+    /** @brief Restarts the clock, the time elapsed since the last phase is not accounted */
+    void resume();
+    /** @brief Records the time elapsed since the last phase under @param phase */
+    void mark(const QString &phase);
+    /** @brief Phases with their duration in ms, in load order */
+    const QVector<QPair<QString, qint64>> &phases() const;
+    qint64 total() const;
+    QString toString() const;
+
+private:
+    QElapsedTimer m_timer;
+    QVector<QPair<QString, qint64>> m_phases;
+};
+
+#endif
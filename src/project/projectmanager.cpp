@@ -22,7 +22,9 @@ the Free Software Foundation, either version 3 of the License, or
 #include "project/dialogs/backupwidget.h"
 #include "project/dialogs/noteswidget.h"
 #include "project/dialogs/projectsettings.h"
+#include "utils/mediacache.hpp"
 #include "utils/thumbnailcache.hpp"
+#include "utils/tractorsnapshot.hpp"
 #include "xml/xml.hpp"
 
 // Temporary for testing
@@ -50,7 +52,9 @@ the Free Software Foundation, either version 3 of the License, or
 #include <QMimeType>
 #include <QProgressDialog>
 #include <QTimeZone>
+#include <QtConcurrent>
 #include <audiomixer/mixermanager.hpp>
+#include <mlt++/Mlt.h>
 
 static QString getProjectNameFilters(bool ark=true) {
     auto filter = i18n("Kdenlive project (*.kdenlive)");
@@ -86,6 +90,17 @@ ProjectManager::ProjectManager(QObject *parent)
 
     m_autoSaveTimer.setSingleShot(true);
     connect(&m_autoSaveTimer, &QTimer::timeout, this, &ProjectManager::slotAutoSave);
+    connect(&m_autoSaveWatcher, &QFutureWatcherBase::finished, this, [this]() {
+        const qint64 writeTime = m_autoSaveWatcher.result();
+        if (writeTime < 0) {
+            pCore->displayMessage(i18n("Cannot write autosave file"), ErrorMessage);
+            return;
+        }
+        m_lastAutoSaveRevision = m_pendingAutoSaveRevision;
+        m_autoSaveStats.writeTime = writeTime;
+        m_autoSaveStats.saved++;
+        qCDebug(KDENLIVE_LOG) << "Autosave done, GUI thread:" << m_autoSaveStats.guiTime << "ms, write:" << writeTime << "ms";
+    });
 
     // Ensure the default data folder exist
     QDir dir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
@@ -93,7 +108,10 @@ ProjectManager::ProjectManager(QObject *parent)
     dir.mkdir(QStringLiteral("titles"));
 }
 
-ProjectManager::~ProjectManager() = default;
+ProjectManager::~ProjectManager()
+{
+    m_autoSaveWatcher.waitForFinished();
+}
 
 void ProjectManager::slotLoadOnOpen()
 {
@@ -257,6 +275,12 @@ bool ProjectManager::closeCurrentDocument(bool saveChanges, bool quit)
     if (m_mainTimelineModel) {
         m_mainTimelineModel->prepareClose();
     }
+    // The autosave file is removed with the document, make sure we are not writing it
+    m_autoSaveWatcher.waitForFinished();
+    m_pendingAutoSaveRevision = -1;
+    m_lastAutoSaveRevision = -1;
+    // Keep what the clip jobs found about the media for the next projects
+    MediaCache::get()->flush();
     if (!quit && !qApp->isSavingSession()) {
         m_autoSaveTimer.stop();
         if (m_project) {
@@ -641,21 +665,70 @@ void ProjectManager::slotStartAutoSave()
 
 void ProjectManager::slotAutoSave()
 {
+    if (m_autoSaveWatcher.isRunning()) {
+        // Previous autosave is still being written
+        m_autoSaveTimer.start(3000);
+        return;
+    }
+    if (m_project->modificationRevision() == m_lastAutoSaveRevision) {
+        // Nothing changed since the last autosave
+        m_autoSaveStats.skipped++;
+        m_lastSave.start();
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    const QString autoSavePath = m_project->autoSavePath();
+    if (autoSavePath.isEmpty()) {
+        return;
+    }
+    // The timeline cannot be edited while it is copied, so this happens on the GUI thread.
+    // The copy is then serialized and written in a worker thread
     prepareSave();
     QString saveFolder = m_project->url().adjusted(QUrl::RemoveFilename | QUrl::StripTrailingSlash).toLocalFile();
-    QString scene = projectSceneList(saveFolder);
-    if (!m_replacementPattern.isEmpty()) {
-        QMapIterator<QString, QString> i(m_replacementPattern);
+    std::shared_ptr<Mlt::Producer> snapshot;
+    withoutOverlays([&snapshot]() {
+        snapshot = TractorSnapshot::copy(pCore->getCurrentProfile()->profile(), *pCore->window()->getMainTimeline()->controller()->tractor());
+    });
+    QString scene;
+    if (!snapshot) {
+        // The timeline could not be copied, serialize it here
+        scene = projectSceneList(saveFolder);
+        if (scene.isEmpty()) {
+            // Make sure we don't save if scenelist is corrupted
+            KMessageBox::error(QApplication::activeWindow(), i18n("Cannot write to file %1, scene list is corrupted.", autoSavePath));
+            return;
+        }
+    }
+    std::shared_ptr<Mlt::Profile> profile(new Mlt::Profile(mlt_profile_clone(pCore->getCurrentProfile()->get_profile())));
+    m_pendingAutoSaveRevision = m_project->modificationRevision();
+    m_autoSaveWatcher.setFuture(QtConcurrent::run([autoSavePath, saveFolder, scene, snapshot, profile, replacements = m_replacementPattern]() mutable {
+        QElapsedTimer writeTimer;
+        writeTimer.start();
+        if (snapshot) {
+            scene = TractorSnapshot::sceneList(*profile.get(), *snapshot.get(), saveFolder);
+            snapshot.reset();
+            if (scene.isEmpty()) {
+                return qint64(-1);
+            }
+        }
+        QMapIterator<QString, QString> i(replacements);
         while (i.hasNext()) {
             i.next();
             scene.replace(i.key(), i.value());
         }
-    }
-    m_project->slotAutoSave(scene);
+        return KdenliveDoc::writeAutoSave(autoSavePath, scene.toUtf8()) ? writeTimer.elapsed() : qint64(-1);
+    }));
+    m_autoSaveStats.guiTime = timer.elapsed();
     m_lastSave.start();
 }
 
-QString ProjectManager::projectSceneList(const QString &outputFolder)
+const ProjectManager::AutoSaveStats &ProjectManager::autoSaveStats() const
+{
+    return m_autoSaveStats;
+}
+
+void ProjectManager::withoutOverlays(const std::function<void()> &func)
 {
     // Disable multitrack view and overlay
     bool isMultiTrack = pCore->monitorManager()->isMultiTrack();
@@ -667,7 +740,7 @@ QString ProjectManager::projectSceneList(const QString &outputFolder)
         pCore->window()->getMainTimeline()->controller()->updatePreviewConnection(false);
     }
     pCore->mixer()->pauseMonitoring(true);
-    QString scene = pCore->monitorManager()->projectMonitor()->sceneList(outputFolder);
+    func();
     pCore->mixer()->pauseMonitoring(false);
     if (isMultiTrack) {
         pCore->window()->getMainTimeline()->controller()->slotMultitrackView(true, false);
@@ -675,6 +748,12 @@ QString ProjectManager::projectSceneList(const QString &outputFolder)
     if (hasPreview) {
         pCore->window()->getMainTimeline()->controller()->updatePreviewConnection(true);
     }
+}
+
+QString ProjectManager::projectSceneList(const QString &outputFolder)
+{
+    QString scene;
+    withoutOverlays([&scene, &outputFolder]() { scene = pCore->monitorManager()->projectMonitor()->sceneList(outputFolder); });
     return scene;
 }
 
@@ -845,9 +924,12 @@ bool ProjectManager::updateTimeline(int pos, int scrollPos)
     }*/
     pCore->window()->getMainTimeline()->loading = true;
     pCore->window()->slotSwitchTimelineZone(m_project->getDocumentProperty(QStringLiteral("enableTimelineZone")).toInt() == 1);
+    LoadTimings timings = m_project->loadTimings();
+    timings.resume();
     QScopedPointer<Mlt::Producer> xmlProd(new Mlt::Producer(pCore->getCurrentProfile()->profile(), "xml-string", m_project->getProjectXml().constData()));
     Mlt::Service s(*xmlProd);
     Mlt::Tractor tractor(s);
+    timings.mark(QStringLiteral("mlt parse"));
     if (tractor.count() == 0) {
         // Wow we have a project file with empty tractor, probably corrupted, propose to open a recovery file
         KMessageBox::ButtonCode res = KMessageBox::warningContinueCancel(qApp->activeWindow(), i18n("Project file is corrupted (no tracks). Try to find a backup file?"));
@@ -867,7 +949,7 @@ bool ProjectManager::updateTimeline(int pos, int scrollPos)
     // Add snap point at projec start
     m_mainTimelineModel->addSnap(0);
     pCore->window()->getMainTimeline()->setModel(m_mainTimelineModel, pCore->monitorManager()->projectMonitor()->getControllerProxy());
-    if (!constructTimelineFromMelt(m_mainTimelineModel, tractor, m_progressDialog)) {
+    if (!constructTimelineFromMelt(m_mainTimelineModel, tractor, m_progressDialog, &timings)) {
         //TODO: act on project load failure
         qDebug()<<"// Project failed to load!!";
     }
@@ -885,6 +967,7 @@ bool ProjectManager::updateTimeline(int pos, int scrollPos)
     pCore->monitorManager()->updatePreviewScaling();
     pCore->monitorManager()->projectMonitor()->slotActivateMonitor();
     pCore->monitorManager()->projectMonitor()->setProducer(m_mainTimelineModel->producer(), pos);
+    timings.mark(QStringLiteral("monitor"));
     pCore->monitorManager()->projectMonitor()->adjustRulerSize(m_mainTimelineModel->duration() - 1, m_project->getGuideModel());
     pCore->window()->getMainTimeline()->controller()->setZone(m_project->zone(), false);
     //pCore->window()->getMainTimeline()->controller()->setTargetTracks(m_project->targetTracks());
@@ -894,6 +977,9 @@ bool ProjectManager::updateTimeline(int pos, int scrollPos)
         pCore->window()->getMainTimeline()->controller()->setActiveTrack(m_mainTimelineModel->getTrackIndexFromPosition(activeTrackPosition));
     }
     m_mainTimelineModel->setUndoStack(m_project->commandStack());
+    const MediaCache::Stats cacheStats = MediaCache::get()->stats();
+    qCDebug(KDENLIVE_LOG) << "Project loaded," << timings.toString() << "- media cache hits:" << cacheStats.hits << "misses:" << cacheStats.misses;
+    MediaCache::get()->flush();
     return true;
 }
 
@@ -19,9 +19,11 @@ the Free Software Foundation, either version 3 of the License, or
 #include <QTimer>
 #include <QUrl>
 #include <QElapsedTimer>
+#include <QFutureWatcher>
 
 #include "timeline2/model/timelineitemmodel.hpp"
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -89,6 +91,19 @@ public:
      */
     void saveWithUpdatedProfile(const QString &updatedProfile);
 
+    /** @brief Counters and durations (in ms) of the autosaves of the current session */
+    struct AutoSaveStats
+    {
+        /** @brief Time spent on the GUI thread: document properties and scene serialization */
+        qint64 guiTime = 0;
+        /** @brief Time spent on the worker thread: url replacements and atomic write */
+        qint64 writeTime = 0;
+        int saved = 0;
+        /** @brief Autosaves skipped because the document did not change since the last one */
+        int skipped = 0;
+    };
+    const AutoSaveStats &autoSaveStats() const;
+
 public slots:
     void newFile(QString profileName, bool showProjectSettings = true);
     void newFile(bool showProjectSettings = true);
@@ -109,7 +124,7 @@ public slots:
     /** @brief Set properties to match outputFileName and save the document.
      * Creates an autosave version of the output file too, at
      * ~/.kde/data/stalefiles/kdenlive/ \n
-     * that will be actually written in KdenliveDoc::slotAutoSave()
+     * that will be actually written in ProjectManager::slotAutoSave()
      * @param outputFileName The URL to save to / The document's URL.
      * @return Whether we had success. */
     bool saveFileAs(const QString &outputFileName);
@@ -177,11 +192,19 @@ protected:
 private:
     /** @brief checks if autoback files exists, recovers from it if user says yes, returns true if files were recovered. */
     bool checkForBackupFile(const QUrl &url, bool newFile = false);
+    /** @brief Runs @param func with the multitrack view, the timeline preview and the mixer monitoring disabled, so that they are not saved */
+    void withoutOverlays(const std::function<void()> &func);
 
     KdenliveDoc *m_project{nullptr};
     std::shared_ptr<TimelineItemModel> m_mainTimelineModel;
     QElapsedTimer m_lastSave;
     QTimer m_autoSaveTimer;
+    /** @brief Autosave being written, returns the write duration or -1 on failure */
+    QFutureWatcher<qint64> m_autoSaveWatcher;
+    /** @brief Document revision saved by the running autosave, and by the last successful one */
+    int m_pendingAutoSaveRevision{-1};
+    int m_lastAutoSaveRevision{-1};
+    AutoSaveStats m_autoSaveStats;
     QUrl m_startUrl;
     QString m_loadClipsOnOpen;
     QMap<QString, QString> m_replacementPattern;
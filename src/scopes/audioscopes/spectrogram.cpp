@@ -36,10 +36,7 @@
 
 Spectrogram::Spectrogram(QWidget *parent)
     : AbstractAudioScopeWidget(true, parent)
-    , m_fftTools()
-    , m_fftHistory()
-    , m_fftHistoryImg()
-
+    , m_engine(SPECTROGRAM_HISTORY_SIZE)
 {
     m_ui = new Ui::Spectrogram_UI;
     m_ui->setupUi(this);
@@ -318,21 +315,24 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         // Show the window size used, for information
         m_ui->labelFFTSizeNumber->setText(QVariant(fftWindow).toString());
 
-        if (newDataAvailable) {
-
-            auto *freqSpectrum = new float[(uint)fftWindow / 2];
+        // Redraws the image from the history if the size or a parameter like min/max dB changed
+        SpectrogramEngine::Display display;
+        display.size = m_innerScopeRect.size();
+        display.freqRatio = m_freq > 0 ? float(m_freqMax) / ((float)m_freq / 2.f) : 1.f;
+        display.dBmin = m_dBmin;
+        display.dBmax = m_dBmax;
+        display.highlightPeaks = m_aHighlightPeaks->isChecked();
+        display.colorMap = m_colorMap;
+        display.highlight = AbstractScopeWidget::colHighlightDark.rgba();
+        m_engine.setDisplay(display);
 
+        if (newDataAvailable) {
             // Get the spectral power distribution of the input samples,
-            // using the given window size and function
-            FFTTools::WindowType windowType = (FFTTools::WindowType)m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt();
-            m_fftTools.fftNormalized(audioFrame, 0, (uint)num_channels, freqSpectrum, windowType, (uint)fftWindow, 0);
-
+            // using the given window size and function.
             // This method might be called also when a simple refresh is required.
             // In this case there is no data to append to the history. Only append new data.
-            QVector<float> spectrumVector(fftWindow / 2);
-            memcpy(spectrumVector.data(), &freqSpectrum[0], (uint)fftWindow / 2 * sizeof(float));
-            m_fftHistory.prepend(spectrumVector);
-            delete[] freqSpectrum;
+            FFTTools::WindowType windowType = (FFTTools::WindowType)m_ui->windowFunction->itemData(m_ui->windowFunction->currentIndex()).toInt();
+            m_engine.addFrame(audioFrame, 0, (uint)num_channels, windowType, (uint)fftWindow);
         }
 #ifdef DEBUG_SPECTROGRAM
         else {
@@ -340,92 +340,17 @@ QImage Spectrogram::renderAudioScope(uint, const audioShortVector &audioFrame, c
         }
 #endif
 
-        // Limit the maximum history size to avoid wasting space
-        while (m_fftHistory.size() > SPECTROGRAM_HISTORY_SIZE) {
-            m_fftHistory.removeLast();
-        }
-
         // Draw the spectrum
         QImage spectrum(m_scopeRect.size(), QImage::Format_ARGB32);
         spectrum.fill(qRgba(0, 0, 0, 0));
         QPainter davinci(&spectrum);
-        const int h = m_innerScopeRect.height();
-        const int leftDist = m_innerScopeRect.left() - m_scopeRect.left();
-        const int topDist = m_innerScopeRect.top() - m_scopeRect.top();
-        int windowSize;
-        int y;
-        bool completeRedraw = true;
-
-        if (m_fftHistoryImg.size() == m_scopeRect.size() && !m_parameterChanged) {
-            // The size of the widget and the parameters (like min/max dB) have not changed since last time,
-            // so we can re-use it, shift it by one pixel, and render the single remaining line. Usually about
-            // 10 times faster for a widget height of around 400 px.
-            if (newDataAvailable) {
-                davinci.drawImage(0, -1, m_fftHistoryImg);
-            } else {
-                // spectrum = m_fftHistoryImg does NOT work, leads to segfaults (anyone knows why, please tell me)
-                davinci.drawImage(0, 0, m_fftHistoryImg);
-            }
-            completeRedraw = false;
-        }
-
-        y = 0;
-        if ((newData != 0) || m_parameterChanged) {
-            m_parameterChanged = false;
-            bool peak = false;
-
-            QVector<float> dbMap;
-            uint right;
-            ////////////////FIXME
-            for (auto &it : m_fftHistory) {
-
-                windowSize = it.size();
-
-                // Interpolate the frequency data to match the pixel coordinates
-                right = uint(((float)m_freqMax) / ((float)m_freq / 2.) * float(windowSize - 1));
-                dbMap = FFTTools::interpolatePeakPreserving(it, (uint)m_innerScopeRect.width(), 0, right, -180);
-
-                for (int i = 0; i < dbMap.size(); ++i) {
-                    float val;
-                    val = dbMap[i];
-                    peak = val > (float)m_dBmax;
-
-                    // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
-                    val = (val - (float)m_dBmax) / (float)(m_dBmax - m_dBmin) + 1.;
-                    if (val < 0) {
-                        val = 0;
-                    } else if (val > 1) {
-                        val = 1;
-                    }
-                    if (!peak || !m_aHighlightPeaks->isChecked()) {
-                        spectrum.setPixel(leftDist + i, topDist + h - 1 - y, m_colorMap[(int)(val * 255)]);
-                    } else {
-                        spectrum.setPixel(leftDist + i, topDist + h - 1 - y, AbstractScopeWidget::colHighlightDark.rgba());
-                    }
-                }
-
-                y++;
-                if (y >= topDist + m_innerScopeRect.height()) {
-                    break;
-                }
-                if (!completeRedraw) {
-                    break;
-                }
-            }
-        }
+        m_engine.paint(davinci, m_innerScopeRect.topLeft() - m_scopeRect.topLeft());
+        davinci.end();
 
 #ifdef DEBUG_SPECTROGRAM
-        qCDebug(KDENLIVE_LOG) << "Rendered " << y - topDist << "lines from " << m_fftHistory.size() << " available samples in " << start.elapsed() << " ms"
-                              << (completeRedraw ? "" : " (re-used old image)");
-        uint storedBytes = 0;
-        for (QList<QVector<float>>::iterator it = m_fftHistory.begin(); it != m_fftHistory.end(); ++it) {
-            storedBytes += (*it).size() * sizeof((*it)[0]);
-        }
-        qCDebug(KDENLIVE_LOG) << QString("Total storage used: %1 kB").arg((double)storedBytes / 1000, 0, 'f', 2);
+        qCDebug(KDENLIVE_LOG) << "Rendered spectrogram with " << m_engine.historyCount() << " available samples in " << timer.elapsed() << " ms";
 #endif
 
-        m_fftHistoryImg = spectrum;
-
         emit signalScopeRenderingFinished((uint)timer.elapsed(), 1);
         return spectrum;
     }
@@ -495,7 +420,6 @@ void Spectrogram::handleMouseDrag(const QPoint &movement, const RescaleDirection
             }
         }
 
-        m_parameterChanged = true;
         forceUpdateHUD();
         forceUpdateScope();
 
@@ -510,7 +434,6 @@ void Spectrogram::handleMouseDrag(const QPoint &movement, const RescaleDirection
         }
         m_customFreq = true;
 
-        m_parameterChanged = true;
         forceUpdateHUD();
         forceUpdateScope();
     }
@@ -519,17 +442,10 @@ void Spectrogram::handleMouseDrag(const QPoint &movement, const RescaleDirection
 void Spectrogram::slotResetMaxFreq()
 {
     m_customFreq = false;
-    m_parameterChanged = true;
     forceUpdateHUD();
     forceUpdateScope();
 }
 
-void Spectrogram::resizeEvent(QResizeEvent *event)
-{
-    m_parameterChanged = true;
-    AbstractAudioScopeWidget::resizeEvent(event);
-}
-
 #undef SPECTROGRAM_HISTORY_SIZE
 #ifdef DEBUG_SPECTROGRAM
 #undef DEBUG_SPECTROGRAM
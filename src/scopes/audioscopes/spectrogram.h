@@ -11,10 +11,10 @@
 /** This Spectrogram shows the spectral power distribution of incoming audio samples
     over time. See https://en.wikipedia.org/wiki/Spectrogram.
 
-    The Spectrogram makes use of two caches:
-    * A cached image where only the most recent line needs to be appended instead of
-      having to recalculate the whole image. A typical speedup factor is 10x.
-    * A FFT cache storing a history of previous spectral power distributions (i.e.
+    The Spectrogram makes use of two caches, both kept by SpectrogramEngine:
+    * A circular image where only the most recent line needs to be drawn instead of
+      having to recalculate the whole image.
+    * A circular FFT history storing previous spectral power distributions (i.e.
       the Fourier-transformed audio signals). This is used if the user adjusts parameters
       like the maximum frequency to display or minimum/maximum signal strength in dB.
       All required information is preserved in the FFT history, which would not be the
@@ -26,7 +26,7 @@
 #define SPECTROGRAM_H
 
 #include "abstractaudioscopewidget.h"
-#include "lib/audio/fftTools.h"
+#include "spectrogramengine.h"
 #include "ui_spectrogram_ui.h"
 
 class Spectrogram_UI;
@@ -53,27 +53,21 @@ protected:
     void readConfig() override;
     void writeConfig();
     void handleMouseDrag(const QPoint &movement, const RescaleDirection rescaleDirection, const Qt::KeyboardModifiers rescaleModifiers) override;
-    void resizeEvent(QResizeEvent *event) override;
 
 private:
     Ui::Spectrogram_UI *m_ui;
-    FFTTools m_fftTools;
+    SpectrogramEngine m_engine;
     QAction *m_aResetHz;
     QAction *m_aGrid;
     QAction *m_aTrackMouse;
     QAction *m_aHighlightPeaks;
 
-    QList<QVector<float>> m_fftHistory;
-    QImage m_fftHistoryImg;
-
     int m_dBmin{-70};
     int m_dBmax{0};
 
     int m_freqMax{0};
     bool m_customFreq{false};
 
-    bool m_parameterChanged{false};
-
     QRect m_innerScopeRect;
     QRgb m_colorMap[256];
 
@@ -0,0 +1,170 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "spectrogramengine.h"
+
+#include <QPainter>
+#include <algorithm>
+
+bool SpectrogramEngine::Display::operator==(const Display &other) const
+{
+    return size == other.size && qFuzzyCompare(freqRatio, other.freqRatio) && dBmin == other.dBmin && dBmax == other.dBmax &&
+           highlightPeaks == other.highlightPeaks && colorMap == other.colorMap && highlight == other.highlight;
+}
+
+SpectrogramEngine::SpectrogramEngine(int historySize)
+    : m_historySize(qMax(1, historySize))
+    , m_historyBins((size_t)m_historySize, 0)
+    , m_binsCapacity(0)
+    , m_historyHead(-1)
+    , m_historyCount(0)
+    , m_imageHead(-1)
+{
+}
+
+void SpectrogramEngine::reserveBins(int bins)
+{
+    if (bins <= m_binsCapacity) {
+        return;
+    }
+    // Only happens when a larger window size is selected, keep the previous spectra
+    std::vector<float> history((size_t)m_historySize * (size_t)bins);
+    for (int row = 0; row < m_historySize; ++row) {
+        std::copy_n(m_history.data() + (size_t)row * (size_t)m_binsCapacity, m_historyBins[(size_t)row], history.data() + (size_t)row * (size_t)bins);
+    }
+    m_history.swap(history);
+    m_binsCapacity = bins;
+}
+
+void SpectrogramEngine::addFrame(const audioShortVector &audioFrame, uint channel, uint numChannels, FFTTools::WindowType windowType, uint windowSize)
+{
+    const int bins = int(windowSize / 2);
+    if (bins < 1 || (windowSize & 1) != 0u) {
+        return;
+    }
+    reserveBins(bins);
+    m_historyHead = (m_historyHead + 1) % m_historySize;
+    m_historyCount = qMin(m_historyCount + 1, m_historySize);
+    // The FFT is written in place in the history
+    m_fftTools.fftNormalized(audioFrame, channel, numChannels, m_history.data() + (size_t)m_historyHead * (size_t)m_binsCapacity, windowType, windowSize, 0);
+    m_historyBins[(size_t)m_historyHead] = bins;
+
+    if (!m_image.isNull()) {
+        // Scroll by moving the start of the image
+        m_imageHead = (m_imageHead + 1) % m_image.height();
+        drawLine(0, m_imageHead);
+    }
+}
+
+void SpectrogramEngine::setDisplay(const Display &display)
+{
+    if (display == m_display && !m_image.isNull()) {
+        return;
+    }
+    m_display = display;
+    redraw();
+}
+
+void SpectrogramEngine::redraw()
+{
+    if (m_display.size.isEmpty() || m_display.colorMap == nullptr || m_display.dBmax <= m_display.dBmin) {
+        m_image = QImage();
+        return;
+    }
+    if (m_image.size() != m_display.size) {
+        m_image = QImage(m_display.size, QImage::Format_ARGB32);
+    }
+    m_image.fill(qRgba(0, 0, 0, 0));
+    const int height = m_image.height();
+    m_imageHead = height - 1;
+    const int lines = qMin(m_historyCount, height);
+    for (int age = 0; age < lines; ++age) {
+        drawLine(age, height - 1 - age);
+    }
+}
+
+void SpectrogramEngine::drawLine(int age, int row)
+{
+    const int width = m_image.width();
+    auto *line = reinterpret_cast<QRgb *>(m_image.scanLine(row));
+    int bins = 0;
+    const float *spectrum = this->spectrum(age, &bins);
+    if (spectrum == nullptr || bins < 2) {
+        std::fill(line, line + width, qRgba(0, 0, 0, 0));
+        return;
+    }
+    m_dbLine.resize((size_t)width);
+    // Interpolate the frequency data to match the pixel coordinates
+    const auto right = uint(m_display.freqRatio * float(bins - 1));
+    FFTTools::interpolatePeakPreserving(spectrum, (uint)bins, m_dbLine.data(), (uint)width, 0, right, -180);
+
+    const float dBmax = (float)m_display.dBmax;
+    const float range = float(m_display.dBmax - m_display.dBmin);
+    for (int i = 0; i < width; ++i) {
+        float val = m_dbLine[(size_t)i];
+        if (m_display.highlightPeaks && val > dBmax) {
+            line[i] = m_display.highlight;
+            continue;
+        }
+        // Normalize dB value to [0 1], 1 corresponding to dbMax dB and 0 to dbMin dB
+        val = (val - dBmax) / range + 1.f;
+        if (val < 0) {
+            val = 0;
+        } else if (val > 1) {
+            val = 1;
+        }
+        line[i] = m_display.colorMap[(int)(val * 255)];
+    }
+}
+
+void SpectrogramEngine::paint(QPainter &painter, const QPoint &pos) const
+{
+    if (m_image.isNull()) {
+        return;
+    }
+    const int width = m_image.width();
+    const int height = m_image.height();
+    // Lines after the head are the oldest ones
+    const int oldLines = height - 1 - m_imageHead;
+    if (oldLines > 0) {
+        painter.drawImage(pos, m_image, QRect(0, m_imageHead + 1, width, oldLines));
+    }
+    painter.drawImage(pos + QPoint(0, oldLines), m_image, QRect(0, 0, width, m_imageHead + 1));
+}
+
+QImage SpectrogramEngine::image() const
+{
+    if (m_image.isNull()) {
+        return QImage();
+    }
+    QImage result(m_image.size(), QImage::Format_ARGB32);
+    result.fill(qRgba(0, 0, 0, 0));
+    QPainter painter(&result);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    paint(painter, QPoint());
+    painter.end();
+    return result;
+}
+
+int SpectrogramEngine::historyCount() const
+{
+    return m_historyCount;
+}
+
+const float *SpectrogramEngine::spectrum(int age, int *bins) const
+{
+    if (age < 0 || age >= m_historyCount) {
+        *bins = 0;
+        return nullptr;
+    }
+    const int row = (m_historyHead - age + m_historySize) % m_historySize;
+    *bins = m_historyBins[(size_t)row];
+    return m_history.data() + (size_t)row * (size_t)m_binsCapacity;
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SPECTROGRAMENGINE_H
+#define SPECTROGRAMENGINE_H
+
+#include "lib/audio/fftTools.h"
+
+#include <QImage>
+#include <QRgb>
+#include <QSize>
+#include <vector>
+
+class QPainter;
+
+/**
+  Computes and draws the spectrogram lines.
+
+  The spectra are stored in a circular history allocated once, so that parameters like the maximum frequency
+  or the dB range can be changed and the image redrawn. Lines are drawn into a circular image too: a new spectrum
+  only draws one line and moves the start of the image, so the cost of a new frame does not depend on the
+  history length nor on the widget height.
+  */
+class SpectrogramEngine
+{
+public:
+    /** @param historySize the number of spectra kept */
+    explicit SpectrogramEngine(int historySize);
+
+    /** How the spectra are drawn */
+    struct Display
+    {
+        QSize size;
+        /** The displayed maximum frequency, relative to the Nyquist frequency */
+        float freqRatio = 1.f;
+        int dBmin = -70;
+        int dBmax = 0;
+        bool highlightPeaks = false;
+        const QRgb *colorMap = nullptr;
+        QRgb highlight = 0;
+        bool operator==(const Display &other) const;
+    };
+    /** @brief Sets the display parameters, the image is redrawn from the history if they changed */
+    void setDisplay(const Display &display);
+
+    /** @brief Computes the spectrum of @param channel in @param audioFrame and draws it as the newest line */
+    void addFrame(const audioShortVector &audioFrame, uint channel, uint numChannels, FFTTools::WindowType windowType, uint windowSize);
+
+    /** @brief Draws the image at @param pos, the oldest line at the top and the newest at the bottom */
+    void paint(QPainter &painter, const QPoint &pos) const;
+    /** @brief Returns the image drawn by paint(), for tests */
+    QImage image() const;
+
+    /** @brief Number of spectra in the history */
+    int historyCount() const;
+    /** @brief Returns the spectrum added @param age frames ago, 0 being the newest. @param bins is set to its size */
+    const float *spectrum(int age, int *bins) const;
+
+private:
+    FFTTools m_fftTools;
+    int m_historySize;
+    /** Spectra, each stored in a row of m_binsCapacity values */
+    std::vector<float> m_history;
+    std::vector<int> m_historyBins;
+    int m_binsCapacity;
+    int m_historyHead;
+    int m_historyCount;
+
+    Display m_display;
+    QImage m_image;
+    /** Row of m_image holding the newest line */
+    int m_imageHead;
+    std::vector<float> m_dbLine;
+
+    void reserveBins(int bins);
+    void redraw();
+    void drawLine(int age, int row);
+};
+
+#endif // SPECTROGRAMENGINE_H
@@ -9,6 +9,7 @@
  ***************************************************************************/
 
 #include "histogramgenerator.h"
+#include "scopekernels.h"
 
 #include "klocalizedstring.h"
 #include <QImage>
@@ -19,7 +20,7 @@
 HistogramGenerator::HistogramGenerator() = default;
 
 QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, HistogramGenerator::Rec rec, bool unscaled,
-                                              uint accelFactor) const
+                                              uint accelFactor)
 {
     if (paradeSize.height() <= 0 || paradeSize.width() <= 0 || image.width() <= 0 || image.height() <= 0) {
         return QImage();
@@ -33,39 +34,56 @@ QImage HistogramGenerator::calculateHistogram(const QSize &paradeSize, const QIm
 
     int r[256], g[256], b[256], y[256], s[766];
     // Initialize the values to zero
-    std::fill(r, r + 256, 0);
-    std::fill(g, g + 256, 0);
-    std::fill(b, b + 256, 0);
-    std::fill(y, y + 256, 0);
     std::fill(s, s + 766, 0);
 
-    const uint iw = (uint)image.bytesPerLine();
-    const uint ih = (uint)image.height();
+    const QImage frame = ScopeKernels::asRgb32(image);
+    const int iw = frame.width();
+    const int ih = frame.height();
     const uint ww = (uint)paradeSize.width();
     const uint wh = (uint)paradeSize.height();
-    const uint byteCount = iw * ih;
-
-    // Read the stats from the input image
-    for (int Y = 0; Y < image.height(); ++Y) {
-        for (int X = 0; X < image.width(); X += (int)accelFactor) {
-            QRgb col = image.pixel(X, Y);
-            r[qRed(col)]++;
-            g[qGreen(col)]++;
-            b[qBlue(col)]++;
-            if (drawY) {
-                // Use if branch to avoid expensive multiplication if Y disabled
-                if (rec == HistogramGenerator::Rec_601) {
-                    y[(int)floor(.299 * qRed(col) + .587 * qGreen(col) + .114 * qBlue(col))]++;
-                } else {
-                    y[(int)floor(.2125 * qRed(col) + .7154 * qGreen(col) + .0721 * qBlue(col))]++;
+    const uint byteCount = (uint)image.bytesPerLine() * (uint)image.height();
+
+    // Read the stats from the input image, one partial histogram (R, G, B, Y) per block of lines
+    m_stats.reset(4 * 256, ScopeKernels::blockCount(qint64(iw) * ih / accelFactor, 4 * 256));
+    const bool rec709 = rec == HistogramGenerator::Rec_709;
+    ScopeKernels::forEachBlock(ih, m_stats.blocks(), [&](int block, int first, int last) {
+        uint *bins = m_stats.block(block);
+        std::vector<QRgb> samples;
+        std::vector<uchar> luma;
+        for (int Y = first; Y < last; ++Y) {
+            const auto *line = reinterpret_cast<const QRgb *>(frame.constScanLine(Y));
+            if (accelFactor > 1) {
+                samples.clear();
+                for (int X = 0; X < iw; X += (int)accelFactor) {
+                    samples.push_back(line[X]);
                 }
+                line = samples.data();
             }
-            if (drawSum) {
-                // Use an if branch here because the sum takes more operations than rgb
-                s[qRed(col)]++;
-                s[qGreen(col)]++;
-                s[qBlue(col)]++;
+            const int count = accelFactor > 1 ? (int)samples.size() : iw;
+            for (int X = 0; X < count; ++X) {
+                bins[qRed(line[X])]++;
+                bins[256 + qGreen(line[X])]++;
+                bins[512 + qBlue(line[X])]++;
             }
+            if (drawY) {
+                // Skip the luma computation if Y disabled
+                luma.resize((size_t)count);
+                ScopeKernels::luma(line, count, rec709, luma.data());
+                for (uchar l : luma) {
+                    bins[768 + l]++;
+                }
+            }
+        }
+    });
+    const uint *bins = m_stats.merge();
+    for (int i = 0; i < 256; ++i) {
+        r[i] = int(bins[i]);
+        g[i] = int(bins[256 + i]);
+        b[i] = int(bins[512 + i]);
+        y[i] = int(bins[768 + i]);
+        if (drawSum) {
+            // Each pixel counts once per component in the sum
+            s[i] = r[i] + g[i] + b[i];
         }
     }
 
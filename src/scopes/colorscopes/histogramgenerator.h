@@ -11,6 +11,7 @@
 #ifndef HISTOGRAMGENERATOR_H
 #define HISTOGRAMGENERATOR_H
 
+#include "scopekernels.h"
 #include <QObject>
 
 class QColor;
@@ -34,7 +35,7 @@ public:
         components are OR-ed HistogramGenerator::Components flags and decide with components (Y, R, G, B) to paint.
         unscaled = true leaves the width at 256 if the widget is wider (to avoid scaling). */
     QImage calculateHistogram(const QSize &paradeSize, const QImage &image, const int &components, const HistogramGenerator::Rec rec, bool unscaled,
-                              uint accelFactor = 1) const;
+                              uint accelFactor = 1);
 
     QImage drawComponent(const int *y, const QSize &size, const float &scaling, const QColor &color, bool unscaled, uint max) const;
 
@@ -42,6 +43,10 @@ public:
                            uint max) const;
 
     enum Components { ComponentY = 1 << 0, ComponentR = 1 << 1, ComponentG = 1 << 2, ComponentB = 1 << 3, ComponentSum = 1 << 4 };
+
+private:
+    /** @brief Partial histograms, kept between frames */
+    ScopeKernels::Histograms m_stats;
 };
 
 #endif // HISTOGRAMGENERATOR_H
@@ -10,8 +10,10 @@
 
 #include "rgbparadegenerator.h"
 #include "klocalizedstring.h"
+#include "scopekernels.h"
 #include <QColor>
 #include <QPainter>
+#include <algorithm>
 
 #define CHOP255(a) ((255) < (a) ? (255) : int(a))
 #define CHOP1255(a) ((a) < (1) ? (1) : ((a) > (255) ? (255) : (a)))
@@ -23,13 +25,6 @@ const QColor RGBParadeGenerator::colSoft(150, 150, 150, 255);
 const uchar RGBParadeGenerator::distRight(40);
 const uchar RGBParadeGenerator::distBottom(40);
 
-struct StructRGB
-{
-    uint r;
-    uint g;
-    uint b;
-};
-
 RGBParadeGenerator::RGBParadeGenerator() = default;
 
 QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QImage &image, const RGBParadeGenerator::PaintMode paintMode, bool drawAxis,
@@ -47,96 +42,84 @@ QImage RGBParadeGenerator::calculateRGBParade(const QSize &paradeSize, const QIm
 
     const uint ww = (uint)paradeSize.width();
     const uint wh = (uint)paradeSize.height();
-    const uint iw = (uint)image.bytesPerLine();
-    const uint ih = (uint)image.height();
-    const uint byteCount = iw * ih; // Note that 1 px = 4 B
+    const QImage frame = ScopeKernels::asRgb32(image);
+    const int iw = frame.width();
+    const int ih = frame.height();
 
     const uchar offset = 10;
+    if (ww <= 2 * offset + distRight + 3 || wh <= distBottom) {
+        // Too small to draw anything
+        return parade;
+    }
     const uint partW = (ww - 2 * offset - distRight) / 3;
     const uint partH = wh - distBottom;
 
-    // Statistics
-    uchar minR = 255, minG = 255, minB = 255, maxR = 0, maxG = 0, maxB = 0, r, g, b;
-
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = (float)((byteCount >> 2) / accelFactor) / float(partW * 255);
+    const float pixelDepth = (float)(qint64(iw) * ih / accelFactor) / float(partW * 255);
     const float gain = 255 / (8 * pixelDepth);
     //        qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
     QImage unscaled((int)ww - distRight, 256, QImage::Format_ARGB32);
     unscaled.fill(qRgba(0, 0, 0, 0));
 
-    const float wPrediv = (float)(partW - 1) / float((int)iw - 1);
-
-    std::vector<std::vector<StructRGB>> paradeVals(partW, std::vector<StructRGB>(256, {0, 0, 0}));
-
-    const uchar *bits = image.bits();
-    const uint stepsize = uint(uint(image.depth() / 8) * accelFactor);
-
-    for (uint i = 0, x = 0; i < byteCount; i += stepsize) {
-        auto *col = (const QRgb *)(bits);
-        r = (uchar)qRed(*col);
-        g = (uchar)qGreen(*col);
-        b = (uchar)qBlue(*col);
-
-        double dx = x * (double)wPrediv;
-
-        paradeVals[(size_t)dx][r].r++;
-        paradeVals[(size_t)dx][g].g++;
-        paradeVals[(size_t)dx][b].b++;
+    std::vector<uint> columns((size_t)iw);
+    for (int x = 0; x < iw; ++x) {
+        columns[(size_t)x] = iw > 1 ? uint(float(x) * float(partW - 1) / float(iw - 1)) : 0;
+    }
 
-        if (r < minR) {
-            minR = r;
-        }
-        if (g < minG) {
-            minG = g;
-        }
-        if (b < minB) {
-            minB = b;
-        }
-        if (r > maxR) {
-            maxR = r;
+    // One 256 x partW histogram per channel, stored value by value
+    const size_t channelSize = 256 * size_t(partW);
+    m_paradeVals.reset(3 * channelSize, ScopeKernels::blockCount(qint64(iw) * ih / accelFactor, 3 * channelSize));
+    ScopeKernels::forEachBlock(ih, m_paradeVals.blocks(), [&](int block, int first, int last) {
+        uint *red = m_paradeVals.block(block);
+        uint *green = red + channelSize;
+        uint *blue = green + channelSize;
+        for (int y = first; y < last; ++y) {
+            const auto *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+            // Every accelFactor-th pixel is sampled, counting from the start of the frame
+            const qint64 lineStart = qint64(y) * iw;
+            for (int x = int((accelFactor - lineStart % accelFactor) % accelFactor); x < iw; x += (int)accelFactor) {
+                const QRgb col = line[x];
+                const uint column = columns[(size_t)x];
+                red[uint(qRed(col)) * partW + column]++;
+                green[uint(qGreen(col)) * partW + column]++;
+                blue[uint(qBlue(col)) * partW + column]++;
+            }
         }
-        if (g > maxG) {
-            maxG = g;
+    });
+    const uint *bins = m_paradeVals.merge();
+
+    // Statistics
+    uchar mins[3], maxs[3];
+    for (int c = 0; c < 3; ++c) {
+        const uint *channel = bins + size_t(c) * channelSize;
+        auto used = [channel, partW](int value) { return std::any_of(channel + value * partW, channel + (value + 1) * partW, [](uint v) { return v > 0; }); };
+        int min = 0;
+        while (min < 255 && !used(min)) {
+            min++;
         }
-        if (b > maxB) {
-            maxB = b;
+        int max = 255;
+        while (max > 0 && !used(max)) {
+            max--;
         }
-
-        bits += stepsize;
-        x += stepsize;
-        x %= iw; // Modulo image width, to represent the current x position in the image
+        mins[c] = uchar(qMin(min, max));
+        maxs[c] = uchar(max);
     }
+    const uchar minR = mins[0], minG = mins[1], minB = mins[2], maxR = maxs[0], maxG = maxs[1], maxB = maxs[2];
 
     const int offset1 = (int)partW + (int)offset;
     const int offset2 = 2 * (int)partW + 2 * (int)offset;
-    switch (paintMode) {
-    case PaintMode_RGB:
-        for (int i = 0; i < (int)partW; ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 10, 10, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].r)));
-                unscaled.setPixel(i + offset1, j, qRgba(10, 255, 10, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].g)));
-                unscaled.setPixel(i + offset2, j, qRgba(10, 10, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].b)));
-            }
-        }
-        break;
-    default:
-        for (int i = 0; i < (int)partW; ++i) {
-            for (int j = 0; j < 256; ++j) {
-                unscaled.setPixel(i, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].r)));
-                unscaled.setPixel(i + offset1, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].g)));
-                unscaled.setPixel(i + offset2, j, qRgba(255, 255, 255, CHOP255(gain * (float)paradeVals[(size_t)i][(size_t)j].b)));
-            }
-        }
-        break;
-    }
+    const bool white = paintMode != PaintMode_RGB;
+    auto tone = [gain](int r, int g, int b) { return [gain, r, g, b](uint count) { return qRgba(r, g, b, CHOP255(gain * (float)count)); }; };
+    ScopeKernels::toneMap(bins, (int)partW, 256, white ? tone(255, 255, 255) : tone(255, 10, 10), unscaled);
+    ScopeKernels::toneMap(bins + channelSize, (int)partW, 256, white ? tone(255, 255, 255) : tone(10, 255, 10), unscaled, offset1);
+    ScopeKernels::toneMap(bins + 2 * channelSize, (int)partW, 256, white ? tone(255, 255, 255) : tone(10, 10, 255), unscaled, offset2);
 
     // Scale the image to the target height. Scaling is not accomplished before because
     // there are only 255 different values which would lead to gaps if the height is not exactly 255.
     // Don't use bilinear transformation because the fast transformation meets the goal better.
-    davinci.drawImage(0, 0, unscaled.mirrored(false, true).scaled(unscaled.width(), (int)partH, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+    davinci.drawImage(0, 0, unscaled.scaled(unscaled.width(), (int)partH, Qt::IgnoreAspectRatio, Qt::FastTransformation));
 
     if (drawAxis) {
         QRgb opx;
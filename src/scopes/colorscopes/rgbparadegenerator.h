@@ -11,6 +11,7 @@
 #ifndef RGBPARADEGENERATOR_H
 #define RGBPARADEGENERATOR_H
 
+#include "scopekernels.h"
 #include <QObject>
 
 class QColor;
@@ -32,6 +33,10 @@ public:
 
     static const uchar distRight;
     static const uchar distBottom;
+
+private:
+    /** @brief Partial histograms, kept between frames */
+    ScopeKernels::Histograms m_paradeVals;
 };
 
 #endif // RGBPARADEGENERATOR_H
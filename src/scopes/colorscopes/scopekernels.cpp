@@ -0,0 +1,264 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "scopekernels.h"
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <cstring>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCOPES_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(SCOPES_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCOPES_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+// Luma weights in 1/32768 units, rounded so that they sum to 32768 and white maps to 255
+const int rec601Weights[3] = {9798, 19235, 3735};
+const int rec709Weights[3] = {6963, 23442, 2363};
+const int weightShift = 15;
+
+// Pixels per block below which splitting the work costs more than it saves
+const qint64 pixelsPerBlock = 256 * 1024;
+// Memory budget of the partial histograms of one scope, in bytes
+const size_t maxHistogramBytes = 16 * 1024 * 1024;
+// Largest tone mapping table, higher counts are computed directly
+const uint maxLutSize = 1 << 20;
+// One cache line, in uints
+const size_t cacheLine = 64 / sizeof(uint);
+
+#ifdef SCOPES_SSE2
+// QRgb is 0xAARRGGBB: masking with 0x00ff00ff gives (B, R) 16 bit pairs, and after a byte shift (G, A) pairs,
+// which _mm_madd_epi16 multiplies and sums with the weights in one instruction.
+inline __m128i luma4(__m128i px, __m128i wRB, __m128i wG, __m128i mask)
+{
+    __m128i rb = _mm_and_si128(px, mask);
+    __m128i ga = _mm_and_si128(_mm_srli_epi32(px, 8), mask);
+    return _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(rb, wRB), _mm_madd_epi16(ga, wG)), weightShift);
+}
+
+int lumaSse2(const QRgb *pixels, int count, const int *w, uchar *out)
+{
+    const __m128i wRB = _mm_set1_epi32((w[0] << 16) | w[2]);
+    const __m128i wG = _mm_set1_epi32(w[1]);
+    const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const auto *src = reinterpret_cast<const __m128i *>(pixels + i);
+        __m128i a = luma4(_mm_loadu_si128(src), wRB, wG, mask);
+        __m128i b = luma4(_mm_loadu_si128(src + 1), wRB, wG, mask);
+        __m128i c = luma4(_mm_loadu_si128(src + 2), wRB, wG, mask);
+        __m128i d = luma4(_mm_loadu_si128(src + 3), wRB, wG, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+    return i;
+}
+#endif
+
+#ifdef SCOPES_AVX2
+__attribute__((target("avx2"))) inline __m256i luma8(__m256i px, __m256i wRB, __m256i wG, __m256i mask)
+{
+    __m256i rb = _mm256_and_si256(px, mask);
+    __m256i ga = _mm256_and_si256(_mm256_srli_epi32(px, 8), mask);
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_madd_epi16(rb, wRB), _mm256_madd_epi16(ga, wG)), weightShift);
+}
+
+__attribute__((target("avx2"))) int lumaAvx2(const QRgb *pixels, int count, const int *w, uchar *out)
+{
+    const __m256i wRB = _mm256_set1_epi32((w[0] << 16) | w[2]);
+    const __m256i wG = _mm256_set1_epi32(w[1]);
+    const __m256i mask = _mm256_set1_epi32(0x00ff00ff);
+    // Packing works inside 128 bit lanes, this puts the 4 byte groups back in pixel order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const auto *src = reinterpret_cast<const __m256i *>(pixels + i);
+        __m256i a = luma8(_mm256_loadu_si256(src), wRB, wG, mask);
+        __m256i b = luma8(_mm256_loadu_si256(src + 1), wRB, wG, mask);
+        __m256i c = luma8(_mm256_loadu_si256(src + 2), wRB, wG, mask);
+        __m256i d = luma8(_mm256_loadu_si256(src + 3), wRB, wG, mask);
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return i;
+}
+
+bool hasAvx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+    return avx2;
+}
+#endif
+
+void lumaTail(const QRgb *pixels, int from, int count, const int *w, uchar *out)
+{
+    for (int i = from; i < count; ++i) {
+        const QRgb px = pixels[i];
+        out[i] = uchar((w[0] * qRed(px) + w[1] * qGreen(px) + w[2] * qBlue(px)) >> weightShift);
+    }
+}
+} // namespace
+
+void ScopeKernels::lumaScalar(const QRgb *pixels, int count, bool rec709, uchar *out)
+{
+    lumaTail(pixels, 0, count, rec709 ? rec709Weights : rec601Weights, out);
+}
+
+void ScopeKernels::luma(const QRgb *pixels, int count, bool rec709, uchar *out)
+{
+    const int *w = rec709 ? rec709Weights : rec601Weights;
+    int done = 0;
+#ifdef SCOPES_AVX2
+    if (hasAvx2()) {
+        done = lumaAvx2(pixels, count, w, out);
+    }
+#endif
+#ifdef SCOPES_SSE2
+    done += lumaSse2(pixels + done, count - done, w, out + done);
+#endif
+    lumaTail(pixels, done, count, w, out);
+}
+
+const char *ScopeKernels::lumaInstructionSet()
+{
+#ifdef SCOPES_AVX2
+    if (hasAvx2()) {
+        return "AVX2";
+    }
+#endif
+#ifdef SCOPES_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+int ScopeKernels::blockCount(qint64 pixels, size_t bins)
+{
+    qint64 maxBlocks = qMax(1, QThread::idealThreadCount());
+    if (bins > 0) {
+        maxBlocks = qMin(maxBlocks, qint64(maxHistogramBytes / (bins * sizeof(uint))));
+    }
+    return int(qBound(qint64(1), pixels / pixelsPerBlock, qMax(qint64(1), maxBlocks)));
+}
+
+void ScopeKernels::forEachBlock(int rows, int blocks, const std::function<void(int, int, int)> &fn)
+{
+    blocks = qBound(1, blocks, qMax(1, rows));
+    auto run = [rows, blocks, &fn](int block) {
+        const int first = int(qint64(rows) * block / blocks);
+        const int last = int(qint64(rows) * (block + 1) / blocks);
+        fn(block, first, last);
+    };
+    if (blocks == 1) {
+        run(0);
+        return;
+    }
+    QVector<int> indexes(blocks);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    // Scopes are already rendered from a pool thread: blockingMap also works in the calling thread, so it cannot starve the pool
+    QtConcurrent::blockingMap(indexes, run);
+}
+
+QImage ScopeKernels::asRgb32(const QImage &image)
+{
+    if (image.depth() == 32) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_RGB32);
+}
+
+ScopeKernels::Histograms::Histograms(size_t bins, int blocks)
+{
+    reset(bins, blocks);
+}
+
+ScopeKernels::Histograms::~Histograms()
+{
+    qFreeAligned(m_data);
+}
+
+void ScopeKernels::Histograms::reset(size_t bins, int blocks)
+{
+    m_bins = bins;
+    m_stride = (bins + cacheLine - 1) / cacheLine * cacheLine;
+    m_blocks = qMax(1, blocks);
+    const size_t size = qMax(size_t(1), m_stride * size_t(m_blocks));
+    if (size > m_capacity) {
+        qFreeAligned(m_data);
+        m_data = static_cast<uint *>(qMallocAligned(size * sizeof(uint), 64));
+        Q_CHECK_PTR(m_data);
+        m_capacity = size;
+    }
+    memset(m_data, 0, size * sizeof(uint));
+}
+
+size_t ScopeKernels::Histograms::bins() const
+{
+    return m_bins;
+}
+
+int ScopeKernels::Histograms::blocks() const
+{
+    return m_blocks;
+}
+
+uint *ScopeKernels::Histograms::block(int index)
+{
+    return m_data + m_stride * size_t(index);
+}
+
+const uint *ScopeKernels::Histograms::block(int index) const
+{
+    return m_data + m_stride * size_t(index);
+}
+
+const uint *ScopeKernels::Histograms::merge()
+{
+    uint *result = block(0);
+    for (int b = 1; b < m_blocks; ++b) {
+        const uint *partial = block(b);
+        for (size_t i = 0; i < m_bins; ++i) {
+            result[i] += partial[i];
+        }
+    }
+    m_blocks = 1;
+    return result;
+}
+
+uint ScopeKernels::maxCount(const uint *bins, size_t size)
+{
+    return size == 0 ? 0 : *std::max_element(bins, bins + size);
+}
+
+void ScopeKernels::toneMap(const uint *bins, int width, int height, const std::function<QRgb(uint)> &tone, QImage &target, int xOffset)
+{
+    Q_ASSERT(target.depth() == 32);
+    Q_ASSERT(xOffset + width <= target.width() && height <= target.height());
+    const uint max = maxCount(bins, size_t(width) * size_t(height));
+    std::vector<QRgb> lut(std::min(max, maxLutSize - 1) + 1);
+    for (uint count = 0; count < lut.size(); ++count) {
+        lut[count] = tone(count);
+    }
+    for (int y = 0; y < height; ++y) {
+        const uint *row = bins + size_t(y) * size_t(width);
+        auto *line = reinterpret_cast<QRgb *>(target.scanLine(height - 1 - y)) + xOffset;
+        for (int x = 0; x < width; ++x) {
+            const uint count = row[x];
+            line[x] = count < lut.size() ? lut[count] : tone(count);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef SCOPEKERNELS_H
+#define SCOPEKERNELS_H
+
+#include <QImage>
+#include <QRgb>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+/**
+  Building blocks shared by the color scope generators.
+
+  Scopes are computed in two passes: the frame is first binned into flat histograms, one partial histogram per
+  block of rows so that blocks can be processed in parallel without locking, then the merged counts are turned
+  into colors through a lookup table and written directly to the scanlines of the scope image.
+  */
+namespace ScopeKernels {
+
+/** @brief Computes the 8 bit luma of @param count pixels into @param out, using Rec. 709 or Rec. 601 weights.
+    Uses AVX2 or SSE2 when available. */
+void luma(const QRgb *pixels, int count, bool rec709, uchar *out);
+/** @brief Plain C++ implementation of luma(), used on other architectures and as a reference */
+void lumaScalar(const QRgb *pixels, int count, bool rec709, uchar *out);
+/** @brief Name of the instruction set used by luma() on this cpu */
+const char *lumaInstructionSet();
+
+/** @brief Number of row blocks worth processing in parallel for @param pixels sampled pixels.
+    If @param bins is not 0, the blocks are also limited so that their partial histograms of @param bins bins fit in a fixed memory budget. */
+int blockCount(qint64 pixels, size_t bins = 0);
+/** @brief Calls @param fn(block, firstRow, lastRow) for @param blocks blocks covering [0, rows[, in parallel when there is more than one block */
+void forEachBlock(int rows, int blocks, const std::function<void(int, int, int)> &fn);
+
+/** @brief Returns @param image if it has 32 bits per pixel, a RGB32 copy otherwise */
+QImage asRgb32(const QImage &image);
+
+/**
+  A set of partial histograms of the same size, one per block of rows.
+  Each partial histogram starts on its own cache line so that threads never write to the same line.
+  The buffer is kept by reset(), so that a generator keeping its Histograms does not allocate them again for each frame.
+  */
+class Histograms
+{
+public:
+    Histograms() = default;
+    Histograms(size_t bins, int blocks);
+    ~Histograms();
+    Histograms(const Histograms &) = delete;
+    Histograms &operator=(const Histograms &) = delete;
+
+    /** @brief Clears the histograms and resizes them to @param blocks partial histograms of @param bins bins.
+        Memory is only allocated when the buffer is too small. */
+    void reset(size_t bins, int blocks);
+    size_t bins() const;
+    int blocks() const;
+    uint *block(int index);
+    const uint *block(int index) const;
+    /** @brief Sums all partial histograms into the first one and returns it */
+    const uint *merge();
+
+private:
+    size_t m_bins{0};
+    size_t m_stride{0};
+    int m_blocks{1};
+    size_t m_capacity{0};
+    uint *m_data{nullptr};
+};
+
+/** @brief Maximum count of a histogram */
+uint maxCount(const uint *bins, size_t size);
+
+/**
+  Writes a @param width x @param height histogram to @param target, bin (x, y) going to pixel (x + xOffset, height - 1 - y)
+  so that low values are at the bottom. The color of each count is computed once by @param tone and read back from a
+  lookup table.
+  */
+void toneMap(const uint *bins, int width, int height, const std::function<QRgb(uint)> &tone, QImage &target, int xOffset = 0);
+
+} // namespace ScopeKernels
+
+#endif // SCOPEKERNELS_H
@@ -64,8 +64,11 @@ mRgb2YPbPr =                        r =
  */
 
 #include "vectorscopegenerator.h"
+#include "scopekernels.h"
 #include <QImage>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 // The maximum distance from the center for any RGB color is 0.63, so
 // no need to make the circle bigger than required.
@@ -110,7 +113,7 @@ QPoint VectorscopeGenerator::mapToCircle(const QSize &targetSize, const QPointF
 
 QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain,
                                                   const VectorscopeGenerator::PaintMode &paintMode, const VectorscopeGenerator::ColorSpace &colorSpace, bool,
-                                                  uint accelFactor) const
+                                                  uint accelFactor)
 {
     if (vectorscopeSize.width() <= 0 || vectorscopeSize.height() <= 0 || image.width() <= 0 || image.height() <= 0) {
         // Invalid size
@@ -122,147 +125,183 @@ QImage VectorscopeGenerator::calculateVectorscope(const QSize &vectorscopeSize,
     QImage scope = QImage(cw, cw, QImage::Format_ARGB32);
     scope.fill(qRgba(0, 0, 0, 0));
 
-    const uchar *bits = image.bits();
-
-    double dy, dr, dg, db, dmax;
-    double /*y,*/ u, v;
-    QPoint pt;
-    QRgb px;
-
-    const int stepsize = int(uint(image.depth() / 8) * accelFactor);
+    const QImage frame = ScopeKernels::asRgb32(image);
+    const int iw = frame.width();
+    const int ih = frame.height();
 
     // Just an average for the number of image pixels per scope pixel.
-    // NOTE: byteCount() has to be replaced by (img.bytesPerLine()*img.height()) for Qt 4.5 to compile, see:
-    // https://doc.qt.io/qt-5/qimage.html#bytesPerLine
-    double avgPxPerPx = (double)image.depth() / 8 * (image.bytesPerLine() * image.height()) / scope.size().width() / scope.size().height() / accelFactor;
-
-    for (int i = 0; i < (image.bytesPerLine() * image.height()); i += stepsize) {
-        auto *col = (const QRgb *)(bits);
-
-        int r = qRed(*col);
-        int g = qGreen(*col);
-        int b = qBlue(*col);
+    const double avgPxPerPx = double(iw) * ih / scope.size().width() / scope.size().height() / accelFactor;
 
+    // U and V are linear in R, G and B: precompute the contribution of each channel value, already scaled to the circle
+    double ur[256], ug[256], ub[256], vr[256], vg[256], vb[256];
+    for (int c = 0; c < 256; ++c) {
         switch (colorSpace) {
         case VectorscopeGenerator::ColorSpace_YUV:
             //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double)-0.0005781 * r - 0.001135 * g + 0.001713 * b;
-            v = (double)0.002411 * r - 0.002019 * g - 0.0003921 * b;
+            ur[c] = -0.0005781 * c;
+            ug[c] = -0.001135 * c;
+            ub[c] = 0.001713 * c;
+            vr[c] = 0.002411 * c;
+            vg[c] = -0.002019 * c;
+            vb[c] = -0.0003921 * c;
             break;
         case VectorscopeGenerator::ColorSpace_YPbPr:
         default:
             //             y = (double)  0.001173 * r +0.002302 * g +0.0004471* b;
-            u = (double)-0.0006671 * r - 0.001299 * g + 0.0019608 * b;
-            v = (double)0.001961 * r - 0.001642 * g - 0.0003189 * b;
+            ur[c] = -0.0006671 * c;
+            ug[c] = -0.001299 * c;
+            ub[c] = 0.0019608 * c;
+            vr[c] = 0.001961 * c;
+            vg[c] = -0.001642 * c;
+            vb[c] = -0.0003189 * c;
             break;
         }
+    }
 
-        pt = mapToCircle(vectorscopeSize, QPointF(SCALING * gain * u, SCALING * gain * v));
-
-        if (pt.x() >= scope.width() || pt.x() < 0 || pt.y() >= scope.height() || pt.y() < 0) {
-            // Point lies outside (because of scaling), don't plot it
-
-        } else {
-
-            // Draw the pixel using the chosen draw mode.
-            switch (paintMode) {
-            case PaintMode_YUV:
-                // see yuvColorWheel
-                dy = 128; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
-                    break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
-                default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
-                    break;
-                }
+    // The color of a scope pixel depends either on the number of image pixels falling on it, or on the last of them.
+    const bool lastColor = paintMode == PaintMode_YUV || paintMode == PaintMode_Chroma || paintMode == PaintMode_Original;
+    const size_t scopeSize = size_t(cw) * size_t(cw);
+    // The color bins take as much memory as the counts. They are only read where the count is not 0, so they are not cleared
+    m_counts.reset(scopeSize, ScopeKernels::blockCount(qint64(iw) * ih / accelFactor, lastColor ? scopeSize * 2 : scopeSize));
+    if (lastColor && m_colors.size() < size_t(m_counts.blocks())) {
+        m_colors.resize(size_t(m_counts.blocks()));
+    }
 
-                if (dr < 0) {
-                    dr = 0;
-                }
-                if (dg < 0) {
-                    dg = 0;
-                }
-                if (db < 0) {
-                    db = 0;
-                }
-                if (dr > 255) {
-                    dr = 255;
-                }
-                if (dg > 255) {
-                    dg = 255;
+    ScopeKernels::forEachBlock(ih, m_counts.blocks(), [&](int block, int first, int last) {
+        uint *bins = m_counts.block(block);
+        QRgb *colorBins = nullptr;
+        if (lastColor) {
+            m_colors[(size_t)block].resize(scopeSize);
+            colorBins = m_colors[(size_t)block].data();
+        }
+        double dy, dr, dg, db, dmax;
+        for (int y = first; y < last; ++y) {
+            const auto *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+            // Every accelFactor-th pixel is sampled, counting from the start of the frame
+            const qint64 lineStart = qint64(y) * iw;
+            for (int x = int((accelFactor - lineStart % accelFactor) % accelFactor); x < iw; x += (int)accelFactor) {
+                const QRgb col = line[x];
+                const int r = qRed(col);
+                const int g = qGreen(col);
+                const int b = qBlue(col);
+                const double u = ur[r] + ug[g] + ub[b];
+                const double v = vr[r] + vg[g] + vb[b];
+                const QPoint pt = mapToCircle(vectorscopeSize, QPointF(SCALING * gain * u, SCALING * gain * v));
+                if (pt.x() >= cw || pt.x() < 0 || pt.y() >= cw || pt.y() < 0) {
+                    // Point lies outside (because of scaling), don't plot it
+                    continue;
                 }
-                if (db > 255) {
-                    db = 255;
+                const size_t ix = size_t(pt.y()) * size_t(cw) + size_t(pt.x());
+                bins[ix]++;
+                if (!lastColor) {
+                    continue;
                 }
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
-
-            case PaintMode_Chroma:
-                dy = 200; // Default Y value. Lower = darker.
-
-                // Calculate the RGB values from YUV/YPbPr
-                switch (colorSpace) {
-                case VectorscopeGenerator::ColorSpace_YUV:
-                    dr = dy + 290.8 * v;
-                    dg = dy - 100.6 * u - 148 * v;
-                    db = dy + 517.2 * u;
+                // Compute the pixel color using the chosen draw mode.
+                switch (paintMode) {
+                case PaintMode_YUV:
+                    // see yuvColorWheel
+                    dy = 128; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+                    colorBins[ix] = qRgba(qBound(0., dr, 255.), qBound(0., dg, 255.), qBound(0., db, 255.), 255);
+                    break;
+                case PaintMode_Chroma:
+                    dy = 200; // Default Y value. Lower = darker.
+
+                    // Calculate the RGB values from YUV/YPbPr
+                    switch (colorSpace) {
+                    case VectorscopeGenerator::ColorSpace_YUV:
+                        dr = dy + 290.8 * v;
+                        dg = dy - 100.6 * u - 148 * v;
+                        db = dy + 517.2 * u;
+                        break;
+                    case VectorscopeGenerator::ColorSpace_YPbPr:
+                    default:
+                        dr = dy + 357.5 * v;
+                        dg = dy - 87.75 * u - 182 * v;
+                        db = dy + 451.9 * u;
+                        break;
+                    }
+
+                    // Scale the RGB values back to max 255
+                    dmax = std::max(dr, std::max(dg, db));
+                    dmax = 255 / dmax;
+                    colorBins[ix] = qRgba(dr * dmax, dg * dmax, db * dmax, 255);
                     break;
-                case VectorscopeGenerator::ColorSpace_YPbPr:
                 default:
-                    dr = dy + 357.5 * v;
-                    dg = dy - 87.75 * u - 182 * v;
-                    db = dy + 451.9 * u;
+                    colorBins[ix] = col;
                     break;
                 }
-
-                // Scale the RGB values back to max 255
-                dmax = dr;
-                if (dg > dmax) {
-                    dmax = dg;
-                }
-                if (db > dmax) {
-                    dmax = db;
+            }
+        }
+    });
+
+    if (lastColor) {
+        // Later blocks cover later lines, their pixels are the last ones drawn
+        std::vector<QRgb> merged(scopeSize, qRgba(0, 0, 0, 0));
+        for (int block = 0; block < m_counts.blocks(); ++block) {
+            const uint *bins = m_counts.block(block);
+            const std::vector<QRgb> &colorBins = m_colors[(size_t)block];
+            for (size_t ix = 0; ix < scopeSize; ++ix) {
+                if (bins[ix] > 0) {
+                    merged[ix] = colorBins[ix];
                 }
-                dmax = 255 / dmax;
-
-                dr *= dmax;
-                dg *= dmax;
-                db *= dmax;
-
-                scope.setPixel(pt, qRgba(dr, dg, db, 255));
-                break;
-            case PaintMode_Original:
-                scope.setPixel(pt, *col);
-                break;
-            case PaintMode_Green:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(qRed(px) + (255 - qRed(px)) / (3 * avgPxPerPx), qGreen(px) + 20 * (255 - qGreen(px)) / (avgPxPerPx),
-                                         qBlue(px) + (255 - qBlue(px)) / (avgPxPerPx), qAlpha(px) + (255 - qAlpha(px)) / (avgPxPerPx)));
-                break;
-            case PaintMode_Green2:
-                px = scope.pixel(pt);
-                scope.setPixel(pt,
-                               qRgba(qRed(px) + ceil((255 - (float)qRed(px)) / (4 * avgPxPerPx)), 255,
-                                     qBlue(px) + ceil((255 - (float)qBlue(px)) / (avgPxPerPx)), qAlpha(px) + ceil((255 - (float)qAlpha(px)) / (avgPxPerPx))));
-                break;
-            case PaintMode_Black:
-                px = scope.pixel(pt);
-                scope.setPixel(pt, qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20));
-                break;
             }
         }
+        for (int y = 0; y < cw; ++y) {
+            memcpy(scope.scanLine(y), merged.data() + size_t(y) * size_t(cw), size_t(cw) * sizeof(QRgb));
+        }
+        return scope;
+    }
 
-        bits += stepsize;
+    // Each image pixel falling on a scope pixel brightens it a bit more: the result only depends on the count,
+    // so the colors are computed once for each count, by applying the same steps as many times.
+    const uint *bins = m_counts.merge();
+    const uint max = ScopeKernels::maxCount(bins, scopeSize);
+    std::vector<QRgb> lut(1, qRgba(0, 0, 0, 0));
+    lut.reserve(std::min(max, 1u << 16) + 1);
+    while (lut.size() <= max) {
+        const QRgb px = lut.back();
+        QRgb next;
+        switch (paintMode) {
+        case PaintMode_Green:
+            next = qRgba(qRed(px) + (255 - qRed(px)) / (3 * avgPxPerPx), qGreen(px) + 20 * (255 - qGreen(px)) / (avgPxPerPx),
+                         qBlue(px) + (255 - qBlue(px)) / (avgPxPerPx), qAlpha(px) + (255 - qAlpha(px)) / (avgPxPerPx));
+            break;
+        case PaintMode_Green2:
+            next = qRgba(qRed(px) + ceil((255 - (float)qRed(px)) / (4 * avgPxPerPx)), 255, qBlue(px) + ceil((255 - (float)qBlue(px)) / (avgPxPerPx)),
+                         qAlpha(px) + ceil((255 - (float)qAlpha(px)) / (avgPxPerPx)));
+            break;
+        case PaintMode_Black:
+        default:
+            next = qRgba(0, 0, 0, qAlpha(px) + (255 - qAlpha(px)) / 20);
+            break;
+        }
+        if (next == px && lut.size() > 1) {
+            // Reached a fixed point, higher counts keep the last color
+            break;
+        }
+        lut.push_back(next);
+    }
+    for (int y = 0; y < cw; ++y) {
+        const uint *row = bins + size_t(y) * size_t(cw);
+        auto *line = reinterpret_cast<QRgb *>(scope.scanLine(y));
+        for (int x = 0; x < cw; ++x) {
+            line[x] = lut[std::min(size_t(row[x]), lut.size() - 1)];
+        }
     }
     return scope;
 }
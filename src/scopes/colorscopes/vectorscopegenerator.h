@@ -11,8 +11,10 @@
 #ifndef VECTORSCOPEGENERATOR_H
 #define VECTORSCOPEGENERATOR_H
 
+#include "scopekernels.h"
 #include <QImage>
 #include <QObject>
+#include <vector>
 
 class QImage;
 class QPoint;
@@ -28,13 +30,18 @@ public:
     enum PaintMode { PaintMode_Green, PaintMode_Green2, PaintMode_Original, PaintMode_Chroma, PaintMode_YUV, PaintMode_Black };
 
     QImage calculateVectorscope(const QSize &vectorscopeSize, const QImage &image, const float &gain, const VectorscopeGenerator::PaintMode &paintMode,
-                                const VectorscopeGenerator::ColorSpace &colorSpace, bool, uint accelFactor = 1) const;
+                                const VectorscopeGenerator::ColorSpace &colorSpace, bool, uint accelFactor = 1);
 
     QPoint mapToCircle(const QSize &targetSize, const QPointF &point) const;
     static const float scaling;
 
 signals:
     void signalCalculationFinished(const QImage &image, uint ms);
+
+private:
+    /** @brief Partial histograms and the last color of each bin per block, kept between frames */
+    ScopeKernels::Histograms m_counts;
+    std::vector<std::vector<QRgb>> m_colors;
 };
 
 #endif // VECTORSCOPEGENERATOR_H
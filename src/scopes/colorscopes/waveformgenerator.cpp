@@ -9,16 +9,17 @@
  ***************************************************************************/
 
 #include "waveformgenerator.h"
+#include "scopekernels.h"
 
 #include <cmath>
 
 #include <QImage>
 #include <QPainter>
 #include <QSize>
-#include <QElapsedTimer>
 #include <vector>
 
-#define CHOP255(a) ((255) < (a) ? (255) : (a))
+// Clamp to [0, 255], faint bins have a negative logarithm
+#define CHOP255(a) int((255) < (a) ? (255) : ((a) < 0 ? 0 : (a)))
 
 WaveformGenerator::WaveformGenerator() = default;
 
@@ -43,85 +44,66 @@ QImage WaveformGenerator::calculateWaveform(const QSize &waveformSize, const QIm
 
     const uint ww = (uint)waveformSize.width();
     const uint wh = (uint)waveformSize.height();
-    const uint iw = (uint)image.bytesPerLine();
-    const uint ih = (uint)image.height();
-    const uint byteCount = iw * ih;
-
-    std::vector<std::vector<uint>> waveValues((size_t)waveformSize.width(), std::vector<uint>((size_t)waveformSize.height(), 0));
+    const QImage frame = ScopeKernels::asRgb32(image);
+    const int iw = frame.width();
+    const int ih = frame.height();
+    // Only every accelFactor-th line is sampled
+    const int sampledRows = (ih + (int)accelFactor - 1) / (int)accelFactor;
 
     // Number of input pixels that will fall on one scope pixel.
     // Must be a float because the acceleration factor can be high, leading to <1 expected px per px.
-    const float pixelDepth = (float)((byteCount >> 2) / accelFactor) / float(ww * wh);
+    const float pixelDepth = (float)(qint64(iw) * ih / accelFactor) / float(ww * wh);
     const float gain = 255. / (8. * pixelDepth);
     // qCDebug(KDENLIVE_LOG) << "Pixel depth: expected " << pixelDepth << "; Gain: using " << gain << " (acceleration: " << accelFactor << "x)";
 
+    // Scope row of each luma value and scope column of each image column.
     // Subtract 1 from sizes because we start counting from 0.
     // Not doing it would result in attempts to paint outside of the image.
-    const float hPrediv = (float)(wh - 1) / 255.;
-    const float wPrediv = (float)(ww - 1) / float(iw - 1);
-
-    const uchar *bits = image.bits();
-    const int bpp = image.depth() / 8;
-
-    for (uint i = 0, x = 0; i < byteCount; i += (uint)bpp) {
-
-        Q_ASSERT(bits < image.bits() + byteCount);
-
-        double dY, dx, dy;
-        auto *col = (const QRgb *)bits;
+    uint lumaRow[256];
+    for (int l = 0; l < 256; ++l) {
+        lumaRow[l] = uint(float(l) * float(wh - 1) / 255.f) * ww;
+    }
+    std::vector<uint> columns((size_t)iw);
+    for (int x = 0; x < iw; ++x) {
+        columns[(size_t)x] = iw > 1 ? uint(float(x) * float(ww - 1) / float(iw - 1)) : 0;
+    }
 
-        if (rec == WaveformGenerator::Rec_601) {
-            // CIE 601 Luminance
-            dY = .299 * qRed(*col) + .587 * qGreen(*col) + .114 * qBlue(*col);
-        } else {
-            // CIE 709 Luminance
-            dY = .2125 * qRed(*col) + .7154 * qGreen(*col) + .0721 * qBlue(*col);
-        }
-        // dY is on [0,255] now.
-
-        dy = dY * hPrediv;
-        dx = (float)x * wPrediv;
-        waveValues[(size_t)dx][(size_t)dy]++;
-
-        bits += bpp;
-        x += (uint)bpp;
-        if (x > iw) {
-            x -= iw;
-            if (accelFactor > 1) {
-                bits += bpp * (int)iw * ((int)accelFactor - 1);
-                i += (uint)bpp * iw * (accelFactor - 1);
+    // Bins are stored line by line (luma major), as they will be written to the scope
+    const size_t binCount = size_t(ww) * wh;
+    m_waveValues.reset(binCount, ScopeKernels::blockCount(qint64(sampledRows) * iw, binCount));
+    const bool rec709 = rec == WaveformGenerator::Rec_709;
+    ScopeKernels::forEachBlock(sampledRows, m_waveValues.blocks(), [&](int block, int first, int last) {
+        uint *bins = m_waveValues.block(block);
+        std::vector<uchar> luma((size_t)iw);
+        for (int row = first; row < last; ++row) {
+            ScopeKernels::luma(reinterpret_cast<const QRgb *>(frame.constScanLine(row * (int)accelFactor)), iw, rec709, luma.data());
+            for (int x = 0; x < iw; ++x) {
+                bins[lumaRow[luma[(size_t)x]] + columns[(size_t)x]]++;
             }
         }
-    }
+    });
+    const uint *bins = m_waveValues.merge();
 
+    std::function<QRgb(uint)> tone;
     switch (paintMode) {
     case PaintMode_Green:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                // Logarithmic scale. Needs fine tuning by hand, but looks great.
-                wave.setPixel(i, waveformSize.height() - j - 1,
-                              qRgba(CHOP255(52 * log(0.1 * gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(52 * std::log(gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(52 * log(.25 * gain * (float)waveValues[(size_t)i][(size_t)j])),
-                                    CHOP255(64 * std::log(gain * (float)waveValues[(size_t)i][(size_t)j]))));
+        // Logarithmic scale. Needs fine tuning by hand, but looks great.
+        tone = [gain](uint count) {
+            if (count == 0) {
+                return qRgba(0, 0, 0, 0);
             }
-        }
+            const float l = std::log(gain * (float)count);
+            return qRgba(CHOP255(52 * (std::log(0.1f) + l)), CHOP255(52 * l), CHOP255(52 * (std::log(.25f) + l)), CHOP255(64 * l));
+        };
         break;
     case PaintMode_Yellow:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 242, 0, CHOP255(gain * (float)waveValues[(size_t)i][(size_t)j])));
-            }
-        }
+        tone = [gain](uint count) { return qRgba(255, 242, 0, CHOP255(gain * (float)count)); };
         break;
     default:
-        for (int i = 0; i < waveformSize.width(); ++i) {
-            for (int j = 0; j < waveformSize.height(); ++j) {
-                wave.setPixel(i, waveformSize.height() - j - 1, qRgba(255, 255, 255, CHOP255(2. * gain * (float)waveValues[(size_t)i][(size_t)j])));
-            }
-        }
+        tone = [gain](uint count) { return qRgba(255, 255, 255, CHOP255(2. * gain * (float)count)); };
         break;
     }
+    ScopeKernels::toneMap(bins, (int)ww, (int)wh, tone, wave);
 
     if (drawAxis) {
         QPainter davinci(&wave);
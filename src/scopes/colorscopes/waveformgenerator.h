@@ -11,6 +11,7 @@
 #ifndef WAVEFORMGENERATOR_H
 #define WAVEFORMGENERATOR_H
 
+#include "scopekernels.h"
 #include <QObject>
 class QImage;
 class QSize;
@@ -28,6 +29,10 @@ public:
 
     QImage calculateWaveform(const QSize &waveformSize, const QImage &image, WaveformGenerator::PaintMode paintMode, bool drawAxis,
                              const WaveformGenerator::Rec rec, uint accelFactor = 1);
+
+private:
+    /** @brief Partial histograms, kept between frames */
+    ScopeKernels::Histograms m_waveValues;
 };
 
 #endif // WAVEFORMGENERATOR_H
@@ -29,6 +29,7 @@
 #include "bin/projectitemmodel.h"
 #include "core.h"
 #include "kdenlivesettings.h"
+#include "project/loadtimings.h"
 
 #include <KLocalizedString>
 #include <KMessageBox>
@@ -49,7 +50,7 @@ bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline,
 bool constructTrackFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, int tid, Mlt::Playlist &track,
                             const std::unordered_map<QString, QString> &binIdCorresp, Fun &undo, Fun &redo, bool audioTrack, QProgressDialog *progressDialog = nullptr);
 
-bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, Mlt::Tractor tractor, QProgressDialog *progressDialog)
+bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, Mlt::Tractor tractor, QProgressDialog *progressDialog, LoadTimings *timings)
 {
     Fun undo = []() { return true; };
     Fun redo = []() { return true; };
@@ -58,6 +59,9 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
     m_errorMessage.clear();
     std::unordered_map<QString, QString> binIdCorresp;
     pCore->projectItemModel()->loadBinPlaylist(&tractor, timeline->tractor(), binIdCorresp, progressDialog);
+    if (timings) {
+        timings->mark(QStringLiteral("clip probing"));
+    }
 
     QSet<QString> reserved_names{QLatin1String("playlistmain"), QLatin1String("timeline_preview"), QLatin1String("timeline_overlay"),
                                  QLatin1String("black_track")};
@@ -190,6 +194,9 @@ bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timelin
     for (int tid : lockedTracksIndexes) {
         timeline->setTrackLockedState(tid, true);
     }
+    if (timings) {
+        timings->mark(QStringLiteral("timeline build"));
+    }
 
     if (!ok) {
         // TODO log error
@@ -24,12 +24,15 @@
 #include <memory>
 #include <mlt++/MltTractor.h>
 
+class LoadTimings;
 class TimelineItemModel;
 class QProgressDialog;
 
 /** @brief This function can be used to construct a TimelineModel object from a Mlt object hierarchy
+    @param timings if not null, the time spent loading the bin clips and building the timeline is recorded there
  */
 
-bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, Mlt::Tractor mlt_timeline, QProgressDialog *progressDialog = nullptr);
+bool constructTimelineFromMelt(const std::shared_ptr<TimelineItemModel> &timeline, Mlt::Tractor mlt_timeline, QProgressDialog *progressDialog = nullptr,
+                               LoadTimings *timings = nullptr);
 
 #endif
@@ -20,6 +20,7 @@
  ***************************************************************************/
 #include "snapmodel.hpp"
 #include <QDebug>
+#include <algorithm>
 #include <climits>
 #include <cstdlib>
 
@@ -68,6 +69,86 @@ int SnapModel::getClosestPoint(int position)
     return (int)next;
 }
 
+int SnapModel::getClosestPoint(int position, int maxDistance, const std::vector<int> &exclude, int extraPoint) const
+{
+    if (maxDistance < 0) {
+        return -1;
+    }
+    return closestAround(m_snaps.lower_bound(position), position, maxDistance, exclude, extraPoint);
+}
+
+std::pair<int, int> SnapModel::getBestSnap(const std::vector<int> &points, int offset, int maxDistance, int extraPoint) const
+{
+    std::pair<int, int> best(-1, -1);
+    if (maxDistance < 0 || points.empty()) {
+        return best;
+    }
+    int lowestDiff = maxDistance + 1;
+    auto it = m_snaps.lower_bound(points.front() + offset);
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (i > 0 && points[i] == points[i - 1]) {
+            continue;
+        }
+        const int target = points[i] + offset;
+        // The targets are increasing, so the first snap point after the target is found by moving forward from the previous one
+        while (it != m_snaps.end() && it->first < target) {
+            ++it;
+        }
+        // Only look for points closer than the best one found so far
+        int snapped = closestAround(it, target, lowestDiff - 1, points, extraPoint);
+        if (snapped != -1) {
+            lowestDiff = qAbs(target - snapped);
+            best = {points[i], snapped};
+            if (lowestDiff < 2) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+int SnapModel::closestAround(std::map<int, int>::const_iterator next, int position, int maxDistance, const std::vector<int> &exclude, int extraPoint) const
+{
+    if (maxDistance < 0) {
+        return -1;
+    }
+    long long int closest = -1;
+    long long int closestDist = LLONG_MAX;
+    auto consider = [&](long long int point) {
+        long long int dist = std::llabs((long long)position - point);
+        if (dist <= maxDistance && (dist < closestDist || (dist == closestDist && point > closest))) {
+            closest = point;
+            closestDist = dist;
+        }
+    };
+    // A position is usable if some of its elements are not excluded
+    auto isExcluded = [&exclude](const std::pair<const int, int> &snap) {
+        auto range = std::equal_range(exclude.begin(), exclude.end(), snap.first);
+        return std::distance(range.first, range.second) >= snap.second;
+    };
+    // Only the points within maxDistance are visited, so a long run of excluded points does not slow down the query
+    for (auto it = next; it != m_snaps.end() && (long long)it->first - position <= maxDistance; ++it) {
+        if (!isExcluded(*it)) {
+            consider(it->first);
+            break;
+        }
+    }
+    for (auto it = next; it != m_snaps.begin();) {
+        --it;
+        if ((long long)position - it->first > maxDistance) {
+            break;
+        }
+        if (!isExcluded(*it)) {
+            consider(it->first);
+            break;
+        }
+    }
+    if (extraPoint >= 0) {
+        consider(extraPoint);
+    }
+    return (int)closest;
+}
+
 int SnapModel::getNextPoint(int position)
 {
     if (m_snaps.empty()) {
@@ -111,44 +192,27 @@ void SnapModel::unIgnore()
     m_ignore.clear();
 }
 
-int SnapModel::proposeSize(int in, int out, int size, bool right, int maxSnapDist)
+int SnapModel::proposeSize(int in, int out, int size, bool right, int maxSnapDist, int extraPoint) const
 {
-    ignore({in, out});
-    int proposed_size = -1;
-    if (right) {
-        int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
-            proposed_size = snapped_pos - in;
-        }
-    } else {
-        int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
-            proposed_size = out - snapped_pos;
-        }
-    }
-    unIgnore();
-    return proposed_size;
+    return proposeSize(in, out, {in, out}, size, right, maxSnapDist, extraPoint);
 }
 
-int SnapModel::proposeSize(int in, int out, const std::vector<int> boundaries, int size, bool right, int maxSnapDist)
+int SnapModel::proposeSize(int in, int out, std::vector<int> boundaries, int size, bool right, int maxSnapDist, int extraPoint) const
 {
-    ignore(boundaries);
+    std::sort(boundaries.begin(), boundaries.end());
     int proposed_size = -1;
     if (right) {
         int target_pos = in + size - 1;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist, boundaries, extraPoint);
+        if (snapped_pos != -1) {
             proposed_size = snapped_pos - in;
         }
     } else {
         int target_pos = out + 1 - size;
-        int snapped_pos = getClosestPoint(target_pos);
-        if (snapped_pos != -1 && qAbs(target_pos - snapped_pos) <= maxSnapDist) {
+        int snapped_pos = getClosestPoint(target_pos, maxSnapDist, boundaries, extraPoint);
+        if (snapped_pos != -1) {
             proposed_size = out - snapped_pos;
         }
     }
-    unIgnore();
     return proposed_size;
 }
@@ -61,6 +61,24 @@ public:
     /* @brief Retrieves closest point. Returns -1 if there is no snappoint available */
     int getClosestPoint(int position);
 
+    /* @brief Retrieves the closest point at most maxDistance frames away, without modifying the snap points.
+       Returns -1 if there is no such point. On equal distances, the point after position is preferred, like getClosestPoint.
+       @param exclude sorted list of points to ignore, for example the in/outs of the items being moved. A position listed n times hides n of its snappoints
+       @param extraPoint an additional point to consider, for example the timeline cursor, or -1
+     */
+    int getClosestPoint(int position, int maxDistance, const std::vector<int> &exclude, int extraPoint = -1) const;
+
+    /* @brief Retrieves the best snap point for a group of points moved by offset, without modifying the snap points.
+       The moved points are visited in increasing order in a single pass over the snap points. The first one getting the closest snap point is kept,
+       and the search stops as soon as a snap point less than 2 frames away is found.
+       @param points sorted list of the points being moved, they are excluded from the snap points
+       @param offset the move applied to the points
+       @param maxDistance maximal distance between a moved point and its snap point
+       @param extraPoint an additional point to consider, for example the timeline cursor, or -1
+       @returns the pair (moved point, snap point), or (-1, -1) if no snap point is close enough
+     */
+    std::pair<int, int> getBestSnap(const std::vector<int> &points, int offset, int maxDistance, int extraPoint = -1) const;
+
     /* @brief Retrieves next snap point. Returns position if there is no snappoint available */
     int getNextPoint(int position);
 
@@ -70,6 +88,7 @@ public:
     /* @brief Ignores the given positions until unIgnore() is called
        You can make several call to this before unIgnoring
        Note that you cannot remove ignored points.
+       Prefer the getClosestPoint overload taking an exclusion list for queries, it does not modify the snap points.
        @param points list of point to ignore
      */
     void ignore(const std::vector<int> &pts);
@@ -84,14 +103,18 @@ public:
        @param size is the size requested before snapping
        @param right true if we resize the right end of the item
        @param maxSnapDist maximal number of frames we are allowed to snap to
+       @param extraPoint an additional snap point, for example the timeline cursor, or -1
     */
-    int proposeSize(int in, int out, int size, bool right, int maxSnapDist);
-    int proposeSize(int in, int out, const std::vector<int> boundaries, int size, bool right, int maxSnapDist);
+    int proposeSize(int in, int out, int size, bool right, int maxSnapDist, int extraPoint = -1) const;
+    int proposeSize(int in, int out, std::vector<int> boundaries, int size, bool right, int maxSnapDist, int extraPoint = -1) const;
 
     // For testing only
     std::map<int, int> _snaps() { return m_snaps; }
 
 private:
+    /* @brief Closest point to position at most maxDistance away, next being the first snap point not before position */
+    int closestAround(std::map<int, int>::const_iterator next, int position, int maxDistance, const std::vector<int> &exclude, int extraPoint) const;
+
     std::map<int, int> m_snaps; // This represents the snappoints internally. The keys are the positions and the values are the number of elements at this
                                 // position. Note that it is important that the datastructure is ordered. QMap is NOT ordered, and therefore not suitable.
 
@@ -571,6 +571,35 @@ const QString TimelineItemModel::getTrackFullName(int tid) const
     return trackName.isEmpty() ? tag : tag + QStringLiteral(" - ") + trackName;
 }
 
+std::unordered_set<int> TimelineItemModel::getViewItemsInRange(int start, int end)
+{
+    READ_LOCK();
+    std::unordered_set<int> items;
+    for (const auto &track : m_allTracks) {
+        std::unordered_set<int> clips = track->getClipsInRange(start, end);
+        items.insert(clips.begin(), clips.end());
+        std::unordered_set<int> compositions = track->getCompositionsInRange(start, end);
+        items.insert(compositions.begin(), compositions.end());
+    }
+    return items;
+}
+
+bool TimelineItemModel::isItemInRange(int itemId, int start, int end) const
+{
+    READ_LOCK();
+    auto intersects = [start, end](int position, int duration) { return position < end && position + duration > start; };
+    if (isClip(itemId)) {
+        const auto &clip = m_allClips.at(itemId);
+        const int duration = clip->getPlaytime();
+        return intersects(clip->getPosition(), duration) || (clip->getFakeTrackId() > -1 && intersects(clip->getFakePosition(), duration));
+    }
+    if (isComposition(itemId)) {
+        const auto &compo = m_allCompositions.at(itemId);
+        return intersects(compo->getPosition(), compo->getPlaytime());
+    }
+    return false;
+}
+
 const QString TimelineItemModel::groupsData()
 {
     return m_groups->toJson();
@@ -94,6 +94,10 @@ public:
     int getFirstVideoTrackIndex() const;
     int getFirstAudioTrackIndex() const;
     const QString getTrackFullName(int tid) const;
+    /** @brief Returns the ids of the clips and compositions of all tracks, locked or not, intersecting [start, end[ */
+    std::unordered_set<int> getViewItemsInRange(int start, int end);
+    /** @brief Returns true if the clip or composition @param itemId intersects [start, end[, at its position or at the one it is being dragged to */
+    bool isItemInRange(int itemId, int start, int end) const;
     void notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, bool start, bool duration, bool updateThumb) override;
     void notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, const QVector<int> &roles) override;
     void notifyChange(const QModelIndex &topleft, const QModelIndex &bottomright, int role) override;
@@ -1940,10 +1940,7 @@ int TimelineModel::requestItemResizeInfo(int itemId, int in, int out, int size,
                 size = out - getTrackById_const(trackId)->getBlankStart(in - 1);
             }
         }
-        int timelinePos = pCore->getTimelinePosition();
-        m_snaps->addPoint(timelinePos);
-        int proposed_size = m_snaps->proposeSize(in, out, getBoundaries(itemId), size, right, snapDistance);
-        m_snaps->removePoint(timelinePos);
+        int proposed_size = m_snaps->proposeSize(in, out, getBoundaries(itemId), size, right, snapDistance, pCore->getTimelinePosition());
         if (proposed_size > 0) {
             // only test move if proposed_size is valid
             bool success = false;
@@ -1987,10 +1984,7 @@ int TimelineModel::requestItemSpeedChange(int itemId, int size, bool right, int
             size = out - getTrackById_const(trackId)->getBlankStart(in - 1);
         }
     }
-    int timelinePos = pCore->getTimelinePosition();
-    m_snaps->addPoint(timelinePos);
-    int proposed_size = m_snaps->proposeSize(in, out, getBoundaries(itemId), size, right, snapDistance);
-    m_snaps->removePoint(timelinePos);
+    int proposed_size = m_snaps->proposeSize(in, out, getBoundaries(itemId), size, right, snapDistance, pCore->getTimelinePosition());
     qDebug()<<"==== RESIZE REQUEST: "<<size<<"*, RESULKT: "<<proposed_size;
     return proposed_size > 0 ? proposed_size : size;
 }
@@ -2732,31 +2726,16 @@ int TimelineModel::suggestSnapPoint(int pos, int snapDistance)
 
 int TimelineModel::getBestSnapPos(int referencePos, int diff, std::vector<int> pts, int cursorPosition, int snapDistance)
 {
-    if (!pts.empty()) {
-        m_snaps->ignore(pts);
-    } else {
+    if (pts.empty()) {
         return -1;
     }
-    // Sort and remove duplicates
+    // The points of the moved items are excluded from the query instead of being removed from the snap model, since this runs on each mouse move
     std::sort(pts.begin(), pts.end());
-    pts.erase( std::unique(pts.begin(), pts.end()), pts.end());
-    m_snaps->addPoint(cursorPosition);
-    int closest = -1;
-    int lowestDiff = snapDistance + 1;
-    for (int point : pts) {
-        int snapped = m_snaps->getClosestPoint(point + diff);
-        int currentDiff = qAbs(point + diff - snapped);
-        if (currentDiff < lowestDiff) {
-            lowestDiff = currentDiff;
-            closest = snapped - (point - referencePos);
-            if (lowestDiff < 2) {
-                break;
-            }
-        }
+    const std::pair<int, int> snap = m_snaps->getBestSnap(pts, diff, snapDistance, cursorPosition);
+    if (snap.second == -1) {
+        return -1;
     }
-    m_snaps->unIgnore();
-    m_snaps->removePoint(cursorPosition);
-    return closest;
+    return snap.second - (snap.first - referencePos);
 }
 
 int TimelineModel::getNextSnapPos(int pos, std::vector<size_t> &snaps)
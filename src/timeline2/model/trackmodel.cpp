@@ -29,8 +29,55 @@
 #include "timelinemodel.hpp"
 #include <QDebug>
 #include <QModelIndex>
+#include <algorithm>
 #include <mlt++/MltTransition.h>
 
+namespace {
+// Clips and compositions rows follow the order of their ids, we keep a sorted copy of the ids to map rows without walking the maps
+void insertRowId(std::vector<int> &rows, int id)
+{
+    auto it = std::lower_bound(rows.begin(), rows.end(), id);
+    if (it == rows.end() || *it != id) {
+        rows.insert(it, id);
+    }
+}
+
+void removeRowId(std::vector<int> &rows, int id)
+{
+    auto it = std::lower_bound(rows.begin(), rows.end(), id);
+    if (it != rows.end() && *it == id) {
+        rows.erase(it);
+    }
+}
+
+int rowFromId(const std::vector<int> &rows, int id)
+{
+    return (int)std::distance(rows.begin(), std::lower_bound(rows.begin(), rows.end(), id));
+}
+
+/* Returns the ids of the items intersecting [position, end[, given their position index (position -> id).
+   Items of a track don't overlap, so only the one starting just before position can intersect the range without starting in it */
+template <typename T>
+std::unordered_set<int> itemsInRange(const std::map<int, int> &positions, const std::map<int, std::shared_ptr<T>> &items, int position, int end)
+{
+    std::unordered_set<int> ids;
+    auto it = positions.lower_bound(position);
+    if (it != positions.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + items.at(prev->second)->getPlaytime() - 1 >= position) {
+            it = prev;
+        }
+    }
+    for (; it != positions.end(); ++it) {
+        if (end > -1 && it->first >= end) {
+            break;
+        }
+        ids.insert(it->second);
+    }
+    return ids;
+}
+} // namespace
+
 TrackModel::TrackModel(const std::weak_ptr<TimelineModel> &parent, int id, const QString &trackName, bool audioTrack)
     : m_parent(parent)
     , m_id(id == -1 ? TimelineModel::getNextId() : id)
@@ -143,8 +190,10 @@ Fun TrackModel::requestClipInsertion_lambda(int clipId, int position, bool updat
         if (auto ptr = m_parent.lock()) {
             std::shared_ptr<ClipModel> clip = ptr->getClipPtr(clipId);
             m_allClips[clip->getId()] = clip; // store clip
+            insertRowId(m_clipRows, clipId);
             // update clip position and track
             clip->setPosition(position);
+            m_clipPos[position] = clipId;
             clip->setSubPlaylistIndex(subPlaylist);
             int new_in = clip->getPosition();
             int new_out = new_in + clip->getPlaytime();
@@ -325,7 +374,9 @@ Fun TrackModel::requestClipDeletion_lambda(int clipId, bool updateView, bool fin
             m_playlists[target_track].consolidate_blanks();
             m_allClips[clipId]->setCurrentTrackId(-1);
             m_allClips[clipId]->setSubPlaylistIndex(-1);
+            m_clipPos.erase(m_allClips[clipId]->getPosition());
             m_allClips.erase(clipId);
+            removeRowId(m_clipRows, clipId);
             delete prod;
             m_playlists[target_track].unlock();
             if (auto ptr = m_parent.lock()) {
@@ -565,7 +616,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
             // The second is parameter is delta - 1 because this function expects an out time, which is basically size - 1
             m_playlists[target_track].insert_blank(blank_index, delta - 1);
             if (!right) {
+                m_clipPos.erase(clip_position);
                 m_allClips[clipId]->setPosition(clip_position + delta);
+                m_clipPos[clip_position + delta] = clipId;
                 // Because we inserted blank before, the index of our clip has increased
                 target_clip_mutable++;
             }
@@ -648,7 +701,9 @@ Fun TrackModel::requestClipResize_lambda(int clipId, int in, int out, bool right
                     err = m_playlists[target_track].resize_clip(target_clip_mutable, in, out);
                 }
                 if (!right && err == 0) {
+                    m_clipPos.erase(m_allClips[clipId]->getPosition());
                     m_allClips[clipId]->setPosition(m_playlists[target_track].clip_start(target_clip_mutable));
+                    m_clipPos[m_allClips[clipId]->getPosition()] = clipId;
                 }
                 if (err == 0) {
                     update_snaps(m_allClips[clipId]->getPosition(), m_allClips[clipId]->getPosition() + out - in + 1);
@@ -700,77 +755,59 @@ QSharedPointer<Mlt::Producer> TrackModel::getClipProducer(int clipId)
 int TrackModel::getCompositionByPosition(int position)
 {
     READ_LOCK();
-    for (const auto &comp : m_compoPos) {
-        if (comp.first == position) {
-            return comp.second;
-        } else if (comp.first < position) {
-            if (comp.first + m_allCompositions[comp.second]->getPlaytime() >= position) {
-                return comp.second;
-            }
+    // Compositions never overlap on a track, so only the last one starting before position and its predecessor can match
+    auto it = m_compoPos.upper_bound(position);
+    if (it == m_compoPos.begin()) {
+        return -1;
+    }
+    --it;
+    if (it != m_compoPos.begin()) {
+        // A composition ending exactly at position takes precedence over the one starting there
+        auto prev = std::prev(it);
+        if (prev->first + m_allCompositions[prev->second]->getPlaytime() >= position) {
+            return prev->second;
         }
     }
+    if (it->first == position || it->first + m_allCompositions[it->second]->getPlaytime() >= position) {
+        return it->second;
+    }
     return -1;
 }
 
 int TrackModel::getClipByRow(int row) const
 {
     READ_LOCK();
-    if (row >= static_cast<int>(m_allClips.size())) {
+    if (row < 0 || row >= static_cast<int>(m_clipRows.size())) {
         return -1;
     }
-    auto it = m_allClips.cbegin();
-    std::advance(it, row);
-    return (*it).first;
+    return m_clipRows[(size_t)row];
 }
 
 std::unordered_set<int> TrackModel::getClipsInRange(int position, int end)
 {
     READ_LOCK();
-    std::unordered_set<int> ids;
-    for (const auto &clp : m_allClips) {
-        int pos = clp.second->getPosition();
-        int length = clp.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
-            ids.insert(clp.first);
-        }
-    }
-    return ids;
+    return itemsInRange(m_clipPos, m_allClips, position, end);
 }
 
 int TrackModel::getRowfromClip(int clipId) const
 {
     READ_LOCK();
     Q_ASSERT(m_allClips.count(clipId) > 0);
-    return (int)std::distance(m_allClips.begin(), m_allClips.find(clipId));
+    return rowFromId(m_clipRows, clipId);
 }
 
 std::unordered_set<int> TrackModel::getCompositionsInRange(int position, int end)
 {
     READ_LOCK();
     // TODO: this function doesn't take into accounts the fact that there are two tracks
-    std::unordered_set<int> ids;
-    for (const auto &compo : m_allCompositions) {
-        int pos = compo.second->getPosition();
-        int length = compo.second->getPlaytime();
-        if (end > -1 && pos >= end) {
-            continue;
-        }
-        if (pos >= position || pos + length - 1 >= position) {
-            
-            ids.insert(compo.first);
-        }
-    }
-    return ids;
+    return itemsInRange(m_compoPos, m_allCompositions, position, end);
 }
 
 int TrackModel::getRowfromComposition(int tid) const
 {
     READ_LOCK();
     Q_ASSERT(m_allCompositions.count(tid) > 0);
-    return (int)m_allClips.size() + (int)std::distance(m_allCompositions.begin(), m_allCompositions.find(tid));
+    return (int)m_clipRows.size() + rowFromId(m_compoRows, tid);
 }
 
 QVariant TrackModel::getProperty(const QString &name) const
@@ -916,6 +953,23 @@ bool TrackModel::checkConsistency()
         return false;
     }
 
+    // We now check the position and row indexes of the clips
+    if (m_allClips.size() != m_clipPos.size() || m_allClips.size() != m_clipRows.size()) {
+        qDebug() << "Error: the number of clips position doesn't match number of clips";
+        return false;
+    }
+    for (const auto &clp : m_allClips) {
+        int pos = clp.second->getPosition();
+        if (m_clipPos.count(pos) == 0 || m_clipPos.at(pos) != clp.first) {
+            qDebug() << "Error: the position of clip " << clp.first << " is not properly stored";
+            return false;
+        }
+        if (m_clipRows[(size_t)rowFromId(m_clipRows, clp.first)] != clp.first) {
+            qDebug() << "Error: the row of clip " << clp.first << " is not properly stored";
+            return false;
+        }
+    }
+
     // We now check compositions positions
     if (m_allCompositions.size() != m_compoPos.size()) {
         qDebug() << "Error: the number of compositions position doesn't match number of compositions";
@@ -1148,6 +1202,7 @@ Fun TrackModel::requestCompositionDeletion_lambda(int compoId, bool updateView,
         }
         m_allCompositions[compoId]->setCurrentTrackId(-1);
         m_allCompositions.erase(compoId);
+        removeRowId(m_compoRows, compoId);
         m_compoPos.erase(old_in);
         ptr->m_snaps->removePoint(old_in);
         ptr->m_snaps->removePoint(old_out);
@@ -1165,9 +1220,7 @@ int TrackModel::getCompositionByRow(int row) const
         return -1;
     }
     Q_ASSERT(row <= (int)m_allClips.size() + (int)m_allCompositions.size());
-    auto it = m_allCompositions.cbegin();
-    std::advance(it, row - (int)m_allClips.size());
-    return (*it).first;
+    return m_compoRows[(size_t)(row - (int)m_clipRows.size())];
 }
 
 int TrackModel::getCompositionsCount() const
@@ -1191,6 +1244,7 @@ Fun TrackModel::requestCompositionInsertion_lambda(int compoId, int position, bo
             if (auto ptr = m_parent.lock()) {
                 std::shared_ptr<CompositionModel> composition = ptr->getCompositionPtr(compoId);
                 m_allCompositions[composition->getId()] = composition; // store clip
+                insertRowId(m_compoRows, compoId);
                 // update clip position and track
                 composition->setCurrentTrackId(getId());
                 int new_in = position;
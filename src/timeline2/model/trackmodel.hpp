@@ -31,6 +31,7 @@
 #include <mlt++/MltTractor.h>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 class TimelineModel;
 class ClipModel;
@@ -290,6 +291,9 @@ private:
 
     std::map<int, int> m_compoPos; // We store the positions of the compositions. In Melt, the compositions are not inserted at the track level, but we keep
                                    // those positions here to check for moves and resize
+    std::map<int, int> m_clipPos; // Position index of the clips (start -> id), used to answer range queries without scanning all clips
+    std::vector<int> m_clipRows;  // Sorted ids of the clips, index is the clip row
+    std::vector<int> m_compoRows; // Sorted ids of the compositions, index is the composition row minus the clips count
 
     mutable QReadWriteLock m_lock; // This is a lock that ensures safety in case of concurrent access
 
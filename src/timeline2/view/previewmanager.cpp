@@ -29,6 +29,7 @@
 #include <KLocalizedString>
 #include <QProcess>
 #include <QStandardPaths>
+#include <QThread>
 #include <QCollator>
 
 PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tractor)
@@ -43,7 +44,6 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
 {
     m_previewGatherTimer.setSingleShot(true);
     m_previewGatherTimer.setInterval(200);
-    QObject::connect(&m_previewProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &PreviewManager::processEnded);
 
 
     // Find path for Kdenlive renderer
@@ -58,8 +58,11 @@ PreviewManager::PreviewManager(TimelineController *controller, Mlt::Tractor *tra
             m_renderer = QStringLiteral("kdenlive_render");
         }
     }
-    connect(this, &PreviewManager::abortPreview, &m_previewProcess, &QProcess::kill, Qt::DirectConnection);
-    connect(&m_previewProcess, &QProcess::readyReadStandardError, this, &PreviewManager::receivedStderr);
+    connect(this, &PreviewManager::abortPreview, this, [this]() {
+        for (auto &process : m_previewProcesses) {
+            process->kill();
+        }
+    }, Qt::DirectConnection);
 }
 
 PreviewManager::~PreviewManager()
@@ -468,12 +471,12 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
     if (add) {
         qDebug() << "CHUNKS CHANGED: " << m_dirtyChunks;
         m_controller->dirtyChunksChanged();
-        if (m_previewProcess.state() == QProcess::NotRunning && KdenliveSettings::autopreview()) {
+        if (!isRendering() && KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     } else {
         // Remove processed chunks
-        bool isRendering = m_previewProcess.state() != QProcess::NotRunning;
+        bool rendering = isRendering();
         m_previewGatherTimer.stop();
         abortRendering();
         m_tractor->lock();
@@ -495,23 +498,44 @@ void PreviewManager::addPreviewRange(const QPoint zone, bool add)
         m_controller->renderedChunksChanged();
         m_controller->dirtyChunksChanged();
         m_tractor->unlock();
-        if (isRendering || KdenliveSettings::autopreview()) {
+        if (rendering || KdenliveSettings::autopreview()) {
             m_previewTimer.start();
         }
     }
 }
 
+bool PreviewManager::isRendering() const
+{
+    for (const auto &process : m_previewProcesses) {
+        if (process->state() != QProcess::NotRunning) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int PreviewManager::previewWorkers() const
+{
+    if (KdenliveSettings::previewworkers() > 0) {
+        return KdenliveSettings::previewworkers();
+    }
+    // Encoders are multithreaded too, so keep some cores for them
+    return qBound(1, QThread::idealThreadCount() / 4, 8);
+}
+
 void PreviewManager::abortRendering()
 {
-    if (m_previewProcess.state() == QProcess::NotRunning) {
+    if (!isRendering()) {
         return;
     }
     qDebug() << "/// ABORTING RENDEIGN 1\nRRRRRRRRRR";
     emit abortPreview();
-    m_previewProcess.waitForFinished();
-    if (m_previewProcess.state() != QProcess::NotRunning) {
-        m_previewProcess.kill();
-        m_previewProcess.waitForFinished();
+    for (auto &process : m_previewProcesses) {
+        process->waitForFinished();
+        if (process->state() != QProcess::NotRunning) {
+            process->kill();
+            process->waitForFinished();
+        }
     }
     // Re-init time estimation
     emit previewRender(-1, QString(), 1000);
@@ -537,17 +561,19 @@ void PreviewManager::startPreviewRender()
     }
 }
 
-void PreviewManager::receivedStderr()
+void PreviewManager::receivedStderr(QProcess *process)
 {
-    QStringList resultList = QString::fromLocal8Bit(m_previewProcess.readAllStandardError()).split(QLatin1Char('\n'));
+    QStringList resultList = QString::fromLocal8Bit(process->readAllStandardError()).split(QLatin1Char('\n'));
     for (auto &result : resultList) {
         qDebug() << "GOT PROCESS RESULT: " << result;
         if (result.startsWith(QLatin1String("START:"))) {
             workingPreview = result.section(QLatin1String("START:"), 1).simplified().toInt();
+            process->setProperty("workingChunk", workingPreview);
             qDebug() << "// GOT START INFO: " << workingPreview;
             m_controller->workingPreviewChanged();
         } else if (result.startsWith(QLatin1String("DONE:"))) {
             int chunk = result.section(QLatin1String("DONE:"), 1).simplified().toInt();
+            process->setProperty("workingChunk", -1);
             m_processedChunks++;
             QString fileName = QStringLiteral("%1.%2").arg(chunk).arg(m_extension);
             qDebug() << "---------------\nJOB PROGRRESS: " << m_chunksToRender << ", " << m_processedChunks << " = "
@@ -566,49 +592,75 @@ void PreviewManager::doPreviewRender(const QString &scene)
     if (m_dirtyChunks.isEmpty()) {
         return;
     }
-    Q_ASSERT(m_previewProcess.state() == QProcess::NotRunning);
-
-    QStringList chunks;
-    for (QVariant &frame : m_dirtyChunks) {
-        chunks << frame.toString();
+    Q_ASSERT(!isRendering());
+    int chunkSize = KdenliveSettings::timelinechunks();
+    // Render the chunks closest to the playhead first
+    QList<int> ordered;
+    for (const QVariant &frame : m_dirtyChunks) {
+        ordered << frame.toInt();
+    }
+    const int position = pCore->getTimelinePosition();
+    std::stable_sort(ordered.begin(), ordered.end(), [position, chunkSize](int a, int b) {
+        int distA = position >= a && position < a + chunkSize ? 0 : qAbs(a - position);
+        int distB = position >= b && position < b + chunkSize ? 0 : qAbs(b - position);
+        return distA < distB;
+    });
+    // Deal the chunks to the workers in turn, so that each of them also starts with the closest ones
+    const int workers = qMin(previewWorkers(), ordered.count());
+    QVector<QStringList> shards(workers);
+    for (int i = 0; i < ordered.count(); ++i) {
+        shards[i % workers] << QString::number(ordered.at(i));
     }
     m_chunksToRender = m_dirtyChunks.count();
     m_processedChunks = 0;
-    int chunkSize = KdenliveSettings::timelinechunks();
-    QStringList args{KdenliveSettings::rendererpath(),
-                     scene,
-                     m_cacheDir.absolutePath(),
-                     QStringLiteral("-split"),
-                     chunks.join(QLatin1Char(',')),
-                     QString::number(chunkSize - 1),
-                     pCore->getCurrentProfilePath(),
-                     m_extension,
-                     m_consumerParams.join(QLatin1Char(' '))};
-    qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
+    m_previewCrashed = false;
+    m_previewProcesses.clear();
     pCore->currentDoc()->previewProgress(0);
-    m_previewProcess.start(m_renderer, args);
-    if (m_previewProcess.waitForStarted()) {
-        qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
-    }
-}
-
-void PreviewManager::processEnded(int, QProcess::ExitStatus status)
+    for (const QStringList &chunks : shards) {
+        QStringList args{KdenliveSettings::rendererpath(),
+                         scene,
+                         m_cacheDir.absolutePath(),
+                         QStringLiteral("-split"),
+                         chunks.join(QLatin1Char(',')),
+                         QString::number(chunkSize - 1),
+                         pCore->getCurrentProfilePath(),
+                         m_extension,
+                         m_consumerParams.join(QLatin1Char(' '))};
+        qDebug() << " -  - -STARTING PREVIEW JOBS: " << args;
+        m_previewProcesses.emplace_back(new QProcess);
+        QProcess *process = m_previewProcesses.back().get();
+        process->setProperty("workingChunk", -1);
+        connect(process, &QProcess::readyReadStandardError, this, [this, process]() { receivedStderr(process); });
+        connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+                [this, process](int, QProcess::ExitStatus status) { processEnded(process, status); });
+        process->start(m_renderer, args);
+        if (process->waitForStarted()) {
+            qDebug() << " -  - -STARTING PREVIEW JOBS . . . STARTED";
+        }
+    }
+}
+
+void PreviewManager::processEnded(QProcess *process, QProcess::ExitStatus status)
 {
     qDebug() << "// PROCESS IS FINISHED!!!";
-    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
-    QFile::remove(sceneList);
     if (status == QProcess::QProcess::CrashExit) {
         qDebug() << "// PROCESS CRASHED!!!!!!";
-        pCore->currentDoc()->previewProgress(-1);
-        if (workingPreview >= 0) {
-            const QString fileName = QStringLiteral("%1.%2").arg(workingPreview).arg(m_extension);
+        m_previewCrashed = true;
+        int workingChunk = process->property("workingChunk").toInt();
+        if (workingChunk >= 0) {
+            const QString fileName = QStringLiteral("%1.%2").arg(workingChunk).arg(m_extension);
             if (m_cacheDir.exists(fileName)) {
                 m_cacheDir.remove(fileName);
             }
         }
-    } else {
-        pCore->currentDoc()->previewProgress(1000);
     }
+    if (isRendering()) {
+        // Other workers are still busy
+        return;
+    }
+    const QString sceneList = m_cacheDir.absoluteFilePath(QStringLiteral("preview.mlt"));
+    QFile::remove(sceneList);
+    pCore->currentDoc()->previewProgress(m_previewCrashed ? -1 : 1000);
     workingPreview = -1;
     m_controller->workingPreviewChanged();
 }
@@ -749,7 +801,9 @@ void PreviewManager::gotPreviewRender(int frame, const QString &file, int progre
 void PreviewManager::corruptedChunk(int frame, const QString &fileName)
 {
     emit abortPreview();
-    m_previewProcess.waitForFinished();
+    for (auto &process : m_previewProcesses) {
+        process->waitForFinished();
+    }
     if (workingPreview >= 0) {
         workingPreview = -1;
         m_controller->workingPreviewChanged();
@@ -27,6 +27,8 @@
 #include <QMutex>
 #include <QProcess>
 #include <QTimer>
+#include <memory>
+#include <vector>
 
 class TimelineController;
 
@@ -100,8 +102,10 @@ private:
     int m_previewTrackIndex;
     /** @brief: The kdenlive renderer app. */
     QString m_renderer;
-    /** @brief: The kdenlive timeline preview process. */
-    QProcess m_previewProcess;
+    /** @brief: The kdenlive timeline preview processes, each one rendering a share of the dirty chunks. */
+    std::vector<std::unique_ptr<QProcess>> m_previewProcesses;
+    /** @brief: Set if one of the preview processes crashed during the current rendering. */
+    bool m_previewCrashed{false};
     /** @brief: The directory used to store the preview files. */
     QDir m_cacheDir;
     /** @brief: The directory used to store undo history of preview files (child of m_cacheDir). */
@@ -126,6 +130,10 @@ private:
     void reloadChunks(const QVariantList chunks);
     /** @brief: A chunk failed to render, abort. */
     void corruptedChunk(int workingPreview, const QString &fileName);
+    /** @brief: Returns true if a preview process is running. */
+    bool isRendering() const;
+    /** @brief: Number of preview processes to start, from KdenliveSettings::previewworkers. */
+    int previewWorkers() const;
     /** @brief: Re-enable timeline preview track. */
     void enable();
     /** @brief: Temporarily disable timeline preview track. */
@@ -141,8 +149,8 @@ private slots:
     /** @brief: When the timer collecting invalid zones is done, process. */
     void slotProcessDirtyChunks();
     /** @brief: Process preview rendering output. */
-    void receivedStderr();
-    void processEnded(int, QProcess::ExitStatus status);
+    void receivedStderr(QProcess *process);
+    void processEnded(QProcess *process, QProcess::ExitStatus status);
 
 public slots:
     /** @brief: Prepare and start rendering. */
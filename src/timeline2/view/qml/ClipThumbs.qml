@@ -40,7 +40,9 @@ Row {
             cache: enableCache
             property int currentFrame: fixedThumbs ? 0 : thumbRepeater.count < 3 ? (index == 0 ? thumbRepeater.thumbStartFrame : thumbRepeater.thumbEndFrame) : Math.floor(clipRoot.inPoint + Math.round((index) * width / timeline.scaleFactor)* clipRoot.speed)
             horizontalAlignment: thumbRepeater.count < 3 ? (index == 0 ? Image.AlignLeft : Image.AlignRight) : Image.AlignLeft
-            source: thumbRepeater.count < 3 ? (clipRoot.baseThumbPath + currentFrame) : (index * width < clipRoot.scrollStart - width || index * width > clipRoot.scrollStart + scrollView.contentItem.width) ? '' : clipRoot.baseThumbPath + currentFrame
+            // Each thumbnail covers several frames when zoomed out, allow the displayed frame to move within half of them
+            property int tolerance: fixedThumbs ? 0 : Math.floor(width / timeline.scaleFactor * Math.abs(clipRoot.speed) / 2)
+            source: thumbRepeater.count < 3 ? (clipRoot.baseThumbPath + currentFrame) : (index * width < clipRoot.scrollStart - width || index * width > clipRoot.scrollStart + scrollView.contentItem.width) ? '' : clipRoot.baseThumbPath + currentFrame + ':' + tolerance
             onStatusChanged: {
                 if (thumbRepeater.count < 3) {
                     if (status === Image.Ready) {
@@ -305,6 +305,11 @@ Rectangle {
         console.log('GOT SCALE: ', timeScale, ', BASE: ', baseUnit, ' - SNAPPING: ', snapping)
     }
 
+    // Only the clips and compositions around the visible part of the timeline get a delegate
+    onScrollMinChanged: multitrack.setVisibleRange(scrollMin, scrollMax + 1)
+    onScrollMaxChanged: multitrack.setVisibleRange(scrollMin, scrollMax + 1)
+    Component.onCompleted: multitrack.setVisibleRange(scrollMin, scrollMax + 1)
+
     onConsumerPositionChanged: {
         if (autoScrolling) Logic.scrollIfNeeded()
     }
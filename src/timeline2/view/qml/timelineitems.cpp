@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "kdenlivesettings.h"
 #include "core.h"
 #include "bin/projectitemmodel.h"
+#include "lib/audio/audioLevels.h"
 #include <QPainter>
 #include <QPainterPath>
 #include <QQuickPaintedItem>
@@ -97,8 +98,9 @@ public:
         //setMipmap(true);
         setTextureSize(QSize(1, 1));
         connect(this, &TimelineWaveform::levelsChanged, [&]() {
-            if (!m_binId.isEmpty() && m_audioLevels.isEmpty()) {
-                m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
+            if (!m_binId.isEmpty()) {
+                // The levels may have been recomputed, drop our reference to the old ones
+                m_levels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
                 update();
             }
         });
@@ -128,54 +130,65 @@ public:
         if (!m_showItem || m_binId.isEmpty()) {
             return;
         }
-        if (m_audioLevels.isEmpty()) {
-            m_audioLevels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
-            if (m_audioLevels.isEmpty()) {
+        if (!m_levels) {
+            m_levels = pCore->projectItemModel()->getAudioLevelsByBinID(m_binId);
+            if (!m_levels) {
                 return;
             }
         }
-        qreal indicesPrPixel = qreal(m_outPoint - m_inPoint) / width();
+        const AudioLevelPyramid &pyramid = m_levels->pyramid();
+        // waveInPoint / waveOutPoint are expressed in audio level indices (frame * channels)
+        const int channels = qMax(1, m_channels);
+        const double framesPrPixel = qreal(m_outPoint - m_inPoint) / channels / width();
+        const double startFrame = double(m_inPoint) / channels;
+        const int frames = pyramid.frames();
+        // When zoomed in, there is no point in drawing more than one point per frame
+        const double increment = qMax(1., 1 / qAbs(framesPrPixel));
+        // Returns the range of frames covered by a pixel column, whatever the playback direction
+        auto frameRange = [&](double x, int &first, int &last) {
+            double a = startFrame + x * framesPrPixel;
+            double b = startFrame + (x + increment) * framesPrPixel;
+            first = int(qMin(a, b));
+            last = qMax(first + 1, int(qMax(a, b)));
+            return first >= 0 && first < frames;
+        };
         QPen pen = painter->pen();
         pen.setColor(m_color);
         pen.setWidthF(0);
         painter->setBrush(m_color);
         if (!KdenliveSettings::displayallchannels()) {
-            // Draw merged channels
-            QPainterPath path;
-            path.moveTo(-1, height());
+            // Draw merged channels: peak envelope, with the rms level on top
+            QPainterPath peakPath;
+            QPainterPath rmsPath;
+            peakPath.moveTo(-1, height());
+            rmsPath.moveTo(-1, height());
             double i = 0;
-            double increment = qMax(1., 1 / qAbs(indicesPrPixel));
-            double level;
-            int lastIdx = -1;
+            int first, last;
             for (; i <= width(); i += increment) {
-                int idx = m_inPoint + int(i * indicesPrPixel);
-                if (idx + m_channels >= m_audioLevels.length() || idx < 0) {
+                if (!frameRange(i, first, last)) {
                     break;
                 }
-                if (lastIdx == idx) {
-                    continue;
-                }
-                lastIdx = idx;
-                level = m_audioLevels.at(idx) / 255.;
-                for (int j = 1; j < m_channels; j++) {
-                    level = qMax(level, m_audioLevels.at(idx + j) / 255.);
-                }
-                path.lineTo(i, height() - level * height());
+                AudioLevelPyramid::Sample level = pyramid.sample(first, last);
+                peakPath.lineTo(i, height() - level.max * height() / 255.);
+                rmsPath.lineTo(i, height() - level.rms * height() / 255.);
             }
-            path.lineTo(i, height());
-            painter->drawPath(path);
+            peakPath.lineTo(i, height());
+            rmsPath.lineTo(i, height());
+            painter->setPen(Qt::NoPen);
+            painter->setOpacity(0.6);
+            painter->drawPath(peakPath);
+            painter->setOpacity(1);
+            painter->drawPath(rmsPath);
         } else {
-            double channelHeight = height() / (2 * m_channels);
+            double channelHeight = height() / (2 * channels);
             QFont font = painter->font();
             font.setPixelSize(channelHeight - 1);
             painter->setFont(font);
             // Draw separate channels
             double i = 0;
-            double increment = qMax(1., 1 / indicesPrPixel);
-            double level;
             QRectF bgRect(0, 0, width(), 2 * channelHeight);
-            QVector<QPainterPath> channelPaths(m_channels);
-            for (int channel = 0; channel < m_channels; channel++) {
+            QVector<QPainterPath> channelPaths(channels);
+            for (int channel = 0; channel < channels; channel++) {
                 double y = height() - (2 * channel * channelHeight) - channelHeight;
                 channelPaths[channel].moveTo(-1, y);
                 painter->setOpacity(0.2);
@@ -188,19 +201,15 @@ public:
                 painter->setPen(pen);
                 painter->drawLine(QLineF(0., y, width(), y));
                 painter->setOpacity(1);
-                int lastIdx = -1;
+                int first, last;
                 for (i = 0; i <= width(); i += increment) {
-                    int idx = m_inPoint + ceil(i * indicesPrPixel);
-                    if (lastIdx == idx) {
-                        continue;
+                    if (!frameRange(i, first, last)) {
+                        break;
                     }
-                    lastIdx = idx;
-                    idx += channel;
-                    if (idx >= m_audioLevels.length() || idx < 0) break;
-                    level = m_audioLevels.at(idx) * channelHeight / 255.;
+                    double level = pyramid.sample(first, last, channel).max * channelHeight / 255.;
                     channelPaths[channel].lineTo(i, y - level);
                 }
-                if (m_firstChunk && m_channels > 1 && m_channels < 7) {
+                if (m_firstChunk && channels > 1 && channels < 7) {
                     painter->drawText(2, y + channelHeight, chanelNames[channel]);
                 }
                 channelPaths[channel].lineTo(i, y);
@@ -220,7 +229,7 @@ signals:
     void audioChannelsChanged();
 
 private:
-    QVector<uint8_t> m_audioLevels;
+    std::shared_ptr<const AudioLevels> m_levels;
     int m_inPoint;
     int m_outPoint;
     QString m_binId;
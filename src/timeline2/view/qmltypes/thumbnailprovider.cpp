@@ -17,49 +17,113 @@
  */
 
 #include "thumbnailprovider.h"
-#include "bin/projectclip.h"
-#include "bin/projectitemmodel.h"
-#include "core.h"
 #include "utils/thumbnailcache.hpp"
-#include "doc/kthumb.h"
+#include "utils/thumbnailscheduler.hpp"
 
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
 #include <QQuickImageProvider>
-#include <mlt++/MltFilter.h>
 #include <mlt++/MltProfile.h>
 
-ThumbnailProvider::ThumbnailProvider()
-    : QQuickImageProvider(QQmlImageProviderBase::Image, QQmlImageProviderBase::ForceAsynchronousImageLoading)
+namespace {
+// The frame decoded for the last tolerant requests. The cache only stores images under the frame they show, so that exact requests never get
+// another frame, and this table lets the next tolerant request for the same frame find the image
+class DecodedFrames
 {
-}
+public:
+    void insert(const QString &binId, int frame, int decoded)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_frames.size() > 10000) {
+            m_frames.clear();
+        }
+        m_frames.insert(key(binId, frame), decoded);
+    }
+
+    int value(const QString &binId, int frame) const
+    {
+        QMutexLocker lock(&m_mutex);
+        return m_frames.value(key(binId, frame), -1);
+    }
+
+private:
+    static QString key(const QString &binId, int frame) { return QStringLiteral("%1#%2").arg(binId).arg(frame); }
+    mutable QMutex m_mutex;
+    QHash<QString, int> m_frames;
+};
+DecodedFrames decodedFrames;
+} // namespace
+
+class ThumbnailResponse : public QQuickImageResponse
+{
+public:
+    explicit ThumbnailResponse(const QImage &image = QImage())
+        : m_image(image)
+    {
+    }
+
+    void request(const QString &binId, int frameNumber, int tolerance)
+    {
+        m_request = ThumbnailScheduler::get()->request(binId, frameNumber, tolerance, [this, binId, frameNumber](const QImage &image, int frame) {
+            if (!image.isNull()) {
+                ThumbnailCache::get()->storeThumbnail(binId, frame, image, false);
+                if (frame != frameNumber) {
+                    decodedFrames.insert(binId, frameNumber, frame);
+                }
+            }
+            m_image = image;
+            emit finished();
+        });
+    }
+
+    QQuickTextureFactory *textureFactory() const override { return QQuickTextureFactory::textureFactoryForImage(m_image); }
+
+    void cancel() override { ThumbnailScheduler::get()->cancel(m_request); }
+
+private:
+    QImage m_image;
+    std::shared_ptr<ThumbnailScheduler::Request> m_request;
+};
+
+ThumbnailProvider::ThumbnailProvider() = default;
 
 ThumbnailProvider::~ThumbnailProvider() = default;
 
-QImage ThumbnailProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+QQuickImageResponse *ThumbnailProvider::requestImageResponse(const QString &id, const QSize &requestedSize)
 {
-    QImage result;
-    // id is binID/#frameNumber
+    Q_UNUSED(requestedSize)
+    // id is binID/documentId/#frameNumber, optionally followed by :tolerance
     QString binId = id.section('/', 0, 0);
+    const QString position = id.section('#', -1);
     bool ok;
-    int frameNumber = id.section('#', -1).toInt(&ok);
+    int frameNumber = position.section(':', 0, 0).toInt(&ok);
     if (ok) {
+        const int tolerance = position.section(':', 1, 1).toInt();
+        int cachedFrame = -1;
         if (ThumbnailCache::get()->hasThumbnail(binId, frameNumber, false)) {
-            result = ThumbnailCache::get()->getThumbnail(binId, frameNumber);
-            *size = result.size();
-            return result;
-        }
-        std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
-        if (binClip) {
-            std::shared_ptr<Mlt::Producer> prod = binClip->thumbProducer();
-            if (prod && prod->is_valid()) {
-                result = makeThumbnail(prod, frameNumber, requestedSize);
-                ThumbnailCache::get()->storeThumbnail(binId, frameNumber, result, false);
+            cachedFrame = frameNumber;
+        } else if (tolerance > 0) {
+            // A close frame decoded for a previous request
+            const int decoded = decodedFrames.value(binId, frameNumber);
+            if (decoded >= 0 && qAbs(decoded - frameNumber) <= tolerance && ThumbnailCache::get()->hasThumbnail(binId, decoded, false)) {
+                cachedFrame = decoded;
             }
         }
+        if (cachedFrame >= 0) {
+            auto *response = new ThumbnailResponse(ThumbnailCache::get()->getThumbnail(binId, cachedFrame));
+            // The engine only listens to the response once it is returned
+            QMetaObject::invokeMethod(response, "finished", Qt::QueuedConnection);
+            return response;
+        }
+        auto *response = new ThumbnailResponse();
+        response->request(binId, frameNumber, tolerance);
+        return response;
     }
-    if (size) *size = result.size();
-    return result;
+    auto *response = new ThumbnailResponse();
+    QMetaObject::invokeMethod(response, "finished", Qt::QueuedConnection);
+    return response;
 }
 
 QString ThumbnailProvider::cacheKey(Mlt::Properties &properties, const QString &service, const QString &resource, const QString &hash, int frameNumber)
@@ -79,18 +143,3 @@ QString ThumbnailProvider::cacheKey(Mlt::Properties &properties, const QString &
     }
     return key;
 }
-
-QImage ThumbnailProvider::makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize)
-{
-    Q_UNUSED(requestedSize)
-    producer->seek(frameNumber);
-    QScopedPointer<Mlt::Frame> frame(producer->get_frame());
-    if (frame == nullptr || !frame->is_valid()) {
-        return QImage();
-    }
-    // TODO: cache these values ?
-    int imageHeight = pCore->thumbProfile()->height();
-    int imageWidth = pCore->thumbProfile()->width();
-    int fullWidth = imageHeight * pCore->getCurrentDar() + 0.5;
-    return KThumb::getFrame(frame.data(), imageWidth, imageHeight, fullWidth);
-}
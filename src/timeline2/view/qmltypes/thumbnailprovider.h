@@ -19,22 +19,23 @@
 #ifndef THUMBNAILPROVIDER_H
 #define THUMBNAILPROVIDER_H
 
-#include <KImageCache>
-#include <QCache>
 #include <QQuickImageProvider>
 #include <memory>
 #include <mlt++/MltProducer.h>
 #include <mlt++/MltProfile.h>
 
-class ThumbnailProvider : public QQuickImageProvider
+/** @brief Serves the timeline thumbnails. Images that are not cached are extracted by the ThumbnailScheduler,
+    and the requests of images scrolled out of view are cancelled by QML.
+    The image id is binId/documentId/#frame, optionally followed by :tolerance, the number of frames the displayed image may differ from the requested one.
+ */
+class ThumbnailProvider : public QQuickAsyncImageProvider
 {
 public:
     explicit ThumbnailProvider();
     ~ThumbnailProvider() override;
-    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+    QQuickImageResponse *requestImageResponse(const QString &id, const QSize &requestedSize) override;
 
 private:
-    QImage makeThumbnail(const std::shared_ptr<Mlt::Producer> &producer, int frameNumber, const QSize &requestedSize);
     QString cacheKey(Mlt::Properties &properties, const QString &service, const QString &resource, const QString &hash, int frameNumber);
 };
 
@@ -0,0 +1,134 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#include "timelineviewportmodel.hpp"
+#include "timeline2/model/timelineitemmodel.hpp"
+
+TimelineViewportModel::TimelineViewportModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_hasRange(false)
+    , m_bandStart(0)
+    , m_bandEnd(0)
+    , m_refreshes(0)
+    , m_skipped(0)
+{
+}
+
+void TimelineViewportModel::setTimelineModel(const std::shared_ptr<TimelineItemModel> &model)
+{
+    if (sourceModel() != nullptr) {
+        disconnect(sourceModel(), &QAbstractItemModel::dataChanged, this, &TimelineViewportModel::slotSourceDataChanged);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &TimelineViewportModel::slotSourceRowsAboutToBeRemoved);
+        disconnect(sourceModel(), &QAbstractItemModel::modelAboutToBeReset, this, &TimelineViewportModel::slotSourceAboutToBeReset);
+    }
+    m_model = model;
+    m_shown.clear();
+    setSourceModel(model.get());
+    // Connected after the proxy, so that we know if it already filtered the changed rows
+    connect(model.get(), &QAbstractItemModel::dataChanged, this, &TimelineViewportModel::slotSourceDataChanged);
+    connect(model.get(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &TimelineViewportModel::slotSourceRowsAboutToBeRemoved);
+    connect(model.get(), &QAbstractItemModel::modelAboutToBeReset, this, &TimelineViewportModel::slotSourceAboutToBeReset);
+}
+
+void TimelineViewportModel::setVisibleRange(int start, int end)
+{
+    const int length = qMax(1, end - start);
+    if (m_hasRange && start >= m_bandStart && end <= m_bandEnd && m_bandEnd - m_bandStart <= 6 * length) {
+        // Still in the margin, and the view was not zoomed in too much
+        m_skipped++;
+        return;
+    }
+    m_bandStart = qMax(0, start - length);
+    m_bandEnd = end + length;
+    auto ptr = m_model.lock();
+    if (m_hasRange && ptr) {
+        // The range query only visits the items of the new range, filtering all rows again is only needed if they changed
+        const std::unordered_set<int> items = ptr->getViewItemsInRange(m_bandStart, m_bandEnd);
+        if (items == m_shown) {
+            m_skipped++;
+            return;
+        }
+    }
+    m_hasRange = true;
+    m_refreshes++;
+    invalidateFilter();
+}
+
+bool TimelineViewportModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (!sourceParent.isValid()) {
+        // Tracks are always shown
+        return true;
+    }
+    const int itemId = int(sourceModel()->index(sourceRow, 0, sourceParent).internalId());
+    auto ptr = m_model.lock();
+    const bool accepted = m_hasRange && ptr && ptr->isItemInRange(itemId, m_bandStart, m_bandEnd);
+    if (accepted) {
+        m_shown.insert(itemId);
+    } else {
+        m_shown.erase(itemId);
+    }
+    return accepted;
+}
+
+void TimelineViewportModel::slotSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    if (!m_hasRange || !topLeft.parent().isValid()) {
+        return;
+    }
+    if (!roles.isEmpty() && !roles.contains(TimelineModel::StartRole) && !roles.contains(TimelineModel::DurationRole) &&
+        !roles.contains(TimelineModel::FakePositionRole)) {
+        return;
+    }
+    auto ptr = m_model.lock();
+    if (!ptr) {
+        return;
+    }
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const int itemId = int(sourceModel()->index(row, 0, topLeft.parent()).internalId());
+        if (ptr->isItemInRange(itemId, m_bandStart, m_bandEnd) != (m_shown.count(itemId) > 0)) {
+            // The item was moved in or out of the range, but the proxy did not filter it again
+            invalidateFilter();
+            return;
+        }
+    }
+}
+
+void TimelineViewportModel::slotSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (!parent.isValid()) {
+        return;
+    }
+    for (int row = first; row <= last; ++row) {
+        m_shown.erase(int(sourceModel()->index(row, 0, parent).internalId()));
+    }
+}
+
+void TimelineViewportModel::slotSourceAboutToBeReset()
+{
+    m_shown.clear();
+}
+
+TimelineViewportModel::Stats TimelineViewportModel::stats() const
+{
+    return {int(m_shown.size()), m_refreshes, m_skipped};
+}
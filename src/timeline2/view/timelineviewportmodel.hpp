@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QSortFilterProxyModel>
+#include <memory>
+#include <unordered_set>
+
+class TimelineItemModel;
+
+/** @brief Proxy of the timeline model used by the QML view. It sorts the tracks, and only exposes the clips and compositions intersecting the visible
+    part of the timeline plus a margin, so that the view only creates delegates for them.
+    Delegates scrolled out of view are kept while they stay in the margin, so that small scroll steps do not destroy and recreate them.
+ */
+class TimelineViewportModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit TimelineViewportModel(QObject *parent = nullptr);
+
+    /** @brief Sets the timeline model exposed by this proxy */
+    void setTimelineModel(const std::shared_ptr<TimelineItemModel> &model);
+
+    /** @brief Sets the frames [start, end[ shown by the view. Items are exposed if they intersect this range extended by its length on each side */
+    Q_INVOKABLE void setVisibleRange(int start, int end);
+
+    struct Stats
+    {
+        /** @brief Number of items currently exposed to the view */
+        int shown;
+        /** @brief Number of visible range changes that required filtering the items again */
+        int refreshes;
+        /** @brief Number of visible range changes handled without filtering the items again */
+        int skipped;
+    };
+    Stats stats() const;
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private slots:
+    void slotSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void slotSourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void slotSourceAboutToBeReset();
+
+private:
+    std::weak_ptr<TimelineItemModel> m_model;
+    bool m_hasRange;
+    /** @brief Range of the exposed items */
+    int m_bandStart;
+    int m_bandEnd;
+    /** @brief Ids of the items currently exposed, updated each time an item is filtered */
+    mutable std::unordered_set<int> m_shown;
+    int m_refreshes;
+    int m_skipped;
+};
@@ -35,6 +35,7 @@
 #include "qml/timelineitems.h"
 #include "qmltypes/thumbnailprovider.h"
 #include "timelinecontroller.h"
+#include "timelineviewportmodel.hpp"
 #include "utils/clipboardproxy.hpp"
 #include "effects/effectsrepository.hpp"
 
@@ -47,7 +48,6 @@
 #include <QUuid>
 #include <QMenu>
 #include <QFontDatabase>
-#include <QSortFilterProxyModel>
 
 const int TimelineWidget::comboScale[] = {1, 2, 4, 8, 15, 30, 50, 75, 100, 150, 200, 300, 500, 800, 1000, 1500, 2000, 3000, 6000, 15000, 30000};
 
@@ -60,7 +60,7 @@ TimelineWidget::TimelineWidget(QWidget *parent)
     kdeclarative.setupContext();
     setClearColor(palette().window().color());
     registerTimelineItems();
-    m_sortModel = std::make_unique<QSortFilterProxyModel>(this);
+    m_sortModel = std::make_unique<TimelineViewportModel>(this);
     m_proxy = new TimelineController(this);
     connect(m_proxy, &TimelineController::zoneMoved, this, &TimelineWidget::zoneMoved);
     connect(m_proxy, &TimelineController::ungrabHack, this, &TimelineWidget::slotUngrabHack);
@@ -151,7 +151,7 @@ void TimelineWidget::setTimelineMenu(QMenu *clipMenu, QMenu *compositionMenu, QM
 
 void TimelineWidget::setModel(const std::shared_ptr<TimelineItemModel> &model, MonitorProxy *proxy)
 {
-    m_sortModel->setSourceModel(model.get());
+    m_sortModel->setTimelineModel(model);
     m_sortModel->setSortRole(TimelineItemModel::SortRole);
     m_sortModel->sort(0, Qt::DescendingOrder);
     m_proxy->setModel(model);
@@ -27,7 +27,7 @@
 
 class ThumbnailProvider;
 class TimelineController;
-class QSortFilterProxyModel;
+class TimelineViewportModel;
 class MonitorProxy;
 class QMenu;
 
@@ -93,7 +93,7 @@ private:
     QMenu *m_favCompositions;
     QAction *m_editGuideAcion;
     static const int comboScale[];
-    std::unique_ptr<QSortFilterProxyModel> m_sortModel;
+    std::unique_ptr<TimelineViewportModel> m_sortModel;
     /* @brief Keep last scale before fit to restore it on second click */
     double m_prevScale;
     /* @brief Keep last scroll position before fit to restore it on second click */
@@ -43,8 +43,9 @@ TransitionsRepository::TransitionsRepository()
         }
     }
     if (!invalidTransition.isEmpty()) {
-        pCore->displayMessage(i18n("Some of your favorite compositions are invalid and were removed: %1", invalidTransition.join(QLatin1Char(','))),
-                              ErrorMessage);
+        // The repository is built on startup, before the main window can display messages
+        const QString message = i18n("Some of your favorite compositions are invalid and were removed: %1", invalidTransition.join(QLatin1Char(',')));
+        QMetaObject::invokeMethod(pCore.get(), [message]() { pCore->displayMessage(message, ErrorMessage); }, Qt::QueuedConnection);
         QStringList newFavorites = KdenliveSettings::favorite_transitions();
         for (const QString &effect : invalidTransition) {
             newFavorites.removeAll(effect);
@@ -63,13 +64,8 @@ Mlt::Properties *TransitionsRepository::getMetadata(const QString &assetId) cons
     return pCore->getMltRepository()->metadata(transition_type, assetId.toLatin1().data());
 }
 
-void TransitionsRepository::parseCustomAssetFile(const QString &file_name, std::unordered_map<QString, Info> &customAssets) const
+void TransitionsRepository::parseCustomAssetFile(const QString &file_name, QDomDocument &doc, std::unordered_map<QString, Info> &customAssets) const
 {
-    QFile file(file_name);
-    QDomDocument doc;
-    doc.setContent(&file, false);
-    file.close();
-
     QDomElement base = doc.documentElement();
     QDomNodeList transitions = doc.elementsByTagName(QStringLiteral("transition"));
 
@@ -153,6 +149,11 @@ QString TransitionsRepository::assetPreferredListPath() const
     return QStringLiteral("");
 }
 
+QString TransitionsRepository::assetCacheName() const
+{
+    return QStringLiteral("transitions");
+}
+
 std::unique_ptr<Mlt::Transition> TransitionsRepository::getTransition(const QString &transitionId) const
 {
     Q_ASSERT(exists(transitionId));
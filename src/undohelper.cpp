@@ -22,7 +22,82 @@
 #include "undohelper.hpp"
 #include "logger.hpp"
 #include <QDebug>
+#include <algorithm>
 #include <utility>
+
+UndoTransaction *UndoTransaction::edit(Fun &lambda)
+{
+    auto *transaction = lambda.target<UndoTransaction>();
+    if (transaction == nullptr) {
+        UndoTransaction created;
+        created.m_ops = std::make_shared<Operations>();
+        created.m_ops->back.push_back({std::move(lambda), false, 0});
+        lambda = std::move(created);
+        transaction = lambda.target<UndoTransaction>();
+    } else if (transaction->m_ops.use_count() > 1) {
+        transaction->m_ops = std::make_shared<Operations>(*transaction->m_ops);
+    }
+    return transaction;
+}
+
+void UndoTransaction::pushBack(Fun &lambda, Fun operation, bool shortCircuit)
+{
+    UndoTransaction *transaction = edit(lambda);
+    Operations &ops = *transaction->m_ops;
+    ops.back.push_back({std::move(operation), shortCircuit, ops.front.size()});
+}
+
+void UndoTransaction::pushFront(Fun &lambda, Fun operation, bool shortCircuit)
+{
+    UndoTransaction *transaction = edit(lambda);
+    Operations &ops = *transaction->m_ops;
+    ops.front.push_back({std::move(operation), shortCircuit, ops.back.size()});
+}
+
+size_t UndoTransaction::size(const Fun &lambda)
+{
+    const auto *transaction = lambda.target<UndoTransaction>();
+    return transaction == nullptr ? 1 : transaction->m_ops->front.size() + transaction->m_ops->back.size();
+}
+
+bool UndoTransaction::operator()() const
+{
+    // Keep the operations alive even if the Fun holding them is replaced while they run
+    std::shared_ptr<Operations> ops = m_ops;
+    // A short circuit operation only depends on the operations that were there when it was pushed.
+    // If it was pushed at the front and fails, these operations are skipped.
+    std::vector<char> frontResults(ops->front.size(), 1);
+    size_t skipBack = 0;
+    for (size_t i = ops->front.size(); i > 0; --i) {
+        const Operation &op = ops->front[i - 1];
+        if (!op.fun()) {
+            frontResults[i - 1] = 0;
+            if (op.shortCircuit) {
+                std::fill(frontResults.begin(), frontResults.begin() + long(i - 1), 0);
+                skipBack = op.otherCount;
+                break;
+            }
+        }
+    }
+    // Result of the front operations pushed before the current back operation, and of the back operations before it
+    bool frontResult = true;
+    size_t frontChecked = 0;
+    bool backResult = skipBack == 0;
+    for (size_t i = skipBack; i < ops->back.size(); ++i) {
+        const Operation &op = ops->back[i];
+        for (; frontChecked < op.otherCount; ++frontChecked) {
+            frontResult = frontResult && frontResults[frontChecked] != 0;
+        }
+        if (!op.shortCircuit || (frontResult && backResult)) {
+            backResult = op.fun() && backResult;
+        }
+    }
+    for (; frontChecked < frontResults.size(); ++frontChecked) {
+        frontResult = frontResult && frontResults[frontChecked] != 0;
+    }
+    return frontResult && backResult;
+}
+
 FunctionalUndoCommand::FunctionalUndoCommand(Fun undo, Fun redo, const QString &text, QUndoCommand *parent)
     : QUndoCommand(parent)
     , m_undo(std::move(undo))
@@ -22,24 +22,59 @@
 #ifndef UNDOHELPER_H
 #define UNDOHELPER_H
 #include <functional>
+#include <memory>
+#include <vector>
 
 using Fun = std::function<bool(void)>;
 
-/* @brief this macro executes an operation after a given lambda
+/* @brief A list of operations executed one after the other when the Fun holding it is called.
+   The macros below store it in the Fun they modify, so that pushing an operation appends it to a flat list instead of wrapping the previous
+   function in a new closure. Undoing an operation touching N items then runs a loop over N operations instead of N nested calls.
+   Copies of the Fun share the list until one of them is modified.
  */
-#define PUSH_LAMBDA(operation, lambda)                                                                                                                         \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = lambda();                                                                                                                                     \
-        return v && operation();                                                                                                                               \
+class UndoTransaction
+{
+public:
+    /* @brief Adds operation at the end of lambda.
+       @param shortCircuit if true, operation is only executed if everything before it succeeded
+     */
+    static void pushBack(Fun &lambda, Fun operation, bool shortCircuit);
+    /* @brief Adds operation at the beginning of lambda.
+       @param shortCircuit if true, the operations that were in lambda are not executed if operation fails
+     */
+    static void pushFront(Fun &lambda, Fun operation, bool shortCircuit);
+    /* @brief Returns the number of operations stored in lambda, 1 if it is not a transaction */
+    static size_t size(const Fun &lambda);
+
+    bool operator()() const;
+
+private:
+    struct Operation
+    {
+        Fun fun;
+        bool shortCircuit;
+        // The number of operations on the other side (front or back) when it was pushed
+        size_t otherCount;
+    };
+    struct Operations
+    {
+        // Executed in reverse order, before the back operations
+        std::vector<Operation> front;
+        std::vector<Operation> back;
     };
+    /* @brief Returns the transaction stored in lambda, after converting it if needed. The operations are not shared with other copies */
+    static UndoTransaction *edit(Fun &lambda);
+
+    std::shared_ptr<Operations> m_ops;
+};
+
+/* @brief this macro executes an operation after a given lambda
+ */
+#define PUSH_LAMBDA(operation, lambda) UndoTransaction::pushBack(lambda, operation, true);
 
 /* @brief this macro executes an operation before a given lambda
  */
-#define PUSH_FRONT_LAMBDA(operation, lambda)                                                                                                                   \
-    lambda = [lambda, operation]() {                                                                                                                           \
-        bool v = operation();                                                                                                                                  \
-        return v && lambda();                                                                                                                                  \
-    };
+#define PUSH_FRONT_LAMBDA(operation, lambda) UndoTransaction::pushFront(lambda, operation, true);
 
 #include <QUndoCommand>
 
@@ -0,0 +1,119 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include "definitions.h"
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Mlt {
+class Producer;
+class Properties;
+}
+
+/** @brief This class is a persistent cache of the media information found by probing files: stream properties, duration, frame rate,
+    audio layout and the partial md5 hash used to identify clips.
+    Entries are shared by all projects and keyed by path, size, modification time and inode, so that a modified or replaced file is probed again.
+    The cache is loaded from disk on first use and written back by flush().
+ * Note that this class is a Singleton
+ */
+class MediaCache
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<MediaCache> &get();
+    ~MediaCache();
+
+    /** @brief Identity of a file on disk */
+    struct FileId
+    {
+        qint64 size = -1;
+        qint64 modified = 0;
+        quint64 inode = 0;
+        bool isValid() const { return size >= 0; }
+        bool operator==(const FileId &other) const { return size == other.size && modified == other.modified && inode == other.inode; }
+    };
+    static FileId identify(const QString &path);
+
+    /** @brief Sets on @param properties the properties cached for @param path. Returns false if the file is unknown or changed */
+    bool restoreProperties(const QString &path, Mlt::Properties &properties);
+    /** @brief Stores the probed properties of @param producer for @param path */
+    void storeProperties(const QString &path, Mlt::Producer &producer);
+    /** @brief Returns the hash of @param path, computed from its first and last MB if not cached. Returns an empty string if the file cannot be read
+        @param size is set to the size of the file
+        @param readBytes is set to the number of bytes read to compute the hash, 0 if it was cached */
+    QString fileHash(const QString &path, qint64 *size = nullptr, qint64 *readBytes = nullptr);
+
+    /** @brief Writes the cache to disk if it changed */
+    void flush();
+    /** @brief Drops all entries, in memory and on disk */
+    void clear();
+    /** @brief Use @param path to store the cache instead of the default location, dropping the loaded entries */
+    void setCacheFile(const QString &path);
+
+    struct Stats
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 hashHits = 0;
+        qint64 hashMisses = 0;
+    };
+    Stats stats() const;
+    void resetStats();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    MediaCache();
+
+    struct Entry
+    {
+        FileId id;
+        QString hash;
+        QMap<QString, QString> properties;
+        // last access, in seconds since epoch, used to drop old entries
+        qint64 used = 0;
+    };
+    /** @brief Returns the entry of @param path if it matches @param id, nullptr otherwise. The mutex must be locked */
+    Entry *find(const QString &path, const FileId &id);
+    /** @brief Returns the entry of @param path, resetting it if the file changed. The mutex must be locked */
+    Entry &entry(const QString &path, const FileId &id);
+    void load();
+
+    static std::unique_ptr<MediaCache> instance;
+    static std::once_flag m_onceFlag; // flag to create the cache only once;
+
+    mutable QMutex m_mutex;
+    QString m_cacheFile;
+    std::unordered_map<QString, Entry> m_entries;
+    bool m_loaded{false};
+    bool m_dirty{false};
+    std::atomic<qint64> m_hits{0};
+    std::atomic<qint64> m_misses{0};
+    std::atomic<qint64> m_hashHits{0};
+    std::atomic<qint64> m_hashMisses{0};
+};
@@ -0,0 +1,103 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/** @brief A fixed size, lock-free queue with a single producer thread and a single consumer thread.
+    The storage is allocated once in the constructor, push() and pop() never allocate nor block, so the producer can be a realtime thread.
+    When the queue is full, new values are dropped and counted.
+ */
+template <typename T> class SpscRingBuffer
+{
+public:
+    /** @param minCapacity the number of values the queue can hold, rounded up to a power of 2 */
+    explicit SpscRingBuffer(size_t minCapacity)
+    {
+        size_t capacity = 2;
+        while (capacity < minCapacity) {
+            capacity <<= 1;
+        }
+        m_data.resize(capacity);
+        m_mask = capacity - 1;
+    }
+
+    /** @brief Producer side: appends @param value, returns false if the queue is full */
+    bool push(const T &value)
+    {
+        const size_t head = m_head.value.load(std::memory_order_relaxed);
+        if (head - m_tail.value.load(std::memory_order_acquire) == m_data.size()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_data[head & m_mask] = value;
+        m_head.value.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Consumer side: takes the oldest value in @param value, returns false if the queue is empty */
+    bool pop(T &value)
+    {
+        const size_t tail = m_tail.value.load(std::memory_order_relaxed);
+        if (tail == m_head.value.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = m_data[tail & m_mask];
+        m_tail.value.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Consumer side: calls @param f on all queued values in order, returns the number of values */
+    template <class F> size_t drain(F f)
+    {
+        const size_t tail = m_tail.value.load(std::memory_order_relaxed);
+        const size_t head = m_head.value.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; ++i) {
+            f(m_data[i & m_mask]);
+        }
+        m_tail.value.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    /** @brief Consumer side: drops all queued values */
+    void discard() { m_tail.value.store(m_head.value.load(std::memory_order_acquire), std::memory_order_release); }
+
+    size_t size() const { return m_head.value.load(std::memory_order_acquire) - m_tail.value.load(std::memory_order_acquire); }
+    size_t capacity() const { return m_data.size(); }
+    /** @brief Number of values dropped because the queue was full */
+    size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<T> m_data;
+    size_t m_mask;
+    // Keep the indexes written by each thread on separate cache lines
+    struct Index
+    {
+        std::atomic<size_t> value{0};
+        char padding[64 - sizeof(std::atomic<size_t>)];
+    };
+    Index m_head;
+    Index m_tail;
+    std::atomic<size_t> m_dropped{0};
+};
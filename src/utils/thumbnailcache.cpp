@@ -26,8 +26,14 @@
 #include "doc/kdenlivedoc.h"
 #include <QDir>
 #include <QMutexLocker>
+#include <algorithm>
 #include <list>
 
+namespace {
+// Maximum number of thumbnail packs kept open
+const size_t maxOpenPacks = 32;
+} // namespace
+
 std::unique_ptr<ThumbnailCache> ThumbnailCache::instance;
 std::once_flag ThumbnailCache::m_onceFlag;
 
@@ -118,7 +124,15 @@ bool ThumbnailCache::hasThumbnail(const QString &binId, int pos, bool volatileOn
         return false;
     }
     QDir thumbFolder = getDir(pos < 0, &ok);
-    return ok && thumbFolder.exists(key);
+    if (!ok) {
+        return false;
+    }
+    if (pos < 0) {
+        return thumbFolder.exists(key);
+    }
+    const QString hash = getHash(binId, &ok);
+    ThumbnailPack *pack = ok ? getPack(hash, thumbFolder) : nullptr;
+    return pack != nullptr && pack->contains(pos);
 }
 
 QImage ThumbnailCache::getAudioThumbnail(const QString &binId, bool volatileOnly) const
@@ -164,9 +178,14 @@ QImage ThumbnailCache::getThumbnail(const QString &binId, int pos, bool volatile
         return QImage();
     }
     QDir thumbFolder = getDir(false, &ok);
-    if (ok && thumbFolder.exists(key)) {
-        m_storedOnDisk[binId].push_back(pos);
-        return QImage(thumbFolder.absoluteFilePath(key));
+    const QString hash = ok ? getHash(binId, &ok) : QString();
+    ThumbnailPack *pack = ok ? getPack(hash, thumbFolder) : nullptr;
+    if (pack) {
+        QImage img = pack->image(pos);
+        if (!img.isNull()) {
+            m_storedOnDisk[binId].push_back(pos);
+        }
+        return img;
     }
     return QImage();
 }
@@ -181,9 +200,11 @@ void ThumbnailCache::storeThumbnail(const QString &binId, int pos, const QImage
     }
     if (persistent) {
         QDir thumbFolder = getDir(false, &ok);
+        const QString hash = ok ? getHash(binId, &ok) : QString();
         if (ok) {
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: "<<thumbFolder.absoluteFilePath(key);
+            ThumbnailPack *pack = getPack(hash, thumbFolder, true);
+            if (!pack->store(pos, img)) {
+                qDebug() << ".............\n!!!!!!!! ERROR SAVING THUMB in: " << pack->path();
             }
             m_storedOnDisk[binId].push_back(pos);
             // if volatile cache also contains this entry, update it
@@ -207,13 +228,18 @@ void ThumbnailCache::saveCachedThumbs(QStringList keys)
     if (!ok) {
         return;
     }
+    QMutexLocker locker(&m_mutex);
     for (const QString &key : keys) {
-        if (!thumbFolder.exists(key) && m_volatileCache->contains(key)) {
-            QImage img = m_volatileCache->get(key);
-            if (!img.save(thumbFolder.absoluteFilePath(key))) {
-                qDebug() << "// Error writing thumbnails to " << thumbFolder.absolutePath();
-                break;
-            }
+        // keys have the form hash#pos.png
+        const QString hash = key.section(QLatin1Char('#'), 0, 0);
+        int pos = key.section(QLatin1Char('#'), 1).section(QLatin1Char('.'), 0, 0).toInt(&ok);
+        if (!ok || !m_volatileCache->contains(key)) {
+            continue;
+        }
+        ThumbnailPack *pack = getPack(hash, thumbFolder, true);
+        if (!pack->contains(pos) && !pack->store(pos, m_volatileCache->get(key))) {
+            qDebug() << "// Error writing thumbnails to " << pack->path();
+            break;
         }
     }
 }
@@ -235,20 +261,19 @@ void ThumbnailCache::invalidateThumbsForClip(const QString &binId, bool reloadAu
     // Video thumbs
     QDir thumbFolder = getDir(false, &ok);
     QDir audioThumbFolder = getDir(true, &ok);
-    if (ok && m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
+    const QString hash = ok ? getHash(binId, &ok) : QString();
+    if (ok) {
         // Remove persistent cache
-        for (int pos : m_storedOnDisk.at(binId)) {
-            if (pos < 0) {
-                if (reloadAudio) {
-                    auto key = getAudioKey(binId, &ok);
-                    if (ok) {
-                        QFile::remove(audioThumbFolder.absoluteFilePath(key));
-                    }
-                }
-            } else {
-                auto key = getKey(binId, pos, &ok);
+        ThumbnailPack *pack = getPack(hash, thumbFolder);
+        if (pack) {
+            pack->remove();
+        }
+        if (reloadAudio && m_storedOnDisk.find(binId) != m_storedOnDisk.end()) {
+            const std::vector<int> &stored = m_storedOnDisk.at(binId);
+            if (std::find(stored.cbegin(), stored.cend(), -1) != stored.cend()) {
+                auto key = getAudioKey(binId, &ok);
                 if (ok) {
-                    QFile::remove(thumbFolder.absoluteFilePath(key));
+                    QFile::remove(audioThumbFolder.absoluteFilePath(key));
                 }
             }
         }
@@ -262,6 +287,22 @@ void ThumbnailCache::clearCache()
     m_volatileCache->clear();
     m_storedVolatile.clear();
     m_storedOnDisk.clear();
+    m_packs.clear();
+    m_packIndex.clear();
+    m_missingPacks.clear();
+    m_legacyThumbs.clear();
+    m_legacyScannedDir.clear();
+}
+
+void ThumbnailCache::closePacks()
+{
+    QMutexLocker locker(&m_mutex);
+    m_storedOnDisk.clear();
+    m_packs.clear();
+    m_packIndex.clear();
+    m_missingPacks.clear();
+    m_legacyThumbs.clear();
+    m_legacyScannedDir.clear();
 }
 
 // static
@@ -276,6 +317,65 @@ QString ThumbnailCache::getKey(const QString &binId, int pos, bool *ok)
     return *ok ? binClip->hash() + QLatin1Char('#') + QString::number(pos) + QStringLiteral(".png") : QString();
 }
 
+// static
+QString ThumbnailCache::getHash(const QString &binId, bool *ok)
+{
+    if (binId.isEmpty()) {
+        *ok = false;
+        return QString();
+    }
+    auto binClip = pCore->projectItemModel()->getClipByBinID(binId);
+    *ok = binClip != nullptr;
+    return *ok ? binClip->hash() : QString();
+}
+
+ThumbnailPack *ThumbnailCache::getPack(const QString &hash, const QDir &thumbFolder, bool create) const
+{
+    const QString packPath = thumbFolder.absoluteFilePath(hash + ThumbnailPack::extension());
+    auto it = m_packIndex.find(packPath);
+    if (it != m_packIndex.end()) {
+        m_packs.splice(m_packs.begin(), m_packs, it->second);
+        return m_packs.front().get();
+    }
+    if (!create && m_missingPacks.count(packPath) > 0) {
+        return nullptr;
+    }
+    if (m_legacyScannedDir != thumbFolder.absolutePath()) {
+        // List the thumbnails stored by previous versions (one hash#pos.png file per frame) once per folder
+        m_legacyScannedDir = thumbFolder.absolutePath();
+        m_legacyThumbs.clear();
+        const QStringList files = thumbFolder.entryList({QStringLiteral("*#*.png")}, QDir::Files);
+        for (const QString &file : files) {
+            int sep = file.lastIndexOf(QLatin1Char('#'));
+            bool ok = false;
+            int pos = file.midRef(sep + 1, file.length() - sep - 5).toInt(&ok);
+            if (ok) {
+                m_legacyThumbs[file.left(sep)].emplace_back(pos, thumbFolder.absoluteFilePath(file));
+            }
+        }
+    }
+    std::unique_ptr<ThumbnailPack> pack(new ThumbnailPack(packPath));
+    auto legacy = m_legacyThumbs.find(hash);
+    if (legacy != m_legacyThumbs.end()) {
+        int imported = pack->importFiles(legacy->second);
+        qDebug() << "// Imported" << imported << "legacy thumbnails in" << packPath;
+        m_legacyThumbs.erase(legacy);
+    }
+    if (!create && !pack->exists()) {
+        m_missingPacks.insert(packPath);
+        return nullptr;
+    }
+    m_missingPacks.erase(packPath);
+    m_packs.push_front(std::move(pack));
+    m_packIndex[packPath] = m_packs.begin();
+    while (m_packs.size() > maxOpenPacks) {
+        // Closes the least recently used pack
+        m_packIndex.erase(m_packs.back()->path());
+        m_packs.pop_back();
+    }
+    return m_packs.front().get();
+}
+
 // static
 QString ThumbnailCache::getAudioKey(const QString &binId, bool *ok)
 {
@@ -22,17 +22,21 @@
 #pragma once
 
 #include "definitions.h"
+#include "thumbnailpack.hpp"
 #include <QDir>
 #include <QUrl>
 #include <QImage>
 #include <QMutex>
+#include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 /** @brief This class class is an interface to the caches that store thumbnails.
     In Kdenlive, we use two such caches, a persistent that is stored on disk to allow thumbnails to be reused when reopening.
+    The persistent cache keeps all the thumbnails of a clip in one ThumbnailPack file, named after the clip hash.
     The other one is a volatile LRU cache that lives in memory.
     Note that for the volatile cache uses a custom implementation.
     QCache is not suitable since it operates on pointers and since the object is removed from the cache when accessed.
@@ -79,6 +83,9 @@ public:
     /* @brief Reset cache (discarding all thumbs stored in memory) */
     void clearCache();
 
+    /* @brief Close the thumbnail packs, must be called before their folder is deleted */
+    void closePacks();
+
 protected:
     // Constructor is protected because class is a Singleton
     ThumbnailCache();
@@ -90,6 +97,13 @@ protected:
     // Return the dir where the persistent cache lives
     static QDir getDir(bool audio, bool *ok);
 
+    // Return the hash identifying a bin clip in the persistent cache
+    static QString getHash(const QString &binId, bool *ok);
+
+    // Return the thumbnail pack of a clip, importing the legacy one-file-per-frame thumbnails on first access.
+    // Returns nullptr if the clip has no pack, unless @param create is true
+    ThumbnailPack *getPack(const QString &hash, const QDir &thumbFolder, bool create = false) const;
+
     static std::unique_ptr<ThumbnailCache> instance;
     static std::once_flag m_onceFlag; // flag to create the repository only once;
 
@@ -101,4 +115,13 @@ protected:
     // Note that we don't track deletions due to items dropped from the cache. So the maps can contain more items that are currently stored.
     std::unordered_map<QString, std::vector<int>> m_storedVolatile;
     mutable std::unordered_map<QString, std::vector<int>> m_storedOnDisk;
+
+    // the open thumbnail packs, most recently used first. Each one holds an open file and a memory map, so only a few are kept
+    mutable std::list<std::unique_ptr<ThumbnailPack>> m_packs;
+    mutable std::unordered_map<QString, decltype(m_packs.begin())> m_packIndex;
+    // path of the packs known not to exist, so that clips without thumbnails do not cause a filesystem access on each query
+    mutable std::unordered_set<QString> m_missingPacks;
+    // legacy png thumbnails found in the thumbs folder (by clip hash) that were not yet imported in a pack
+    mutable std::unordered_map<QString, std::vector<std::pair<int, QString>>> m_legacyThumbs;
+    mutable QString m_legacyScannedDir;
 };
@@ -0,0 +1,328 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#include "thumbnailpack.hpp"
+
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+const quint32 packMagic = 0x4b54484b; // KHTK
+const quint32 packVersion = 1;
+const quint32 recordMagic = 0x4b544852; // RHTK
+const quint32 compressedFlag = 1;
+
+struct PackHeader
+{
+    quint32 magic;
+    quint32 version;
+};
+
+struct RecordHeader
+{
+    quint32 magic;
+    qint32 pos;
+    quint32 width;
+    quint32 height;
+    quint32 bytesPerLine;
+    quint32 format;
+    quint32 flags;
+    quint32 size;
+};
+
+/** @brief Check the geometry of a record against its size, so that a corrupted pack cannot make us read past the record */
+bool validRecord(const RecordHeader &record)
+{
+    if (record.format <= QImage::Format_Invalid || record.format >= QImage::NImageFormats || record.width == 0 || record.height == 0 ||
+        record.width > 0x7fff || record.height > 0x7fff) {
+        return false;
+    }
+    const quint64 minimumLine = (quint64(record.width) * QImage::toPixelFormat(QImage::Format(record.format)).bitsPerPixel() + 7) / 8;
+    if (record.bytesPerLine < minimumLine) {
+        return false;
+    }
+    // Compressed records are checked once inflated
+    return (record.flags & compressedFlag) != 0u || quint64(record.bytesPerLine) * record.height <= record.size;
+}
+} // namespace
+
+ThumbnailPack::ThumbnailPack(const QString &path)
+    : m_file(path)
+{
+}
+
+ThumbnailPack::~ThumbnailPack()
+{
+    unmap();
+}
+
+// static
+const QString ThumbnailPack::extension()
+{
+    return QStringLiteral(".kthumbs");
+}
+
+const QString ThumbnailPack::path() const
+{
+    return m_file.fileName();
+}
+
+void ThumbnailPack::unmap()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_mappedSize = 0;
+}
+
+bool ThumbnailPack::remap()
+{
+    unmap();
+    m_mappedSize = m_file.size();
+    if (m_mappedSize == 0) {
+        return true;
+    }
+    m_data = m_file.map(0, m_mappedSize);
+    if (m_data == nullptr) {
+        qDebug() << "// Cannot map thumbnail pack" << m_file.fileName() << m_file.errorString();
+        m_mappedSize = 0;
+        return false;
+    }
+    return true;
+}
+
+bool ThumbnailPack::load()
+{
+    if (m_loaded) {
+        return true;
+    }
+    if (m_missing) {
+        return false;
+    }
+    if (!m_file.exists() || !m_file.open(QIODevice::ReadWrite)) {
+        m_missing = true;
+        return false;
+    }
+    PackHeader header;
+    if (m_file.size() < qint64(sizeof(PackHeader)) || m_file.read(reinterpret_cast<char *>(&header), sizeof(PackHeader)) != sizeof(PackHeader) ||
+        header.magic != packMagic || header.version != packVersion) {
+        // Unknown or broken pack, start from scratch
+        qDebug() << "// Discarding invalid thumbnail pack" << m_file.fileName();
+        header = {packMagic, packVersion};
+        m_file.resize(0);
+        m_file.seek(0);
+        m_file.write(reinterpret_cast<const char *>(&header), sizeof(PackHeader));
+        m_file.flush();
+    }
+    if (!remap()) {
+        m_file.close();
+        return false;
+    }
+    // Walk the record headers to build the index
+    std::vector<std::pair<int, qint64>> entries;
+    qint64 offset = sizeof(PackHeader);
+    while (offset + qint64(sizeof(RecordHeader)) <= m_mappedSize) {
+        RecordHeader record;
+        memcpy(&record, m_data + offset, sizeof(RecordHeader));
+        if (record.magic != recordMagic || offset + qint64(sizeof(RecordHeader)) + record.size > m_mappedSize) {
+            break;
+        }
+        entries.emplace_back(record.pos, offset);
+        offset += qint64(sizeof(RecordHeader)) + record.size;
+    }
+    if (offset < m_mappedSize) {
+        // Truncated write (crash during save), drop the incomplete tail
+        unmap();
+        m_file.resize(offset);
+        remap();
+    }
+    // Keep only the last record for each frame
+    std::stable_sort(entries.begin(), entries.end(), [](const std::pair<int, qint64> &a, const std::pair<int, qint64> &b) { return a.first < b.first; });
+    m_index.clear();
+    m_index.reserve(entries.size());
+    for (const auto &entry : entries) {
+        if (!m_index.empty() && m_index.back().first == entry.first) {
+            m_index.back().second = entry.second;
+        } else {
+            m_index.push_back(entry);
+        }
+    }
+    m_loaded = true;
+    return true;
+}
+
+bool ThumbnailPack::exists()
+{
+    return load();
+}
+
+bool ThumbnailPack::contains(int pos)
+{
+    if (!load()) {
+        return false;
+    }
+    auto it = std::lower_bound(m_index.cbegin(), m_index.cend(), pos, [](const std::pair<int, qint64> &entry, int p) { return entry.first < p; });
+    return it != m_index.cend() && it->first == pos;
+}
+
+QImage ThumbnailPack::image(int pos)
+{
+    if (!load()) {
+        return QImage();
+    }
+    auto it = std::lower_bound(m_index.cbegin(), m_index.cend(), pos, [](const std::pair<int, qint64> &entry, int p) { return entry.first < p; });
+    if (it == m_index.cend() || it->first != pos) {
+        return QImage();
+    }
+    qint64 offset = it->second;
+    if (offset + qint64(sizeof(RecordHeader)) > m_mappedSize) {
+        // The record was appended after the file was mapped
+        remap();
+    }
+    RecordHeader record;
+    if (offset + qint64(sizeof(RecordHeader)) <= m_mappedSize) {
+        memcpy(&record, m_data + offset, sizeof(RecordHeader));
+        if (offset + qint64(sizeof(RecordHeader)) + record.size > m_mappedSize) {
+            remap();
+        }
+    }
+    if (offset + qint64(sizeof(RecordHeader)) > m_mappedSize || offset + qint64(sizeof(RecordHeader)) + record.size > m_mappedSize ||
+        record.magic != recordMagic || !validRecord(record)) {
+        qDebug() << "// Corrupted thumbnail in pack" << m_file.fileName() << pos;
+        remove();
+        return QImage();
+    }
+    const uchar *source = m_data + offset + sizeof(RecordHeader);
+    QByteArray inflated;
+    if ((record.flags & compressedFlag) != 0u) {
+        inflated = qUncompress(source, int(record.size));
+        source = reinterpret_cast<const uchar *>(inflated.constData());
+        if (quint64(inflated.size()) < quint64(record.bytesPerLine) * record.height) {
+            qDebug() << "// Corrupted thumbnail in pack" << m_file.fileName() << pos;
+            remove();
+            return QImage();
+        }
+    }
+    QImage result(int(record.width), int(record.height), QImage::Format(record.format));
+    if (result.isNull()) {
+        return QImage();
+    }
+    const int lineSize = qMin(int(record.bytesPerLine), result.bytesPerLine());
+    for (int y = 0; y < result.height(); ++y) {
+        memcpy(result.scanLine(y), source + size_t(y) * record.bytesPerLine, size_t(lineSize));
+    }
+    return result;
+}
+
+bool ThumbnailPack::store(int pos, const QImage &img)
+{
+    if (img.isNull()) {
+        return false;
+    }
+    if (!load()) {
+        // Create a new pack
+        if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            qDebug() << "// Cannot create thumbnail pack" << m_file.fileName() << m_file.errorString();
+            return false;
+        }
+        PackHeader header{packMagic, packVersion};
+        m_file.write(reinterpret_cast<const char *>(&header), sizeof(PackHeader));
+        m_index.clear();
+        m_loaded = true;
+        m_missing = false;
+    }
+    const auto bytes = int(img.sizeInBytes());
+    // Thumbnails are small, a fast deflate pass roughly halves them and is still much cheaper to read back than a png
+    QByteArray packed = qCompress(img.constBits(), bytes, 1);
+    bool compressed = packed.size() < bytes - bytes / 4;
+    RecordHeader record{recordMagic, pos, quint32(img.width()), quint32(img.height()), quint32(img.bytesPerLine()), quint32(img.format()),
+                        compressed ? compressedFlag : 0u, quint32(compressed ? packed.size() : bytes)};
+    qint64 offset = m_file.size();
+    m_file.seek(offset);
+    bool ok = m_file.write(reinterpret_cast<const char *>(&record), sizeof(RecordHeader)) == sizeof(RecordHeader);
+    if (ok) {
+        if (compressed) {
+            ok = m_file.write(packed) == packed.size();
+        } else {
+            ok = m_file.write(reinterpret_cast<const char *>(img.constBits()), bytes) == bytes;
+        }
+    }
+    if (!ok || !m_file.flush()) {
+        qDebug() << "// Error writing thumbnail pack" << m_file.fileName() << m_file.errorString();
+        unmap();
+        m_file.resize(offset);
+        return false;
+    }
+    auto it = std::lower_bound(m_index.begin(), m_index.end(), pos, [](const std::pair<int, qint64> &entry, int p) { return entry.first < p; });
+    if (it != m_index.end() && it->first == pos) {
+        it->second = offset;
+    } else {
+        m_index.insert(it, {pos, offset});
+    }
+    return true;
+}
+
+std::vector<int> ThumbnailPack::positions()
+{
+    std::vector<int> result;
+    if (!load()) {
+        return result;
+    }
+    result.reserve(m_index.size());
+    for (const auto &entry : m_index) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+int ThumbnailPack::count()
+{
+    return load() ? int(m_index.size()) : 0;
+}
+
+int ThumbnailPack::importFiles(const std::vector<std::pair<int, QString>> &files)
+{
+    int imported = 0;
+    for (const auto &file : files) {
+        if (!contains(file.first)) {
+            QImage img(file.second);
+            if (img.isNull() || !store(file.first, img)) {
+                // Keep the file, it will be imported again next time
+                continue;
+            }
+            imported++;
+        }
+        QFile::remove(file.second);
+    }
+    return imported;
+}
+
+void ThumbnailPack::remove()
+{
+    unmap();
+    m_file.close();
+    m_file.remove();
+    m_index.clear();
+    m_loaded = false;
+    m_missing = true;
+}
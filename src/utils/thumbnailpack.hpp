@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#pragma once
+
+#include <QFile>
+#include <QImage>
+#include <QString>
+#include <utility>
+#include <vector>
+
+/** @brief This class stores all the persistent thumbnails of a clip in a single file.
+    The file is an append-only list of records, each holding a frame position, the image geometry and the raw or zlib compressed
+    pixels. When opening the pack, the record headers are walked once through a memory map to build a sorted index, so
+    lookups are a binary search followed by a copy (or inflate) of the pixels, without any filesystem access.
+    Storing an already existing position appends a new record that supersedes the previous one.
+ */
+class ThumbnailPack
+{
+public:
+    explicit ThumbnailPack(const QString &path);
+    ~ThumbnailPack();
+
+    /* @brief Returns true if the pack file exists and is open.
+       A missing file is only looked for once, the pack then stays empty until something is stored in it */
+    bool exists();
+
+    /* @brief Returns true if the pack contains a thumbnail for the given frame */
+    bool contains(int pos);
+
+    /* @brief Returns the thumbnail stored for the given frame, or a null image. A corrupted record makes the whole pack be deleted */
+    QImage image(int pos);
+
+    /* @brief Append a thumbnail to the pack, returns false on write error */
+    bool store(int pos, const QImage &img);
+
+    /* @brief Returns the sorted list of frames stored in the pack */
+    std::vector<int> positions();
+
+    /* @brief Number of thumbnails in the pack */
+    int count();
+
+    /* @brief Import legacy one-file-per-frame thumbnails into the pack. The files are deleted once stored, or if the pack already has their frame.
+       @param files is a list of (frame, png file path)
+       @return the number of imported thumbnails
+    */
+    int importFiles(const std::vector<std::pair<int, QString>> &files);
+
+    /* @brief Delete the pack file and reset the index */
+    void remove();
+
+    /* @brief Path of the pack file */
+    const QString path() const;
+
+    /* @brief Extension of the pack files in the thumbnails cache dir */
+    static const QString extension();
+
+private:
+    /* @brief Open and map the pack file, building the index. Returns false if the file does not exist or is invalid */
+    bool load();
+    /* @brief Map the whole file for reading */
+    bool remap();
+    void unmap();
+
+    QFile m_file;
+    uchar *m_data{nullptr};
+    qint64 m_mappedSize{0};
+    bool m_loaded{false};
+    /* @brief The file was found missing, or removed */
+    bool m_missing{false};
+    /* @brief index of the pack: sorted (frame, record offset) pairs */
+    std::vector<std::pair<int, qint64>> m_index;
+};
@@ -0,0 +1,368 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#include "thumbnailscheduler.hpp"
+#include "bin/projectclip.h"
+#include "bin/projectitemmodel.h"
+#include "core.h"
+#include "doc/kthumb.h"
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltProducer.h>
+#include <mlt++/MltProfile.h>
+
+std::unique_ptr<ThumbnailScheduler> ThumbnailScheduler::instance;
+std::once_flag ThumbnailScheduler::m_onceFlag;
+
+class ThumbnailScheduler::Request
+{
+public:
+    QString binId;
+    int frame = 0;
+    int tolerance = 0;
+    // Frame that will be decoded
+    int target = 0;
+    Callback callback;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> finished{false};
+
+    void finish(const QImage &image, int decoded)
+    {
+        if (!finished.exchange(true)) {
+            callback(image, decoded);
+        }
+    }
+};
+
+class ThumbnailTask : public QRunnable
+{
+public:
+    ThumbnailTask(ThumbnailScheduler *scheduler, QString binId)
+        : m_scheduler(scheduler)
+        , m_binId(std::move(binId))
+    {
+    }
+
+    void run() override { m_scheduler->process(m_binId); }
+
+private:
+    ThumbnailScheduler *m_scheduler;
+    QString m_binId;
+};
+
+std::unique_ptr<ThumbnailScheduler> &ThumbnailScheduler::get()
+{
+    std::call_once(m_onceFlag, [] { instance.reset(new ThumbnailScheduler()); });
+    return instance;
+}
+
+ThumbnailScheduler::ThumbnailScheduler(SourceFactory factory, int poolSize, int maxIdle)
+    : m_factory(factory ? std::move(factory) : SourceFactory(&ThumbnailScheduler::clipSource))
+    , m_poolSize(qMax(1, poolSize))
+    , m_maxIdle(qMax(0, maxIdle))
+    , m_batchSize(8)
+{
+    // Decoders already use several threads each
+    m_threads.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+ThumbnailScheduler::~ThumbnailScheduler()
+{
+    std::vector<std::shared_ptr<Request>> dropped;
+    m_mutex.lock();
+    for (auto &clip : m_clips) {
+        for (auto &req : clip.second.pending) {
+            req->cancelled = true;
+            dropped.push_back(req);
+        }
+        clip.second.pending.clear();
+    }
+    m_mutex.unlock();
+    for (auto &req : dropped) {
+        req->finish(QImage(), req->frame);
+    }
+    m_threads.waitForDone();
+}
+
+ThumbnailScheduler::Source ThumbnailScheduler::clipSource(const QString &binId)
+{
+    Source source;
+    std::shared_ptr<ProjectClip> binClip = pCore->projectItemModel()->getClipByBinID(binId);
+    if (!binClip) {
+        return source;
+    }
+    std::shared_ptr<Mlt::Producer> producer = binClip->createThumbProducer();
+    if (!producer || !producer->is_valid()) {
+        return source;
+    }
+    const int lastFrame = qMax(0, producer->get_length() - 1);
+    source.decode = [producer, lastFrame](int frameNumber) {
+        producer->seek(qBound(0, frameNumber, lastFrame));
+        QScopedPointer<Mlt::Frame> frame(producer->get_frame());
+        if (frame == nullptr || !frame->is_valid()) {
+            return QImage();
+        }
+        int imageHeight = pCore->thumbProfile()->height();
+        int imageWidth = pCore->thumbProfile()->width();
+        int fullWidth = int(imageHeight * pCore->getCurrentDar() + 0.5);
+        return KThumb::getFrame(frame.data(), imageWidth, imageHeight, fullWidth, true);
+    };
+    return source;
+}
+
+std::shared_ptr<ThumbnailScheduler::Request> ThumbnailScheduler::request(const QString &binId, int frame, int tolerance, Callback callback)
+{
+    auto req = std::make_shared<Request>();
+    req->binId = binId;
+    req->frame = qMax(0, frame);
+    req->target = req->frame;
+    req->tolerance = qMax(0, tolerance);
+    req->callback = std::move(callback);
+    QMutexLocker lock(&m_mutex);
+    m_stats.requests++;
+    ClipQueue &clip = m_clips[binId];
+    clip.pending.push_back(req);
+    dispatch(binId, clip);
+    return req;
+}
+
+void ThumbnailScheduler::cancel(const std::shared_ptr<Request> &request)
+{
+    if (!request || request->finished) {
+        return;
+    }
+    request->cancelled = true;
+    QMutexLocker lock(&m_mutex);
+    m_stats.cancelled++;
+    auto it = m_clips.find(request->binId);
+    if (it == m_clips.end()) {
+        return;
+    }
+    ClipQueue &clip = it->second;
+    auto found = std::find(clip.pending.begin(), clip.pending.end(), request);
+    if (found == clip.pending.end()) {
+        // Being decoded, the worker will finish it
+        return;
+    }
+    clip.pending.erase(found);
+    if (clip.pending.empty() && clip.running == 0 && clip.idle.empty()) {
+        m_clips.erase(it);
+    }
+    lock.unlock();
+    request->finish(QImage(), request->frame);
+}
+
+void ThumbnailScheduler::invalidate(const QString &binId)
+{
+    std::vector<Decoder> released;
+    QMutexLocker lock(&m_mutex);
+    auto it = m_clips.find(binId);
+    if (it == m_clips.end()) {
+        return;
+    }
+    ClipQueue &clip = it->second;
+    clip.generation++;
+    released.swap(clip.idle);
+    clip.sources -= int(released.size());
+    m_stats.sources -= int(released.size());
+    m_stats.idle -= int(released.size());
+    if (clip.pending.empty() && clip.running == 0) {
+        m_clips.erase(it);
+    }
+    // The producers are closed once unlocked
+    lock.unlock();
+}
+
+void ThumbnailScheduler::waitForDone()
+{
+    m_threads.waitForDone();
+}
+
+void ThumbnailScheduler::dispatch(const QString &binId, ClipQueue &clip)
+{
+    // One worker per batch of pending requests, up to the pool size
+    while (clip.running < m_poolSize && clip.running * m_batchSize < int(clip.pending.size())) {
+        clip.running++;
+        m_threads.start(new ThumbnailTask(this, binId));
+    }
+}
+
+std::vector<std::shared_ptr<ThumbnailScheduler::Request>> ThumbnailScheduler::takeBatch(ClipQueue &clip, const Decoder &decoder)
+{
+    auto &pending = clip.pending;
+    // Decode order
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const std::shared_ptr<Request> &a, const std::shared_ptr<Request> &b) { return a->target < b->target; });
+    // Requests accepting the frame of the previous one share its image
+    for (size_t i = 1; i < pending.size(); ++i) {
+        Request &req = *pending[i];
+        const int previous = pending[i - 1]->target;
+        if (req.target != previous && qAbs(req.frame - previous) <= req.tolerance) {
+            req.target = previous;
+        }
+    }
+    // Continue forward from the last decoded frame
+    auto start = std::lower_bound(pending.begin(), pending.end(), decoder.position,
+                                  [](const std::shared_ptr<Request> &req, int position) { return req->target < position; });
+    if (start == pending.end()) {
+        start = pending.begin();
+    }
+    auto end = start;
+    int frames = 0;
+    int last = INT_MIN;
+    while (end != pending.end()) {
+        if ((*end)->target != last) {
+            if (frames == m_batchSize) {
+                break;
+            }
+            frames++;
+            last = (*end)->target;
+        }
+        ++end;
+    }
+    std::vector<std::shared_ptr<Request>> batch(start, end);
+    pending.erase(start, end);
+    return batch;
+}
+
+void ThumbnailScheduler::process(const QString &binId)
+{
+    QMutexLocker lock(&m_mutex);
+    // The queue is not erased while it has running workers
+    ClipQueue &clip = m_clips[binId];
+    Decoder decoder;
+    bool hasDecoder = false;
+    if (!clip.idle.empty()) {
+        decoder = std::move(clip.idle.back());
+        clip.idle.pop_back();
+        m_stats.idle--;
+        hasDecoder = true;
+    } else if (!clip.pending.empty()) {
+        decoder.generation = clip.generation;
+        clip.sources++;
+        m_stats.sources++;
+        hasDecoder = true;
+        lock.unlock();
+        decoder.source = m_factory(binId);
+        lock.relock();
+    }
+    while (hasDecoder && !clip.pending.empty() && decoder.generation == clip.generation) {
+        std::vector<std::shared_ptr<Request>> batch = takeBatch(clip, decoder);
+        m_stats.batches++;
+        lock.unlock();
+        QImage image;
+        int decoded = -1;
+        qint64 decodedCount = 0;
+        qint64 coalesced = 0;
+        for (const auto &req : batch) {
+            if (req->cancelled) {
+                req->finish(QImage(), req->frame);
+                continue;
+            }
+            if (req->target != decoded) {
+                image = decoder.source.decode ? decoder.source.decode(req->target) : QImage();
+                decoded = req->target;
+                decoder.position = decoded;
+                decodedCount++;
+            } else {
+                coalesced++;
+            }
+            req->finish(image, decoded);
+        }
+        lock.relock();
+        m_stats.decoded += decodedCount;
+        m_stats.coalesced += coalesced;
+    }
+    Decoder released;
+    std::vector<Decoder> evicted;
+    if (hasDecoder) {
+        if (decoder.source.decode && decoder.generation == clip.generation) {
+            decoder.lastUse = ++m_useCounter;
+            clip.idle.push_back(std::move(decoder));
+            m_stats.idle++;
+            evictIdle(evicted);
+        } else {
+            clip.sources--;
+            m_stats.sources--;
+            released = std::move(decoder);
+        }
+    }
+    clip.running--;
+    if (!clip.pending.empty()) {
+        dispatch(binId, clip);
+    } else if (clip.running == 0 && clip.idle.empty()) {
+        m_clips.erase(binId);
+    }
+    // The released producers are closed once unlocked
+    lock.unlock();
+}
+
+void ThumbnailScheduler::evictIdle(std::vector<Decoder> &released)
+{
+    while (m_stats.idle > m_maxIdle) {
+        auto oldestClip = m_clips.end();
+        size_t oldest = 0;
+        for (auto it = m_clips.begin(); it != m_clips.end(); ++it) {
+            const std::vector<Decoder> &idle = it->second.idle;
+            for (size_t i = 0; i < idle.size(); ++i) {
+                if (oldestClip == m_clips.end() || idle[i].lastUse < oldestClip->second.idle[oldest].lastUse) {
+                    oldestClip = it;
+                    oldest = i;
+                }
+            }
+        }
+        if (oldestClip == m_clips.end()) {
+            break;
+        }
+        ClipQueue &clip = oldestClip->second;
+        released.push_back(std::move(clip.idle[oldest]));
+        clip.idle.erase(clip.idle.begin() + long(oldest));
+        clip.sources--;
+        m_stats.sources--;
+        m_stats.idle--;
+        m_stats.evicted++;
+        // A clip with a worker running is not erased, its worker is using it
+        if (clip.pending.empty() && clip.running == 0 && clip.idle.empty()) {
+            m_clips.erase(oldestClip);
+        }
+    }
+}
+
+ThumbnailScheduler::Stats ThumbnailScheduler::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+void ThumbnailScheduler::resetStats()
+{
+    QMutexLocker lock(&m_mutex);
+    const int sources = m_stats.sources;
+    const int idle = m_stats.idle;
+    m_stats = Stats();
+    m_stats.sources = sources;
+    m_stats.idle = idle;
+}
@@ -0,0 +1,149 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include "definitions.h"
+#include <QImage>
+#include <QMutex>
+#include <QThreadPool>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/** @brief This class extracts the clip thumbnails requested by the timeline.
+    Requests are queued per clip and decoded in batches sorted by frame, so that a decoder moving forward in a clip
+    continues from its current position instead of seeking back to the previous keyframe for each thumbnail.
+    A request can accept a frame close to the requested one: it is then merged with a queued request for a close frame,
+    and requests for the same frame are decoded once.
+    Each clip is decoded by a small pool of producers, and cancelled requests are dropped before being decoded.
+    Idle producers are kept open for the next requests, up to a global limit after which the least recently used are closed.
+ * Note that this class is a Singleton
+ */
+
+class ThumbnailScheduler
+{
+
+public:
+    // Returns the instance of the Singleton
+    static std::unique_ptr<ThumbnailScheduler> &get();
+    ~ThumbnailScheduler();
+
+    /* @brief A decoder for a clip */
+    struct Source
+    {
+        // Returns the image of a frame, or a null image on failure
+        std::function<QImage(int)> decode;
+    };
+    using SourceFactory = std::function<Source(const QString &binId)>;
+    /* @brief Called once per request, from a worker thread, with the decoded image and the frame it shows.
+       The image is null if the request was cancelled or the decoding failed
+     */
+    using Callback = std::function<void(const QImage &image, int frame)>;
+    class Request;
+
+    /* @brief Queue the thumbnail of a clip
+       @param binId is the id of the clip
+       @param frame is the requested frame
+       @param tolerance is the maximum distance to @param frame of the decoded frame
+     */
+    std::shared_ptr<Request> request(const QString &binId, int frame, int tolerance, Callback callback);
+
+    /* @brief Drop a request. Its callback is called now if it is not being decoded, or as soon as it is decoded otherwise */
+    void cancel(const std::shared_ptr<Request> &request);
+
+    /* @brief Release the producers of a clip, because it was reloaded or deleted */
+    void invalidate(const QString &binId);
+
+    /* @brief Wait until all queued requests are processed */
+    void waitForDone();
+
+    struct Stats
+    {
+        qint64 requests = 0;
+        // Images decoded, and requests served by an image decoded for another one
+        qint64 decoded = 0;
+        qint64 coalesced = 0;
+        qint64 cancelled = 0;
+        qint64 batches = 0;
+        // Producers currently open, and the ones among them waiting for requests
+        int sources = 0;
+        int idle = 0;
+        // Idle producers closed to stay within the limit
+        qint64 evicted = 0;
+    };
+    Stats stats() const;
+    void resetStats();
+
+protected:
+    // Constructor is protected because class is a Singleton
+    explicit ThumbnailScheduler(SourceFactory factory = SourceFactory(), int poolSize = 2, int maxIdle = 8);
+
+    // Create a thumbnail producer for a bin clip
+    static Source clipSource(const QString &binId);
+
+    struct Decoder
+    {
+        Source source;
+        // Last decoded frame
+        int position = -1;
+        int generation = 0;
+        // Value of m_useCounter when it became idle
+        qint64 lastUse = 0;
+    };
+    struct ClipQueue
+    {
+        std::vector<std::shared_ptr<Request>> pending;
+        std::vector<Decoder> idle;
+        int sources = 0;
+        int running = 0;
+        // Increased when the clip is invalidated, so that the producers in use are not reused
+        int generation = 0;
+    };
+    friend class ThumbnailTask;
+
+    // Start workers for a clip as long as the pool allows. m_mutex must be locked
+    void dispatch(const QString &binId, ClipQueue &clip);
+    // Worker loop decoding the pending requests of a clip
+    void process(const QString &binId);
+    // Remove the next requests to decode from the queue, the ones closest after @param position. m_mutex must be locked
+    std::vector<std::shared_ptr<Request>> takeBatch(ClipQueue &clip, const Decoder &decoder);
+    // Move the least recently used idle producers to @param released until there are at most m_maxIdle. m_mutex must be locked
+    void evictIdle(std::vector<Decoder> &released);
+
+    static std::unique_ptr<ThumbnailScheduler> instance;
+    static std::once_flag m_onceFlag; // flag to create the scheduler only once;
+
+    SourceFactory m_factory;
+    int m_poolSize;
+    // Maximum number of idle producers for all clips
+    int m_maxIdle;
+    qint64 m_useCounter = 0;
+    // Number of frames decoded before checking the queue again
+    int m_batchSize;
+    QThreadPool m_threads;
+    mutable QMutex m_mutex;
+    std::unordered_map<QString, ClipQueue> m_clips;
+    Stats m_stats;
+};
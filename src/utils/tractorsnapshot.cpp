@@ -0,0 +1,178 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#include "tractorsnapshot.hpp"
+#include "kdenlive_debug.h"
+#include <mlt++/Mlt.h>
+#include <vector>
+
+namespace {
+// Recreates the filters attached to @param source on @param target
+bool copyFilters(Mlt::Profile &profile, Mlt::Service &source, Mlt::Service &target)
+{
+    for (int i = 0; i < source.filter_count(); ++i) {
+        std::unique_ptr<Mlt::Filter> filter(source.filter(i));
+        if (!filter || !filter->is_valid() || filter->get_int("_loader") == 1) {
+            // Filters added by the loader are not saved
+            continue;
+        }
+        Mlt::Filter filterCopy(profile, filter->get("mlt_service"));
+        if (!filterCopy.is_valid()) {
+            qCDebug(KDENLIVE_LOG) << "Cannot copy filter" << filter->get("mlt_service");
+            return false;
+        }
+        filterCopy.inherit(*filter.get());
+        target.attach(filterCopy);
+    }
+    return true;
+}
+
+std::unique_ptr<Mlt::Producer> copyPlaylist(Mlt::Profile &profile, Mlt::Producer &producer)
+{
+    Mlt::Playlist playlist(producer);
+    std::unique_ptr<Mlt::Playlist> playlistCopy(new Mlt::Playlist(profile));
+    playlistCopy->inherit(playlist);
+    for (int i = 0; i < playlist.count(); ++i) {
+        std::unique_ptr<Mlt::ClipInfo> info(playlist.clip_info(i));
+        if (playlist.is_blank(i)) {
+            playlistCopy->blank(info->frame_count - 1);
+            continue;
+        }
+        // The cut is recreated from the master producer, which is shared
+        std::unique_ptr<Mlt::Producer> cut(info->producer->cut(info->frame_in, info->frame_out));
+        cut->inherit(*info->cut);
+        if (!copyFilters(profile, *info->cut, *cut.get())) {
+            return nullptr;
+        }
+        playlistCopy->append(*cut.get());
+    }
+    if (!copyFilters(profile, playlist, *playlistCopy.get())) {
+        return nullptr;
+    }
+    return playlistCopy;
+}
+
+std::unique_ptr<Mlt::Producer> copyTractor(Mlt::Profile &profile, Mlt::Producer &producer)
+{
+    Mlt::Tractor tractor(producer);
+    std::unique_ptr<Mlt::Tractor> tractorCopy(new Mlt::Tractor(profile));
+    tractorCopy->inherit(tractor);
+    for (int i = 0; i < tractor.count(); ++i) {
+        std::unique_ptr<Mlt::Producer> track(tractor.track(i));
+        std::unique_ptr<Mlt::Producer> trackCopy = TractorSnapshot::copy(profile, *track.get());
+        if (!trackCopy) {
+            return nullptr;
+        }
+        tractorCopy->set_track(*trackCopy.get(), i);
+    }
+    // Services kept in the xml without being used, like the bin playlist
+    Mlt::Properties properties(tractor.get_properties());
+    for (int i = 0; i < properties.count(); ++i) {
+        const QString name(properties.get_name(i));
+        if (!name.startsWith(QLatin1String("xml_retain"))) {
+            continue;
+        }
+        int size = 0;
+        auto service = static_cast<mlt_service>(properties.get_data(i, size));
+        if (service == nullptr) {
+            continue;
+        }
+        Mlt::Producer retained((mlt_producer)service);
+        std::unique_ptr<Mlt::Producer> retainedCopy = TractorSnapshot::copy(profile, retained);
+        if (!retainedCopy) {
+            return nullptr;
+        }
+        retainedCopy->inc_ref();
+        tractorCopy->set(name.toUtf8().constData(), retainedCopy->get_service(), 0, (mlt_destructor)mlt_service_close);
+    }
+    // Walk the field from the last planted service, then plant the copies in the original order
+    std::vector<std::unique_ptr<Mlt::Service>> planted;
+    std::unique_ptr<Mlt::Field> field(tractor.field());
+    std::unique_ptr<Mlt::Service> service(field->producer());
+    while (service && service->is_valid()) {
+        std::unique_ptr<Mlt::Service> next(service->producer());
+        if (service->type() == transition_type || service->type() == filter_type) {
+            planted.push_back(std::move(service));
+        }
+        service = std::move(next);
+    }
+    for (auto it = planted.rbegin(); it != planted.rend(); ++it) {
+        if ((*it)->type() == transition_type) {
+            Mlt::Transition transition((mlt_transition)(*it)->get_service());
+            Mlt::Transition transitionCopy(profile, transition.get("mlt_service"));
+            if (!transitionCopy.is_valid()) {
+                qCDebug(KDENLIVE_LOG) << "Cannot copy transition" << transition.get("mlt_service");
+                return nullptr;
+            }
+            transitionCopy.inherit(transition);
+            tractorCopy->plant_transition(transitionCopy, transition.get_a_track(), transition.get_b_track());
+        } else {
+            Mlt::Filter filter((mlt_filter)(*it)->get_service());
+            Mlt::Filter filterCopy(profile, filter.get("mlt_service"));
+            if (!filterCopy.is_valid()) {
+                qCDebug(KDENLIVE_LOG) << "Cannot copy filter" << filter.get("mlt_service");
+                return nullptr;
+            }
+            filterCopy.inherit(filter);
+            tractorCopy->plant_filter(filterCopy, filter.get_track());
+        }
+    }
+    if (!copyFilters(profile, tractor, *tractorCopy.get())) {
+        return nullptr;
+    }
+    return tractorCopy;
+}
+} // namespace
+
+std::unique_ptr<Mlt::Producer> TractorSnapshot::copy(Mlt::Profile &profile, Mlt::Producer &producer)
+{
+    if (!producer.is_cut()) {
+        switch (producer.type()) {
+        case tractor_type:
+            return copyTractor(profile, producer);
+        case playlist_type:
+            return copyPlaylist(profile, producer);
+        default:
+            break;
+        }
+    }
+    return std::unique_ptr<Mlt::Producer>(new Mlt::Producer(producer));
+}
+
+QString TractorSnapshot::sceneList(Mlt::Profile &profile, Mlt::Producer &producer, const QString &root, const QString &fullPath)
+{
+    Mlt::Consumer xmlConsumer(profile, "xml", fullPath.isEmpty() ? "kdenlive_playlist" : fullPath.toUtf8().constData());
+    if (!root.isEmpty()) {
+        xmlConsumer.set("root", root.toUtf8().constData());
+    }
+    if (!xmlConsumer.is_valid()) {
+        return QString();
+    }
+    xmlConsumer.set("store", "kdenlive");
+    xmlConsumer.set("time_format", "clock");
+    // Disabling meta creates cleaner files, but then we don't have access to metadata on the fly (meta channels, etc)
+    // And we must use "avformat" instead of "avformat-novalidate" on project loading which causes a big delay on project opening
+    // xmlConsumer.set("no_meta", 1);
+    xmlConsumer.connect(producer);
+    xmlConsumer.run();
+    return fullPath.isEmpty() ? QString::fromUtf8(xmlConsumer.get("kdenlive_playlist")) : fullPath;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright (C) 2020 by Jean-Baptiste Mardelle (jb@kdenlive.org)        *
+ *   This file is part of Kdenlive. See www.kdenlive.org.                  *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) version 3 or any later version accepted by the       *
+ *   membership of KDE e.V. (or its successor approved  by the membership  *
+ *   of KDE e.V.), which shall act as a proxy defined in Section 14 of     *
+ *   version 3 of the license.                                             *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+
+#pragma once
+
+#include <QString>
+#include <memory>
+
+namespace Mlt {
+class Producer;
+class Profile;
+} // namespace Mlt
+
+/** @namespace TractorSnapshot
+    @brief Copies the structure of a timeline so that it can be serialized from another thread while the original is edited.
+    Tractors, playlists, clip cuts, filters and transitions are recreated, while the master producers of the clips are shared with the original.
+ */
+namespace TractorSnapshot {
+/** @brief Returns a copy of @param producer, recreating tractors and playlists and the cuts they contain.
+    Any other producer is returned as a new reference to the same service.
+    This must be called from the thread that edits @param producer.
+    @return the copy, or nullptr if a filter or transition could not be recreated
+ */
+std::unique_ptr<Mlt::Producer> copy(Mlt::Profile &profile, Mlt::Producer &producer);
+
+/** @brief Serializes @param producer to the Kdenlive xml format
+    @param root is the folder that paths are made relative to, if not empty
+    @param fullPath is the file to write the xml to. If it is empty, the xml is returned instead
+    @return the xml, or @param fullPath, or an empty string if the xml consumer could not be created
+ */
+QString sceneList(Mlt::Profile &profile, Mlt::Producer &producer, const QString &root, const QString &fullPath = QString());
+} // namespace TractorSnapshot
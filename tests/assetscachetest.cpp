@@ -0,0 +1,151 @@
+#include "test_utils.hpp"
+
+#include "assets/assetscache.hpp"
+
+#include <QDataStream>
+#include <QDomElement>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace {
+bool sameXml(const QDomElement &a, const QDomElement &b)
+{
+    if (a.tagName() != b.tagName() || a.attributes().count() != b.attributes().count() || a.text() != b.text()) {
+        return false;
+    }
+    // Attribute order is not preserved
+    QDomNamedNodeMap attributes = a.attributes();
+    for (int i = 0; i < attributes.count(); ++i) {
+        QDomAttr attr = attributes.item(i).toAttr();
+        if (b.attribute(attr.name()) != attr.value()) {
+            return false;
+        }
+    }
+    QDomElement childA = a.firstChildElement();
+    QDomElement childB = b.firstChildElement();
+    while (!childA.isNull() && !childB.isNull()) {
+        if (!sameXml(childA, childB)) {
+            return false;
+        }
+        childA = childA.nextSiblingElement();
+        childB = childB.nextSiblingElement();
+    }
+    return childA.isNull() && childB.isNull();
+}
+
+template <class Repository> void compareRepositories(const Repository &parsed, const Repository &cached)
+{
+    REQUIRE(parsed.m_assets.size() == cached.m_assets.size());
+    for (const auto &asset : parsed.m_assets) {
+        INFO("Asset " << asset.first.toStdString());
+        REQUIRE(cached.m_assets.count(asset.first) == 1);
+        const auto &info = cached.m_assets.at(asset.first);
+        REQUIRE(info.id == asset.second.id);
+        REQUIRE(info.mltId == asset.second.mltId);
+        REQUIRE(info.name == asset.second.name);
+        REQUIRE(info.description == asset.second.description);
+        REQUIRE(info.author == asset.second.author);
+        REQUIRE(info.version_str == asset.second.version_str);
+        REQUIRE(info.version == asset.second.version);
+        REQUIRE(info.type == asset.second.type);
+        REQUIRE(sameXml(info.xml, asset.second.xml));
+    }
+}
+} // namespace
+
+TEST_CASE("Assets cache", "[AssetsCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+
+    SECTION("Key changes with services and files")
+    {
+        const QString assetFile = dir.filePath(QStringLiteral("effect.xml"));
+        QFile file(assetFile);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("<effect tag=\"brightness\"/>");
+        file.close();
+        const QStringList services{QStringLiteral("brightness"), QStringLiteral("volume")};
+        const QByteArray key = AssetsCache::key(services, {assetFile});
+        REQUIRE(AssetsCache::key(services, {assetFile}) == key);
+        REQUIRE(AssetsCache::key({QStringLiteral("brightness")}, {assetFile}) != key);
+        REQUIRE(AssetsCache::key(services, {}) != key);
+        REQUIRE(file.open(QIODevice::Append));
+        file.write("\n");
+        file.close();
+        REQUIRE(AssetsCache::key(services, {assetFile}) != key);
+    }
+
+    SECTION("Data is only read back with the same key")
+    {
+        const QString cachePath = dir.filePath(QStringLiteral("test.cache"));
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << QStringLiteral("cached") << 42;
+        {
+            AssetsCache cache(QStringLiteral("test"));
+            cache.m_file.setFileName(cachePath);
+            REQUIRE(cache.save("key", data));
+        }
+        AssetsCache wrongKey(QStringLiteral("test"));
+        wrongKey.m_file.setFileName(cachePath);
+        REQUIRE(wrongKey.open("other key") == nullptr);
+
+        AssetsCache cache(QStringLiteral("test"));
+        cache.m_file.setFileName(cachePath);
+        QDataStream *cached = cache.open("key");
+        REQUIRE(cached != nullptr);
+        QString text;
+        int value = 0;
+        *cached >> text >> value;
+        REQUIRE(text == QLatin1String("cached"));
+        REQUIRE(value == 42);
+    }
+
+    SECTION("Missing cache")
+    {
+        AssetsCache cache(QStringLiteral("test"));
+        cache.m_file.setFileName(dir.filePath(QStringLiteral("missing.cache")));
+        REQUIRE(cache.open("key") == nullptr);
+    }
+}
+
+TEST_CASE("Assets repositories restored from cache", "[AssetsCache]")
+{
+    SECTION("Effects")
+    {
+        QFile::remove(AssetsCache(QStringLiteral("effects")).path());
+        std::unique_ptr<EffectsRepository> parsed(new EffectsRepository());
+        REQUIRE(QFile::exists(AssetsCache(QStringLiteral("effects")).path()));
+        std::unique_ptr<EffectsRepository> cached(new EffectsRepository());
+        compareRepositories(*parsed.get(), *cached.get());
+    }
+
+    SECTION("Transitions")
+    {
+        QFile::remove(AssetsCache(QStringLiteral("transitions")).path());
+        std::unique_ptr<TransitionsRepository> parsed(new TransitionsRepository());
+        REQUIRE(QFile::exists(AssetsCache(QStringLiteral("transitions")).path()));
+        std::unique_ptr<TransitionsRepository> cached(new TransitionsRepository());
+        compareRepositories(*parsed.get(), *cached.get());
+    }
+}
+
+TEST_CASE("Assets repository startup", "[.][Benchmark][AssetsCache]")
+{
+    for (bool warm : {false, true}) {
+        if (!warm) {
+            QFile::remove(AssetsCache(QStringLiteral("effects")).path());
+            QFile::remove(AssetsCache(QStringLiteral("transitions")).path());
+        }
+        QElapsedTimer timer;
+        timer.start();
+        std::unique_ptr<EffectsRepository> effects(new EffectsRepository());
+        const qint64 effectsTime = timer.restart();
+        std::unique_ptr<TransitionsRepository> transitions(new TransitionsRepository());
+        const qint64 transitionsTime = timer.elapsed();
+        WARN((warm ? "Cached: " : "Parsed: ") << effects->m_assets.size() << " effects in " << effectsTime << "ms, " << transitions->m_assets.size()
+                                              << " transitions in " << transitionsTime << "ms");
+    }
+}
@@ -0,0 +1,224 @@
+#include "catch.hpp"
+#include "lib/audio/audioLevelPyramid.h"
+#include "lib/audio/audioLevels.h"
+
+#include <QFile>
+#include <QImage>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTemporaryDir>
+#include <random>
+
+namespace {
+QVector<uint8_t> randomLevels(int frames, int channels)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    QVector<uint8_t> levels(frames * channels);
+    for (uint8_t &v : levels) {
+        v = uint8_t(dist(gen));
+    }
+    return levels;
+}
+} // namespace
+
+TEST_CASE("Audio level pyramid", "[AudioLevelPyramid]")
+{
+    const int channels = 2;
+    const int frames = 1001;
+    QVector<uint8_t> levels = randomLevels(frames, channels);
+    AudioLevelPyramid pyramid(levels, channels);
+    REQUIRE(pyramid.frames() == frames);
+    REQUIRE(pyramid.channels() == channels);
+    REQUIRE(pyramid.levels() == 11);
+
+    SECTION("Single frames match the base levels")
+    {
+        for (int f = 0; f < frames; f += 17) {
+            for (int c = 0; c < channels; ++c) {
+                AudioLevelPyramid::Sample s = pyramid.sample(f, f + 1, c);
+                REQUIRE(s.min == levels.at(f * channels + c));
+                REQUIRE(s.max == levels.at(f * channels + c));
+                REQUIRE(s.rms == levels.at(f * channels + c));
+            }
+        }
+    }
+
+    SECTION("Ranges cover at least the requested frames")
+    {
+        for (int length : {2, 3, 7, 64, 100, 1000}) {
+            for (int start = 0; start + length <= frames; start += 97) {
+                uint8_t min = 255, max = 0;
+                for (int f = start; f < start + length; ++f) {
+                    for (int c = 0; c < channels; ++c) {
+                        min = std::min(min, levels.at(f * channels + c));
+                        max = std::max(max, levels.at(f * channels + c));
+                    }
+                }
+                AudioLevelPyramid::Sample s = pyramid.sample(start, start + length);
+                // Buckets are aligned, so the summary may include a few neighbour frames
+                REQUIRE(s.max >= max);
+                REQUIRE(s.min <= min);
+                REQUIRE(s.rms <= s.max);
+                REQUIRE(s.rms >= s.min);
+            }
+        }
+    }
+
+    SECTION("Out of range queries are clamped")
+    {
+        REQUIRE(pyramid.sample(-10, 0).max == pyramid.sample(0, 1).max);
+        REQUIRE(pyramid.sample(frames + 10, frames + 20).max == pyramid.sample(frames - 1, frames).max);
+        AudioLevelPyramid empty(QVector<uint8_t>(), channels);
+        REQUIRE(empty.frames() == 0);
+        REQUIRE(empty.sample(0, 10).max == 0);
+    }
+}
+
+TEST_CASE("Shared audio levels", "[AudioLevelPyramid]")
+{
+    const int channels = 2;
+    const int frames = 1001;
+    QVector<uint8_t> levels = randomLevels(frames, channels);
+    const qint64 memoryBefore = AudioLevels::totalMemoryUse();
+    std::shared_ptr<const AudioLevels> computed = AudioLevels::fromLevels(levels, channels);
+    REQUIRE(computed->frames() == frames);
+    REQUIRE(computed->channels() == channels);
+    REQUIRE_FALSE(computed->isMapped());
+    REQUIRE(computed->level(10, 1) == levels.at(21));
+    REQUIRE(computed->pyramid().frames() == frames);
+    REQUIRE(AudioLevels::totalMemoryUse() == memoryBefore + qint64(computed->memoryUse()));
+
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("levels") + AudioLevels::extension());
+
+    SECTION("Cached levels are mapped back")
+    {
+        REQUIRE(computed->save(path));
+        const qint64 mappedBefore = AudioLevels::totalMappedSize();
+        std::shared_ptr<const AudioLevels> loaded = AudioLevels::load(path);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->isMapped());
+        REQUIRE(loaded->frames() == frames);
+        REQUIRE(loaded->channels() == channels);
+        REQUIRE(std::equal(loaded->data(), loaded->data() + loaded->size(), levels.constBegin()));
+        REQUIRE(loaded->pyramid().sample(0, frames).max == computed->pyramid().sample(0, frames).max);
+        // The base level is not copied, only the summary levels use memory
+        REQUIRE(loaded->memoryUse() == loaded->pyramid().memoryUse());
+        REQUIRE(AudioLevels::totalMappedSize() > mappedBefore);
+        loaded.reset();
+        REQUIRE(AudioLevels::totalMappedSize() == mappedBefore);
+    }
+
+    SECTION("The scale of the levels is kept")
+    {
+        REQUIRE(computed->scale() == AudioLevels::Scale::Unknown);
+        std::shared_ptr<const AudioLevels> iec = AudioLevels::fromLevels(levels, channels, AudioLevels::Scale::IEC, 48000);
+        REQUIRE(iec->save(path));
+        std::shared_ptr<const AudioLevels> loaded = AudioLevels::load(path);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->scale() == AudioLevels::Scale::IEC);
+        REQUIRE(loaded->sampleRate() == 48000);
+        REQUIRE(std::equal(loaded->data(), loaded->data() + loaded->size(), levels.constBegin()));
+
+        // Files written by older versions do not tell the scale
+        loaded.reset();
+        QFile file(path);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        const qint32 header[4] = {0x4b4c564c, 1, channels, frames};
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(levels.constData()), levels.size());
+        file.close();
+        loaded = AudioLevels::load(path);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->scale() == AudioLevels::Scale::Unknown);
+        REQUIRE(loaded->sampleRate() == 0);
+        REQUIRE(std::equal(loaded->data(), loaded->data() + loaded->size(), levels.constBegin()));
+    }
+
+    SECTION("Invalid files are rejected")
+    {
+        REQUIRE(AudioLevels::load(dir.filePath(QStringLiteral("missing"))) == nullptr);
+        REQUIRE(computed->save(path));
+        QFile file(path);
+        REQUIRE(file.resize(file.size() - 1));
+        REQUIRE(AudioLevels::load(path) == nullptr);
+        QFile garbage(dir.filePath(QStringLiteral("garbage")));
+        REQUIRE(garbage.open(QIODevice::WriteOnly));
+        garbage.write(QByteArray(64, 'x'));
+        garbage.close();
+        REQUIRE(AudioLevels::load(garbage.fileName()) == nullptr);
+    }
+
+    computed.reset();
+    REQUIRE(AudioLevels::totalMemoryUse() == memoryBefore);
+}
+
+TEST_CASE("Waveform paint time", "[.][Benchmark][AudioLevelPyramid]")
+{
+    // One hour of stereo audio at 25fps, painted on a 1500 pixels wide item
+    const int channels = 2;
+    const int frames = 25 * 3600;
+    QVector<uint8_t> levels = randomLevels(frames, channels);
+    AudioLevelPyramid pyramid(levels, channels);
+    QImage target(1500, 60, QImage::Format_ARGB32_Premultiplied);
+
+    for (double framesPrPixel : {0.25, 1., 10., 60.}) {
+        const int width = target.width();
+        BENCHMARK(QStringLiteral("Single frame per pixel, %1 frames per pixel").arg(framesPrPixel).toStdString())
+        {
+            // Previous implementation: one raw level per pixel, fast but aliased when zoomed out
+            QPainter painter(&target);
+            QPainterPath path;
+            path.moveTo(-1, target.height());
+            double increment = qMax(1., 1 / framesPrPixel);
+            for (double i = 0; i <= width; i += increment) {
+                int idx = int(i * framesPrPixel) * channels;
+                if (idx + channels >= levels.size()) {
+                    break;
+                }
+                double level = qMax(levels.at(idx), levels.at(idx + 1)) / 255.;
+                path.lineTo(i, target.height() - level * target.height());
+            }
+            painter.drawPath(path);
+        }
+        BENCHMARK(QStringLiteral("Full scan of raw levels, %1 frames per pixel").arg(framesPrPixel).toStdString())
+        {
+            // Aliasing free drawing without the pyramid: every frame under a pixel is visited
+            QPainter painter(&target);
+            QPainterPath path;
+            path.moveTo(-1, target.height());
+            double increment = qMax(1., 1 / framesPrPixel);
+            for (double i = 0; i <= width; i += increment) {
+                int first = int(i * framesPrPixel);
+                int last = qMax(first + 1, int((i + increment) * framesPrPixel));
+                if (last * channels > levels.size()) {
+                    break;
+                }
+                uint8_t level = 0;
+                for (int idx = first * channels; idx < last * channels; ++idx) {
+                    level = qMax(level, levels.at(idx));
+                }
+                path.lineTo(i, target.height() - level * target.height() / 255.);
+            }
+            painter.drawPath(path);
+        }
+        BENCHMARK(QStringLiteral("Pyramid path, %1 frames per pixel").arg(framesPrPixel).toStdString())
+        {
+            QPainter painter(&target);
+            QPainterPath path;
+            path.moveTo(-1, target.height());
+            double increment = qMax(1., 1 / framesPrPixel);
+            for (double i = 0; i <= width; i += increment) {
+                int first = int(i * framesPrPixel);
+                int last = qMax(first + 1, int((i + increment) * framesPrPixel));
+                if (first >= frames) {
+                    break;
+                }
+                path.lineTo(i, target.height() - pyramid.sample(first, last).max * target.height() / 255.);
+            }
+            painter.drawPath(path);
+        }
+    }
+}
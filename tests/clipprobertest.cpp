@@ -0,0 +1,198 @@
+#include "test_utils.hpp"
+
+#include "bin/binplaylist.hpp"
+#include "bin/clipprober.hpp"
+#include "project/loadtimings.h"
+#include "xml/xml.hpp"
+
+#include <QDomDocument>
+#include <mlt++/MltFrame.h>
+#include <mlt++/MltPlaylist.h>
+#include <mlt++/MltTractor.h>
+
+using namespace fakeit;
+Mlt::Profile profile_probe;
+
+namespace {
+QString property(const QString &name, const QString &value)
+{
+    return QStringLiteral("<property name=\"%1\">%2</property>").arg(name, value);
+}
+
+// A project with @param clips bin clips spread over @param tracks tracks. Clips use @param media if set, color producers otherwise
+QString projectXml(int clips, int tracks, const QString &media)
+{
+    QString xml = QStringLiteral("<mlt LC_NUMERIC=\"C\">");
+    for (int i = 1; i <= clips; ++i) {
+        xml += QStringLiteral("<producer id=\"producer%1\" in=\"0\" out=\"99\">").arg(i);
+        if (media.isEmpty()) {
+            xml += property(QStringLiteral("mlt_service"), QStringLiteral("color")) +
+                   property(QStringLiteral("resource"), i % 2 ? QStringLiteral("red") : QStringLiteral("blue"));
+        } else {
+            xml += property(QStringLiteral("mlt_service"), QStringLiteral("avformat")) + property(QStringLiteral("resource"), media) +
+                   property(QStringLiteral("meta.media.nb_streams"), QStringLiteral("1"));
+        }
+        xml += property(QStringLiteral("length"), QStringLiteral("100")) + property(QStringLiteral("kdenlive:id"), QString::number(i));
+        xml += QStringLiteral("</producer>");
+    }
+    xml += QStringLiteral("<playlist id=\"main_bin\">") + property(QStringLiteral("xml_retain"), QStringLiteral("1"));
+    for (int i = 1; i <= clips; ++i) {
+        xml += QStringLiteral("<entry producer=\"producer%1\" in=\"0\" out=\"99\"/>").arg(i);
+    }
+    xml += QStringLiteral("</playlist>");
+    for (int t = 0; t < tracks; ++t) {
+        xml += QStringLiteral("<playlist id=\"playlist%1\">").arg(t);
+        for (int i = 1 + t; i <= clips; i += tracks) {
+            xml += QStringLiteral("<entry producer=\"producer%1\" in=\"0\" out=\"49\"/>").arg(i);
+        }
+        xml += QStringLiteral("</playlist>");
+    }
+    xml += QStringLiteral("<tractor id=\"tractor0\">");
+    for (int t = 0; t < tracks; ++t) {
+        xml += QStringLiteral("<track producer=\"playlist%1\"/>").arg(t);
+    }
+    xml += QStringLiteral("</tractor></mlt>");
+    return xml;
+}
+} // namespace
+
+TEST_CASE("Clip probing on project load", "[ClipProber]")
+{
+    SECTION("Producers with stream information are deferred")
+    {
+        QDomDocument doc;
+        REQUIRE(doc.setContent(projectXml(3, 1, QStringLiteral("/nonexistent/media.mp4"))));
+        QDomElement noMeta = doc.elementsByTagName(QStringLiteral("producer")).at(2).toElement();
+        QDomNodeList props = noMeta.elementsByTagName(QStringLiteral("property"));
+        for (int i = 0; i < props.count(); ++i) {
+            if (props.at(i).toElement().attribute(QStringLiteral("name")) == QLatin1String("meta.media.nb_streams")) {
+                noMeta.removeChild(props.at(i));
+                break;
+            }
+        }
+        REQUIRE(ClipProber::deferProbing(doc) == 2);
+        REQUIRE(Xml::getXmlProperty(doc.elementsByTagName(QStringLiteral("producer")).at(0).toElement(), QStringLiteral("mlt_service")) ==
+                QLatin1String("avformat-novalidate"));
+        REQUIRE(Xml::getXmlProperty(noMeta, QStringLiteral("mlt_service")) == QLatin1String("avformat"));
+
+        QDomDocument colors;
+        REQUIRE(colors.setContent(projectXml(3, 1, QString())));
+        REQUIRE(ClipProber::deferProbing(colors) == 0);
+    }
+
+    SECTION("Only lazy producers are probed")
+    {
+        auto color = std::make_shared<Mlt::Producer>(profile_probe, "color", "red");
+        REQUIRE_FALSE(ClipProber::needsProbe(*color));
+        auto missing = std::make_shared<Mlt::Producer>(profile_probe, "avformat-novalidate", "/nonexistent/media.mp4");
+        REQUIRE(missing->is_valid());
+        REQUIRE(ClipProber::needsProbe(*missing));
+        auto known = std::make_shared<Mlt::Producer>(profile_probe, "avformat-novalidate", "/nonexistent/other.mp4");
+        known->set("meta.media.nb_streams", 1);
+        REQUIRE_FALSE(ClipProber::needsProbe(*known));
+
+        ClipProber prober(profile_probe);
+        prober.enqueue(1, color);
+        prober.enqueue(2, missing);
+        prober.enqueue(3, known);
+        REQUIRE(prober.waitFor(1));
+        REQUIRE(prober.waitFor(3));
+        // The file does not exist, so the probe fails
+        REQUIRE_FALSE(prober.waitFor(2));
+        REQUIRE(prober.probedCount() == 1);
+        REQUIRE(prober.failedCount() == 1);
+        // Waiting again on a finished clip does not block
+        REQUIRE(prober.waitFor(2));
+    }
+}
+
+TEST_CASE("Project open", "[.][Benchmark][ProjectLoad]")
+{
+    // Set KDENLIVE_BENCH_MEDIA to a media file to measure the avformat probing, color clips are used otherwise
+    const QString media = qEnvironmentVariable("KDENLIVE_BENCH_MEDIA");
+    const int clipCount = 2000;
+    const int trackCount = 8;
+    const QString xml = projectXml(clipCount, trackCount, media);
+
+    Logger::clear();
+    auto binModel = pCore->projectItemModel();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    for (bool deferred : {false, true}) {
+        binModel->clean();
+        TimelineItemModel tim(&profile_probe, undoStack);
+        Mock<TimelineItemModel> timMock(tim);
+        auto timeline = std::shared_ptr<TimelineItemModel>(&timMock.get(), [](...) {});
+        TimelineItemModel::finishConstruct(timeline, guideModel);
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+
+        LoadTimings timings;
+        QDomDocument doc;
+        REQUIRE(doc.setContent(xml));
+        timings.mark(QStringLiteral("xml parse"));
+        if (deferred) {
+            ClipProber::deferProbing(doc);
+        }
+        timings.mark(QStringLiteral("validation"));
+        Mlt::Producer xmlProd(profile_probe, "xml-string", doc.toString().toUtf8().constData());
+        Mlt::Service s(xmlProd);
+        Mlt::Tractor tractor(s);
+        timings.mark(QStringLiteral("mlt parse"));
+
+        // Same steps as ProjectItemModel::loadBinPlaylist, the bin widget is not available in tests
+        Mlt::Properties retainList((mlt_properties)tractor.get_data("xml_retain"));
+        Mlt::Playlist bin((mlt_playlist)retainList.get_data(BinPlaylist::binPlaylistId.toUtf8().constData()));
+        REQUIRE(bin.count() == clipCount);
+        ClipProber prober(profile_probe);
+        std::vector<std::shared_ptr<Mlt::Producer>> producers;
+        for (int i = 0; i < bin.count(); ++i) {
+            QScopedPointer<Mlt::Producer> prod(bin.get_clip(i));
+            producers.push_back(std::make_shared<Mlt::Producer>(prod->parent()));
+            prober.enqueue(producers.back()->get_int("kdenlive:id"), producers.back());
+        }
+        std::unordered_map<int, QString> binIds;
+        for (const auto &producer : producers) {
+            const int id = producer->get_int("kdenlive:id");
+            prober.waitFor(id);
+            QString binId = QString::number(binModel->getFreeClipId());
+            auto binClip = ProjectClip::construct(binId, QIcon(), binModel, producer);
+            REQUIRE(binModel->addItem(binClip, binModel->getRootFolder()->clipId(), undo, redo));
+            binIds[id] = binId;
+        }
+        timings.mark(QStringLiteral("clip probing"));
+
+        for (int t = 0; t < tractor.count(); ++t) {
+            QScopedPointer<Mlt::Producer> track(tractor.track(t));
+            Mlt::Playlist playlist(*track);
+            int tid = TrackModel::construct(timeline);
+            for (int j = 0; j < playlist.count(); ++j) {
+                if (playlist.is_blank(j)) {
+                    continue;
+                }
+                QScopedPointer<Mlt::Producer> clip(playlist.get_clip(j));
+                int cid = ClipModel::construct(timeline, binIds.at(clip->parent().get_int("kdenlive:id")), -1, PlaylistState::VideoOnly);
+                REQUIRE(timeline->requestClipMove(cid, tid, playlist.clip_start(j), true, false, false, true, undo, redo));
+            }
+        }
+        timings.mark(QStringLiteral("timeline build"));
+
+        QScopedPointer<Mlt::Frame> frame(timeline->tractor()->get_frame());
+        mlt_image_format format = mlt_image_rgb24a;
+        int width = profile_probe.width();
+        int height = profile_probe.height();
+        REQUIRE(frame->get_image(format, width, height) != nullptr);
+        timings.mark(QStringLiteral("first frame"));
+
+        REQUIRE(timeline->checkConsistency());
+        WARN((deferred ? "Parallel probing: " : "Probing while parsing: ") << timings.toString().toStdString() << ", " << prober.probedCount()
+                                                                             << " clips probed");
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
@@ -0,0 +1,149 @@
+#include "test_utils.hpp"
+
+#include "kdenlivesettings.h"
+
+using namespace fakeit;
+Mlt::Profile profile_decoders;
+
+TEST_CASE("Decoders are pooled between tracks", "[DecoderPool]")
+{
+    Logger::clear();
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    TimelineItemModel tim(&profile_decoders, undoStack);
+    Mock<TimelineItemModel> timMock(tim);
+    auto timeline = std::shared_ptr<TimelineItemModel>(&timMock.get(), [](...) {});
+    TimelineItemModel::finishConstruct(timeline, guideModel);
+
+    const int previousLimit = KdenliveSettings::maxdecodersperclip();
+    KdenliveSettings::setMaxdecodersperclip(4);
+
+    QString binId = createProducerWithSound(profile_decoders, binModel);
+    std::shared_ptr<ProjectClip> clip = binModel->getClipByBinID(binId);
+
+    // The same clip on 25 audio and 25 video tracks
+    QList<int> clips;
+    for (int i = 0; i < 25; ++i) {
+        int audioTrack = TrackModel::construct(timeline, -1, -1, QString(), true);
+        int videoTrack = TrackModel::construct(timeline);
+        int audioClip = ClipModel::construct(timeline, binId, -1, PlaylistState::AudioOnly);
+        int videoClip = ClipModel::construct(timeline, binId, -1, PlaylistState::VideoOnly);
+        REQUIRE(timeline->requestClipMove(audioClip, audioTrack, 10 * i));
+        REQUIRE(timeline->requestClipMove(videoClip, videoTrack, 10 * i));
+        clips << audioClip << videoClip;
+    }
+    REQUIRE(timeline->checkConsistency());
+
+    ProjectClip::DecoderStats stats = clip->decoderStats();
+    REQUIRE(stats.users == 50);
+    // Tracks never share a producer, the clips overlap in time
+    REQUIRE(stats.audio == 25);
+    REQUIRE(stats.video == 25);
+
+    SECTION("Moving a clip to a new track reuses the pool")
+    {
+        int audioTrack = TrackModel::construct(timeline, -1, -1, QString(), true);
+        REQUIRE(timeline->requestClipMove(clips.first(), audioTrack, 0));
+        REQUIRE(timeline->checkConsistency());
+        stats = clip->decoderStats();
+        REQUIRE(stats.users == 51);
+        REQUIRE(stats.audio == 26);
+        undoStack->undo();
+        REQUIRE(timeline->checkConsistency());
+        REQUIRE(timeline->getClipTrackId(clips.first()) != audioTrack);
+        REQUIRE(clip->decoderStats().audio == 26);
+    }
+
+    SECTION("Every clip keeps a valid producer")
+    {
+        std::unordered_set<const void *> audioParents;
+        for (int cid : clips) {
+            REQUIRE(timeline->getClipPtr(cid)->getProducer()->is_valid());
+            REQUIRE(timeline->getClipPtr(cid)->getProducer()->parent().is_valid());
+            if (timeline->getClipPtr(cid)->clipState() == PlaylistState::AudioOnly) {
+                audioParents.insert(timeline->getClipPtr(cid)->getProducer()->parent().get_producer());
+            }
+        }
+        REQUIRE(audioParents.size() == 25);
+    }
+
+    SECTION("Unused decoders are reused and closed")
+    {
+        // Decoders whose cuts are all deleted are only referenced by the pool
+        std::vector<std::shared_ptr<Mlt::Producer>> cuts;
+        std::unordered_set<const Mlt::Producer *> opened;
+        for (int i = 0; i < 6; ++i) {
+            std::shared_ptr<Mlt::Producer> producer = clip->pooledProducer(clip->m_videoProducers, 1000 + i, false);
+            opened.insert(producer.get());
+            cuts.emplace_back(producer->cut());
+        }
+        REQUIRE(opened.size() == 6);
+        REQUIRE(clip->decoderStats().video == 31);
+        cuts.clear();
+
+        // A new track takes over the most recently used unused decoder, and the other unused ones are closed
+        std::shared_ptr<Mlt::Producer> producer = clip->pooledProducer(clip->m_videoProducers, 2000, false);
+        REQUIRE(opened.count(producer.get()) == 1);
+        REQUIRE(clip->m_videoProducers.count(1005) == 0);
+        REQUIRE(clip->decoderStats().video == 26);
+        for (int cid : clips) {
+            REQUIRE(timeline->getClipPtr(cid)->getProducer()->parent().is_valid());
+        }
+
+        clip->releasePooledProducer(clip->m_videoProducers, 2000);
+        REQUIRE(clip->decoderStats().video == 25);
+        REQUIRE(clip->m_producerUse.count(producer.get()) == 0);
+    }
+
+    KdenliveSettings::setMaxdecodersperclip(previousLimit);
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Avformat producers are cloned without xml", "[DecoderPool]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<Mlt::Producer> producer =
+        std::make_shared<Mlt::Producer>(pCore->getCurrentProfile()->profile(), "avformat", TESTS_SOURCE_DIR "/small.mkv");
+    if (!producer->is_valid()) {
+        WARN("avformat is not available, the direct cloning of producers is not tested");
+        return;
+    }
+    producer->set("kdenlive:duration", producer->get_length());
+    producer->set("kdenlive:clipname", "small");
+    QString binId = QString::number(binModel->getFreeClipId());
+    auto binClip = ProjectClip::construct(binId, QIcon(), binModel, producer);
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    REQUIRE(binModel->addItem(binClip, binModel->getRootFolder()->clipId(), undo, redo));
+
+    std::shared_ptr<Mlt::Producer> clone = binClip->cloneProducerDirect(true);
+    REQUIRE(clone);
+    REQUIRE(clone->is_valid());
+    REQUIRE(clone.get() != producer.get());
+    REQUIRE(QString(clone->get("resource")) == QString(producer->get("resource")));
+    REQUIRE(clone->get_length() == producer->get_length());
+    REQUIRE(QString(clone->get("kdenlive:clipname")) == QStringLiteral("small"));
+    REQUIRE(clone->get_int("mute_on_pause") == 0);
+    std::unique_ptr<Mlt::Frame> frame(clone->get_frame());
+    REQUIRE(frame->is_valid());
+
+    // A producer with filters that are not kdenlive effects goes through xml
+    Mlt::Filter filter(pCore->getCurrentProfile()->profile(), "brightness");
+    REQUIRE(filter.is_valid());
+    binClip->m_masterProducer->attach(filter);
+    REQUIRE(binClip->cloneProducerDirect(true) == nullptr);
+    REQUIRE(binClip->cloneProducer(true)->is_valid());
+    binClip->m_masterProducer->detach(filter);
+    binModel->clean();
+}
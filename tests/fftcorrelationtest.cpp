@@ -0,0 +1,259 @@
+#include "catch.hpp"
+#include "lib/audio/audioCorrelation.h"
+#include "lib/audio/audioEnvelope.h"
+#include "lib/audio/audioLevels.h"
+#include "lib/audio/fftCorrelation.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace {
+std::vector<qint64> randomEnvelope(size_t size, std::mt19937 &gen)
+{
+    std::vector<qint64> envelope(size);
+    for (qint64 &v : envelope) {
+        v = qint64(gen() % 20000) - 10000;
+    }
+    return envelope;
+}
+
+/** @brief A copy of @param envelope starting at @param offset, with some noise */
+std::vector<qint64> excerpt(const std::vector<qint64> &envelope, size_t offset, size_t size, std::mt19937 &gen)
+{
+    std::vector<qint64> result(size);
+    for (size_t i = 0; i < size; ++i) {
+        result[i] = (offset + i < envelope.size() ? envelope[offset + i] : 0) + qint64(gen() % 2000) - 1000;
+    }
+    return result;
+}
+
+size_t maxIndex(const std::vector<qint64> &correlation)
+{
+    return size_t(std::max_element(correlation.begin(), correlation.end()) - correlation.begin());
+}
+
+/** @brief The correlation as it was computed before plans were cached: new configurations and buffers for every call */
+void uncachedCorrelate(const qint64 *left, size_t leftSize, const qint64 *right, size_t rightSize, qint64 *out)
+{
+    qint64 maxLeft = 1, maxRight = 1;
+    for (size_t i = 0; i < leftSize; ++i) {
+        maxLeft = qMax(maxLeft, qAbs(left[i]));
+    }
+    for (size_t i = 0; i < rightSize; ++i) {
+        maxRight = qMax(maxRight, qAbs(right[i]));
+    }
+    size_t size = 64;
+    while (size / 2 < qMax(leftSize, rightSize)) {
+        size = size << 1;
+    }
+    kiss_fftr_cfg fftConfig = kiss_fftr_alloc((int)size, 0, nullptr, nullptr);
+    kiss_fftr_cfg ifftConfig = kiss_fftr_alloc((int)size, 1, nullptr, nullptr);
+    std::vector<kiss_fft_cpx> leftFFT(size / 2 + 1), rightFFT(size / 2 + 1), correlatedFFT(size / 2 + 1);
+    std::vector<float> leftData(size, 0), rightData(size, 0), convolved(size);
+    for (size_t i = 0; i < leftSize; ++i) {
+        leftData[i] = float(double(left[i]) / maxLeft);
+    }
+    for (size_t i = 0; i < rightSize; ++i) {
+        rightData[rightSize - 1 - i] = float(double(right[i]) / maxRight);
+    }
+    kiss_fftr(fftConfig, &leftData[0], &leftFFT[0]);
+    kiss_fftr(fftConfig, &rightData[0], &rightFFT[0]);
+    for (size_t i = 0; i < correlatedFFT.size(); ++i) {
+        correlatedFFT[i].r = leftFFT[i].r * rightFFT[i].r - leftFFT[i].i * rightFFT[i].i;
+        correlatedFFT[i].i = leftFFT[i].r * rightFFT[i].i + leftFFT[i].i * rightFFT[i].r;
+    }
+    kiss_fftri(ifftConfig, &correlatedFFT[0], &convolved[0]);
+    out[0] = 0;
+    for (size_t i = 0; i < leftSize + rightSize; ++i) {
+        out[i + 1] = qint64(convolved[i]);
+    }
+    kiss_fftr_free(fftConfig);
+    kiss_fftr_free(ifftConfig);
+}
+const int samplesPerFrame = 1920;
+
+/** @brief Mono noise whose amplitude changes on each frame, following @param amplitudes, with some constant @param noise */
+std::vector<qint16> frameNoise(const std::vector<double> &amplitudes, double noise, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<double> dist(-1., 1.);
+    std::vector<qint16> samples(amplitudes.size() * samplesPerFrame);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = qint16(qBound(-32767., (amplitudes[i / samplesPerFrame] * dist(gen) + noise * dist(gen)) * 30000., 32767.));
+    }
+    return samples;
+}
+
+/** @brief The envelope of decoded audio, as computed by AudioEnvelope */
+std::vector<qint64> decodedEnvelope(const std::vector<qint16> &samples)
+{
+    std::vector<qint64> envelope(samples.size() / samplesPerFrame);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        envelope[i / samplesPerFrame] += qAbs(samples[i]);
+    }
+    return envelope;
+}
+
+double iecScale(double dB)
+{
+    if (dB < -70.) {
+        return 0.;
+    } else if (dB < -60.) {
+        return (dB + 70.) * 0.0025;
+    } else if (dB < -50.) {
+        return (dB + 60.) * 0.005 + 0.025;
+    } else if (dB < -40.) {
+        return (dB + 50.) * 0.0075 + 0.075;
+    } else if (dB < -30.) {
+        return (dB + 40.) * 0.015 + 0.15;
+    } else if (dB < -20.) {
+        return (dB + 30.) * 0.02 + 0.3;
+    }
+    return qMin(1., (dB + 20.) * 0.025 + 0.5);
+}
+
+/** @brief Audio thumbnail levels as computed by the audio thumbnail job: mean amplitude of one sample every 32 with FFmpeg, IEC scaled RMS with MLT */
+std::shared_ptr<const AudioLevels> thumbnailLevels(const std::vector<qint16> &samples, AudioLevels::Scale scale)
+{
+    const size_t frames = samples.size() / samplesPerFrame;
+    std::vector<double> values(frames);
+    for (size_t f = 0; f < frames; ++f) {
+        const qint16 *frame = samples.data() + f * samplesPerFrame;
+        double sum = 0;
+        if (scale == AudioLevels::Scale::Linear) {
+            for (int i = 0; i < samplesPerFrame; i += 32) {
+                sum += qAbs(frame[i]);
+            }
+            values[f] = sum / (samplesPerFrame / 32);
+        } else {
+            for (int i = 0; i < samplesPerFrame; ++i) {
+                sum += double(frame[i]) * frame[i];
+            }
+            values[f] = iecScale(20. * log10(sqrt(sum / samplesPerFrame) / 32768.));
+        }
+    }
+    const double max = scale == AudioLevels::Scale::Linear ? *std::max_element(values.begin(), values.end()) : 1.;
+    QVector<uint8_t> levels;
+    for (double v : values) {
+        levels << uint8_t(255 * v / max);
+    }
+    return AudioLevels::fromLevels(levels, 1, scale, 48000 / (scale == AudioLevels::Scale::Linear ? 32 : 1));
+}
+
+/** @brief Shift of @param sub in @param main, with the envelopes normalized like AudioEnvelope does */
+long alignment(std::vector<qint64> main, std::vector<qint64> sub)
+{
+    for (std::vector<qint64> *envelope : {&main, &sub}) {
+        const qint64 mean = std::accumulate(envelope->begin(), envelope->end(), 0LL) / qint64(envelope->size());
+        for (qint64 &v : *envelope) {
+            v -= mean;
+        }
+    }
+    std::vector<qint64> correlation(main.size() + sub.size() + 1);
+    FFTCorrelation::correlate(main.data(), main.size(), sub.data(), sub.size(), correlation.data());
+    return long(maxIndex(correlation)) - long(sub.size());
+}
+} // namespace
+
+TEST_CASE("FFT correlation", "[AudioCorrelation]")
+{
+    std::mt19937 gen(42);
+    std::vector<qint64> main = randomEnvelope(3000, gen);
+    FFTCorrelation::Reference reference(main.data(), main.size());
+
+    SECTION("FFT and direct correlations find the same shift")
+    {
+        for (size_t offset : {0, 17, 1000, 2200}) {
+            std::vector<qint64> sub = excerpt(main, offset, 700, gen);
+            std::vector<qint64> direct(main.size() + sub.size() + 1);
+            std::vector<qint64> fft(direct.size());
+            AudioCorrelation::correlate(main.data(), main.size(), sub.data(), sub.size(), direct.data());
+            reference.correlate(sub.data(), sub.size(), fft.data());
+            REQUIRE(maxIndex(fft) == maxIndex(direct));
+            // Index of the best match is offset + sub.size()
+            REQUIRE(maxIndex(fft) == offset + sub.size());
+        }
+    }
+
+    SECTION("The cached reference gives the same result as a one shot correlation")
+    {
+        std::vector<qint64> sub = excerpt(main, 500, 1234, gen);
+        std::vector<qint64> once(main.size() + sub.size() + 1);
+        std::vector<qint64> cached(once.size());
+        std::vector<qint64> uncached(once.size());
+        FFTCorrelation::correlate(main.data(), main.size(), sub.data(), sub.size(), once.data());
+        reference.correlate(sub.data(), sub.size(), cached.data());
+        reference.correlate(sub.data(), sub.size(), cached.data());
+        uncachedCorrelate(main.data(), main.size(), sub.data(), sub.size(), uncached.data());
+        REQUIRE(once == cached);
+        REQUIRE(once == uncached);
+    }
+}
+
+TEST_CASE("Alignment from audio thumbnail levels", "[AudioCorrelation]")
+{
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(0.02, 1.);
+    std::vector<double> amplitudes(3000);
+    for (double &a : amplitudes) {
+        a = dist(gen);
+    }
+    const std::vector<qint16> main = frameNoise(amplitudes, 0., gen);
+    const std::shared_ptr<const AudioLevels> mainLinear = thumbnailLevels(main, AudioLevels::Scale::Linear);
+    const std::shared_ptr<const AudioLevels> mainIec = thumbnailLevels(main, AudioLevels::Scale::IEC);
+    REQUIRE(AudioLevels::amplitude(255, AudioLevels::Scale::IEC) == Approx(1.));
+    REQUIRE(AudioLevels::amplitude(0, AudioLevels::Scale::IEC) == 0.);
+    REQUIRE(AudioLevels::amplitude(128, AudioLevels::Scale::Unknown) == 0.);
+
+    for (long offset : {0L, 250L, 1800L, 2290L}) {
+        // Another recording of the same sound
+        const std::vector<double> excerpt(amplitudes.begin() + offset, amplitudes.begin() + offset + 700);
+        const std::vector<qint16> sub = frameNoise(excerpt, 0.05, gen);
+        const std::shared_ptr<const AudioLevels> subLinear = thumbnailLevels(sub, AudioLevels::Scale::Linear);
+        const std::shared_ptr<const AudioLevels> subIec = thumbnailLevels(sub, AudioLevels::Scale::IEC);
+        REQUIRE(alignment(decodedEnvelope(main), decodedEnvelope(sub)) == offset);
+        REQUIRE(alignment(AudioEnvelope::levelsEnvelope(*mainLinear, 0, amplitudes.size()), AudioEnvelope::levelsEnvelope(*subLinear, 0, excerpt.size())) ==
+                offset);
+        REQUIRE(alignment(AudioEnvelope::levelsEnvelope(*mainIec, 0, amplitudes.size()), AudioEnvelope::levelsEnvelope(*subIec, 0, excerpt.size())) == offset);
+    }
+}
+
+TEST_CASE("Audio alignment correlation", "[.][Benchmark][AudioCorrelation]")
+{
+    // One hour envelopes at 25fps, one reference and several children of the same length
+    std::mt19937 gen(42);
+    const size_t frames = 25 * 3600;
+    const int childCount = 8;
+    std::vector<qint64> main = randomEnvelope(frames, gen);
+    std::vector<std::vector<qint64>> children;
+    for (int i = 0; i < childCount; ++i) {
+        children.push_back(excerpt(main, size_t(i) * 1000, frames, gen));
+    }
+    std::vector<std::vector<qint64>> results(childCount, std::vector<qint64>(2 * frames + 1));
+
+    BENCHMARK("Uncached plans, one pair")
+    {
+        uncachedCorrelate(main.data(), frames, children[0].data(), frames, results[0].data());
+    }
+    BENCHMARK("Cached plans, one pair")
+    {
+        FFTCorrelation::correlate(main.data(), frames, children[0].data(), frames, results[0].data());
+    }
+    BENCHMARK("Uncached plans, sequential children")
+    {
+        for (int i = 0; i < childCount; ++i) {
+            uncachedCorrelate(main.data(), frames, children[i].data(), frames, results[i].data());
+        }
+    }
+    BENCHMARK("Shared reference, parallel children")
+    {
+        FFTCorrelation::Reference reference(main.data(), frames);
+        QVector<int> indexes;
+        for (int i = 0; i < childCount; ++i) {
+            indexes << i;
+        }
+        QtConcurrent::blockingMap(indexes, [&](int i) { reference.correlate(children[i].data(), frames, results[i].data()); });
+    }
+}
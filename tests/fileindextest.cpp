@@ -0,0 +1,193 @@
+#include "test_utils.hpp"
+
+#include "doc/fileindex.hpp"
+#include "utils/mediacache.hpp"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace {
+QString createFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return QFileInfo(path).absoluteFilePath();
+}
+
+QString md5(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+}
+
+// The former depth first search, run once per missing clip
+QString searchFileRecursively(const QDir &dir, qint64 matchSize, const QString &matchHash)
+{
+    const QStringList files = dir.entryList(QDir::Files | QDir::Readable);
+    for (const QString &name : files) {
+        QFile file(dir.absoluteFilePath(name));
+        if (file.size() == matchSize && file.open(QIODevice::ReadOnly)) {
+            QByteArray fileData;
+            if (file.size() > 2000000) {
+                fileData = file.read(1000000);
+                if (file.seek(file.size() - 1000000)) {
+                    fileData.append(file.readAll());
+                }
+            } else {
+                fileData = file.readAll();
+            }
+            if (md5(fileData) == matchHash) {
+                return file.fileName();
+            }
+        }
+    }
+    const QStringList folders = dir.entryList(QDir::Dirs | QDir::Readable | QDir::Executable | QDir::NoDotAndDotDot);
+    for (const QString &folder : folders) {
+        QString found = searchFileRecursively(QDir(dir.absoluteFilePath(folder)), matchSize, matchHash);
+        if (!found.isEmpty()) {
+            return found;
+        }
+    }
+    return QString();
+}
+} // namespace
+
+TEST_CASE("Missing files search", "[FileIndex]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    auto &cache = MediaCache::get();
+    cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+    const QString root = dir.filePath(QStringLiteral("media"));
+    const QByteArray clip1("first clip data");
+    const QByteArray clip2("other clip data");
+    const QByteArray clip3("a third clip, longer");
+    // clip1 and clip2 have the same size
+    const QString path1 = createFile(root + QStringLiteral("/a/b/clip1.mp4"), clip1);
+    const QString path2 = createFile(root + QStringLiteral("/c/clip2.mp4"), clip2);
+    const QString copy2 = createFile(root + QStringLiteral("/c/d/e/clip2.mp4"), clip2);
+    const QString path3 = createFile(root + QStringLiteral("/clip3.mp4"), clip3);
+    createFile(root + QStringLiteral("/slides/img_001.png"), QByteArray("1"));
+    createFile(root + QStringLiteral("/slides/img_002.png"), QByteArray("2"));
+
+    FileIndex index(4);
+    int progressCalls = 0;
+    index.build(root, [&progressCalls](int, int) { progressCalls++; });
+    REQUIRE(index.stats().folders == 7);
+    REQUIRE(index.stats().files == 6);
+    REQUIRE(progressCalls == 7);
+
+    SECTION("Find by size and hash")
+    {
+        QList<QPair<qint64, QString>> queries;
+        queries << qMakePair(qint64(clip1.size()), md5(clip1)) << qMakePair(qint64(clip2.size()), md5(clip2))
+                << qMakePair(qint64(clip3.size()), md5(clip3)) << qMakePair(qint64(12), md5(QByteArray("not on disk!")));
+        const QHash<QString, QString> found = index.findByHash(queries);
+        REQUIRE(found.size() == 3);
+        REQUIRE(found.value(md5(clip1)) == path1);
+        // The copy closest to the root is used
+        REQUIRE(found.value(md5(clip2)) == path2);
+        REQUIRE(found.value(md5(clip3)) == path3);
+        // Only files with a matching size were read
+        REQUIRE(index.stats().hashedFiles == 4);
+        REQUIRE(index.stats().hashedBytes == 2 * clip1.size() + clip2.size() + clip3.size());
+        REQUIRE(copy2 != path2);
+        // Hashes are now cached, no file is read again
+        REQUIRE(index.findByHash(queries) == found);
+        REQUIRE(index.stats().hashedFiles == 8);
+        REQUIRE(index.stats().hashedBytes == 2 * clip1.size() + clip2.size() + clip3.size());
+    }
+
+    SECTION("Find by name")
+    {
+        REQUIRE(index.findByName(QStringLiteral("clip2.mp4")) == path2);
+        REQUIRE(index.findByName(QStringLiteral("clip1.mp4")) == path1);
+        REQUIRE(index.findByName(QStringLiteral("missing.mp4")).isEmpty());
+        REQUIRE(QFileInfo(index.findByPrefix(QStringLiteral("img_"))).fileName() == QLatin1String("img_001.png"));
+        REQUIRE(index.findByPrefix(QStringLiteral("none")).isEmpty());
+    }
+
+#ifdef Q_OS_UNIX
+    SECTION("Symbolic links to parent folders are listed once")
+    {
+        REQUIRE(QFile::link(root, root + QStringLiteral("/a/b/loop")));
+        FileIndex loopIndex(4);
+        loopIndex.build(root);
+        REQUIRE(loopIndex.stats().files == 6);
+    }
+#endif
+
+    SECTION("Canceled search")
+    {
+        index.cancel();
+        QList<QPair<qint64, QString>> queries;
+        queries << qMakePair(qint64(clip1.size()), md5(clip1));
+        REQUIRE(index.findByHash(queries).isEmpty());
+    }
+    cache->clear();
+    cache->resetStats();
+}
+
+TEST_CASE("Relink missing clips", "[.][Benchmark][FileIndex]")
+{
+    // Set KDENLIVE_BENCH_FOLDER to a folder of media files to search a real volume, a generated tree is used otherwise
+    QString root = qEnvironmentVariable("KDENLIVE_BENCH_FOLDER");
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    auto &cache = MediaCache::get();
+    cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+    QList<QPair<qint64, QString>> queries;
+    if (root.isEmpty()) {
+        root = dir.filePath(QStringLiteral("media"));
+        // 20 folders of 50 files, many of them sharing the same size
+        for (int i = 0; i < 1000; ++i) {
+            const QByteArray data = QByteArray(100000 + (i % 20) * 1000, char('a' + i % 26)) + QByteArray::number(i);
+            createFile(QStringLiteral("%1/day%2/cam%3/clip%4.mp4").arg(root).arg(i / 50).arg(i % 2).arg(i), data);
+            if (i % 2 == 0) {
+                queries << qMakePair(qint64(data.size()), md5(data));
+            }
+        }
+    } else {
+        // Relink the first files of the folder, skipping duplicates
+        QDirIterator it(root, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+        while (it.hasNext() && queries.size() < 500) {
+            const QString path = it.next();
+            const auto query = qMakePair(QFileInfo(path).size(), cache->fileHash(path));
+            if (!query.second.isEmpty() && !queries.contains(query)) {
+                queries << query;
+            }
+        }
+        cache->clear();
+        cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int found = 0;
+    for (const auto &query : queries) {
+        if (!searchFileRecursively(QDir(root), query.first, query.second).isEmpty()) {
+            found++;
+        }
+    }
+    const qint64 sequential = timer.elapsed();
+    REQUIRE(found == queries.size());
+
+    timer.restart();
+    FileIndex index(8);
+    index.build(root);
+    const QHash<QString, QString> matches = index.findByHash(queries);
+    const qint64 indexed = timer.elapsed();
+    REQUIRE(matches.size() == queries.size());
+    const FileIndex::Stats stats = index.stats();
+    WARN(queries.size() << " clips, search per clip: " << sequential << "ms, indexed: " << indexed << "ms (" << stats.folders << " folders, " << stats.files
+                        << " files listed in " << stats.scanTime << "ms, " << stats.hashedFiles << " files hashed in " << stats.hashTime << "ms)");
+    cache->clear();
+    cache->resetStats();
+}
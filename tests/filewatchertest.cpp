@@ -0,0 +1,205 @@
+#include "test_utils.hpp"
+
+#include "bin/filewatcher.hpp"
+#include "bin/pathtrie.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace {
+QString createFile(const QString &path, const QByteArray &data)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return QFileInfo(path).absoluteFilePath();
+}
+
+// Moves the modification time in the past, so that the file is considered stable
+void setModified(const QString &path, const QDateTime &time)
+{
+    QFile file(path);
+    file.open(QIODevice::ReadWrite);
+    file.setFileTime(time, QFileDevice::FileModificationTime);
+    file.close();
+}
+} // namespace
+
+TEST_CASE("Path trie", "[FileWatcher]")
+{
+    PathTrie trie;
+    REQUIRE(trie.insert(QStringLiteral("/media/day1/a.mp4"), QStringLiteral("1")));
+    REQUIRE_FALSE(trie.insert(QStringLiteral("/media/day1/a.mp4"), QStringLiteral("2")));
+    REQUIRE(trie.insert(QStringLiteral("/media/day1/b.mp4"), QStringLiteral("3")));
+    REQUIRE(trie.insert(QStringLiteral("/media/day1/cam/c.mp4"), QStringLiteral("4")));
+    REQUIRE(trie.insert(QStringLiteral("/media/day2/d.mp4"), QStringLiteral("5")));
+    REQUIRE(trie.size() == 4);
+
+    REQUIRE(trie.contains(QStringLiteral("/media/day1/a.mp4")));
+    REQUIRE_FALSE(trie.contains(QStringLiteral("/media/day1")));
+    REQUIRE(trie.ids(QStringLiteral("/media/day1/a.mp4")).size() == 2);
+    REQUIRE(trie.ids(QStringLiteral("/media/day3/a.mp4")).empty());
+
+    QStringList files = trie.files(QStringLiteral("/media/day1"));
+    files.sort();
+    REQUIRE(files == QStringList({QStringLiteral("/media/day1/a.mp4"), QStringLiteral("/media/day1/b.mp4")}));
+    files = trie.filesBelow(QStringLiteral("/media/"));
+    REQUIRE(files.size() == 4);
+    REQUIRE(files.contains(QStringLiteral("/media/day1/cam/c.mp4")));
+    REQUIRE(trie.filesBelow(QStringLiteral("/media/day2/d.mp4")) == QStringList({QStringLiteral("/media/day2/d.mp4")}));
+
+    REQUIRE_FALSE(trie.remove(QStringLiteral("/media/day1/a.mp4"), QStringLiteral("1")));
+    REQUIRE(trie.remove(QStringLiteral("/media/day1/a.mp4"), QStringLiteral("2")));
+    REQUIRE_FALSE(trie.remove(QStringLiteral("/media/day1/a.mp4"), QStringLiteral("2")));
+    REQUIRE(trie.remove(QStringLiteral("/media/day2/d.mp4"), QStringLiteral("5")));
+    REQUIRE(trie.size() == 2);
+    // Empty folders are pruned
+    REQUIRE(trie.filesBelow(QStringLiteral("/media/day2")).isEmpty());
+    REQUIRE(trie.filesBelow(QStringLiteral("/media")).size() == 2);
+    trie.clear();
+    REQUIRE(trie.size() == 0);
+}
+
+TEST_CASE("File watcher", "[FileWatcher]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString a = createFile(dir.filePath(QStringLiteral("day1/a.mp4")), QByteArray(100, 'a'));
+    const QString b = createFile(dir.filePath(QStringLiteral("day1/b.mp4")), QByteArray(100, 'b'));
+    const QString c = createFile(dir.filePath(QStringLiteral("day2/c.mp4")), QByteArray(100, 'c'));
+
+    FileWatcher watcher;
+    QStringList modified, waiting, missing;
+    QObject::connect(&watcher, &FileWatcher::binClipModified, [&modified](const QString &id) { modified << id; });
+    QObject::connect(&watcher, &FileWatcher::binClipWaiting, [&waiting](const QString &id) { waiting << id; });
+    QObject::connect(&watcher, &FileWatcher::binClipMissing, [&missing](const QString &id) { missing << id; });
+    watcher.addFile(QStringLiteral("1"), a);
+    watcher.addFile(QStringLiteral("2"), a);
+    watcher.addFile(QStringLiteral("3"), b);
+    watcher.addFile(QStringLiteral("4"), c);
+    watcher.addFile(QStringLiteral("5"), dir.filePath(QStringLiteral("day1/none.mp4")));
+
+    FileWatcher::Stats stats = watcher.stats();
+    REQUIRE(stats.folders == 2);
+    REQUIRE(stats.files == 3);
+    REQUIRE(stats.clips == 4);
+
+    SECTION("Unchanged files are ignored")
+    {
+        watcher.slotUrlChanged(a);
+        watcher.slotUrlChanged(dir.filePath(QStringLiteral("day1")));
+        watcher.slotProcessEvents();
+        REQUIRE(modified.isEmpty());
+        REQUIRE(waiting.isEmpty());
+        REQUIRE(missing.isEmpty());
+        stats = watcher.stats();
+        REQUIRE(stats.events == 2);
+        REQUIRE(stats.batches == 1);
+        REQUIRE(stats.checkedFiles == 2);
+        REQUIRE(stats.changedFiles == 0);
+    }
+
+    SECTION("Modified files are reloaded once stable")
+    {
+        createFile(a, QByteArray(200, 'a'));
+        // A burst of notifications for the same file
+        for (int i = 0; i < 10; ++i) {
+            watcher.slotUrlChanged(a);
+        }
+        watcher.slotProcessEvents();
+        waiting.sort();
+        REQUIRE(waiting == QStringList({QStringLiteral("1"), QStringLiteral("2")}));
+        REQUIRE(watcher.stats().largestBatch == 1);
+        REQUIRE(watcher.m_modifiedTimer.isActive());
+        setModified(a, QDateTime::currentDateTime().addSecs(-5));
+        watcher.slotProcessModifiedUrls();
+        modified.sort();
+        REQUIRE(modified == QStringList({QStringLiteral("1"), QStringLiteral("2")}));
+        REQUIRE_FALSE(watcher.m_modifiedTimer.isActive());
+    }
+
+    SECTION("Folder notifications")
+    {
+        createFile(b, QByteArray(50, 'b'));
+        watcher.slotUrlChanged(dir.filePath(QStringLiteral("day1")));
+        watcher.slotProcessEvents();
+        REQUIRE(waiting == QStringList({QStringLiteral("3")}));
+    }
+
+    SECTION("Deleted and restored files")
+    {
+        QDir(dir.filePath(QStringLiteral("day2"))).removeRecursively();
+        watcher.slotUrlChanged(dir.filePath(QStringLiteral("day2")));
+        watcher.slotProcessEvents();
+        REQUIRE(missing == QStringList({QStringLiteral("4")}));
+        createFile(c, QByteArray(100, 'c'));
+        watcher.slotUrlChanged(c);
+        watcher.slotProcessEvents();
+        REQUIRE(modified == QStringList({QStringLiteral("4")}));
+    }
+
+    SECTION("Removed clips")
+    {
+        watcher.removeFile(QStringLiteral("1"));
+        REQUIRE(watcher.stats().files == 3);
+        watcher.removeFile(QStringLiteral("2"));
+        watcher.removeFile(QStringLiteral("3"));
+        stats = watcher.stats();
+        REQUIRE(stats.folders == 1);
+        REQUIRE(stats.files == 1);
+        createFile(a, QByteArray(10, 'a'));
+        watcher.slotUrlChanged(a);
+        watcher.slotProcessEvents();
+        REQUIRE(waiting.isEmpty());
+        // Changing the path of a clip
+        watcher.addFile(QStringLiteral("4"), a);
+        stats = watcher.stats();
+        REQUIRE(stats.folders == 1);
+        REQUIRE(stats.files == 1);
+        watcher.clear();
+        stats = watcher.stats();
+        REQUIRE(stats.folders == 0);
+        REQUIRE(stats.files == 0);
+        REQUIRE(stats.clips == 0);
+    }
+}
+
+TEST_CASE("Watch project files", "[.][Benchmark][FileWatcher]")
+{
+    // 5000 clips in 20 folders, all files touched at once
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const int count = 5000;
+    QStringList paths;
+    for (int i = 0; i < count; ++i) {
+        paths << createFile(QStringLiteral("%1/day%2/clip%3.mp4").arg(dir.path()).arg(i % 20).arg(i), QByteArray::number(i));
+    }
+    FileWatcher watcher;
+    int waiting = 0;
+    QObject::connect(&watcher, &FileWatcher::binClipWaiting, [&waiting]() { waiting++; });
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i) {
+        watcher.addFile(QString::number(i), paths.at(i));
+    }
+    const qint64 addTime = timer.elapsed();
+    for (int i = 0; i < count; i += 2) {
+        createFile(paths.at(i), QByteArray::number(i) + QByteArray(10, 'x'));
+    }
+    timer.restart();
+    for (const QString &path : paths) {
+        watcher.slotUrlChanged(path);
+    }
+    watcher.slotProcessEvents();
+    const qint64 processTime = timer.elapsed();
+    REQUIRE(waiting == count / 2);
+    const FileWatcher::Stats stats = watcher.stats();
+    WARN(count << " clips watched with " << stats.folders << " " << stats.method.toStdString() << " folder watches in " << addTime << "ms, " << stats.events
+               << " notifications processed in " << processTime << "ms, " << stats.changedFiles << " changed files");
+}
@@ -0,0 +1,131 @@
+#include "test_utils.hpp"
+
+#include "jobs/jobmanager.h"
+#include "jobs/jobscheduler.hpp"
+
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QThread>
+#include <functional>
+
+namespace {
+using JobBody = std::function<bool(const QString &)>;
+
+class TestJob : public AbstractClipJob
+{
+public:
+    TestJob(const QString &binId, JobBody body)
+        : AbstractClipJob(CACHEJOB, binId)
+        , m_body(std::move(body))
+    {
+    }
+
+    const QString getDescription() const override { return QStringLiteral("Test job"); }
+    bool startJob() override { return m_body(m_clipId); }
+    bool commitResult(Fun &, Fun &) override { return true; }
+
+private:
+    JobBody m_body;
+};
+
+// Builds a job like JobManager::startJob does, one task per clip
+std::shared_ptr<Job_t> makeJob(const QStringList &binIds, const JobBody &body)
+{
+    auto job = std::make_shared<Job_t>();
+    for (const QString &binId : binIds) {
+        job->m_job.push_back(std::make_shared<TestJob>(binId, body));
+    }
+    job->m_type = AbstractClipJob::CACHEJOB;
+    job->m_pendingTasks = int(job->m_job.size());
+    job->m_futureInterface.setProgressRange(0, int(job->m_job.size()));
+    job->m_actualFuture = job->m_futureInterface.future();
+    return job;
+}
+
+// A future that was never started does not block in waitForFinished, so poll it
+bool waitFinished(const std::shared_ptr<Job_t> &job)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!job->m_actualFuture.isFinished() && timer.elapsed() < 10000) {
+        QThread::msleep(1);
+    }
+    return job->m_actualFuture.isFinished();
+}
+} // namespace
+
+TEST_CASE("Job scheduler", "[JobScheduler]")
+{
+    JobScheduler scheduler;
+    // Run the test jobs one at a time, so that their order is the dispatch order
+    scheduler.setTypeLimit(AbstractClipJob::CACHEJOB, 1);
+
+    QMutex mutex;
+    QStringList executed;
+    JobBody record = [&mutex, &executed](const QString &binId) {
+        QMutexLocker lock(&mutex);
+        executed << binId;
+        return true;
+    };
+    // The first job holds the only slot until the others are queued
+    QSemaphore started;
+    QSemaphore gate;
+    auto blocker = makeJob({QStringLiteral("blocker")}, [&started, &gate](const QString &) {
+        started.release();
+        gate.acquire();
+        return true;
+    });
+    scheduler.enqueue(blocker, JobPriority::Background);
+    REQUIRE(started.tryAcquire(1, 10000));
+    REQUIRE(blocker->m_actualFuture.isStarted());
+    REQUIRE_FALSE(blocker->m_actualFuture.isFinished());
+    REQUIRE(scheduler.runningCount() == 1);
+
+    SECTION("Tasks run by priority, then in submission order")
+    {
+        auto background = makeJob({QStringLiteral("a1"), QStringLiteral("a2")}, record);
+        auto visible = makeJob({QStringLiteral("b")}, record);
+        auto interactive = makeJob({QStringLiteral("c")}, record);
+        auto promoted = makeJob({QStringLiteral("d")}, record);
+        scheduler.enqueue(background, JobPriority::Background);
+        scheduler.enqueue(visible, JobPriority::Visible);
+        scheduler.enqueue(interactive, JobPriority::Interactive);
+        scheduler.enqueue(promoted, JobPriority::Background);
+        // Promoted clips go in front of their new class
+        scheduler.setClipPriority(QStringLiteral("d"), JobPriority::Interactive);
+        REQUIRE(scheduler.queuedCount() == 5);
+        // Queued jobs are not started yet
+        REQUIRE_FALSE(background->m_actualFuture.isStarted());
+        REQUIRE_FALSE(interactive->m_actualFuture.isStarted());
+
+        gate.release();
+        for (const auto &job : {blocker, background, visible, interactive, promoted}) {
+            REQUIRE(waitFinished(job));
+            REQUIRE(job->m_actualFuture.isStarted());
+            REQUIRE_FALSE(job->m_actualFuture.isCanceled());
+        }
+        REQUIRE(executed == QStringList({QStringLiteral("d"), QStringLiteral("c"), QStringLiteral("b"), QStringLiteral("a1"), QStringLiteral("a2")}));
+        REQUIRE(background->m_actualFuture.resultCount() == 2);
+        REQUIRE(background->m_actualFuture.resultAt(0));
+        REQUIRE(background->m_actualFuture.resultAt(1));
+    }
+
+    SECTION("Canceled jobs are finished without running")
+    {
+        auto canceled = makeJob({QStringLiteral("x1"), QStringLiteral("x2")}, record);
+        auto kept = makeJob({QStringLiteral("y")}, record);
+        scheduler.enqueue(canceled, JobPriority::Interactive);
+        scheduler.enqueue(kept, JobPriority::Background);
+        canceled->m_futureInterface.cancel();
+
+        gate.release();
+        REQUIRE(waitFinished(canceled));
+        REQUIRE(waitFinished(kept));
+        REQUIRE(canceled->m_actualFuture.isCanceled());
+        REQUIRE_FALSE(canceled->m_actualFuture.isStarted());
+        REQUIRE(kept->m_actualFuture.isStarted());
+        REQUIRE(executed == QStringList({QStringLiteral("y")}));
+    }
+    REQUIRE(waitFinished(blocker));
+    REQUIRE(scheduler.queuedCount() == 0);
+}
@@ -0,0 +1,208 @@
+#include "test_utils.hpp"
+
+#include "utils/mediacache.hpp"
+
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <mlt++/MltProducer.h>
+
+Mlt::Profile profile_mediacache;
+
+namespace {
+QString writeFile(const QTemporaryDir &dir, const QString &name, const QByteArray &data)
+{
+    const QString path = dir.filePath(name);
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write(data);
+    file.close();
+    return path;
+}
+
+// Stand in for a producer that opened a media file
+std::unique_ptr<Mlt::Producer> probedProducer()
+{
+    std::unique_ptr<Mlt::Producer> producer(new Mlt::Producer(profile_mediacache, "color", "red"));
+    producer->set("mlt_service", "avformat");
+    producer->set("meta.media.nb_streams", 2);
+    producer->set("meta.media.0.stream.type", "video");
+    producer->set("meta.media.1.stream.type", "audio");
+    producer->set("length", 250);
+    producer->set("kdenlive:id", 3);
+    producer->set("_private", 1);
+    return producer;
+}
+} // namespace
+
+TEST_CASE("Media information cache", "[MediaCache]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    auto &cache = MediaCache::get();
+    cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+    cache->resetStats();
+    QByteArray data(3000000, 'a');
+    data[10] = 'b';
+    data[2999990] = 'c';
+    const QString media = writeFile(dir, QStringLiteral("media.mp4"), data);
+
+    SECTION("Files are identified by size, date and inode")
+    {
+        MediaCache::FileId id = MediaCache::identify(media);
+        REQUIRE(id.isValid());
+        REQUIRE(id.size == 3000000);
+        REQUIRE(MediaCache::identify(media) == id);
+        REQUIRE_FALSE(MediaCache::identify(dir.filePath(QStringLiteral("missing.mp4"))).isValid());
+        REQUIRE_FALSE(MediaCache::identify(dir.path()).isValid());
+    }
+
+    SECTION("Probed properties are restored until the file changes")
+    {
+        Mlt::Producer empty(profile_mediacache, "color", "blue");
+        REQUIRE_FALSE(cache->restoreProperties(media, empty));
+        REQUIRE(cache->stats().misses == 1);
+
+        cache->storeProperties(media, *probedProducer().get());
+        Mlt::Producer restored(profile_mediacache, "avformat-novalidate", media.toUtf8().constData());
+        REQUIRE(cache->restoreProperties(media, restored));
+        REQUIRE(cache->stats().hits == 1);
+        REQUIRE(restored.get_int("meta.media.nb_streams") == 2);
+        REQUIRE(QString(restored.get("meta.media.1.stream.type")) == QLatin1String("audio"));
+        REQUIRE(restored.get_int("length") == 250);
+        // Document and internal properties are not cached
+        REQUIRE(restored.get("kdenlive:id") == nullptr);
+        REQUIRE(restored.get("_private") == nullptr);
+        REQUIRE(QString(restored.get("mlt_service")) == QLatin1String("avformat-novalidate"));
+
+        // Modifying the file invalidates the entry
+        QFile file(media);
+        REQUIRE(file.open(QIODevice::Append));
+        file.write("more data");
+        file.close();
+        Mlt::Producer modified(profile_mediacache, "avformat-novalidate", media.toUtf8().constData());
+        REQUIRE_FALSE(cache->restoreProperties(media, modified));
+        REQUIRE(modified.get("meta.media.nb_streams") == nullptr);
+        REQUIRE(cache->stats().misses == 2);
+    }
+
+    SECTION("Only avformat producers are cached")
+    {
+        Mlt::Producer color(profile_mediacache, "color", "red");
+        color.set("length", 100);
+        cache->storeProperties(media, color);
+        Mlt::Producer restored(profile_mediacache, "color", "blue");
+        REQUIRE_FALSE(cache->restoreProperties(media, restored));
+    }
+
+    SECTION("File hash is computed once")
+    {
+        QByteArray hashed = data.left(1000000);
+        hashed.append(data.right(1000000));
+        const QString expected = QCryptographicHash::hash(hashed, QCryptographicHash::Md5).toHex();
+        qint64 size = 0;
+        qint64 readBytes = 0;
+        REQUIRE(cache->fileHash(media, &size, &readBytes) == expected);
+        REQUIRE(size == 3000000);
+        REQUIRE(readBytes == 2000000);
+        REQUIRE(cache->stats().hashMisses == 1);
+        REQUIRE(cache->fileHash(media, nullptr, &readBytes) == expected);
+        REQUIRE(readBytes == 0);
+        REQUIRE(cache->stats().hashHits == 1);
+        // Storing properties keeps the hash of an unchanged file
+        cache->storeProperties(media, *probedProducer().get());
+        REQUIRE(cache->fileHash(media) == expected);
+        REQUIRE(cache->stats().hashHits == 2);
+
+        const QString small = writeFile(dir, QStringLiteral("small.wav"), QByteArray("small file"));
+        REQUIRE(cache->fileHash(small) == QString(QCryptographicHash::hash(QByteArray("small file"), QCryptographicHash::Md5).toHex()));
+        REQUIRE(cache->fileHash(dir.filePath(QStringLiteral("missing.mp4"))).isEmpty());
+    }
+
+    SECTION("Cache is persistent")
+    {
+        const QString hash = cache->fileHash(media);
+        cache->storeProperties(media, *probedProducer().get());
+        cache->flush();
+        REQUIRE(QFile::exists(dir.filePath(QStringLiteral("mediainfo.cache"))));
+
+        // Reload from disk
+        cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+        cache->resetStats();
+        Mlt::Producer restored(profile_mediacache, "avformat-novalidate", media.toUtf8().constData());
+        REQUIRE(cache->restoreProperties(media, restored));
+        REQUIRE(restored.get_int("meta.media.nb_streams") == 2);
+        REQUIRE(cache->fileHash(media) == hash);
+        REQUIRE(cache->stats().hashHits == 1);
+
+        // A corrupted cache file is ignored
+        writeFile(dir, QStringLiteral("mediainfo.cache"), QByteArray("garbage"));
+        cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+        REQUIRE_FALSE(cache->restoreProperties(media, restored));
+    }
+    cache->clear();
+    cache->resetStats();
+}
+
+TEST_CASE("Cold and warm media information", "[.][Benchmark][MediaCache]")
+{
+    // Set KDENLIVE_BENCH_MEDIA to a media file to also measure the avformat probing, only hashing is measured otherwise
+    const QString media = qEnvironmentVariable("KDENLIVE_BENCH_MEDIA");
+    const int fileCount = 100;
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QStringList files;
+    const QByteArray data(5000000, 'k');
+    for (int i = 0; i < fileCount; ++i) {
+        const QString name = QStringLiteral("clip%1.%2").arg(i).arg(media.isEmpty() ? QStringLiteral("bin") : QFileInfo(media).suffix());
+        if (media.isEmpty()) {
+            files << writeFile(dir, name, data);
+        } else {
+            REQUIRE(QFile::copy(media, dir.filePath(name)));
+            files << dir.filePath(name);
+        }
+    }
+    auto &cache = MediaCache::get();
+    cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+
+    // Same steps as LoadJob and ProjectClip::getFileHash for an avformat clip
+    auto openAll = [&]() {
+        for (const QString &file : files) {
+            REQUIRE_FALSE(cache->fileHash(file).isEmpty());
+            if (media.isEmpty()) {
+                continue;
+            }
+            Mlt::Producer cached(profile_mediacache, "avformat-novalidate", file.toUtf8().constData());
+            if (!cache->restoreProperties(file, cached)) {
+                Mlt::Producer probed(profile_mediacache, "avformat", file.toUtf8().constData());
+                REQUIRE(probed.is_valid());
+                cache->storeProperties(file, probed);
+            }
+        }
+    };
+
+    for (bool warm : {false, true}) {
+        if (warm) {
+            // Start from what the previous session stored on disk
+            cache->flush();
+            cache->setCacheFile(dir.filePath(QStringLiteral("mediainfo.cache")));
+        }
+        cache->resetStats();
+        QElapsedTimer timer;
+        timer.start();
+        openAll();
+        const qint64 elapsed = timer.elapsed();
+        const MediaCache::Stats stats = cache->stats();
+        if (warm) {
+            REQUIRE(stats.hashMisses == 0);
+            REQUIRE(stats.misses == 0);
+        }
+        WARN((warm ? "Warm: " : "Cold: ") << elapsed << "ms for " << fileCount << " files, hash hits: " << stats.hashHits << ", misses: " << stats.hashMisses
+                                         << ", media hits: " << stats.hits << ", misses: " << stats.misses);
+    }
+    // Cold reads come from the page cache here, the gap is much larger with files on a network share
+    cache->clear();
+    cache->resetStats();
+}
@@ -0,0 +1,145 @@
+#include "catch.hpp"
+#include "scopes/colorscopes/histogramgenerator.h"
+#include "scopes/colorscopes/rgbparadegenerator.h"
+#include "scopes/colorscopes/scopekernels.h"
+#include "scopes/colorscopes/vectorscopegenerator.h"
+#include "scopes/colorscopes/waveformgenerator.h"
+
+#include <QImage>
+#include <QThread>
+#include <random>
+
+namespace {
+QImage randomFrame(int width, int height)
+{
+    std::mt19937 gen(42);
+    QImage frame(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y) {
+        auto *line = reinterpret_cast<QRgb *>(frame.scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            line[x] = qRgb(int(gen() % 256), int(gen() % 256), int(gen() % 256));
+        }
+    }
+    return frame;
+}
+} // namespace
+
+TEST_CASE("Scope kernels", "[Scopes]")
+{
+    SECTION("Vectorized luma matches the scalar version")
+    {
+        QImage frame = randomFrame(1037, 3);
+        const auto *pixels = reinterpret_cast<const QRgb *>(frame.constBits());
+        for (bool rec709 : {false, true}) {
+            for (int count : {0, 7, 16, 31, 32, 33, 100, 1037}) {
+                std::vector<uchar> vectorized((size_t)count), scalar((size_t)count);
+                ScopeKernels::luma(pixels, count, rec709, vectorized.data());
+                ScopeKernels::lumaScalar(pixels, count, rec709, scalar.data());
+                REQUIRE(vectorized == scalar);
+            }
+        }
+        const QRgb white = qRgb(255, 255, 255);
+        uchar l;
+        ScopeKernels::luma(&white, 1, false, &l);
+        REQUIRE(l == 255);
+    }
+
+    SECTION("Partial histograms are merged")
+    {
+        ScopeKernels::Histograms histograms(100, 4);
+        REQUIRE(histograms.blocks() == 4);
+        ScopeKernels::forEachBlock(1000, histograms.blocks(), [&](int block, int first, int last) {
+            for (int row = first; row < last; ++row) {
+                histograms.block(block)[row % 100]++;
+            }
+        });
+        const uint *bins = histograms.merge();
+        for (int i = 0; i < 100; ++i) {
+            REQUIRE(bins[i] == 10);
+        }
+    }
+
+    SECTION("Histograms are cleared and reused between frames")
+    {
+        ScopeKernels::Histograms histograms;
+        histograms.reset(1000, 4);
+        const uint *data = histograms.block(0);
+        histograms.block(0)[0] = 1;
+        histograms.block(3)[999] = 5;
+        histograms.reset(100, 2);
+        REQUIRE(histograms.block(0) == data);
+        REQUIRE(histograms.bins() == 100);
+        REQUIRE(histograms.blocks() == 2);
+        for (int block = 0; block < 2; ++block) {
+            for (int i = 0; i < 100; ++i) {
+                REQUIRE(histograms.block(block)[i] == 0);
+            }
+        }
+        // Partial histograms are limited by their memory, not only by the pixel count
+        const qint64 pixels = qint64(1) << 40;
+        REQUIRE(ScopeKernels::blockCount(pixels, 256) == qMax(1, QThread::idealThreadCount()));
+        REQUIRE(ScopeKernels::blockCount(pixels, 8 * 1024 * 1024) == 1);
+    }
+
+    SECTION("Generators draw a single color frame")
+    {
+        QImage frame(640, 360, QImage::Format_RGB32);
+        frame.fill(qRgb(200, 50, 50));
+        WaveformGenerator waveform;
+        QImage wave = waveform.calculateWaveform(QSize(300, 256), frame, WaveformGenerator::PaintMode_Yellow, false, WaveformGenerator::Rec_709);
+        REQUIRE(wave.size() == QSize(300, 256));
+        // All pixels share the same luma, so only one line of the waveform is lit
+        int litRows = 0;
+        for (int y = 0; y < wave.height(); ++y) {
+            if (qAlpha(wave.pixel(150, y)) > 0) {
+                litRows++;
+            }
+        }
+        REQUIRE(litRows == 1);
+
+        VectorscopeGenerator vectorscope;
+        QImage scope = vectorscope.calculateVectorscope(QSize(200, 200), frame, 1.f, VectorscopeGenerator::PaintMode_Original,
+                                                        VectorscopeGenerator::ColorSpace_YUV, false);
+        int litPixels = 0;
+        for (int y = 0; y < scope.height(); ++y) {
+            for (int x = 0; x < scope.width(); ++x) {
+                if (scope.pixel(x, y) != 0) {
+                    REQUIRE(scope.pixel(x, y) == frame.pixel(0, 0));
+                    litPixels++;
+                }
+            }
+        }
+        REQUIRE(litPixels == 1);
+    }
+}
+
+TEST_CASE("Color scope rendering", "[.][Benchmark][Scopes]")
+{
+    WARN("Luma kernel: " << ScopeKernels::lumaInstructionSet());
+    const QSize scopeSize(800, 400);
+    WaveformGenerator waveform;
+    RGBParadeGenerator parade;
+    HistogramGenerator histogram;
+    VectorscopeGenerator vectorscope;
+    for (const QSize &size : {QSize(1920, 1080), QSize(3840, 2160), QSize(7680, 4320)}) {
+        QImage frame = randomFrame(size.width(), size.height());
+        const std::string name = QStringLiteral("%1x%2").arg(size.width()).arg(size.height()).toStdString();
+        BENCHMARK("Waveform " + name)
+        {
+            waveform.calculateWaveform(scopeSize, frame, WaveformGenerator::PaintMode_Green, true, WaveformGenerator::Rec_709);
+        }
+        BENCHMARK("RGB parade " + name)
+        {
+            parade.calculateRGBParade(scopeSize, frame, RGBParadeGenerator::PaintMode_RGB, true, false);
+        }
+        BENCHMARK("Histogram " + name)
+        {
+            histogram.calculateHistogram(scopeSize, frame, HistogramGenerator::ComponentY | HistogramGenerator::ComponentR | HistogramGenerator::ComponentSum,
+                                         HistogramGenerator::Rec_709, false);
+        }
+        BENCHMARK("Vectorscope " + name)
+        {
+            vectorscope.calculateVectorscope(scopeSize, frame, 1.f, VectorscopeGenerator::PaintMode_Green2, VectorscopeGenerator::ColorSpace_YUV, false);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+#include "catch.hpp"
+
+#include "../renderer/segmentplanner.hpp"
+
+#include <random>
+
+using Ranges = QVector<QPair<int, int>>;
+
+TEST_CASE("Render zone split in segments", "[SegmentPlanner]")
+{
+    SECTION("A single segment is the whole zone")
+    {
+        REQUIRE(SegmentPlanner::plan(0, 99, 1, 0, 1) == Ranges({{0, 99}}));
+        REQUIRE(SegmentPlanner::plan(10, 250, 0, 25, 1) == Ranges({{10, 250}}));
+    }
+
+    SECTION("Even split")
+    {
+        REQUIRE(SegmentPlanner::plan(0, 99, 4, 0, 1) == Ranges({{0, 24}, {25, 49}, {50, 74}, {75, 99}}));
+    }
+
+    SECTION("Count not dividing the length")
+    {
+        // The last segment ends on the zone out point
+        REQUIRE(SegmentPlanner::plan(10, 109, 3, 0, 1) == Ranges({{10, 42}, {43, 75}, {76, 109}}));
+        REQUIRE(SegmentPlanner::plan(0, 10, 4, 0, 1) == Ranges({{0, 1}, {2, 4}, {5, 7}, {8, 10}}));
+    }
+
+    SECTION("Boundaries rounded to the GOP, relative to the in point")
+    {
+        REQUIRE(SegmentPlanner::plan(0, 999, 3, 25, 1) == Ranges({{0, 324}, {325, 674}, {675, 999}}));
+        REQUIRE(SegmentPlanner::plan(100, 1099, 3, 25, 1) == Ranges({{100, 424}, {425, 774}, {775, 1099}}));
+    }
+
+    SECTION("Boundaries collapsing on the same GOP are merged")
+    {
+        REQUIRE(SegmentPlanner::plan(0, 99, 4, 50, 1) == Ranges({{0, 49}, {50, 99}}));
+        // Rounding beyond the out point drops the boundary
+        REQUIRE(SegmentPlanner::plan(0, 109, 8, 64, 1) == Ranges({{0, 63}, {64, 109}}));
+    }
+
+    SECTION("Zone shorter than the segment count")
+    {
+        REQUIRE(SegmentPlanner::plan(5, 7, 8, 0, 1) == Ranges({{5, 5}, {6, 6}, {7, 7}}));
+        REQUIRE(SegmentPlanner::plan(5, 5, 8, 0, 1) == Ranges({{5, 5}}));
+    }
+
+    SECTION("Minimum segment length")
+    {
+        REQUIRE(SegmentPlanner::plan(0, 99, 8, 0, 30) == Ranges({{0, 32}, {33, 65}, {66, 99}}));
+        REQUIRE(SegmentPlanner::plan(0, 10, 8, 0, 30) == Ranges({{0, 10}}));
+    }
+
+    SECTION("Segments always cover the zone")
+    {
+        std::mt19937 gen(42);
+        for (int i = 0; i < 2000; ++i) {
+            const int in = int(gen() % 500);
+            const int out = in + int(gen() % 3000);
+            const int count = 1 + int(gen() % 16);
+            const int gop = int(gen() % 4) == 0 ? 0 : 1 + int(gen() % 300);
+            const int minimumLength = 1 + int(gen() % 200);
+            const Ranges ranges = SegmentPlanner::plan(in, out, count, gop, minimumLength);
+            REQUIRE(!ranges.isEmpty());
+            REQUIRE(ranges.size() <= count);
+            REQUIRE(ranges.first().first == in);
+            REQUIRE(ranges.last().second == out);
+            for (int j = 0; j < ranges.size(); ++j) {
+                REQUIRE(ranges.at(j).first <= ranges.at(j).second);
+                if (j > 0) {
+                    REQUIRE(ranges.at(j).first == ranges.at(j - 1).second + 1);
+                    if (gop > 0) {
+                        REQUIRE((ranges.at(j).first - in) % gop == 0);
+                    }
+                }
+            }
+        }
+    }
+}
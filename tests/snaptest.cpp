@@ -1,8 +1,47 @@
 #include "catch.hpp"
 #include "timeline2/model/snapmodel.hpp"
+#include <QElapsedTimer>
+#include <QtGlobal>
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <unordered_set>
 
+namespace {
+// Previous implementation of TimelineModel::getBestSnapPos, ignoring the moved points in the snap model
+int ignoringBestSnapPos(SnapModel &snap, int referencePos, int diff, std::vector<int> pts, int cursorPosition, int snapDistance)
+{
+    snap.ignore(pts);
+    std::sort(pts.begin(), pts.end());
+    pts.erase(std::unique(pts.begin(), pts.end()), pts.end());
+    snap.addPoint(cursorPosition);
+    int closest = -1;
+    int lowestDiff = snapDistance + 1;
+    for (int point : pts) {
+        int snapped = snap.getClosestPoint(point + diff);
+        int currentDiff = qAbs(point + diff - snapped);
+        if (currentDiff < lowestDiff) {
+            lowestDiff = currentDiff;
+            closest = snapped - (point - referencePos);
+            if (lowestDiff < 2) {
+                break;
+            }
+        }
+    }
+    snap.unIgnore();
+    snap.removePoint(cursorPosition);
+    return closest;
+}
+
+// Same search as TimelineModel::getBestSnapPos
+int excludingBestSnapPos(const SnapModel &snap, int referencePos, int diff, std::vector<int> pts, int cursorPosition, int snapDistance)
+{
+    std::sort(pts.begin(), pts.end());
+    const std::pair<int, int> best = snap.getBestSnap(pts, diff, snapDistance, cursorPosition);
+    return best.second == -1 ? -1 : best.second - (best.first - referencePos);
+}
+} // namespace
+
 TEST_CASE("Snap points model test", "[SnapModel]")
 {
     SnapModel snap;
@@ -124,3 +163,114 @@ TEST_CASE("Snap points model test", "[SnapModel]")
         REQUIRE(snap.getClosestPoint(999) == 15);
     }
 }
+
+TEST_CASE("Snap queries with excluded points", "[SnapModel]")
+{
+    SnapModel snap;
+    snap.addPoint(10);
+    snap.addPoint(10);
+    snap.addPoint(15);
+    snap.addPoint(40);
+
+    REQUIRE(snap.getClosestPoint(12, 5, {}) == 10);
+    REQUIRE(snap.getClosestPoint(13, 5, {}) == 15);
+    REQUIRE(snap.getClosestPoint(25, 5, {}) == -1);
+    REQUIRE(snap.getClosestPoint(25, 5, {}, 22) == 22);
+    REQUIRE(snap.getClosestPoint(12, -1, {}) == -1);
+    // A position is only hidden if all its elements are excluded
+    REQUIRE(snap.getClosestPoint(11, 5, {10}) == 10);
+    REQUIRE(snap.getClosestPoint(11, 5, {10, 10}) == 15);
+    REQUIRE(snap.getClosestPoint(11, 5, {10, 10, 15}) == -1);
+    REQUIRE(snap.getClosestPoint(11, 50, {10, 10, 15}) == 40);
+    // On equal distances, the next point is preferred
+    REQUIRE(snap.getClosestPoint(25, 15, {15}) == 40);
+    REQUIRE(snap.getClosestPoint(25, 15, {15}, 10) == 40);
+    // Moving the points 10 and 15 by 20: 15 is the first to snap, to 40
+    REQUIRE(snap.getBestSnap({10, 15}, 20, 10) == std::make_pair(15, 40));
+    REQUIRE(snap.getBestSnap({10, 15}, 20, 4) == std::make_pair(-1, -1));
+    REQUIRE(snap.getBestSnap({10, 15}, 20, 4, 31) == std::make_pair(10, 31));
+    // The snap points are not modified
+    REQUIRE(snap._snaps() == std::map<int, int>({{10, 2}, {15, 1}, {40, 1}}));
+
+    SECTION("Same result as ignoring the points")
+    {
+        std::mt19937 gen(42);
+        for (int round = 0; round < 200; ++round) {
+            SnapModel random;
+            std::vector<int> points;
+            for (int i = 0; i < 30; ++i) {
+                points.push_back(int(gen() % 200));
+                random.addPoint(points.back());
+            }
+            // A group of moved items
+            std::vector<int> moved(points.begin(), points.begin() + int(gen() % 30));
+            const int cursor = int(gen() % 200);
+            const int diff = int(gen() % 41) - 20;
+            const int snapDistance = int(gen() % 10) - 1;
+            const int reference = moved.empty() ? 0 : moved.front();
+            if (!moved.empty()) {
+                REQUIRE(excludingBestSnapPos(random, reference, diff, moved, cursor, snapDistance) ==
+                        ignoringBestSnapPos(random, reference, diff, moved, cursor, snapDistance));
+            }
+            std::vector<int> boundaries(points.begin(), points.begin() + 2);
+            const int in = std::min(boundaries[0], boundaries[1]);
+            const int out = std::max(boundaries[0], boundaries[1]);
+            random.ignore(boundaries);
+            random.addPoint(cursor);
+            const int target = int(gen() % 200);
+            const int expected = random.getClosestPoint(target);
+            random.removePoint(cursor);
+            random.unIgnore();
+            REQUIRE(random.getClosestPoint(target, snapDistance, std::vector<int>({in, out}), cursor) ==
+                    (snapDistance >= 0 && qAbs(expected - target) <= snapDistance ? expected : -1));
+            REQUIRE(random.proposeSize(in, out, target - in + 1, true, snapDistance, cursor) ==
+                    (snapDistance >= 0 && qAbs(expected - target) <= snapDistance ? expected - in : -1));
+        }
+    }
+}
+
+TEST_CASE("Snap while dragging a group", "[.][Benchmark][SnapModel]")
+{
+    // Another track with 20000 clips of 20 frames separated by gaps of 5 frames
+    SnapModel snap;
+    for (int i = 0; i < 20000; ++i) {
+        snap.addPoint(i * 25 + 3);
+        snap.addPoint(i * 25 + 23);
+    }
+    std::mt19937 gen(1);
+    const int events = 200;
+    for (int groupSize : {10, 100, 1000, 5000}) {
+        // The dragged group, with the same layout
+        std::vector<int> pts;
+        for (int i = 0; i < groupSize; ++i) {
+            pts.push_back(i * 25);
+            pts.push_back(i * 25 + 20);
+        }
+        for (int pt : pts) {
+            snap.addPoint(pt);
+        }
+        std::vector<int> diffs;
+        for (int i = 0; i < events; ++i) {
+            diffs.push_back(int(gen() % 101) - 50);
+        }
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<int> previous;
+        for (int diff : diffs) {
+            previous.push_back(ignoringBestSnapPos(snap, 0, diff, pts, 250000, 2));
+        }
+        const qint64 ignoring = timer.nsecsElapsed();
+        timer.restart();
+        std::vector<int> excluding;
+        for (int diff : diffs) {
+            excluding.push_back(excludingBestSnapPos(snap, 0, diff, pts, 250000, 2));
+        }
+        const qint64 excluded = timer.nsecsElapsed();
+        REQUIRE(previous == excluding);
+        WARN("Group of " << groupSize << " clips: ignoring points " << ignoring / events / 1000 << "us per mouse move, excluding points "
+                         << excluded / events / 1000 << "us per mouse move");
+        for (int pt : pts) {
+            snap.removePoint(pt);
+        }
+    }
+}
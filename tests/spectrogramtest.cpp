@@ -0,0 +1,206 @@
+#include "catch.hpp"
+#include "lib/audio/fftTools.h"
+#include "scopes/audioscopes/spectrogramengine.h"
+
+#include <QElapsedTimer>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+audioShortVector sine(int samples, int channels, double cycles, double amplitude)
+{
+    audioShortVector frame(samples * channels);
+    for (int i = 0; i < samples; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            frame[i * channels + c] = qint16(32767 * amplitude * sin(2 * M_PI * cycles * i / samples));
+        }
+    }
+    return frame;
+}
+
+audioShortVector noise(int samples, int channels, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> dist(-20000, 20000);
+    audioShortVector frame(samples * channels);
+    for (qint16 &v : frame) {
+        v = qint16(dist(gen));
+    }
+    return frame;
+}
+
+// The previous implementation, computing the window on each call
+std::vector<float> referenceSpectrum(const audioShortVector &frame, int channels, FFTTools::WindowType type, int size)
+{
+    const QVector<float> window = FFTTools::window(type, size, 0);
+    std::vector<float> data((size_t)size);
+    for (int i = 0; i < size; ++i) {
+        data[(size_t)i] = float(frame[i * channels]) / 32767.0f * window[i];
+    }
+    std::vector<kiss_fft_cpx> freq((size_t)size / 2 + 1);
+    kiss_fftr_cfg cfg = kiss_fftr_alloc(size, 0, nullptr, nullptr);
+    kiss_fftr(cfg, data.data(), freq.data());
+    free(cfg);
+    const float scale = 1.0f / window[size];
+    std::vector<float> spectrum((size_t)size / 2);
+    for (size_t i = 0; i < spectrum.size(); ++i) {
+        spectrum[i] = float(20 * log(pow(pow(fabs(freq[i].r * scale), 2) + pow(fabs(freq[i].i * scale), 2), .5) / ((float)size / 2.0f)) / log(10));
+    }
+    return spectrum;
+}
+
+QRgb colorMap[256];
+
+SpectrogramEngine::Display display(int width, int height)
+{
+    for (int i = 0; i < 256; ++i) {
+        colorMap[i] = qRgb(i, 255 - i, i / 2);
+    }
+    SpectrogramEngine::Display display;
+    display.size = QSize(width, height);
+    display.freqRatio = 0.5f;
+    display.dBmin = -90;
+    display.dBmax = -10;
+    display.highlightPeaks = true;
+    display.colorMap = colorMap;
+    display.highlight = qRgb(255, 0, 0);
+    return display;
+}
+} // namespace
+
+TEST_CASE("FFT tools", "[Spectrogram]")
+{
+    FFTTools fft;
+
+    SECTION("Sine peak")
+    {
+        const int size = 1024;
+        audioShortVector frame = sine(size, 2, 64, 0.5);
+        std::vector<float> spectrum(size / 2);
+        fft.fftNormalized(frame, 1, 2, spectrum.data(), FFTTools::Window_Rect, size);
+        auto peak = std::max_element(spectrum.begin(), spectrum.end());
+        REQUIRE(peak - spectrum.begin() == 64);
+        REQUIRE(*peak == Approx(20 * log10(0.5)).margin(0.05));
+    }
+
+    SECTION("Same result as the previous implementation")
+    {
+        for (auto type : {FFTTools::Window_Rect, FFTTools::Window_Triangle, FFTTools::Window_Hamming}) {
+            for (int size : {256, 2048, 16384}) {
+                audioShortVector frame = noise(size, 2, unsigned(size));
+                std::vector<float> expected = referenceSpectrum(frame, 2, type, size);
+                std::vector<float> spectrum(size / 2);
+                // Twice, so that the cached window and plan are used
+                fft.fftNormalized(frame, 0, 2, spectrum.data(), type, (uint)size);
+                fft.fftNormalized(frame, 0, 2, spectrum.data(), type, (uint)size);
+                for (size_t i = 0; i < spectrum.size(); ++i) {
+                    REQUIRE(spectrum[i] == Approx(expected[i]).margin(0.01));
+                }
+            }
+        }
+    }
+
+    SECTION("Short frames are padded with silence")
+    {
+        audioShortVector frame = noise(100, 1, 7);
+        std::vector<float> spectrum(128);
+        fft.fftNormalized(frame, 0, 1, spectrum.data(), FFTTools::Window_Hamming, 256);
+        frame.resize(256);
+        std::vector<float> expected = referenceSpectrum(frame, 1, FFTTools::Window_Hamming, 256);
+        for (size_t i = 0; i < spectrum.size(); ++i) {
+            REQUIRE(spectrum[i] == Approx(expected[i]).margin(0.01));
+        }
+    }
+}
+
+TEST_CASE("Spectrogram history", "[Spectrogram]")
+{
+    SpectrogramEngine engine(3);
+    FFTTools fft;
+    std::vector<std::vector<float>> expected;
+    for (int i = 0; i < 5; ++i) {
+        // Window size changes are kept in the history
+        const int size = i < 2 ? 256 : 512;
+        audioShortVector frame = noise(size, 1, unsigned(i));
+        engine.addFrame(frame, 0, 1, FFTTools::Window_Hamming, (uint)size);
+        expected.emplace_back(size / 2);
+        fft.fftNormalized(frame, 0, 1, expected.back().data(), FFTTools::Window_Hamming, (uint)size);
+    }
+    REQUIRE(engine.historyCount() == 3);
+    for (int age = 0; age < 3; ++age) {
+        int bins = 0;
+        const float *spectrum = engine.spectrum(age, &bins);
+        const std::vector<float> &reference = expected.at(size_t(4 - age));
+        REQUIRE(bins == int(reference.size()));
+        REQUIRE(std::vector<float>(spectrum, spectrum + bins) == reference);
+    }
+    int bins = 0;
+    REQUIRE(engine.spectrum(3, &bins) == nullptr);
+}
+
+TEST_CASE("Spectrogram image", "[Spectrogram]")
+{
+    const int width = 200;
+    const int height = 30;
+    SpectrogramEngine incremental(100);
+    incremental.setDisplay(display(width, height));
+    SpectrogramEngine redrawn(100);
+    for (int i = 0; i < 45; ++i) {
+        audioShortVector frame = i % 3 == 0 ? sine(512, 2, i + 3, 0.8) : noise(512, 2, unsigned(i));
+        incremental.addFrame(frame, 0, 2, FFTTools::Window_Hamming, 512);
+        redrawn.addFrame(frame, 0, 2, FFTTools::Window_Hamming, 512);
+        if (i == 10) {
+            // Fewer lines than the image height
+            SpectrogramEngine partial(100);
+            partial.addFrame(frame, 0, 2, FFTTools::Window_Hamming, 512);
+            partial.setDisplay(display(width, height));
+            QImage image = partial.image();
+            REQUIRE(qAlpha(image.pixel(10, height - 2)) == 0);
+            REQUIRE(qAlpha(image.pixel(10, height - 1)) == 255);
+        }
+    }
+    redrawn.setDisplay(display(width, height));
+    REQUIRE(incremental.image() == redrawn.image());
+
+    // Changing a parameter redraws from the history
+    SpectrogramEngine::Display other = display(width, height);
+    other.dBmin = -60;
+    incremental.setDisplay(other);
+    REQUIRE(incremental.image() != redrawn.image());
+    redrawn.setDisplay(other);
+    REQUIRE(incremental.image() == redrawn.image());
+}
+
+TEST_CASE("Spectrogram rendering", "[.][Benchmark][Spectrogram]")
+{
+    const QSize scope(800, 400);
+    const int frames = 200;
+    for (int size : {4096, 16384}) {
+        audioShortVector frame = noise(size, 2, 1);
+        for (int history : {10, 1000}) {
+            SpectrogramEngine engine(1000);
+            engine.setDisplay(display(scope.width(), scope.height()));
+            for (int i = 0; i < history; ++i) {
+                engine.addFrame(frame, 0, 2, FFTTools::Window_Hamming, (uint)size);
+            }
+            QImage spectrum(scope, QImage::Format_ARGB32);
+            QElapsedTimer timer;
+            timer.start();
+            for (int i = 0; i < frames; ++i) {
+                engine.addFrame(frame, 0, 2, FFTTools::Window_Hamming, (uint)size);
+                spectrum.fill(qRgba(0, 0, 0, 0));
+                QPainter painter(&spectrum);
+                engine.paint(painter, QPoint());
+            }
+            const qint64 frameTime = timer.nsecsElapsed() / frames / 1000;
+            timer.restart();
+            SpectrogramEngine::Display other = display(scope.width(), scope.height());
+            other.dBmin = -100;
+            engine.setDisplay(other);
+            const qint64 redrawTime = timer.nsecsElapsed() / 1000;
+            WARN("FFT size " << size << ", " << history << " spectra in history: " << frameTime << "us per frame, full redraw " << redrawTime << "us");
+        }
+    }
+}
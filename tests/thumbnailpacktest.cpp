@@ -0,0 +1,191 @@
+#include "catch.hpp"
+#include "utils/thumbnailpack.hpp"
+
+#include <QDir>
+#include <QPainter>
+#include <QTemporaryDir>
+#include <random>
+
+namespace {
+QImage makeThumb(int pos)
+{
+    QImage img(160, 90, QImage::Format_ARGB32_Premultiplied);
+    img.fill(QColor(pos % 255, (pos * 7) % 255, (pos * 13) % 255));
+    QPainter p(&img);
+    p.drawText(img.rect(), Qt::AlignCenter, QString::number(pos));
+    p.end();
+    return img;
+}
+/** @brief Overwrite a 32 bits field of the first record of the pack */
+void corruptFirstRecord(const QString &packPath, int field, quint32 value)
+{
+    QFile file(packPath);
+    REQUIRE(file.open(QIODevice::ReadWrite));
+    // 8 bytes pack header, then the record header fields
+    REQUIRE(file.seek(8 + 4 * field));
+    REQUIRE(file.write(reinterpret_cast<const char *>(&value), sizeof(value)) == sizeof(value));
+}
+} // namespace
+
+TEST_CASE("Thumbnail pack storage", "[ThumbnailPack]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    const QString packPath = QDir(dir.path()).absoluteFilePath(QStringLiteral("clip") + ThumbnailPack::extension());
+
+    SECTION("Store and read back")
+    {
+        ThumbnailPack pack(packPath);
+        REQUIRE_FALSE(pack.exists());
+        REQUIRE(pack.count() == 0);
+        REQUIRE_FALSE(pack.contains(10));
+        REQUIRE(pack.image(10).isNull());
+
+        for (int pos : {50, 10, 30}) {
+            REQUIRE(pack.store(pos, makeThumb(pos)));
+        }
+        REQUIRE(pack.exists());
+        REQUIRE(pack.count() == 3);
+        REQUIRE(pack.positions() == std::vector<int>({10, 30, 50}));
+        REQUIRE(pack.image(30) == makeThumb(30));
+        REQUIRE_FALSE(pack.contains(20));
+
+        // Overwrite an existing frame
+        REQUIRE(pack.store(30, makeThumb(31)));
+        REQUIRE(pack.count() == 3);
+        REQUIRE(pack.image(30) == makeThumb(31));
+    }
+
+    SECTION("Reopen and recover from truncated write")
+    {
+        {
+            ThumbnailPack pack(packPath);
+            for (int pos = 0; pos < 20; ++pos) {
+                REQUIRE(pack.store(pos, makeThumb(pos)));
+            }
+            REQUIRE(pack.store(5, makeThumb(100)));
+        }
+        ThumbnailPack reopened(packPath);
+        REQUIRE(reopened.count() == 20);
+        REQUIRE(reopened.image(5) == makeThumb(100));
+        REQUIRE(reopened.image(19) == makeThumb(19));
+
+        // Simulate a crash in the middle of the last record
+        QFile file(packPath);
+        qint64 size = file.size();
+        REQUIRE(file.resize(size - 100));
+        ThumbnailPack truncated(packPath);
+        REQUIRE(truncated.count() == 20);
+        REQUIRE(truncated.image(5) == makeThumb(5));
+        REQUIRE(truncated.store(5, makeThumb(200)));
+        REQUIRE(truncated.image(5) == makeThumb(200));
+    }
+
+    SECTION("Import legacy files")
+    {
+        std::vector<std::pair<int, QString>> files;
+        for (int pos = 0; pos < 5; ++pos) {
+            QString path = QDir(dir.path()).absoluteFilePath(QStringLiteral("clip#%1.png").arg(pos));
+            REQUIRE(makeThumb(pos).save(path));
+            files.emplace_back(pos, path);
+        }
+        ThumbnailPack pack(packPath);
+        REQUIRE(pack.importFiles(files) == 5);
+        REQUIRE(pack.count() == 5);
+        REQUIRE(pack.image(3) == makeThumb(3).convertToFormat(pack.image(3).format()));
+        for (const auto &file : files) {
+            REQUIRE_FALSE(QFile::exists(file.second));
+        }
+        pack.remove();
+        REQUIRE_FALSE(QFile::exists(packPath));
+        REQUIRE_FALSE(pack.exists());
+        REQUIRE(pack.count() == 0);
+        REQUIRE(pack.store(3, makeThumb(3)));
+        REQUIRE(pack.exists());
+        REQUIRE(pack.count() == 1);
+    }
+
+    SECTION("Legacy files that cannot be imported are kept")
+    {
+        const QString valid = QDir(dir.path()).absoluteFilePath(QStringLiteral("clip#1.png"));
+        const QString existing = QDir(dir.path()).absoluteFilePath(QStringLiteral("clip#2.png"));
+        const QString corrupt = QDir(dir.path()).absoluteFilePath(QStringLiteral("clip#3.png"));
+        REQUIRE(makeThumb(1).save(valid));
+        REQUIRE(makeThumb(2).save(existing));
+        QFile file(corrupt);
+        REQUIRE(file.open(QIODevice::WriteOnly));
+        file.write("not a png");
+        file.close();
+        ThumbnailPack pack(packPath);
+        REQUIRE(pack.store(2, makeThumb(20)));
+        REQUIRE(pack.importFiles({{1, valid}, {2, existing}, {3, corrupt}}) == 1);
+        REQUIRE_FALSE(QFile::exists(valid));
+        // Already in the pack
+        REQUIRE_FALSE(QFile::exists(existing));
+        REQUIRE(pack.image(2) == makeThumb(20));
+        REQUIRE(QFile::exists(corrupt));
+        REQUIRE_FALSE(pack.contains(3));
+    }
+
+    SECTION("Corrupted records are rejected")
+    {
+        // Noise does not compress, so the record is stored raw
+        std::mt19937 gen(42);
+        QImage noise(64, 32, QImage::Format_ARGB32);
+        for (int y = 0; y < noise.height(); ++y) {
+            for (int x = 0; x < noise.width(); ++x) {
+                noise.setPixel(x, y, gen() | 0xff000000);
+            }
+        }
+        // Fields are magic, pos, width, height, bytesPerLine, format, flags, size
+        const std::vector<std::pair<int, quint32>> corruptions{{4, 100000}, {4, 16}, {2, 1000}, {5, 0}, {5, 1000}, {7, 1000}};
+        for (const auto &corruption : corruptions) {
+            {
+                ThumbnailPack pack(packPath);
+                REQUIRE(pack.store(0, noise));
+            }
+            {
+                ThumbnailPack pack(packPath);
+                REQUIRE(pack.image(0) == noise);
+            }
+            corruptFirstRecord(packPath, corruption.first, corruption.second);
+            ThumbnailPack pack(packPath);
+            REQUIRE(pack.image(0).isNull());
+            // The broken pack is dropped
+            REQUIRE_FALSE(QFile::exists(packPath));
+            REQUIRE(pack.count() == 0);
+        }
+    }
+}
+
+TEST_CASE("Thumbnail cold open latency", "[.][Benchmark][ThumbnailPack]")
+{
+    QTemporaryDir dir;
+    REQUIRE(dir.isValid());
+    QDir folder(dir.path());
+    const int count = 2000;
+    {
+        ThumbnailPack pack(folder.absoluteFilePath(QStringLiteral("clip") + ThumbnailPack::extension()));
+        for (int pos = 0; pos < count; ++pos) {
+            QImage img = makeThumb(pos);
+            img.save(folder.absoluteFilePath(QStringLiteral("clip#%1.png").arg(pos)));
+            pack.store(pos, img);
+        }
+    }
+
+    BENCHMARK("Read one png file per frame")
+    {
+        for (int pos = 0; pos < count; ++pos) {
+            QImage img(folder.absoluteFilePath(QStringLiteral("clip#%1.png").arg(pos)));
+            REQUIRE_FALSE(img.isNull());
+        }
+    }
+
+    BENCHMARK("Open pack and read all frames")
+    {
+        ThumbnailPack pack(folder.absoluteFilePath(QStringLiteral("clip") + ThumbnailPack::extension()));
+        for (int pos = 0; pos < count; ++pos) {
+            REQUIRE_FALSE(pack.image(pos).isNull());
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include "test_utils.hpp"
+
+#include "utils/thumbnailscheduler.hpp"
+
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <map>
+
+namespace {
+// Decodes like a long GOP video: a frame is decoded from the previous keyframe, unless the decoder is already before it in the same GOP
+class SimulatedDecoder
+{
+public:
+    SimulatedDecoder(int gop, qint64 frameCost)
+        : m_gop(gop)
+        , m_frameCost(frameCost)
+    {
+    }
+
+    QImage decode(int frame)
+    {
+        const int keyframe = frame / m_gop * m_gop;
+        const int start = (m_position >= keyframe && m_position < frame) ? m_position + 1 : keyframe;
+        QElapsedTimer timer;
+        timer.start();
+        while (timer.nsecsElapsed() < m_frameCost * (frame - start + 1)) {
+        }
+        m_position = frame;
+        QImage image(8, 8, QImage::Format_RGB32);
+        image.fill(uint(frame));
+        return image;
+    }
+
+private:
+    int m_gop;
+    qint64 m_frameCost;
+    int m_position = -1;
+};
+
+struct Results
+{
+    QMutex mutex;
+    std::vector<int> decoded;
+    std::map<int, int> delivered;
+    int cancelled = 0;
+
+    ThumbnailScheduler::Callback callback(int frame)
+    {
+        return [this, frame](const QImage &image, int decodedFrame) {
+            QMutexLocker lock(&mutex);
+            if (image.isNull()) {
+                cancelled++;
+            } else {
+                delivered[frame] = decodedFrame;
+            }
+        };
+    }
+};
+} // namespace
+
+TEST_CASE("Thumbnail requests", "[ThumbnailScheduler]")
+{
+    Results results;
+    // Blocks the first decoded frame until all requests are queued
+    QSemaphore started;
+    QSemaphore gate;
+    const int gateFrame = 500;
+    int created = 0;
+    auto factory = [&](const QString &) {
+        results.mutex.lock();
+        created++;
+        results.mutex.unlock();
+        ThumbnailScheduler::Source source;
+        source.decode = [&](int frame) {
+            if (frame == gateFrame) {
+                started.release();
+                gate.acquire();
+            }
+            QMutexLocker lock(&results.mutex);
+            results.decoded.push_back(frame);
+            QImage image(8, 8, QImage::Format_RGB32);
+            image.fill(uint(frame));
+            return image;
+        };
+        return source;
+    };
+
+    SECTION("Decode order, duplicates and cancellation")
+    {
+        ThumbnailScheduler scheduler(factory, 1);
+        scheduler.request(QStringLiteral("1"), gateFrame, 0, results.callback(gateFrame));
+        started.acquire();
+        scheduler.request(QStringLiteral("1"), 200, 0, results.callback(200));
+        scheduler.request(QStringLiteral("1"), 900, 0, results.callback(900));
+        scheduler.request(QStringLiteral("1"), 100, 0, results.callback(100));
+        auto dropped = scheduler.request(QStringLiteral("1"), 300, 0, results.callback(300));
+        scheduler.request(QStringLiteral("1"), 200, 0, results.callback(-200));
+        scheduler.cancel(dropped);
+        REQUIRE(results.cancelled == 1);
+        gate.release();
+        scheduler.waitForDone();
+        // Forward from the last decoded frame, then from the start
+        REQUIRE(results.decoded == std::vector<int>({gateFrame, 900, 100, 200}));
+        REQUIRE(results.delivered.size() == 5);
+        REQUIRE(results.delivered.at(-200) == 200);
+        const ThumbnailScheduler::Stats stats = scheduler.stats();
+        REQUIRE(stats.requests == 6);
+        REQUIRE(stats.decoded == 4);
+        REQUIRE(stats.coalesced == 1);
+        REQUIRE(stats.cancelled == 1);
+        REQUIRE(stats.sources == 1);
+        REQUIRE(created == 1);
+    }
+
+    SECTION("Imprecise requests")
+    {
+        ThumbnailScheduler scheduler(factory, 1);
+        scheduler.request(QStringLiteral("1"), gateFrame, 0, results.callback(gateFrame));
+        started.acquire();
+        scheduler.request(QStringLiteral("1"), 1048, 5, results.callback(1048));
+        // Accepts the previous request
+        scheduler.request(QStringLiteral("1"), 1060, 12, results.callback(1060));
+        scheduler.request(QStringLiteral("1"), 1070, 0, results.callback(1070));
+        scheduler.request(QStringLiteral("1"), 1072, 2, results.callback(1072));
+        // Too far from the previous request
+        scheduler.request(QStringLiteral("1"), 1080, 5, results.callback(1080));
+        gate.release();
+        scheduler.waitForDone();
+        REQUIRE(results.decoded == std::vector<int>({gateFrame, 1048, 1070, 1080}));
+        REQUIRE(results.delivered.at(1048) == 1048);
+        REQUIRE(results.delivered.at(1060) == 1048);
+        REQUIRE(results.delivered.at(1070) == 1070);
+        REQUIRE(results.delivered.at(1072) == 1070);
+        REQUIRE(results.delivered.at(1080) == 1080);
+        REQUIRE(scheduler.stats().coalesced == 2);
+    }
+
+    SECTION("Producer pool")
+    {
+        ThumbnailScheduler scheduler(factory, 2);
+        for (int i = 0; i < 40; ++i) {
+            scheduler.request(QStringLiteral("1"), i * 10, 0, results.callback(i * 10));
+            scheduler.request(QStringLiteral("2"), i * 10, 0, results.callback(i * 10 + 1));
+        }
+        scheduler.waitForDone();
+        REQUIRE(results.delivered.size() == 80);
+        REQUIRE(created <= 4);
+        REQUIRE(scheduler.stats().sources == created);
+        scheduler.invalidate(QStringLiteral("1"));
+        scheduler.invalidate(QStringLiteral("2"));
+        REQUIRE(scheduler.stats().sources == 0);
+        REQUIRE(scheduler.m_clips.empty());
+        // New producers are created for later requests
+        scheduler.request(QStringLiteral("1"), 0, 0, results.callback(0));
+        scheduler.waitForDone();
+        REQUIRE(scheduler.stats().sources == 1);
+    }
+
+    SECTION("Idle producers are limited")
+    {
+        ThumbnailScheduler scheduler(factory, 1, 2);
+        for (int i = 0; i < 5; ++i) {
+            scheduler.request(QString::number(i), 10, 0, results.callback(i));
+            scheduler.waitForDone();
+        }
+        REQUIRE(results.delivered.size() == 5);
+        REQUIRE(created == 5);
+        ThumbnailScheduler::Stats stats = scheduler.stats();
+        REQUIRE(stats.sources == 2);
+        REQUIRE(stats.idle == 2);
+        REQUIRE(stats.evicted == 3);
+        // The least recently used producers were closed
+        REQUIRE(scheduler.m_clips.size() == 2);
+        REQUIRE(scheduler.m_clips.count(QStringLiteral("3")) == 1);
+        REQUIRE(scheduler.m_clips.count(QStringLiteral("4")) == 1);
+        scheduler.request(QStringLiteral("4"), 20, 0, results.callback(20));
+        scheduler.waitForDone();
+        REQUIRE(created == 5);
+        scheduler.request(QStringLiteral("0"), 20, 0, results.callback(21));
+        scheduler.waitForDone();
+        REQUIRE(created == 6);
+        REQUIRE(scheduler.stats().sources == 2);
+        REQUIRE(scheduler.m_clips.count(QStringLiteral("3")) == 0);
+    }
+}
+
+TEST_CASE("Scroll a long timeline", "[.][Benchmark][ThumbnailScheduler]")
+{
+    // A 2 hour clip at 25 fps with a keyframe every 2 seconds, decoding a frame takes 20us
+    const int duration = 2 * 3600 * 25;
+    const int gop = 50;
+    const qint64 frameCost = 20000;
+    // 24 thumbnails visible, the view scrolled by 4 thumbnails at a time
+    const int visible = 24;
+    const int scrollStep = 4;
+    for (int framesPerThumb : {250, 10}) {
+        const int thumbs = qMin(duration / framesPerThumb, 2000);
+        // Previous behavior: each request seeks the shared producer, and requests scrolled out of view are still decoded
+        QElapsedTimer timer;
+        timer.start();
+        {
+            SimulatedDecoder decoder(gop, frameCost);
+            for (int first = 0; first + visible <= thumbs; first += scrollStep) {
+                const int newThumbs = first == 0 ? visible : scrollStep;
+                for (int i = first + visible - newThumbs; i < first + visible; ++i) {
+                    decoder.decode(i * framesPerThumb);
+                }
+            }
+        }
+        const qint64 sharedTime = timer.nsecsElapsed();
+
+        Results results;
+        ThumbnailScheduler scheduler(
+            [&](const QString &) {
+                auto decoder = std::make_shared<SimulatedDecoder>(gop, frameCost);
+                ThumbnailScheduler::Source source;
+                source.decode = [decoder](int frame) { return decoder->decode(frame); };
+                return source;
+            },
+            2);
+        timer.restart();
+        std::map<int, std::shared_ptr<ThumbnailScheduler::Request>> requests;
+        for (int first = 0; first + visible <= thumbs; first += scrollStep) {
+            for (int i = first; i < first + visible; ++i) {
+                if (requests.count(i) == 0) {
+                    requests[i] = scheduler.request(QStringLiteral("1"), i * framesPerThumb, framesPerThumb / 2, results.callback(i));
+                }
+            }
+            // Thumbnails scrolled out of view
+            while (requests.begin()->first < first) {
+                scheduler.cancel(requests.begin()->second);
+                requests.erase(requests.begin());
+            }
+        }
+        scheduler.waitForDone();
+        const qint64 scheduledTime = timer.nsecsElapsed();
+        const ThumbnailScheduler::Stats stats = scheduler.stats();
+        for (const auto &request : requests) {
+            REQUIRE(results.delivered.count(request.first) == 1);
+        }
+        const int requested = visible + (thumbs - visible) / scrollStep * scrollStep;
+        WARN(framesPerThumb << " frames per thumbnail, " << requested << " thumbnails requested: shared producer " << qint64(requested) * 1000000000 / sharedTime
+                            << " thumbs/s, scheduler " << qint64(results.delivered.size()) * 1000000000 / scheduledTime << " thumbs/s (" << results.delivered.size()
+                            << " delivered, " << stats.decoded << " decoded, " << stats.coalesced << " coalesced, " << stats.cancelled << " cancelled)");
+    }
+}
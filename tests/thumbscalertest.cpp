@@ -0,0 +1,190 @@
+#include "test_utils.hpp"
+
+#include "doc/kthumb.h"
+#include "doc/thumbscaler.hpp"
+
+#include <QElapsedTimer>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+Mlt::Profile profile_thumbscaler;
+
+namespace {
+std::vector<uchar> randomBytes(size_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::vector<uchar> data(size);
+    for (uchar &value : data) {
+        value = uchar(gen() % 256);
+    }
+    return data;
+}
+
+// The previous implementation of KThumb::getFrame
+QImage copySwapScale(const uchar *rgba, int width, int height, int scaledWidth, int scaledHeight)
+{
+    QImage temp(width, height, QImage::Format_ARGB32);
+    memcpy(temp.scanLine(0), rgba, size_t(width * height * 4));
+    if (scaledWidth == width && scaledHeight == height) {
+        return temp.rgbSwapped();
+    }
+    return temp.rgbSwapped().scaled(scaledWidth, scaledHeight);
+}
+
+int referenceChannel(double value)
+{
+    return int(std::lround(qBound(0., value, 255.)));
+}
+} // namespace
+
+TEST_CASE("Thumbnail conversion kernels", "[ThumbScaler]")
+{
+    SECTION("Vectorized conversion matches the scalar version")
+    {
+        for (int width : {2, 6, 14, 16, 30, 256}) {
+            const std::vector<uchar> src = randomBytes(size_t(width) * 5 * 4, unsigned(width));
+            for (int destWidth : {width, width * 2, qMax(1, width / 3)}) {
+                std::vector<QRgb> vectorized(size_t(destWidth) * 3), scalar(size_t(destWidth) * 3);
+                ThumbScaler::fromRgba(src.data(), width, 5, reinterpret_cast<uchar *>(vectorized.data()), destWidth, 3, destWidth * 4);
+                ThumbScaler::fromRgbaScalar(src.data(), width, 5, reinterpret_cast<uchar *>(scalar.data()), destWidth, 3, destWidth * 4);
+                REQUIRE(vectorized == scalar);
+                for (bool rec709 : {false, true}) {
+                    for (bool fullRange : {false, true}) {
+                        ThumbScaler::fromYuv422(src.data(), width, 5, rec709, fullRange, reinterpret_cast<uchar *>(vectorized.data()), destWidth, 3,
+                                                destWidth * 4);
+                        ThumbScaler::fromYuv422Scalar(src.data(), width, 5, rec709, fullRange, reinterpret_cast<uchar *>(scalar.data()), destWidth, 3,
+                                                      destWidth * 4);
+                        REQUIRE(vectorized == scalar);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Same result as the previous RGBA path")
+    {
+        const int width = 254;
+        const int height = 144;
+        const std::vector<uchar> src = randomBytes(size_t(width * height * 4), 1);
+        QImage result(width, height, QImage::Format_ARGB32);
+        ThumbScaler::fromRgba(src.data(), width, height, result.bits(), width, height, result.bytesPerLine());
+        REQUIRE(result == copySwapScale(src.data(), width, height, width, height));
+        // Scaled images sample the source pixel at the center of each destination pixel
+        QImage scaled(341, 100, QImage::Format_ARGB32);
+        ThumbScaler::fromRgba(src.data(), width, height, scaled.bits(), scaled.width(), scaled.height(), scaled.bytesPerLine());
+        const std::vector<int> columns = ThumbScaler::samplePositions(width, scaled.width());
+        const std::vector<int> rows = ThumbScaler::samplePositions(height, scaled.height());
+        REQUIRE(columns.front() == 0);
+        REQUIRE(columns.back() == width - 1);
+        for (int y = 0; y < scaled.height(); ++y) {
+            for (int x = 0; x < scaled.width(); ++x) {
+                REQUIRE(scaled.pixel(x, y) == result.pixel(columns[size_t(x)], rows[size_t(y)]));
+            }
+        }
+    }
+
+    SECTION("YUV conversion accuracy")
+    {
+        const int width = 256;
+        const int height = 16;
+        const std::vector<uchar> src = randomBytes(size_t(width * height * 2), 2);
+        QImage result(width, height, QImage::Format_ARGB32);
+        for (bool rec709 : {false, true}) {
+            for (bool fullRange : {false, true}) {
+                ThumbScaler::fromYuv422(src.data(), width, height, rec709, fullRange, result.bits(), width, height, result.bytesPerLine());
+                const double kr = rec709 ? 0.2126 : 0.299;
+                const double kb = rec709 ? 0.0722 : 0.114;
+                const double kg = 1. - kr - kb;
+                const double lumaScale = fullRange ? 1. : 255. / 219.;
+                const double chromaScale = fullRange ? 1. : 255. / 224.;
+                int maxError = 0;
+                for (int y = 0; y < height; ++y) {
+                    const uchar *line = src.data() + y * width * 2;
+                    for (int x = 0; x < width; ++x) {
+                        const double luma = (line[2 * x] - (fullRange ? 0 : 16)) * lumaScale;
+                        const double u = (line[4 * (x / 2) + 1] - 128) * chromaScale;
+                        const double v = (line[4 * (x / 2) + 3] - 128) * chromaScale;
+                        const QRgb px = result.pixel(x, y);
+                        maxError = qMax(maxError, qAbs(qRed(px) - referenceChannel(luma + 2 * (1 - kr) * v)));
+                        maxError = qMax(maxError, qAbs(qGreen(px) - referenceChannel(luma - (2 * (1 - kb) * kb * u + 2 * (1 - kr) * kr * v) / kg)));
+                        maxError = qMax(maxError, qAbs(qBlue(px) - referenceChannel(luma + 2 * (1 - kb) * u)));
+                        REQUIRE(qAlpha(px) == 255);
+                    }
+                }
+                REQUIRE(maxError <= 3);
+            }
+        }
+    }
+}
+
+TEST_CASE("Thumbnail of a frame", "[ThumbScaler]")
+{
+    Mlt::Producer producer(profile_thumbscaler, "color", "#ff204080");
+    REQUIRE(producer.is_valid());
+    QScopedPointer<Mlt::Frame> frame(producer.get_frame());
+    QImage thumb = KThumb::getFrame(frame.data(), 64, 36, 80);
+    REQUIRE(thumb.size() == QSize(80, 36));
+    REQUIRE(thumb.format() == QImage::Format_ARGB32);
+    REQUIRE(thumb.pixel(40, 18) == qRgba(0x20, 0x40, 0x80, 0xff));
+    frame.reset(producer.get_frame());
+    thumb = KThumb::getFrame(frame.data(), 64, 36);
+    REQUIRE(thumb.size() == QSize(64, 36));
+}
+
+TEST_CASE("Thumbnail conversion", "[.][Benchmark][ThumbScaler]")
+{
+    WARN("Conversion kernel: " << ThumbScaler::instructionSet());
+    const int thumbWidth = 256;
+    const int thumbHeight = 144;
+    const int count = 50;
+    for (const QSize &source : {QSize(1920, 1080), QSize(3840, 2160)}) {
+        // Frames MLT could not scale, converted to a thumbnail
+        const std::vector<uchar> rgba = randomBytes(size_t(source.width() * source.height() * 4), 3);
+        const std::vector<uchar> yuv = randomBytes(size_t(source.width() * source.height() * 2), 4);
+        QElapsedTimer timer;
+        timer.start();
+        qint64 previousBytes = 0;
+        for (int i = 0; i < count; ++i) {
+            QImage thumb = copySwapScale(rgba.data(), source.width(), source.height(), thumbWidth, thumbHeight);
+            // The copy, its swapped version and the scaled image
+            previousBytes = 2 * qint64(source.width()) * source.height() * 4 + thumb.sizeInBytes();
+        }
+        const qint64 previous = timer.nsecsElapsed();
+        timer.restart();
+        qint64 bytes = 0;
+        for (int i = 0; i < count; ++i) {
+            QImage thumb(thumbWidth, thumbHeight, QImage::Format_ARGB32);
+            ThumbScaler::fromRgba(rgba.data(), source.width(), source.height(), thumb.bits(), thumbWidth, thumbHeight, thumb.bytesPerLine());
+            bytes = thumb.sizeInBytes();
+        }
+        const qint64 fusedRgba = timer.nsecsElapsed();
+        timer.restart();
+        for (int i = 0; i < count; ++i) {
+            QImage thumb(thumbWidth, thumbHeight, QImage::Format_ARGB32);
+            ThumbScaler::fromYuv422(yuv.data(), source.width(), source.height(), true, false, thumb.bits(), thumbWidth, thumbHeight, thumb.bytesPerLine());
+        }
+        const qint64 fusedYuv = timer.nsecsElapsed();
+        WARN(source.width() << "x" << source.height() << " to " << thumbWidth << "x" << thumbHeight << ": previous " << qint64(count) * 1000000000 / previous
+                            << " thumbs/s (" << previousBytes / 1024 << "kB allocated), fused RGBA " << qint64(count) * 1000000000 / fusedRgba
+                            << " thumbs/s, fused YUV " << qint64(count) * 1000000000 / fusedYuv << " thumbs/s (" << bytes / 1024 << "kB allocated)");
+    }
+
+    // Frames already scaled by MLT to the thumbnail height, only converted
+    const std::vector<uchar> rgba = randomBytes(size_t(thumbWidth * thumbHeight * 4), 5);
+    const std::vector<uchar> yuv = randomBytes(size_t(thumbWidth * thumbHeight * 2), 6);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count * 20; ++i) {
+        copySwapScale(rgba.data(), thumbWidth, thumbHeight, thumbWidth, thumbHeight);
+    }
+    const qint64 previous = timer.nsecsElapsed();
+    timer.restart();
+    for (int i = 0; i < count * 20; ++i) {
+        QImage thumb(thumbWidth, thumbHeight, QImage::Format_ARGB32);
+        ThumbScaler::fromYuv422(yuv.data(), thumbWidth, thumbHeight, true, false, thumb.bits(), thumbWidth, thumbHeight, thumb.bytesPerLine());
+    }
+    const qint64 fused = timer.nsecsElapsed();
+    WARN(thumbWidth << "x" << thumbHeight << " frame: previous " << qint64(count) * 20 * 1000000000 / previous << " thumbs/s, fused YUV "
+                    << qint64(count) * 20 * 1000000000 / fused << " thumbs/s");
+}
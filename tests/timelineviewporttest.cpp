@@ -0,0 +1,256 @@
+#include "test_utils.hpp"
+
+#include "timeline2/view/timelineviewportmodel.hpp"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
+#include <QSortFilterProxyModel>
+#include <unistd.h>
+
+Mlt::Profile profile_viewport;
+
+namespace {
+// Reference implementation: scan all the clips of the timeline
+std::unordered_set<int> scanItemsInRange(const std::shared_ptr<TimelineItemModel> &timeline, int start, int end)
+{
+    std::unordered_set<int> ids;
+    for (const auto &clp : timeline->m_allClips) {
+        int pos = clp.second->getPosition();
+        if (pos < end && pos + clp.second->getPlaytime() > start) {
+            ids.insert(clp.first);
+        }
+    }
+    return ids;
+}
+
+std::unordered_set<int> shownItems(QAbstractProxyModel &proxy, const std::shared_ptr<TimelineItemModel> &timeline)
+{
+    std::unordered_set<int> ids;
+    for (int trackId : timeline->getAllTracksIds()) {
+        QModelIndex track = proxy.mapFromSource(timeline->makeTrackIndexFromID(trackId));
+        for (int row = 0; row < proxy.rowCount(track); ++row) {
+            ids.insert(int(proxy.mapToSource(proxy.index(row, 0, track)).internalId()));
+        }
+    }
+    return ids;
+}
+
+qint64 residentMemory()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+}
+
+// Tracks and clips laid out like timeline.qml, each clip with a few children standing for its thumbnails and waveform
+const char *timelineQml = R"(
+import QtQuick 2.11
+import QtQml.Models 2.11
+
+Item {
+    id: root
+    property int delegates: 0
+    DelegateModel {
+        id: tracks
+        model: multitrack
+        delegate: Item {
+            DelegateModel {
+                id: clips
+                model: multitrack
+                rootIndex: tracks.modelIndex(index)
+                delegate: Rectangle {
+                    x: model.start
+                    width: model.duration
+                    height: 50
+                    Component.onCompleted: root.delegates++
+                    Component.onDestruction: root.delegates--
+                    Text { text: model.name }
+                    Row {
+                        Repeater {
+                            model: 4
+                            Rectangle { width: 10; height: 10 }
+                        }
+                    }
+                    Rectangle { anchors.bottom: parent.bottom; width: parent.width; height: 10 }
+                }
+            }
+            Repeater { model: clips }
+        }
+    }
+    Repeater { model: tracks }
+}
+)";
+} // namespace
+
+TEST_CASE("Timeline viewport", "[TimelineViewport]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_viewport, guideModel, undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    QString binId = createProducer(profile_viewport, "red", binModel, 20);
+    int tid1, tid2;
+    REQUIRE(timeline->requestTrackInsertion(-1, tid1));
+    REQUIRE(timeline->requestTrackInsertion(-1, tid2));
+
+    // 100 clips of 20 frames separated by gaps of 5 frames on the first track
+    std::vector<int> clips;
+    for (int i = 0; i < 100; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid1, i * 25, cid));
+        clips.push_back(cid);
+    }
+
+    TimelineViewportModel viewport;
+    viewport.setTimelineModel(timeline);
+    // Nothing is exposed until the view gives its visible range
+    REQUIRE(viewport.rowCount() == 2);
+    REQUIRE(shownItems(viewport, timeline).empty());
+
+    // The range is extended by its length on each side
+    viewport.setVisibleRange(500, 600);
+    REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 400, 700));
+    REQUIRE(timeline->getViewItemsInRange(400, 700) == scanItemsInRange(timeline, 400, 700));
+    REQUIRE(viewport.stats().shown == 12);
+    REQUIRE(viewport.stats().refreshes == 1);
+
+    SECTION("Scrolling in the margin keeps the delegates")
+    {
+        viewport.setVisibleRange(420, 520);
+        viewport.setVisibleRange(580, 680);
+        REQUIRE(viewport.stats().refreshes == 1);
+        REQUIRE(viewport.stats().skipped == 2);
+        REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 400, 700));
+        viewport.setVisibleRange(900, 1000);
+        REQUIRE(viewport.stats().refreshes == 2);
+        REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 800, 1100));
+        // Zooming in releases the delegates
+        viewport.setVisibleRange(950, 960);
+        REQUIRE(viewport.stats().refreshes == 3);
+        REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 940, 970));
+        // Past the end of the timeline, the exposed items do not change
+        viewport.setVisibleRange(3000, 3100);
+        REQUIRE(shownItems(viewport, timeline).empty());
+        viewport.setVisibleRange(5000, 5100);
+        REQUIRE(viewport.stats().refreshes == 4);
+        REQUIRE(viewport.stats().skipped == 3);
+    }
+
+    SECTION("Items moved in and out of the range")
+    {
+        REQUIRE(timeline->requestClipMove(clips[0], tid2, 450));
+        REQUIRE(shownItems(viewport, timeline).count(clips[0]) == 1);
+        REQUIRE(timeline->requestClipMove(clips[20], tid2, 2600));
+        REQUIRE(shownItems(viewport, timeline).count(clips[20]) == 0);
+        REQUIRE(timeline->requestClipMove(clips[0], tid2, 2500));
+        REQUIRE(timeline->requestItemDeletion(clips[21]));
+        REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 400, 700));
+        REQUIRE(viewport.stats().shown == 10);
+        undoStack->undo();
+        undoStack->undo();
+        undoStack->undo();
+        undoStack->undo();
+        REQUIRE(shownItems(viewport, timeline) == scanItemsInRange(timeline, 400, 700));
+        REQUIRE(viewport.stats().shown == 12);
+        // Dragging an item in overwrite mode does not move it in the model
+        REQUIRE(timeline->requestFakeClipMove(clips[50], tid2, 1500, true, false, false));
+        REQUIRE(shownItems(viewport, timeline).count(clips[50]) == 0);
+        REQUIRE(timeline->requestFakeClipMove(clips[50], tid2, 600, true, false, false));
+        REQUIRE(shownItems(viewport, timeline).count(clips[50]) == 1);
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Scroll a timeline with 20000 clips", "[.][Benchmark][TimelineViewport]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_viewport, guideModel, undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    // 4 tracks of 5000 clips of 20 frames separated by gaps of 5 frames
+    QString binId = createProducer(profile_viewport, "red", binModel, 20);
+    const int clipsPerTrack = 5000;
+    for (int t = 0; t < 4; ++t) {
+        int tid;
+        REQUIRE(timeline->requestTrackInsertion(-1, tid));
+        for (int i = 0; i < clipsPerTrack; ++i) {
+            int cid;
+            REQUIRE(timeline->requestClipInsertion(binId, tid, i * 25, cid, false));
+        }
+    }
+
+    // 1000 frames visible, scrolled by 100 frames at a time
+    const int visible = 1000;
+    const int step = 100;
+    const int steps = 500;
+    for (bool virtualized : {false, true}) {
+        std::unique_ptr<QSortFilterProxyModel> proxy;
+        if (virtualized) {
+            auto viewport = std::make_unique<TimelineViewportModel>();
+            viewport->setTimelineModel(timeline);
+            viewport->setVisibleRange(0, visible);
+            proxy = std::move(viewport);
+        } else {
+            // Previous behavior: all items are exposed to the view
+            proxy = std::make_unique<QSortFilterProxyModel>();
+            proxy->setSourceModel(timeline.get());
+        }
+        QQmlEngine engine;
+        engine.rootContext()->setContextProperty(QStringLiteral("multitrack"), proxy.get());
+        QQmlComponent component(&engine);
+        component.setData(timelineQml, QUrl());
+        const qint64 memory = residentMemory();
+        QElapsedTimer timer;
+        timer.start();
+        std::unique_ptr<QObject> view(component.create());
+        REQUIRE(view);
+        const qint64 loadTime = timer.elapsed();
+        const qint64 viewMemory = residentMemory() - memory;
+        const int delegates = view->property("delegates").toInt();
+
+        WARN((virtualized ? "Viewport model: " : "All items: ") << delegates << " delegates created in " << loadTime << "ms using " << viewMemory / 1024
+                                                                 << "kB");
+        if (virtualized) {
+            auto *viewport = static_cast<TimelineViewportModel *>(proxy.get());
+            // Time spent creating and destroying delegates for each scroll step
+            qint64 worstStep = 0;
+            timer.restart();
+            for (int i = 1; i <= steps; ++i) {
+                QElapsedTimer frame;
+                frame.start();
+                viewport->setVisibleRange(i * step, i * step + visible);
+                worstStep = qMax(worstStep, frame.nsecsElapsed());
+            }
+            const qint64 scrollTime = timer.nsecsElapsed();
+            const TimelineViewportModel::Stats stats = viewport->stats();
+            WARN("Scroll step " << scrollTime / steps / 1000 << "us on average, " << worstStep / 1000 << "us at worst, " << stats.refreshes << " refreshes, "
+                                << stats.skipped << " skipped, " << view->property("delegates").toInt() << " delegates after scrolling");
+        }
+        view.reset();
+        QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
@@ -0,0 +1,156 @@
+#include "test_utils.hpp"
+
+Mlt::Profile profile_trackindex;
+
+namespace {
+// Reference implementation: scan all the clips of the track
+std::unordered_set<int> scanClipsInRange(const std::shared_ptr<TrackModel> &track, int position, int end)
+{
+    std::unordered_set<int> ids;
+    for (const auto &clp : track->m_allClips) {
+        int pos = clp.second->getPosition();
+        int length = clp.second->getPlaytime();
+        if (end > -1 && pos >= end) {
+            continue;
+        }
+        if (pos >= position || pos + length - 1 >= position) {
+            ids.insert(clp.first);
+        }
+    }
+    return ids;
+}
+
+void checkRows(const std::shared_ptr<TrackModel> &track)
+{
+    int row = 0;
+    for (const auto &clp : track->m_allClips) {
+        REQUIRE(track->getRowfromClip(clp.first) == row);
+        REQUIRE(track->getClipByRow(row) == clp.first);
+        row++;
+    }
+    REQUIRE(track->getClipByRow(row) == -1);
+}
+} // namespace
+
+TEST_CASE("Track position index", "[TrackModel]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_trackindex, guideModel, undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    QString binId = createProducer(profile_trackindex, "red", binModel, 20);
+    int tid;
+    REQUIRE(timeline->requestTrackInsertion(-1, tid));
+    auto track = timeline->getTrackById(tid);
+
+    // 50 clips of 20 frames separated by gaps of 5 frames
+    std::vector<int> clips;
+    for (int i = 0; i < 50; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, i * 25, cid));
+        clips.push_back(cid);
+    }
+    REQUIRE(timeline->checkConsistency());
+
+    auto checkRanges = [&]() {
+        for (int position = 0; position < 1300; position += 7) {
+            for (int length : {1, 5, 20, 60}) {
+                REQUIRE(track->getClipsInRange(position, position + length) == scanClipsInRange(track, position, position + length));
+            }
+            REQUIRE(track->getClipsInRange(position) == scanClipsInRange(track, position, -1));
+        }
+        checkRows(track);
+    };
+
+    SECTION("Range queries match a full scan")
+    {
+        checkRanges();
+        REQUIRE(track->getClipsInRange(21, 24).empty());
+        REQUIRE(track->getClipsInRange(19, 20) == std::unordered_set<int>({clips[0]}));
+        REQUIRE(track->getClipsInRange(19, 26) == std::unordered_set<int>({clips[0], clips[1]}));
+    }
+
+    SECTION("Index follows moves, resizes and deletions")
+    {
+        REQUIRE(timeline->requestClipMove(clips[3], tid, 2000));
+        REQUIRE(timeline->requestItemResize(clips[10], 10, false) == 10);
+        REQUIRE(timeline->requestItemResize(clips[11], 12, true) == 12);
+        REQUIRE(timeline->requestItemDeletion(clips[20]));
+        REQUIRE(timeline->checkConsistency());
+        checkRanges();
+        REQUIRE(track->getClipsInRange(1990, 2010) == std::unordered_set<int>({clips[3]}));
+
+        undoStack->undo();
+        undoStack->undo();
+        undoStack->undo();
+        REQUIRE(timeline->checkConsistency());
+        checkRanges();
+        undoStack->undo();
+        REQUIRE(timeline->checkConsistency());
+        checkRanges();
+        REQUIRE(track->getClipsInRange(75, 76) == std::unordered_set<int>({clips[3]}));
+    }
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
+
+TEST_CASE("Range queries on a large track", "[.][Benchmark][TrackModel]")
+{
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_trackindex, guideModel, undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    QString binId = createProducer(profile_trackindex, "red", binModel, 20);
+    int tid;
+    REQUIRE(timeline->requestTrackInsertion(-1, tid));
+    auto track = timeline->getTrackById(tid);
+
+    // A multicam-like edit: 10000 cuts of 10 frames
+    const int count = 10000;
+    std::vector<int> clips;
+    clips.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, i * 10, cid, false));
+        REQUIRE(timeline->requestItemResize(cid, 10, true, false) == 10);
+        clips.push_back(cid);
+    }
+    REQUIRE(track->getClipsCount() == count);
+
+    size_t found = 0;
+    BENCHMARK("1000 range queries, full scan")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            found += scanClipsInRange(track, i * 97, i * 97 + 250).size();
+        }
+    }
+    BENCHMARK("1000 range queries, position index")
+    {
+        for (int i = 0; i < 1000; ++i) {
+            found += track->getClipsInRange(i * 97, i * 97 + 250).size();
+        }
+    }
+    BENCHMARK("Row of every clip")
+    {
+        for (int cid : clips) {
+            found += size_t(track->getRowfromClip(cid));
+        }
+    }
+    REQUIRE(found > 0);
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}
@@ -0,0 +1,166 @@
+#include "catch.hpp"
+#include "audiomixer/tracklevels.hpp"
+#include "utils/spscringbuffer.hpp"
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QPair>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Lock-free ring buffer", "[TrackLevels]")
+{
+    SECTION("Values are read in order and dropped when full")
+    {
+        SpscRingBuffer<int> queue(5);
+        REQUIRE(queue.capacity() == 8);
+        for (int i = 0; i < 10; ++i) {
+            REQUIRE(queue.push(i) == (i < 8));
+        }
+        REQUIRE(queue.size() == 8);
+        REQUIRE(queue.dropped() == 2);
+        int value = -1;
+        REQUIRE(queue.pop(value));
+        REQUIRE(value == 0);
+        int expected = 1;
+        REQUIRE(queue.drain([&expected](int v) { REQUIRE(v == expected++); }) == 7);
+        REQUIRE_FALSE(queue.pop(value));
+        REQUIRE(queue.push(10));
+        queue.discard();
+        REQUIRE(queue.size() == 0);
+    }
+
+    SECTION("Producer and consumer threads")
+    {
+        SpscRingBuffer<int> queue(64);
+        const int count = 100000;
+        std::atomic<bool> done{false};
+        std::thread producer([&queue, &done]() {
+            for (int i = 0; i < count;) {
+                if (queue.push(i)) {
+                    ++i;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            done = true;
+        });
+        int expected = 0;
+        bool ordered = true;
+        while (!done || queue.size() > 0) {
+            if (queue.drain([&expected, &ordered](int v) { ordered = ordered && v == expected++; }) == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        REQUIRE(ordered);
+        REQUIRE(expected == count);
+    }
+}
+
+TEST_CASE("Track levels", "[TrackLevels]")
+{
+    TrackLevels levels(30);
+    TrackLevels::Meter meter;
+
+    SECTION("Displayed frame")
+    {
+        levels.store(10, 0.5, 0.25);
+        REQUIRE(levels.collect(10, meter));
+        REQUIRE(meter.frames == 1);
+        REQUIRE(meter.rms[0] == Approx(0.5));
+        REQUIRE(meter.peak[1] == Approx(0.25));
+        REQUIRE_FALSE(levels.collect(11, meter));
+    }
+
+    SECTION("Frames since the last collect are summed up")
+    {
+        levels.store(0, 0.1, 0.1);
+        REQUIRE(levels.collect(0, meter));
+        // Rendered ahead of the display
+        for (int i = 1; i <= 5; ++i) {
+            levels.store(i, 0.2 * i, 0.1);
+        }
+        REQUIRE(levels.collect(3, meter));
+        REQUIRE(meter.frames == 3);
+        REQUIRE(meter.peak[0] == Approx(0.6));
+        REQUIRE(meter.rms[0] == Approx(std::sqrt((0.04 + 0.16 + 0.36) / 3)));
+        REQUIRE(meter.rms[1] == Approx(0.1));
+        REQUIRE(levels.collect(5, meter));
+        REQUIRE(meter.frames == 2);
+        REQUIRE(meter.peak[0] == Approx(1.0));
+    }
+
+    SECTION("Seek only shows the displayed frame")
+    {
+        levels.store(100, 0.9, 0.9);
+        REQUIRE(levels.collect(100, meter));
+        levels.store(50, 0.3, 0.3);
+        levels.store(51, 0.4, 0.4);
+        REQUIRE(levels.collect(51, meter));
+        REQUIRE(meter.frames == 1);
+        REQUIRE(meter.peak[0] == Approx(0.4));
+    }
+
+    SECTION("Clear")
+    {
+        levels.store(1, 0.5, 0.5);
+        levels.fetch();
+        levels.store(2, 0.5, 0.5);
+        levels.clear();
+        REQUIRE_FALSE(levels.collect(1, meter));
+        REQUIRE_FALSE(levels.collect(2, meter));
+    }
+}
+
+TEST_CASE("Mixer levels from the consumer thread", "[.][Benchmark][TrackLevels]")
+{
+    // 40 tracks, 10 minutes at 25 fps
+    const int tracks = 40;
+    const int frames = 15000;
+    const int maxLevels = 38;
+    QElapsedTimer timer;
+    timer.start();
+    {
+        // Previous storage: one map per track, trimmed from the front
+        std::vector<QMap<int, QPair<double, double>>> maps(tracks);
+        for (int pos = 0; pos < frames; ++pos) {
+            for (auto &map : maps) {
+                if (!map.contains(pos)) {
+                    map[pos] = {0.5, 0.5};
+                    if (map.size() > maxLevels) {
+                        map.erase(map.begin());
+                    }
+                }
+            }
+        }
+    }
+    const qint64 mapTime = timer.nsecsElapsed();
+    timer.restart();
+    std::vector<std::unique_ptr<TrackLevels>> levels;
+    for (int i = 0; i < tracks; ++i) {
+        levels.emplace_back(new TrackLevels(maxLevels));
+    }
+    TrackLevels::Meter meter;
+    for (int pos = 0; pos < frames; ++pos) {
+        for (auto &track : levels) {
+            track->store(pos, 0.5, 0.5);
+        }
+        if (pos % 8 == 0) {
+            // GUI refresh
+            for (auto &track : levels) {
+                track->collect(pos, meter);
+            }
+        }
+    }
+    const qint64 queueTime = timer.nsecsElapsed();
+    size_t dropped = 0;
+    for (auto &track : levels) {
+        dropped += track->dropped();
+    }
+    REQUIRE(dropped == 0);
+    WARN(tracks << " tracks, " << frames << " frames, per frame: map " << mapTime / frames << "ns, lock-free queue " << queueTime / frames << "ns");
+}
@@ -0,0 +1,230 @@
+#include "test_utils.hpp"
+
+#include "macros.hpp"
+#include "undohelper.hpp"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <unistd.h>
+
+Mlt::Profile profile_undohelper;
+
+namespace {
+// The previous implementation of PUSH_LAMBDA, PUSH_FRONT_LAMBDA and UPDATE_UNDO_REDO_NOLOCK, nesting closures
+void nestedPushBack(Fun &lambda, const Fun &operation, bool shortCircuit)
+{
+    if (shortCircuit) {
+        lambda = [lambda, operation]() {
+            bool v = lambda();
+            return v && operation();
+        };
+    } else {
+        lambda = [operation, lambda]() {
+            bool v = lambda();
+            return operation() && v;
+        };
+    }
+}
+
+void nestedPushFront(Fun &lambda, const Fun &operation, bool shortCircuit)
+{
+    if (shortCircuit) {
+        lambda = [lambda, operation]() {
+            bool v = operation();
+            return v && lambda();
+        };
+    } else {
+        lambda = [operation, lambda]() {
+            bool v = operation();
+            return lambda() && v;
+        };
+    }
+}
+
+qint64 residentMemory()
+{
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) : 0;
+}
+} // namespace
+
+TEST_CASE("Undo transaction", "[UndoHelper]")
+{
+    std::vector<int> trace;
+    auto op = [&trace](int id, bool success = true) {
+        return [&trace, id, success]() {
+            trace.push_back(id);
+            return success;
+        };
+    };
+    Fun undo = op(0);
+    Fun redo = op(0);
+
+    SECTION("Operations order")
+    {
+        PUSH_LAMBDA(op(1), redo);
+        PUSH_LAMBDA(op(2), redo);
+        PUSH_FRONT_LAMBDA(op(1), undo);
+        PUSH_FRONT_LAMBDA(op(2), undo);
+        UndoTransaction::pushBack(redo, op(3), false);
+        UndoTransaction::pushFront(undo, op(3), false);
+        REQUIRE(UndoTransaction::size(redo) == 4);
+        REQUIRE(UndoTransaction::size(undo) == 4);
+        REQUIRE(UndoTransaction::size(op(0)) == 1);
+        REQUIRE(redo());
+        REQUIRE(trace == std::vector<int>({0, 1, 2, 3}));
+        trace.clear();
+        REQUIRE(undo());
+        REQUIRE(trace == std::vector<int>({3, 2, 1, 0}));
+    }
+
+    SECTION("Failures")
+    {
+        // A failing short circuit operation stops the operations pushed before it, but not the ones pushed after without short circuit
+        PUSH_FRONT_LAMBDA(op(1), undo);
+        PUSH_FRONT_LAMBDA(op(2, false), undo);
+        UndoTransaction::pushBack(undo, op(3), false);
+        PUSH_LAMBDA(op(4), undo);
+        UndoTransaction::pushFront(undo, op(5), false);
+        REQUIRE_FALSE(undo());
+        REQUIRE(trace == std::vector<int>({5, 2, 3}));
+    }
+
+    SECTION("Copies share the operations until modified")
+    {
+        PUSH_LAMBDA(op(1), redo);
+        Fun copy = redo;
+        PUSH_LAMBDA(op(2), redo);
+        PUSH_LAMBDA(op(3), copy);
+        // Pushing a transaction into itself
+        PUSH_LAMBDA(copy, copy);
+        REQUIRE(redo());
+        REQUIRE(copy());
+        REQUIRE(trace == std::vector<int>({0, 1, 2, 0, 1, 3, 0, 1, 3}));
+    }
+
+    SECTION("Same result as nested closures")
+    {
+        std::mt19937 gen(42);
+        for (int round = 0; round < 500; ++round) {
+            std::vector<int> nestedTrace;
+            auto nestedOp = [&nestedTrace](int id, bool success) {
+                return [&nestedTrace, id, success]() {
+                    nestedTrace.push_back(id);
+                    return success;
+                };
+            };
+            const bool initial = gen() % 4 != 0;
+            Fun nested = nestedOp(0, initial);
+            Fun flat = op(0, initial);
+            trace.clear();
+            const int count = int(gen() % 30);
+            for (int i = 1; i <= count; ++i) {
+                const bool success = gen() % 4 != 0;
+                const bool front = gen() % 2 == 0;
+                const bool shortCircuit = gen() % 2 == 0;
+                if (front) {
+                    nestedPushFront(nested, nestedOp(i, success), shortCircuit);
+                    UndoTransaction::pushFront(flat, op(i, success), shortCircuit);
+                } else {
+                    nestedPushBack(nested, nestedOp(i, success), shortCircuit);
+                    UndoTransaction::pushBack(flat, op(i, success), shortCircuit);
+                }
+            }
+            REQUIRE(nested() == flat());
+            REQUIRE(nestedTrace == trace);
+        }
+    }
+}
+
+TEST_CASE("Undo a large group move", "[.][Benchmark][UndoHelper]")
+{
+    // Operations capturing a few values, as the model lambdas do
+    const int count = 10000;
+    std::vector<int> positions(count, 0);
+    auto move = [&positions](int id, int delta) {
+        return [&positions, id, delta]() {
+            positions[size_t(id)] += delta;
+            return true;
+        };
+    };
+    for (bool flat : {false, true}) {
+        const qint64 memory = residentMemory();
+        QElapsedTimer timer;
+        timer.start();
+        Fun undo = []() { return true; };
+        Fun redo = []() { return true; };
+        for (int i = 0; i < count; ++i) {
+            if (flat) {
+                UPDATE_UNDO_REDO_NOLOCK(move(i, 10), move(i, -10), undo, redo);
+            } else {
+                nestedPushFront(undo, move(i, -10), false);
+                nestedPushBack(redo, move(i, 10), false);
+            }
+        }
+        const qint64 buildTime = timer.nsecsElapsed();
+        const qint64 buildMemory = residentMemory() - memory;
+        timer.restart();
+        REQUIRE(undo());
+        const qint64 undoTime = timer.nsecsElapsed();
+        timer.restart();
+        REQUIRE(redo());
+        const qint64 redoTime = timer.nsecsElapsed();
+        REQUIRE(std::all_of(positions.begin(), positions.end(), [](int pos) { return pos == 0; }));
+        WARN((flat ? "Transaction: " : "Nested closures: ") << count << " operations recorded in " << buildTime / 1000 << "us using " << buildMemory / 1024
+                                                            << "kB, undo " << undoTime / 1000 << "us, redo " << redoTime / 1000 << "us");
+    }
+
+    // The same size in the timeline
+    auto binModel = pCore->projectItemModel();
+    binModel->clean();
+    std::shared_ptr<DocUndoStack> undoStack = std::make_shared<DocUndoStack>(nullptr);
+    std::shared_ptr<MarkerListModel> guideModel = std::make_shared<MarkerListModel>(undoStack);
+    std::shared_ptr<TimelineItemModel> timeline = TimelineItemModel::construct(&profile_undohelper, guideModel, undoStack);
+
+    Mock<ProjectManager> pmMock;
+    When(Method(pmMock, undoStack)).AlwaysReturn(undoStack);
+    ProjectManager &mocked = pmMock.get();
+    pCore->m_projectManager = &mocked;
+
+    QString binId = createProducer(profile_undohelper, "red", binModel, 20);
+    int tid;
+    REQUIRE(timeline->requestTrackInsertion(-1, tid));
+    std::unordered_set<int> clips;
+    for (int i = 0; i < count; ++i) {
+        int cid;
+        REQUIRE(timeline->requestClipInsertion(binId, tid, i * 20, cid, false));
+        clips.insert(cid);
+    }
+    const int gid = timeline->requestClipsGroup(clips, false);
+    REQUIRE(gid > 0);
+    const int first = *clips.begin();
+    const int position = timeline->getClipPosition(first);
+
+    const qint64 memory = residentMemory();
+    QElapsedTimer timer;
+    timer.start();
+    Fun undo = []() { return true; };
+    Fun redo = []() { return true; };
+    REQUIRE(timeline->requestGroupMove(first, gid, 0, 100, false, true, undo, redo));
+    const qint64 moveTime = timer.elapsed();
+    const qint64 moveMemory = residentMemory() - memory;
+    REQUIRE(timeline->getClipPosition(first) == position + 100);
+    timer.restart();
+    REQUIRE(undo());
+    const qint64 undoTime = timer.elapsed();
+    REQUIRE(timeline->getClipPosition(first) == position);
+    timer.restart();
+    REQUIRE(redo());
+    const qint64 redoTime = timer.elapsed();
+    REQUIRE(timeline->getClipPosition(first) == position + 100);
+    WARN("Timeline: group move of " << count << " clips in " << moveTime << "ms using " << moveMemory / 1024 << "kB, " << UndoTransaction::size(undo)
+                                     << " undo operations, undo " << undoTime << "ms, redo " << redoTime << "ms");
+    binModel->clean();
+    pCore->m_projectManager = nullptr;
+}